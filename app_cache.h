@@ -0,0 +1,204 @@
+/*
+ * Warm App Cache
+ *
+ * Keeps recently used apps resident after they are closed so switching
+ * back to them skips the SD card.
+ * - Entries are keyed by code file path and hold either a paged image
+ *   (.pbc and other code files) or a linked native module (.o)
+ * - A running app pins its entry; only unpinned entries are evicted
+ * - Least recently used entries are evicted when the cache exceeds
+ *   APP_CACHE_BUDGET bytes or the memory backing the pages (PSRAM when
+ *   fitted) drops below APP_CACHE_HEAP_WATERMARK; freed pages are then
+ *   returned to the heap
+ *
+ * Loads and evictions run on the worker core. The UI task only pins
+ * and unpins entries and asks the worker to enforce the limits.
+ *
+ * File: app_cache.h
+ */
+
+#ifndef APP_CACHE_H
+#define APP_CACHE_H
+
+#include <atomic>
+#include "app_pages.h"
+#include "native_module_loader.h"
+#include "task_model.h"
+
+#ifndef APP_CACHE_SLOTS
+#define APP_CACHE_SLOTS           4
+#endif
+#ifndef APP_CACHE_BUDGET
+#define APP_CACHE_BUDGET          (192 * 1024)   // Resident code bytes
+#endif
+#ifndef APP_CACHE_HEAP_WATERMARK
+#define APP_CACHE_HEAP_WATERMARK  (64 * 1024)    // Evict below this free page memory
+#endif
+
+struct AppCacheEntry {
+    char path[64];
+    bool used;
+    bool native;
+    std::atomic<uint8_t> pins;  // Running instances, pinned by the worker, unpinned by the UI
+    uint32_t lastUse;           // appCacheClock when last acquired
+    uint32_t bytes;
+    AppImage image;             // Non-native apps
+    NativeModule module;        // Native apps
+};
+
+struct AppCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t pressureEvictions; // Evictions caused by the heap watermark
+    uint32_t bytes;             // Currently resident
+};
+
+static AppCacheEntry appCache[APP_CACHE_SLOTS];
+static AppCacheStats appCacheStats = {0, 0, 0, 0, 0};
+static uint32_t appCacheClock = 0;
+
+static AppCacheEntry * appCacheFind(const char * path) {
+    for (int i = 0; i < APP_CACHE_SLOTS; i++) {
+        if (appCache[i].used && strcmp(appCache[i].path, path) == 0) return &appCache[i];
+    }
+    return NULL;
+}
+
+// Launcher indicator, safe from the UI task
+bool appCacheContains(const char * path) {
+    return appCacheFind(path) != NULL;
+}
+
+// Free memory of the heap pages are taken from, PSRAM when the board has
+// it (see appPageAlloc), internal RAM otherwise
+static size_t appCacheFreeHeap() {
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0) return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+static void appCacheEvict(AppCacheEntry * e) {
+    Serial.printf("App cache: evict %s (%lu bytes)\n", e->path, e->bytes);
+    if (e->native) nativeModuleUnload(&e->module);
+    else appImageFree(&e->image);
+    appCacheStats.bytes -= e->bytes;
+    appCacheStats.evictions++;
+    e->used = false;
+    e->path[0] = '\0';
+}
+
+static AppCacheEntry * appCacheLeastRecent() {
+    AppCacheEntry * victim = NULL;
+    for (int i = 0; i < APP_CACHE_SLOTS; i++) {
+        AppCacheEntry &e = appCache[i];
+        if (e.used && e.pins == 0 && (!victim || e.lastUse < victim->lastUse)) victim = &e;
+    }
+    return victim;
+}
+
+// Evict until within budget and above the heap watermark (worker core)
+void appCacheEnforce() {
+    bool evicted = false;
+    for (;;) {
+        bool overBudget = appCacheStats.bytes > APP_CACHE_BUDGET;
+        bool lowHeap = appCacheFreeHeap() < APP_CACHE_HEAP_WATERMARK;
+        if (!overBudget && !lowHeap) break;
+
+        AppCacheEntry * victim = appCacheLeastRecent();
+        if (!victim) break;
+        if (lowHeap && !overBudget) appCacheStats.pressureEvictions++;
+        appCacheEvict(victim);
+        evicted = true;
+
+        // Pages only help the heap once they leave the pool
+        if (lowHeap) appPagePoolTrim();
+    }
+    if (evicted && appCacheFreeHeap() < APP_CACHE_HEAP_WATERMARK) appPagePoolTrim();
+}
+
+static void appCacheEnforceJob(void * arg) {
+    appCacheEnforce();
+}
+
+// Drop every unpinned entry, e.g. after /apps changed (worker core)
+void appCacheFlush() {
+    for (int i = 0; i < APP_CACHE_SLOTS; i++) {
+        if (appCache[i].used && appCache[i].pins == 0) appCacheEvict(&appCache[i]);
+    }
+}
+
+// Return a pinned entry for path, loading it on a miss (worker core)
+AppCacheEntry * appCacheAcquire(const char * path, bool native,
+                                AppLoadProgressFunc progress, void * user) {
+    AppCacheEntry * e = appCacheFind(path);
+    if (e) {
+        appCacheStats.hits++;
+        e->pins++;
+        e->lastUse = ++appCacheClock;
+        if (progress) progress(user, e->bytes, e->bytes);
+        return e;
+    }
+    appCacheStats.misses++;
+
+    // Free slot, or the least recently used unpinned one
+    for (int i = 0; i < APP_CACHE_SLOTS && !e; i++) {
+        if (!appCache[i].used) e = &appCache[i];
+    }
+    if (!e) {
+        e = appCacheLeastRecent();
+        if (!e) {
+            Serial.println("App cache: all slots pinned");
+            return NULL;
+        }
+        appCacheEvict(e);
+    }
+
+    bool ok;
+    if (native) {
+        ok = nativeModuleLoadFile(path, &e->module);
+        e->bytes = e->module.execSize + e->module.dataSize;
+    } else {
+        ok = appImageLoadFile(&e->image, path, progress, user);
+        e->bytes = e->image.pageCount * APP_PAGE_SIZE;
+    }
+    if (!ok) return NULL;
+
+    strncpy(e->path, path, sizeof(e->path) - 1);
+    e->path[sizeof(e->path) - 1] = '\0';
+    e->native = native;
+    e->pins = 1;
+    e->lastUse = ++appCacheClock;
+    e->used = true;
+    appCacheStats.bytes += e->bytes;
+
+    appCacheEnforce();
+    return e;
+}
+
+// Unpin after the app closed; the entry stays warm (UI task)
+void appCacheRelease(AppCacheEntry * e) {
+    if (!e || e->pins == 0) return;
+    e->pins--;
+    worker_post(appCacheEnforceJob, NULL);
+}
+
+void printAppCacheStats() {
+    uint32_t lookups = appCacheStats.hits + appCacheStats.misses;
+    Serial.println("\n=== App Cache ===");
+    Serial.printf("Hits: %lu, misses: %lu (%lu%% hit rate)\n",
+                  appCacheStats.hits, appCacheStats.misses,
+                  lookups ? appCacheStats.hits * 100 / lookups : 0);
+    Serial.printf("Evictions: %lu (%lu from memory pressure)\n",
+                  appCacheStats.evictions, appCacheStats.pressureEvictions);
+    Serial.printf("Resident: %lu / %d bytes, free page memory %u\n",
+                  appCacheStats.bytes, APP_CACHE_BUDGET, (unsigned)appCacheFreeHeap());
+    for (int i = 0; i < APP_CACHE_SLOTS; i++) {
+        if (appCache[i].used) {
+            Serial.printf("  %s: %lu bytes%s\n", appCache[i].path, appCache[i].bytes,
+                          appCache[i].pins.load() ? " (running)" : "");
+        }
+    }
+    Serial.println("=================\n");
+}
+
+#endif // APP_CACHE_H
@@ -0,0 +1,439 @@
+/*
+ * App Registry Index
+ *
+ * Binary cache of every /apps/*.manifest and /apps/*.app so the
+ * launchers do not open and parse each descriptor on every visit. Both
+ * formats are found by the same directory walk and parsed by the same
+ * key handler; .app files describe an app without a code file.
+ *
+ * The index lives in /data so writing it never touches /apps itself.
+ *
+ * /data/apps.index layout:
+ *   AppIndexHeader
+ *   AppIndexEntry[count]   (fixed size records)
+ *
+ * Each entry remembers the file's size and modification time.
+ * refreshAppIndex() walks the directory without reading file contents
+ * and only re-parses files whose size or mtime changed, then writes
+ * the index back if anything differs. Disabled or broken files are
+ * indexed too so they are not re-parsed either. Files are matched to
+ * entries through a hash of the file name, so a refresh is O(n).
+ *
+ * Entries live in arrays that grow in PSRAM, there is no app limit
+ * beyond APP_INDEX_LIMIT (a sanity bound for the file header).
+ *
+ * Refreshes are event driven, opening a launcher does no SD access.
+ * appIndexNeedsRefresh() is true once at boot and after each
+ * appIndexNoteChange(), which whatever adds, removes or rewrites files
+ * in /apps calls (an installer, the explicit rescan action). Files
+ * copied onto the card elsewhere show up on the next boot or rescan.
+ *
+ * runAppIndexBenchmark() times the matching against a synthetic index.
+ *
+ * File: app_index.h
+ */
+
+#ifndef APP_INDEX_H
+#define APP_INDEX_H
+
+#include "SD_MMC.h"
+#include <FS.h>
+#include <esp_heap_caps.h>
+#include <atomic>
+#include "kv_parser.h"
+#include "storage_stats.h"
+#include "test_check.h"
+
+#define APP_INDEX_FILE    "/data/apps.index"
+#define APP_INDEX_TMP      "/data/apps.index.tmp"
+#define APP_INDEX_MAGIC    0x58494150  // "PAIX"
+#define APP_INDEX_VERSION  3
+#define APP_INDEX_LIMIT    4096
+
+enum AppKind : uint8_t {
+    APP_KIND_MANIFEST,      // .manifest with a code file
+    APP_KIND_DESCRIPTOR     // .app, metadata only
+};
+
+struct AppIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;     // sizeof(AppIndexEntry), guards layout changes
+    uint32_t count;
+    uint32_t checksum;      // FNV-1a over the entries
+};
+
+struct AppIndexEntry {
+    char manifest[48];      // File name inside /apps (.manifest or .app)
+    uint32_t size;          // File size and mtime at parse time
+    uint32_t mtime;
+    char name[32];
+    char description[64];
+    char codefile[48];
+    char icon[48];
+    uint8_t enabled;
+    uint8_t valid;          // Has name, and codefile for manifests
+    uint8_t kind;           // AppKind
+    uint8_t reserved;
+};
+
+static AppIndexEntry * appIndexEntries = NULL;
+static uint32_t appIndexCapacity = 0;
+static uint32_t appIndexCount = 0;
+
+// File name lookup: slots hold entry indices, -1 when empty. Size is a
+// power of two and at least twice appIndexCount so probes stay short.
+// Rebuilt lazily whenever the entries change.
+static int32_t * appIndexSlots = NULL;
+static uint32_t appIndexSlotCount = 0;
+static bool appIndexLookupDirty = true;
+
+struct AppIndexStats {
+    uint32_t reused;        // Entries kept from the index
+    uint32_t parsed;        // Manifests (re)parsed
+    uint32_t removed;       // Entries whose manifest is gone
+    uint32_t micros;        // Last refresh duration
+    uint32_t refreshes;     // Directory walks since boot
+};
+
+static AppIndexStats appIndexStats = {0, 0, 0, 0, 0};
+
+// Changes to /apps noted so far, and how many the index has seen. Starts
+// one apart so the first scan after boot walks the directory. Atomic,
+// installers may note a change from the worker task.
+static std::atomic<uint32_t> appIndexChanges(1);
+static uint32_t appIndexSeenChanges = 0;
+
+static uint32_t appIndexChecksum(const AppIndexEntry * entries, uint32_t count) {
+    const uint8_t * p = (const uint8_t *)entries;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < count * sizeof(AppIndexEntry); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Grow a PSRAM-backed array to hold at least need elements, doubling so
+// growth is amortised. Falls back to internal RAM without PSRAM.
+static bool appArrayGrow(void ** array, uint32_t * capacity, uint32_t need, size_t elemSize) {
+    if (need <= *capacity) return true;
+    uint32_t cap = *capacity ? *capacity : 16;
+    while (cap < need) cap *= 2;
+
+    void * grown = heap_caps_realloc(*array, cap * elemSize, MALLOC_CAP_SPIRAM);
+    if (!grown) grown = heap_caps_realloc(*array, cap * elemSize, MALLOC_CAP_8BIT);
+    if (!grown) {
+        Serial.printf("Out of memory growing app array to %lu\n", cap);
+        return false;
+    }
+    *array = grown;
+    *capacity = cap;
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// MANIFEST PARSING
+// ═══════════════════════════════════════════════════════════════
+
+static void onManifestKey(void * ctx, uint32_t key, KvSlice value) {
+    AppIndexEntry * entry = (AppIndexEntry *)ctx;
+    switch (key) {
+        case kvKey("name"):        kvSliceCopy(value, entry->name, sizeof(entry->name)); break;
+        case kvKey("description"): kvSliceCopy(value, entry->description, sizeof(entry->description)); break;
+        case kvKey("codefile"):    kvSliceCopy(value, entry->codefile, sizeof(entry->codefile)); break;
+        case kvKey("icon"):        kvSliceCopy(value, entry->icon, sizeof(entry->icon)); break;
+        case kvKey("enabled"):     entry->enabled = value.equals("true"); break;
+    }
+}
+
+// Parse one .manifest or .app file into an index entry
+static void parseManifest(const char * path, AppIndexEntry * entry) {
+    entry->name[0] = '\0';
+    entry->description[0] = '\0';
+    entry->codefile[0] = '\0';
+    entry->icon[0] = '\0';
+    entry->enabled = true;
+    entry->valid = false;
+
+    fs::File manifest = SD_MMC.open(path);
+    if (!manifest) return;
+
+    kvParseFile(manifest, onManifestKey, entry);
+    manifest.close();
+
+    entry->valid = entry->name[0] != '\0' &&
+                   (entry->kind == APP_KIND_DESCRIPTOR || entry->codefile[0] != '\0');
+}
+
+// ═══════════════════════════════════════════════════════════════
+// INDEX FILE
+// ═══════════════════════════════════════════════════════════════
+
+bool loadAppIndex() {
+    appIndexCount = 0;
+    appIndexLookupDirty = true;
+
+    fs::File file = SD_MMC.open(APP_INDEX_FILE);
+    if (!file) return false;
+
+    AppIndexHeader header;
+    bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == APP_INDEX_MAGIC &&
+              header.version == APP_INDEX_VERSION &&
+              header.entrySize == sizeof(AppIndexEntry) &&
+              header.count <= APP_INDEX_LIMIT;
+
+    if (ok) {
+        ok = appArrayGrow((void **)&appIndexEntries, &appIndexCapacity, header.count, sizeof(AppIndexEntry));
+    }
+    if (ok) {
+        size_t bytes = header.count * sizeof(AppIndexEntry);
+        ok = file.read((uint8_t *)appIndexEntries, bytes) == bytes &&
+             appIndexChecksum(appIndexEntries, header.count) == header.checksum;
+    }
+    file.close();
+
+    if (!ok) {
+        Serial.println("App index invalid, rebuilding");
+        return false;
+    }
+
+    appIndexCount = header.count;
+    return true;
+}
+
+bool saveAppIndex() {
+    AppIndexHeader header;
+    header.magic = APP_INDEX_MAGIC;
+    header.version = APP_INDEX_VERSION;
+    header.entrySize = sizeof(AppIndexEntry);
+    header.count = appIndexCount;
+    header.checksum = appIndexChecksum(appIndexEntries, appIndexCount);
+
+    // Write a temp file first so a power cut never leaves half an index
+    fs::File file = SD_MMC.open(APP_INDEX_TMP, FILE_WRITE);
+    if (!file) return false;
+    bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t *)appIndexEntries, appIndexCount * sizeof(AppIndexEntry)) ==
+                  appIndexCount * sizeof(AppIndexEntry);
+    file.close();
+
+    if (!ok) {
+        SD_MMC.remove(APP_INDEX_TMP);
+        return false;
+    }
+    return storage_replace_file(APP_INDEX_TMP, APP_INDEX_FILE);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// FILE NAME LOOKUP
+// ═══════════════════════════════════════════════════════════════
+
+static bool appIndexLookupBuild() {
+    uint32_t size = 16;
+    while (size < appIndexCount * 2) size *= 2;
+
+    if (size != appIndexSlotCount) {
+        heap_caps_free(appIndexSlots);
+        appIndexSlots = (int32_t *)heap_caps_malloc(size * sizeof(int32_t), MALLOC_CAP_SPIRAM);
+        if (!appIndexSlots) appIndexSlots = (int32_t *)heap_caps_malloc(size * sizeof(int32_t), MALLOC_CAP_8BIT);
+        appIndexSlotCount = appIndexSlots ? size : 0;
+        if (!appIndexSlots) return false;
+    }
+    memset(appIndexSlots, 0xFF, size * sizeof(int32_t));
+
+    // File names in one directory are unique, no duplicate check needed
+    uint32_t mask = size - 1;
+    for (uint32_t i = 0; i < appIndexCount; i++) {
+        const char * manifest = appIndexEntries[i].manifest;
+        uint32_t slot = kvKeyRuntime(manifest, strlen(manifest)) & mask;
+        while (appIndexSlots[slot] >= 0) slot = (slot + 1) & mask;
+        appIndexSlots[slot] = i;
+    }
+    appIndexLookupDirty = false;
+    return true;
+}
+
+// Index entry for a file in /apps, -1 if none
+static int findIndexEntry(const char * manifest) {
+    if (appIndexLookupDirty && !appIndexLookupBuild()) return -1;
+    uint32_t mask = appIndexSlotCount - 1;
+
+    for (uint32_t slot = kvKeyRuntime(manifest, strlen(manifest)) & mask;; slot = (slot + 1) & mask) {
+        int32_t i = appIndexSlots[slot];
+        if (i < 0) return -1;
+        if (strcmp(appIndexEntries[i].manifest, manifest) == 0) return i;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// REFRESH
+// ═══════════════════════════════════════════════════════════════
+
+static AppKind appFileKind(const char * fname, bool * matches) {
+    size_t len = strlen(fname);
+    *matches = true;
+    if (len > 9 && strcmp(fname + len - 9, ".manifest") == 0) return APP_KIND_MANIFEST;
+    if (len > 4 && strcmp(fname + len - 4, ".app") == 0) return APP_KIND_DESCRIPTOR;
+    *matches = false;
+    return APP_KIND_MANIFEST;
+}
+
+// Call after adding, removing or rewriting files in /apps; the next
+// scan walks the directory again
+void appIndexNoteChange() {
+    appIndexChanges++;
+}
+
+// True when /apps may differ from the index. No SD access.
+bool appIndexNeedsRefresh() {
+    return appIndexChanges.load() != appIndexSeenChanges;
+}
+
+// Bring the index in line with /apps, re-parsing only changed files.
+// Returns true when the index changed.
+bool refreshAppIndex() {
+    uint32_t start = micros();
+    appIndexStats.reused = appIndexStats.parsed = appIndexStats.removed = 0;
+    appIndexStats.refreshes++;
+    appIndexSeenChanges = appIndexChanges.load();
+
+    fs::File root = SD_MMC.open("/apps");
+    if (!root || !root.isDirectory()) {
+        Serial.println("No /apps directory");
+        appIndexCount = 0;
+        appIndexLookupDirty = true;
+        return false;
+    }
+
+    static AppIndexEntry * fresh = NULL;
+    static uint32_t freshCapacity = 0;
+    uint32_t freshCount = 0;
+    uint32_t matched = 0;
+    bool changed = false;
+
+    fs::File file = root.openNextFile();
+    while (file && freshCount < APP_INDEX_LIMIT) {
+        const char * fname = file.name();
+        bool isApp;
+        AppKind kind = appFileKind(fname, &isApp);
+
+        if (!file.isDirectory() && isApp) {
+            if (!appArrayGrow((void **)&fresh, &freshCapacity, freshCount + 1, sizeof(AppIndexEntry))) break;
+            AppIndexEntry &entry = fresh[freshCount++];
+            uint32_t size = file.size();
+            uint32_t mtime = (uint32_t)file.getLastWrite();
+
+            int old = findIndexEntry(fname);
+            if (old >= 0) matched++;
+            if (old >= 0 && appIndexEntries[old].size == size && appIndexEntries[old].mtime == mtime) {
+                entry = appIndexEntries[old];
+                appIndexStats.reused++;
+            } else {
+                memset(&entry, 0, sizeof(entry));
+                strncpy(entry.manifest, fname, sizeof(entry.manifest) - 1);
+                entry.size = size;
+                entry.mtime = mtime;
+                entry.kind = kind;
+                parseManifest(file.path(), &entry);
+                appIndexStats.parsed++;
+                changed = true;
+            }
+        }
+        file = root.openNextFile();
+    }
+    root.close();
+
+    // Same names and count: nothing was added or removed
+    appIndexStats.removed = appIndexCount - matched;
+    if (appIndexStats.removed > 0 || freshCount != appIndexCount) changed = true;
+
+    if (changed && !appArrayGrow((void **)&appIndexEntries, &appIndexCapacity, freshCount, sizeof(AppIndexEntry))) {
+        changed = false;
+    }
+    if (changed) {
+        memcpy(appIndexEntries, fresh, freshCount * sizeof(AppIndexEntry));
+        appIndexCount = freshCount;
+        appIndexLookupDirty = true;
+        saveAppIndex();
+    }
+
+    appIndexStats.micros = micros() - start;
+    Serial.printf("App index: %lu reused, %lu parsed, %lu removed in %lu us\n",
+                  appIndexStats.reused, appIndexStats.parsed, appIndexStats.removed,
+                  appIndexStats.micros);
+    return changed;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// BENCHMARK
+// ═══════════════════════════════════════════════════════════════
+
+// Matches a synthetic /apps listing against a synthetic index of the
+// same size, once by linear scan (the old refresh) and once through the
+// name lookup, and checks both agree. No SD access; the live index is
+// restored afterwards. Returns the number of failures.
+uint32_t runAppIndexBenchmark(uint32_t apps = 200) {
+    uint32_t failures = 0;
+    AppIndexEntry * liveEntries = appIndexEntries;
+    uint32_t liveCapacity = appIndexCapacity, liveCount = appIndexCount;
+
+    appIndexEntries = NULL;
+    appIndexCapacity = 0;
+    appIndexCount = 0;
+    if (!appArrayGrow((void **)&appIndexEntries, &appIndexCapacity, apps, sizeof(AppIndexEntry))) {
+        appIndexEntries = liveEntries;
+        appIndexCapacity = liveCapacity;
+        return 1;
+    }
+    memset(appIndexEntries, 0, apps * sizeof(AppIndexEntry));
+    for (uint32_t i = 0; i < apps; i++) {
+        snprintf(appIndexEntries[i].manifest, sizeof(appIndexEntries[i].manifest), "app%04lu.manifest", i);
+    }
+    appIndexCount = apps;
+    appIndexLookupDirty = true;
+
+    // The directory lists files in another order than the index, plus
+    // one new file per ten
+    char name[48];
+    uint32_t linearHits = 0, linearMicros = 0, hashHits = 0, hashMicros = 0, mismatches = 0;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < apps + apps / 10; i++) {
+        snprintf(name, sizeof(name), "app%04lu.manifest", (i * 7919) % (apps + apps / 10));
+        for (uint32_t j = 0; j < appIndexCount; j++) {
+            if (strcmp(appIndexEntries[j].manifest, name) == 0) {
+                linearHits++;
+                break;
+            }
+        }
+    }
+    linearMicros = micros() - start;
+
+    start = micros();
+    appIndexLookupBuild();
+    for (uint32_t i = 0; i < apps + apps / 10; i++) {
+        uint32_t n = (i * 7919) % (apps + apps / 10);
+        snprintf(name, sizeof(name), "app%04lu.manifest", n);
+        int found = findIndexEntry(name);
+        if (found >= 0) hashHits++;
+        if (found != (n < apps ? (int)n : -1)) mismatches++;
+    }
+    hashMicros = micros() - start;
+
+    TEST_CHECK(hashHits == apps && linearHits == apps, "hits: %lu by hash, %lu linear, expected %lu",
+               hashHits, linearHits, apps);
+    TEST_CHECK(mismatches == 0, "%lu lookups returned the wrong entry", mismatches);
+
+    heap_caps_free(appIndexEntries);
+    appIndexEntries = liveEntries;
+    appIndexCapacity = liveCapacity;
+    appIndexCount = liveCount;
+    appIndexLookupDirty = true;
+
+    Serial.printf("App index match, %lu apps: linear %lu us, hashed %lu us (incl. build)\n",
+                  apps, linearMicros, hashMicros);
+    Serial.printf("App index benchmark: %lu failures\n", failures);
+    return failures;
+}
+
+#endif // APP_INDEX_H
@@ -16,124 +16,90 @@
 #include <lvgl.h>
 #include "SD_MMC.h"
 #include <FS.h>
-
-// Forward declare EEZ function to return to home screen
-extern void loadScreen(enum ScreensEnum screenId);
-
-#define MAX_SD_APPS 20
-#define MAX_APP_NAME 32
-
-// App structure for SD card apps
-struct SDApp {
-    char name[MAX_APP_NAME];
-    char description[64];
-    char filename[64];
-    bool enabled;
-};
-
-// Global variables
-SDApp sdApps[MAX_SD_APPS];
-int sdAppCount = 0;
-lv_obj_t * currentAppScreen = NULL;
+#include "app_registry.h"
+#include "virtual_list.h"
+#include "icon_atlas.h"
+#include "screen_manager.h"
 
 // ═══════════════════════════════════════════════════════════════
 // SD CARD APP SCANNING
 // ═══════════════════════════════════════════════════════════════
 
+static void sdIconsReady(void * arg);
+
+// Refresh the shared registry, then the icon atlas in the background
 void scanSDCardApps() {
-    sdAppCount = 0;
-    
-    Serial.println("Scanning /apps/ for applications...");
-    
-    fs::File root = SD_MMC.open("/apps");
-    if (!root || !root.isDirectory()) {
-        Serial.println("No /apps directory");
-        return;
-    }
+    scanApps();
     
-    fs::File file = root.openNextFile();
-    while (file && sdAppCount < MAX_SD_APPS) {
-        String filename = String(file.name());
-        
-        if (!file.isDirectory() && filename.endsWith(".app")) {
-            // Read app metadata
-            fs::File appFile = SD_MMC.open(file.path());
-            
-            String name = "";
-            String desc = "";
-            bool enabled = true;
-            
-            while (appFile.available()) {
-                String line = appFile.readStringUntil('\n');
-                line.trim();
-                
-                if (line.startsWith("name=")) {
-                    name = line.substring(5);
-                } else if (line.startsWith("description=")) {
-                    desc = line.substring(12);
-                } else if (line.startsWith("enabled=")) {
-                    enabled = (line.substring(8) == "true");
-                }
-            }
-            appFile.close();
-            
-            if (name.length() > 0 && enabled) {
-                strncpy(sdApps[sdAppCount].name, name.c_str(), MAX_APP_NAME - 1);
-                strncpy(sdApps[sdAppCount].description, desc.c_str(), 63);
-                strncpy(sdApps[sdAppCount].filename, file.path(), 63);
-                sdApps[sdAppCount].enabled = enabled;
-                
-                Serial.printf("  Found: %s\n", name.c_str());
-                sdAppCount++;
-            }
-        }
-        file = root.openNextFile();
-    }
-    
-    Serial.printf("Found %d apps\n", sdAppCount);
+    static const char ** icons = NULL;
+    static uint32_t iconsCapacity = 0;
+    if (!appArrayGrow((void **)&icons, &iconsCapacity, appCount, sizeof(const char *))) return;
+    for (int i = 0; i < appCount; i++) icons[i] = appRegistry[i].icon;
+    iconAtlasSync(icons, appCount, sdIconsReady);
 }
 
 // ═══════════════════════════════════════════════════════════════
 // APP LAUNCHER UI
 // ═══════════════════════════════════════════════════════════════
 
-// Event handler for app launch buttons
-static void app_launch_handler(lv_event_t * e) {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
+static VirtualList sdAppList;
+static lv_img_dsc_t sdIconDsc[VLIST_MAX_ROWS];
+static uint8_t * sdIconScratch[VLIST_MAX_ROWS];  // Per row, only when the atlas is streamed
+static lv_style_t sd_title_style;
+static lv_style_t sd_name_style;
+static lv_style_t sd_desc_style;
+
+static void initSdLauncherStyles() {
+    static bool ready = false;
+    if (ready) return;
+    lv_style_init(&sd_title_style);
+    lv_style_set_text_font(&sd_title_style, &lv_font_montserrat_20);
+    lv_style_init(&sd_name_style);
+    lv_style_set_text_font(&sd_name_style, &lv_font_montserrat_14);
+    lv_style_init(&sd_desc_style);
+    lv_style_set_text_font(&sd_desc_style, &lv_font_montserrat_10);
+    lv_style_set_text_color(&sd_desc_style, lv_color_hex(0x666666));
+    ready = true;
+}
+
+static int sdAppShown = -1;   // App on the transient info screen
+
+// Info screen of the clicked app, deleted once it is left
+static void buildSdAppScreen(lv_obj_t * screen) {
+    // For now, show a message that the app would launch
+    // You'll replace this with actual app loading logic
+    lv_obj_t * msg = lv_label_create(screen);
+    char msgText[128];
+    snprintf(msgText, sizeof(msgText), "App: %s\n\n%s\n\nFunctionality coming soon!", 
+             appRegistry[sdAppShown].name, appRegistry[sdAppShown].description);
+    lv_label_set_text(msg, msgText);
+    lv_obj_center(msg);
+    lv_obj_set_style_text_align(msg, LV_TEXT_ALIGN_CENTER, 0);
+    
+    // Add back button
+    lv_obj_t * back_btn = lv_btn_create(screen);
+    lv_obj_set_size(back_btn, 120, 50);
+    lv_obj_align(back_btn, LV_ALIGN_BOTTOM_MID, 0, -20);
     
-    int appIndex = (int)(intptr_t)lv_event_get_user_data(e);
+    lv_obj_t * back_label = lv_label_create(back_btn);
+    lv_label_set_text(back_label, "BACK");
+    lv_obj_center(back_label);
     
-    if (appIndex >= 0 && appIndex < sdAppCount) {
-        Serial.printf("Launching: %s\n", sdApps[appIndex].name);
-        
-        // For now, show a message that the app would launch
-        // You'll replace this with actual app loading logic
-        lv_obj_clean(lv_scr_act());
-        
-        lv_obj_t * msg = lv_label_create(lv_scr_act());
-        char msgText[128];
-        snprintf(msgText, sizeof(msgText), "App: %s\n\n%s\n\nFunctionality coming soon!", 
-                 sdApps[appIndex].name, sdApps[appIndex].description);
-        lv_label_set_text(msg, msgText);
-        lv_obj_center(msg);
-        lv_obj_set_style_text_align(msg, LV_TEXT_ALIGN_CENTER, 0);
-        
-        // Add back button
-        lv_obj_t * back_btn = lv_btn_create(lv_scr_act());
-        lv_obj_set_size(back_btn, 120, 50);
-        lv_obj_align(back_btn, LV_ALIGN_BOTTOM_MID, 0, -20);
-        
-        lv_obj_t * back_label = lv_label_create(back_btn);
-        lv_label_set_text(back_label, "BACK");
-        lv_obj_center(back_label);
-        
-        lv_obj_add_event_cb(back_btn, [](lv_event_t * e) {
-            if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
-                // Return to app launcher
-                extern void createAppLauncher();
-                createAppLauncher();
-            }
-        }, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_event_cb(back_btn, [](lv_event_t * e) {
+        if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
+            // Return to app launcher
+            screenManagerShow(SCREEN_ID_APP_LAUNCHER);
+        }
+    }, LV_EVENT_CLICKED, NULL);
+}
+
+// Click on an app row
+static void app_launch_handler(int appIndex, void * user) {
+    if (appIndex >= 0 && appIndex < appCount) {
+        Serial.printf("Launching: %s\n", appRegistry[appIndex].name);
+        sdAppShown = appIndex;
+        screenManagerInvalidate(SCREEN_ID_SD_APP);
+        screenManagerShow(SCREEN_ID_SD_APP);
     }
 }
 
@@ -142,23 +108,89 @@ static void home_button_handler(lv_event_t * e) {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
     
     // Return to EEZ Studio home screen
-    lv_obj_clean(lv_scr_act());
+    screenManagerShowHome();
+}
+
+// One pooled row: icon, name and description
+static lv_obj_t * createSdAppRow(lv_obj_t * parent, void * user) {
+    lv_obj_t * app_container = lv_btn_create(parent);
+    lv_obj_set_size(app_container, 280, 60);
+    lv_obj_set_x(app_container, 5);
+    lv_obj_set_style_bg_color(app_container, lv_color_hex(0xF8F8F8), 0);
+    lv_obj_set_style_border_width(app_container, 2, 0);
+    lv_obj_set_style_border_color(app_container, lv_color_hex(0xE0E0E0), 0);
+    
+    // App icon placeholder, shown until the atlas has the icon
+    lv_obj_t * icon = lv_obj_create(app_container);
+    lv_obj_set_size(icon, ICON_SIZE, ICON_SIZE);
+    lv_obj_align(icon, LV_ALIGN_LEFT_MID, 5, 0);
+    lv_obj_set_style_bg_color(icon, lv_color_hex(0x2196F3), 0);
+    lv_obj_set_style_radius(icon, 5, 0);
+    lv_obj_clear_flag(icon, LV_OBJ_FLAG_CLICKABLE);
     
-    // Load your main EEZ screen (adjust screen ID based on your project)
-    extern void loadScreen(int screenId);
-    loadScreen(1);  // Typically screen ID 1 is the main/home screen
+    // App name
+    lv_obj_t * app_name = lv_label_create(app_container);
+    lv_obj_align(app_name, LV_ALIGN_TOP_LEFT, 55, 8);
+    lv_obj_add_style(app_name, &sd_name_style, 0);
+    
+    // App description
+    lv_obj_t * app_desc = lv_label_create(app_container);
+    lv_obj_align(app_desc, LV_ALIGN_BOTTOM_LEFT, 55, -8);
+    lv_obj_add_style(app_desc, &sd_desc_style, 0);
+    
+    // App icon from the atlas
+    lv_obj_t * icon_img = lv_img_create(app_container);
+    lv_obj_align(icon_img, LV_ALIGN_LEFT_MID, 5, 0);
+    lv_obj_add_flag(icon_img, LV_OBJ_FLAG_HIDDEN);
+    return app_container;
 }
 
-// Create the app launcher UI
-void createAppLauncher() {
-    Serial.println("Creating app launcher...");
+static void bindSdAppRow(lv_obj_t * row, int i, void * user) {
+    lv_label_set_text_static(lv_obj_get_child(row, 1), appRegistry[i].name);
+    lv_label_set_text_static(lv_obj_get_child(row, 2), appRegistry[i].description);
     
-    // Rescan apps each time launcher opens
-    scanSDCardApps();
+    int slot = (int)(intptr_t)lv_obj_get_user_data(row);
+    lv_obj_t * placeholder = lv_obj_get_child(row, 0);
+    lv_obj_t * icon_img = lv_obj_get_child(row, 3);
     
-    // Clear the screen
-    lv_obj_clean(lv_scr_act());
-    lv_obj_t * screen = lv_scr_act();
+    const uint8_t * pixels = NULL;
+    if (appRegistry[i].icon[0] != '\0') {
+        if (!iconAtlasMap && !sdIconScratch[slot]) {
+            sdIconScratch[slot] = (uint8_t *)heap_caps_malloc(ICON_BYTES, MALLOC_CAP_SPIRAM);
+            if (!sdIconScratch[slot]) sdIconScratch[slot] = (uint8_t *)heap_caps_malloc(ICON_BYTES, MALLOC_CAP_8BIT);
+        }
+        pixels = iconAtlasGet(appRegistry[i].iconKey, sdIconScratch[slot]);
+    }
+    if (!pixels) {
+        lv_obj_add_flag(icon_img, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(placeholder, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    
+    lv_img_dsc_t * dsc = &sdIconDsc[slot];
+    dsc->header.cf = LV_IMG_CF_TRUE_COLOR;
+    dsc->header.always_zero = 0;
+    dsc->header.w = ICON_SIZE;
+    dsc->header.h = ICON_SIZE;
+    dsc->data_size = ICON_BYTES;
+    dsc->data = pixels;
+    lv_img_cache_invalidate_src(dsc);
+    lv_img_set_src(icon_img, dsc);
+    lv_obj_invalidate(icon_img);
+    lv_obj_clear_flag(icon_img, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(placeholder, LV_OBJ_FLAG_HIDDEN);
+}
+
+// Atlas finished building, show the icons in the visible rows
+static void sdIconsReady(void * arg) {
+    if (sdAppList.container) virtualListRefresh(&sdAppList);
+}
+
+static uint32_t sdLauncherGeneration = 0;   // Registry the rows were built for
+// Build the app launcher into its screen (once per creation)
+static void buildAppLauncher(lv_obj_t * screen) {
+    initSdLauncherStyles();
+    sdLauncherGeneration = appRegistryGeneration;
     
     // Set background color
     lv_obj_set_style_bg_color(screen, lv_color_hex(0xF0F0F0), 0);
@@ -176,10 +208,7 @@ void createAppLauncher() {
     lv_obj_align(title, LV_ALIGN_LEFT_MID, 15, 0);
     lv_obj_set_style_text_color(title, lv_color_hex(0xFFFFFF), 0);
     
-    static lv_style_t title_style;
-    lv_style_init(&title_style);
-    lv_style_set_text_font(&title_style, &lv_font_montserrat_20);
-    lv_obj_add_style(title, &title_style, 0);
+    lv_obj_add_style(title, &sd_title_style, 0);
     
     // Home button in title bar
     lv_obj_t * home_btn = lv_btn_create(title_bar);
@@ -193,14 +222,21 @@ void createAppLauncher() {
     lv_obj_center(home_label);
     lv_obj_set_style_text_color(home_label, lv_color_hex(0x2196F3), 0);
     
-    // Scrollable container for apps
-    lv_obj_t * scroll_container = lv_obj_create(screen);
-    lv_obj_set_size(scroll_container, 300, 165);
+    // Scrollable container for apps; only visible rows exist and are
+    // rebound while scrolling
+    lv_obj_t * scroll_container;
+    if (appCount > 0) {
+        scroll_container = virtualListCreate(&sdAppList, screen, 300, 165, 65, appCount,
+                                             createSdAppRow, bindSdAppRow, app_launch_handler, NULL);
+    } else {
+        scroll_container = lv_obj_create(screen);
+        lv_obj_set_size(scroll_container, 300, 165);
+    }
     lv_obj_set_pos(scroll_container, 10, 60);
     lv_obj_set_style_pad_all(scroll_container, 5, 0);
     lv_obj_set_style_bg_color(scroll_container, lv_color_hex(0xFFFFFF), 0);
     
-    if (sdAppCount == 0) {
+    if (appCount == 0) {
         // No apps found message
         lv_obj_t * no_apps = lv_label_create(scroll_container);
         lv_label_set_text(no_apps, 
@@ -210,52 +246,13 @@ void createAppLauncher() {
         lv_obj_center(no_apps);
         lv_obj_set_style_text_align(no_apps, LV_TEXT_ALIGN_CENTER, 0);
         lv_obj_set_style_text_color(no_apps, lv_color_hex(0x888888), 0);
-    } else {
-        // Create app list
-        for (int i = 0; i < sdAppCount; i++) {
-            lv_obj_t * app_container = lv_btn_create(scroll_container);
-            lv_obj_set_size(app_container, 280, 60);
-            lv_obj_set_pos(app_container, 5, i * 65);
-            lv_obj_set_style_bg_color(app_container, lv_color_hex(0xF8F8F8), 0);
-            lv_obj_set_style_border_width(app_container, 2, 0);
-            lv_obj_set_style_border_color(app_container, lv_color_hex(0xE0E0E0), 0);
-            lv_obj_add_event_cb(app_container, app_launch_handler, LV_EVENT_CLICKED, (void*)(intptr_t)i);
-            
-            // App icon placeholder
-            lv_obj_t * icon = lv_obj_create(app_container);
-            lv_obj_set_size(icon, 40, 40);
-            lv_obj_align(icon, LV_ALIGN_LEFT_MID, 5, 0);
-            lv_obj_set_style_bg_color(icon, lv_color_hex(0x2196F3), 0);
-            lv_obj_set_style_radius(icon, 5, 0);
-            
-            // App name
-            lv_obj_t * app_name = lv_label_create(app_container);
-            lv_label_set_text(app_name, sdApps[i].name);
-            lv_obj_align(app_name, LV_ALIGN_TOP_LEFT, 55, 8);
-            
-            static lv_style_t name_style;
-            lv_style_init(&name_style);
-            lv_style_set_text_font(&name_style, &lv_font_montserrat_14);
-            lv_obj_add_style(app_name, &name_style, 0);
-            
-            // App description
-            lv_obj_t * app_desc = lv_label_create(app_container);
-            lv_label_set_text(app_desc, sdApps[i].description);
-            lv_obj_align(app_desc, LV_ALIGN_BOTTOM_LEFT, 55, -8);
-            
-            static lv_style_t desc_style;
-            lv_style_init(&desc_style);
-            lv_style_set_text_font(&desc_style, &lv_font_montserrat_10);
-            lv_style_set_text_color(&desc_style, lv_color_hex(0x666666));
-            lv_obj_add_style(app_desc, &desc_style, 0);
-        }
     }
     
     // Footer info
     lv_obj_t * footer = lv_label_create(screen);
     char footer_text[64];
     snprintf(footer_text, sizeof(footer_text), "%d app%s available", 
-             sdAppCount, sdAppCount == 1 ? "" : "s");
+             appCount, appCount == 1 ? "" : "s");
     lv_label_set_text(footer, footer_text);
     lv_obj_align(footer, LV_ALIGN_BOTTOM_MID, 0, -5);
     lv_obj_set_style_text_color(footer, lv_color_hex(0x888888), 0);
@@ -263,18 +260,41 @@ void createAppLauncher() {
     Serial.println("App launcher created");
 }
 
+// Open the app launcher, rebuilt only when the registry changed
+void createAppLauncher() {
+    Serial.println("Opening app launcher...");
+    
+    // Only walks /apps after a noted change, the icon atlas is kept
+    // when the icons are the same
+    scanSDCardApps();
+    
+    if (sdLauncherGeneration != appRegistryGeneration) {
+        screenManagerInvalidate(SCREEN_ID_APP_LAUNCHER);
+    }
+    screenManagerShow(SCREEN_ID_APP_LAUNCHER);
+}
+
 // ═══════════════════════════════════════════════════════════════
 // FUNCTIONS TO CALL FROM EEZ STUDIO ACTIONS
 // ═══════════════════════════════════════════════════════════════
 
 // Call this from your EEZ Studio "Apps" button
 void action_open_app_launcher() {
-    Serial.println("Opening app launcher...");
+    createAppLauncher();
+}
+
+// Call this from an EEZ Studio "Rescan" button, picks up apps copied
+// onto the card without a reboot
+void action_rescan_apps() {
+    rescanApps();
     createAppLauncher();
 }
 
 // Initialize app system (call in setup)
 void initAppLauncher() {
+    screenManagerRegister(SCREEN_ID_APP_LAUNCHER, "app_launcher", buildAppLauncher);
+    screenManagerRegister(SCREEN_ID_SD_APP, "sd_app", buildSdAppScreen, NULL, SCREEN_TRANSIENT);
+    
     // Ensure /apps directory exists
     if (!SD_MMC.exists("/apps")) {
         SD_MMC.mkdir("/apps");
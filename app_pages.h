@@ -0,0 +1,225 @@
+/*
+ * Paged App Images
+ *
+ * App code is loaded into fixed-size pages instead of one malloc of the
+ * whole file:
+ * - Pages come from a shared pool; freed pages go back to the pool's
+ *   free list and are reused, so loading apps does not fragment the heap.
+ *   appPagePoolTrim() hands them back to the heap under memory pressure
+ * - Pages are taken from PSRAM when available, internal RAM otherwise
+ * - An AppImage is a page table; readers use appImageRead() or
+ *   appImagePtr() (direct pointer when a range does not cross a page)
+ * - appImageLoadFile() streams a file page by page and reports progress,
+ *   it is meant to run on the worker core
+ *
+ * The largest image is APP_IMAGE_MAX_PAGES * APP_PAGE_SIZE bytes and is
+ * bounded by the pool, not by one contiguous allocation.
+ *
+ * File: app_pages.h
+ */
+
+#ifndef APP_PAGES_H
+#define APP_PAGES_H
+
+#include <esp_heap_caps.h>
+#if defined(ARDUINO)
+#include "SD_MMC.h"
+#include <FS.h>
+#endif
+
+#define APP_PAGE_SHIFT       12
+#define APP_PAGE_SIZE        (1 << APP_PAGE_SHIFT)   // 4KB
+#define APP_PAGE_MASK        (APP_PAGE_SIZE - 1)
+#define APP_PAGE_POOL_MAX    96                      // Pages ever allocated
+#define APP_IMAGE_MAX_PAGES  64                      // 256KB per image
+
+// Progress callback: bytes loaded so far and file size
+typedef void (*AppLoadProgressFunc)(void * user, uint32_t loaded, uint32_t total);
+
+struct AppImage {
+    uint8_t * pages[APP_IMAGE_MAX_PAGES];
+    uint16_t pageCount;
+    uint32_t size;
+    bool borrowed;          // Pages point into a caller buffer (appImageWrap)
+};
+
+struct AppPagePoolStats {
+    uint32_t allocated;     // Pages obtained from the heap
+    uint32_t free;          // Pages on the free list
+    uint32_t inUse;
+    uint32_t failures;      // Requests that found no page
+};
+
+static uint8_t * appPageFreeList[APP_PAGE_POOL_MAX];
+static AppPagePoolStats appPageStats = {0, 0, 0, 0};
+static portMUX_TYPE appPageLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ═══════════════════════════════════════════════════════════════
+// PAGE POOL
+// ═══════════════════════════════════════════════════════════════
+
+uint8_t * appPageAlloc() {
+    uint8_t * page = NULL;
+    bool grow = false;
+
+    portENTER_CRITICAL(&appPageLock);
+    if (appPageStats.free > 0) {
+        page = appPageFreeList[--appPageStats.free];
+        appPageStats.inUse++;
+    } else if (appPageStats.allocated < APP_PAGE_POOL_MAX) {
+        grow = true;
+    }
+    portEXIT_CRITICAL(&appPageLock);
+    if (page) return page;
+
+    if (grow) {
+        page = (uint8_t *)heap_caps_malloc(APP_PAGE_SIZE, MALLOC_CAP_SPIRAM);
+        if (!page) page = (uint8_t *)heap_caps_malloc(APP_PAGE_SIZE, MALLOC_CAP_8BIT);
+    }
+
+    portENTER_CRITICAL(&appPageLock);
+    if (page) {
+        appPageStats.allocated++;
+        appPageStats.inUse++;
+    } else {
+        appPageStats.failures++;
+    }
+    portEXIT_CRITICAL(&appPageLock);
+    return page;
+}
+
+static void appPageRelease(uint8_t * page) {
+    portENTER_CRITICAL(&appPageLock);
+    appPageFreeList[appPageStats.free++] = page;
+    appPageStats.inUse--;
+    portEXIT_CRITICAL(&appPageLock);
+}
+
+// Give pages on the free list back to the heap, returns pages freed
+uint32_t appPagePoolTrim() {
+    uint32_t freed = 0;
+    for (;;) {
+        uint8_t * page = NULL;
+        portENTER_CRITICAL(&appPageLock);
+        if (appPageStats.free > 0) {
+            page = appPageFreeList[--appPageStats.free];
+            appPageStats.allocated--;
+        }
+        portEXIT_CRITICAL(&appPageLock);
+        if (!page) break;
+        heap_caps_free(page);
+        freed++;
+    }
+    return freed;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// IMAGES
+// ═══════════════════════════════════════════════════════════════
+
+void appImageFree(AppImage * img) {
+    if (!img->borrowed) {
+        for (uint16_t i = 0; i < img->pageCount; i++) {
+            appPageRelease(img->pages[i]);
+        }
+    }
+    img->pageCount = 0;
+    img->size = 0;
+    img->borrowed = false;
+}
+
+// View a caller-owned buffer as an image (no pages are taken)
+bool appImageWrap(AppImage * img, const uint8_t * data, uint32_t size) {
+    uint32_t pages = (size + APP_PAGE_MASK) >> APP_PAGE_SHIFT;
+    if (pages > APP_IMAGE_MAX_PAGES) return false;
+    for (uint32_t i = 0; i < pages; i++) {
+        img->pages[i] = (uint8_t *)data + (i << APP_PAGE_SHIFT);
+    }
+    img->pageCount = pages;
+    img->size = size;
+    img->borrowed = true;
+    return true;
+}
+
+// Direct pointer to [offset, offset + len) if it lies in one page
+static inline const uint8_t * appImagePtr(const AppImage * img, uint32_t offset, uint32_t len) {
+    if (offset >= img->size || len > img->size - offset) return NULL;
+    if ((offset & APP_PAGE_MASK) + len > APP_PAGE_SIZE) return NULL;
+    return img->pages[offset >> APP_PAGE_SHIFT] + (offset & APP_PAGE_MASK);
+}
+
+// Copy any range out of the image, false when out of bounds
+bool appImageRead(const AppImage * img, uint32_t offset, void * dst, uint32_t len) {
+    if (offset > img->size || len > img->size - offset) return false;
+    uint8_t * out = (uint8_t *)dst;
+    while (len > 0) {
+        uint32_t inPage = offset & APP_PAGE_MASK;
+        uint32_t n = APP_PAGE_SIZE - inPage;
+        if (n > len) n = len;
+        memcpy(out, img->pages[offset >> APP_PAGE_SHIFT] + inPage, n);
+        out += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+#if defined(ARDUINO)
+// Stream a file into pages. Blocks on SD I/O, call from the worker.
+bool appImageLoadFile(AppImage * img, const char * path,
+                      AppLoadProgressFunc progress, void * user) {
+    img->pageCount = 0;
+    img->size = 0;
+    img->borrowed = false;
+
+    fs::File file = SD_MMC.open(path);
+    if (!file) {
+        Serial.printf("Failed to open: %s\n", path);
+        return false;
+    }
+
+    uint32_t total = file.size();
+    if (total > (uint32_t)APP_IMAGE_MAX_PAGES * APP_PAGE_SIZE) {
+        Serial.printf("App too large: %lu bytes (max %lu)\n",
+                      total, (uint32_t)APP_IMAGE_MAX_PAGES * APP_PAGE_SIZE);
+        file.close();
+        return false;
+    }
+
+    uint32_t loaded = 0;
+    while (loaded < total) {
+        uint8_t * page = appPageAlloc();
+        if (!page) {
+            Serial.printf("Out of app pages after %lu bytes\n", loaded);
+            break;
+        }
+        img->pages[img->pageCount++] = page;
+
+        uint32_t want = total - loaded < APP_PAGE_SIZE ? total - loaded : APP_PAGE_SIZE;
+        if (file.read(page, want) != want) {
+            Serial.printf("Short read at %lu bytes\n", loaded);
+            break;
+        }
+        loaded += want;
+        img->size = loaded;
+        if (progress) progress(user, loaded, total);
+    }
+    file.close();
+
+    if (loaded < total) {
+        appImageFree(img);
+        return false;
+    }
+    return true;
+}
+#endif
+
+void printAppPageStats() {
+    Serial.println("\n=== App Pages ===");
+    Serial.printf("Pages: %lu allocated, %lu in use, %lu free (%d bytes each)\n",
+                  appPageStats.allocated, appPageStats.inUse, appPageStats.free, APP_PAGE_SIZE);
+    Serial.printf("Allocation failures: %lu\n", appPageStats.failures);
+    Serial.println("=================\n");
+}
+
+#endif // APP_PAGES_H
@@ -0,0 +1,232 @@
+/*
+ * App Registry
+ *
+ * The one list of installed apps shared by both launchers. It is built
+ * from the app index (app_index.h), whose single walk of /apps picks up
+ * .manifest apps (with a code file) and .app descriptors alike.
+ * - Entries live in an array that grows in PSRAM, no fixed app limit
+ * - Names are hashed into an open-addressing index, so
+ *   appRegistryFind() is O(1) instead of a scan over every app
+ * - Runtime state of a loaded app (cache entry, entry points) sits in
+ *   the entry and is owned by the modular app loader
+ *
+ * appRegistry and appCount are only changed by scanApps() on the UI
+ * task. Growing the array moves it, so do not keep AppEntry pointers
+ * across a rescan. While the loader holds the registry (an app is being
+ * launched or runs, see appRegistryHold()) a rescan only refreshes the
+ * index; the rebuild waits for the next scan after the last release, so
+ * runtime state and indices of the running app stay valid.
+ *
+ * File: app_registry.h
+ */
+
+#ifndef APP_REGISTRY_H
+#define APP_REGISTRY_H
+
+#include "app_index.h"
+
+#define MAX_APP_NAME 32
+
+// App function pointer types
+typedef void (*AppSetupFunc)();
+typedef void (*AppLoopFunc)();
+typedef void (*AppCleanupFunc)();
+
+struct AppCacheEntry;
+
+struct AppEntry {
+    char name[MAX_APP_NAME];
+    char description[64];
+    char filepath[64];        // Code file, empty for .app descriptors
+    char source[64];          // The .manifest or .app it came from
+    char icon[64];            // Full icon path, empty when none
+    uint32_t iconKey;         // Icon atlas key
+    uint32_t nameHash;
+    AppKind kind;
+    bool enabled;
+
+    AppCacheEntry * code;     // Pinned cache entry while loaded
+
+    // Function pointers
+    AppSetupFunc setup;
+    AppLoopFunc loop;
+    AppCleanupFunc cleanup;
+
+    // Size of the loaded code (image or linked module)
+    size_t codeSize;
+};
+
+// Global app registry
+AppEntry * appRegistry = NULL;
+int appCount = 0;
+static uint32_t appRegistryCapacity = 0;
+uint32_t appRegistryGeneration = 0;   // Bumped whenever the registry is rebuilt
+static uint32_t appRegistryHolds = 0;     // Launches and running apps
+static bool appRegistryBuilt = false;     // Set by the first rebuild, even with zero apps
+bool appRegistryRebuildPending = false;   // A rescan found changes while held
+
+// Name index: slots hold registry indices, -1 when empty. Size is a
+// power of two and at least twice appCount so probes stay short.
+static int32_t * appNameIndex = NULL;
+static uint32_t appNameIndexSize = 0;
+
+struct AppRegistryStats {
+    uint32_t lookups;
+    uint32_t probes;          // Slots visited by all lookups
+    uint32_t duplicates;      // Apps hidden by an earlier app of the same name
+};
+
+static AppRegistryStats appRegistryStats = {0, 0, 0};
+
+static inline uint32_t appNameHash(const char * name) {
+    return kvKeyRuntime(name, strlen(name));
+}
+
+// ═══════════════════════════════════════════════════════════════
+// NAME INDEX
+// ═══════════════════════════════════════════════════════════════
+
+static bool appNameIndexBuild() {
+    uint32_t size = 16;
+    while (size < (uint32_t)appCount * 2) size *= 2;
+
+    if (size != appNameIndexSize) {
+        heap_caps_free(appNameIndex);
+        appNameIndex = (int32_t *)heap_caps_malloc(size * sizeof(int32_t), MALLOC_CAP_SPIRAM);
+        if (!appNameIndex) appNameIndex = (int32_t *)heap_caps_malloc(size * sizeof(int32_t), MALLOC_CAP_8BIT);
+        appNameIndexSize = appNameIndex ? size : 0;
+        if (!appNameIndex) return false;
+    }
+    memset(appNameIndex, 0xFF, size * sizeof(int32_t));
+
+    uint32_t mask = size - 1;
+    appRegistryStats.duplicates = 0;
+    for (int i = 0; i < appCount; i++) {
+        uint32_t slot = appRegistry[i].nameHash & mask;
+        bool duplicate = false;
+        while (appNameIndex[slot] >= 0) {
+            const AppEntry &other = appRegistry[appNameIndex[slot]];
+            if (other.nameHash == appRegistry[i].nameHash && strcmp(other.name, appRegistry[i].name) == 0) {
+                duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if (duplicate) {
+            Serial.printf("Duplicate app name: %s (%s)\n", appRegistry[i].name, appRegistry[i].source);
+            appRegistryStats.duplicates++;
+            continue;
+        }
+        appNameIndex[slot] = i;
+    }
+    return true;
+}
+
+// Registry index of the app with this name, -1 if none
+int appRegistryFind(const char * name) {
+    if (!appNameIndex || !name) return -1;
+    uint32_t hash = appNameHash(name);
+    uint32_t mask = appNameIndexSize - 1;
+    appRegistryStats.lookups++;
+
+    for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        appRegistryStats.probes++;
+        int32_t i = appNameIndex[slot];
+        if (i < 0) return -1;
+        if (appRegistry[i].nameHash == hash && strcmp(appRegistry[i].name, name) == 0) return i;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SCANNING
+// ═══════════════════════════════════════════════════════════════
+
+// Rebuild the registry from the app index, enabled and valid apps only
+static void appRegistryRebuild() {
+    appCount = 0;
+    if (!appArrayGrow((void **)&appRegistry, &appRegistryCapacity, appIndexCount, sizeof(AppEntry))) return;
+
+    for (uint32_t i = 0; i < appIndexCount; i++) {
+        const AppIndexEntry &entry = appIndexEntries[i];
+        if (!entry.valid || !entry.enabled) continue;
+
+        // Register app
+        AppEntry &app = appRegistry[appCount];
+        memset(&app, 0, sizeof(app));
+        strncpy(app.name, entry.name, MAX_APP_NAME - 1);
+        strncpy(app.description, entry.description, sizeof(app.description) - 1);
+        snprintf(app.source, sizeof(app.source), "/apps/%s", entry.manifest);
+
+        // Build full paths, icons are relative to /apps/ unless absolute
+        if (entry.kind == APP_KIND_MANIFEST) {
+            snprintf(app.filepath, sizeof(app.filepath), "/apps/%s", entry.codefile);
+        }
+        if (entry.icon[0] != '\0') {
+            snprintf(app.icon, sizeof(app.icon), "%s%s", entry.icon[0] == '/' ? "" : "/apps/", entry.icon);
+        }
+        app.iconKey = kvKeyRuntime(app.icon, strlen(app.icon));
+        app.nameHash = appNameHash(app.name);
+        app.kind = (AppKind)entry.kind;
+        app.enabled = true;
+
+        appCount++;
+    }
+
+    appNameIndexBuild();
+    appRegistryBuilt = true;
+    appRegistryGeneration++;
+}
+
+// Keep entries (and their indices) in place while an app is launched or
+// runs, UI task only
+void appRegistryHold() {
+    appRegistryHolds++;
+}
+
+void appRegistryRelease() {
+    if (appRegistryHolds > 0) appRegistryHolds--;
+}
+
+// Bring the registry in line with /apps in one directory walk, or none
+// when no change was noted since the last one (see appIndexNoteChange()).
+// Returns true when anything changed.
+bool scanApps() {
+    static bool indexLoaded = false;
+
+    Serial.println("\n=== Scanning for Apps ===");
+
+    // Only files that changed since the index was written are parsed
+    if (!indexLoaded) {
+        loadAppIndex();
+        indexLoaded = true;
+    }
+    bool changed = appIndexNeedsRefresh() && refreshAppIndex();
+    if (changed || !appRegistryBuilt || appRegistryRebuildPending) {
+        // Rebuilding would wipe the running app's entry
+        appRegistryRebuildPending = appRegistryHolds > 0 && appRegistryBuilt;
+        if (appRegistryRebuildPending) Serial.println("App running, registry rebuild deferred");
+        else appRegistryRebuild();
+    }
+
+    Serial.printf("Found %d apps\n", appCount);
+    return changed;
+}
+
+// Explicit rescan, for apps copied onto the card while it was mounted
+bool rescanApps() {
+    appIndexNoteChange();
+    return scanApps();
+}
+
+void printAppRegistryStats() {
+    Serial.println("\n=== App Registry ===");
+    Serial.printf("Apps: %d (capacity %lu), index %lu slots\n",
+                  appCount, appRegistryCapacity, appNameIndexSize);
+    Serial.printf("Lookups: %lu, %lu.%02lu probes each\n", appRegistryStats.lookups,
+                  appRegistryStats.lookups ? appRegistryStats.probes / appRegistryStats.lookups : 0,
+                  appRegistryStats.lookups ? appRegistryStats.probes * 100 / appRegistryStats.lookups % 100 : 0);
+    Serial.printf("Duplicate names: %lu\n", appRegistryStats.duplicates);
+    Serial.println("====================\n");
+}
+
+#endif // APP_REGISTRY_H
@@ -0,0 +1,827 @@
+/*
+ * App Bytecode VM
+ *
+ * Runs SD card apps compiled offline into .pbc bytecode images.
+ * - Fixed memory: value stack, call frames, globals and widget handles
+ *   are static arrays, nothing is allocated while an app runs
+ * - setup runs on the UI task and may create widgets
+ * - loop runs on the worker core with an instruction budget per tick,
+ *   a call that runs out of budget is resumed on the next tick
+ * - cleanup runs on the UI task after the worker has stopped
+ *
+ * The image is read through its page table (app_pages.h), the string
+ * pool is copied into a fixed buffer at load time.
+ *
+ * .pbc layout (little endian):
+ *   PbcHeader
+ *   code[codeSize]
+ *   strings[stringsSize]    NUL terminated, referenced by byte offset
+ *
+ * Values are int32. Strings are offsets into the string pool.
+ * Every function leaves exactly one return value (compilers push 0 for
+ * void functions). Instructions are one opcode byte plus operands:
+ *
+ *   PUSH8 i8, PUSH32 i32, PUSHS u16     push constant / string offset
+ *   LOADG u8, STOREG u8                  globals
+ *   LOADL u8, STOREL u8, RESERVE u8      locals (args first, then RESERVE)
+ *   JMP/JZ/JNZ i16                       relative to the next instruction
+ *   CALL u32 addr, u8 argc / RET
+ *   NATIVE u8 id                         see vmNatives[] for ids and argc
+ *   YIELD                                end this tick early
+ *   HALT                                 stop the app loop for good
+ *
+ * runVmBenchmark() checks slicing, split fetches and rejected images and
+ * reports throughput; it runs as the "vm" host test and device check.
+ *
+ * File: app_vm.h
+ */
+
+#ifndef APP_VM_H
+#define APP_VM_H
+
+#include <lvgl.h>
+#include <atomic>
+#include "touch.h"
+#include "touch_gestures.h"
+#include "task_model.h"
+#include "app_pages.h"
+#include "test_check.h"
+
+#define PBC_MAGIC        0x31434250  // "PBC1"
+#define PBC_VERSION      1
+#define PBC_NO_ENTRY     0xFFFFFFFF
+
+#define VM_STACK_SIZE    256
+#define VM_MAX_FRAMES    32
+#define VM_MAX_GLOBALS   64
+#define VM_MAX_OBJECTS   32
+#define VM_MAX_STRINGS   2048     // String pool bytes
+#define VM_TICK_BUDGET   2000     // Instructions per worker tick
+#define VM_SETUP_BUDGET  200000   // setup/cleanup must finish within this
+
+struct PbcHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t globals;       // Number of int32 globals
+    uint32_t codeSize;
+    uint32_t stringsSize;
+    uint32_t entrySetup;    // Code offsets, PBC_NO_ENTRY if absent
+    uint32_t entryLoop;
+    uint32_t entryCleanup;
+};
+
+enum VmOp {
+    OP_NOP = 0, OP_HALT, OP_YIELD,
+    OP_PUSH8, OP_PUSH32, OP_PUSHS, OP_POP, OP_DUP, OP_SWAP,
+    OP_LOADG, OP_STOREG, OP_LOADL, OP_STOREL, OP_RESERVE,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_NEG,
+    OP_AND, OP_OR, OP_XOR, OP_NOT, OP_SHL, OP_SHR,
+    OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE,
+    OP_JMP, OP_JZ, OP_JNZ, OP_CALL, OP_RET, OP_NATIVE,
+    VM_OP_COUNT
+};
+
+// Operand bytes following each opcode
+static const uint8_t vmOperandBytes[VM_OP_COUNT] = {
+    0, 0, 0,
+    1, 4, 2, 0, 0, 0,
+    1, 1, 1, 1, 1,
+    0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0,
+    2, 2, 2, 5, 0, 1
+};
+
+enum VmResult {
+    VM_DONE = 0,        // Entry call returned (or HALT)
+    VM_SUSPENDED,       // Out of budget or YIELD, resume next tick
+    VM_ERROR
+};
+
+struct VmFrame {
+    uint32_t ret;       // Return pc
+    uint16_t fp;        // First local of this frame
+};
+
+struct VmStats {
+    uint64_t instructions;
+    uint32_t ticks;
+    uint32_t suspends;  // Ticks that ran out of budget
+    uint64_t micros;
+};
+
+struct AppVM {
+    const AppImage * image;
+    uint32_t codeBase;          // Image offset of code[0]
+    uint32_t codeSize;
+    uint8_t fetch[8];           // Instructions that cross a page boundary
+    char strings[VM_MAX_STRINGS];
+    uint32_t stringsSize;
+    uint32_t entry[3];          // setup, loop, cleanup
+
+    int32_t stack[VM_STACK_SIZE];
+    uint16_t sp;
+    VmFrame frames[VM_MAX_FRAMES];
+    uint8_t depth;
+    uint32_t pc;
+    int32_t result;             // Return value of the last finished call
+
+    int32_t globals[VM_MAX_GLOBALS];
+    uint16_t globalCount;
+
+    lv_obj_t * objects[VM_MAX_OBJECTS];
+    lv_obj_t * labels[VM_MAX_OBJECTS];  // Text target per handle (button label)
+    uint8_t objectCount;
+    std::atomic<uint32_t> clicked;      // Bit per handle, set by LVGL events
+    lv_obj_t * root;
+    GestureEvent gesture;               // Last event returned by gesture()
+
+    bool loaded;
+    bool active;                // A call is in progress (possibly suspended)
+    bool halted;
+    bool failed;
+    bool uiTask;                // Natives may call LVGL directly
+    char error[48];
+
+    VmStats stats;
+};
+
+enum VmEntry { VM_ENTRY_SETUP = 0, VM_ENTRY_LOOP, VM_ENTRY_CLEANUP };
+
+static AppVM appVm;
+
+static VmResult vmFail(AppVM &vm, const char * msg) {
+    if (!vm.failed) {
+        vm.failed = true;
+        vm.active = false;
+        strncpy(vm.error, msg, sizeof(vm.error) - 1);
+        vm.error[sizeof(vm.error) - 1] = '\0';
+        Serial.printf("VM error at pc %lu: %s\n", vm.pc, msg);
+    }
+    return VM_ERROR;
+}
+
+// All code reads go through the image's page table.
+// Returns NULL when [pc, pc + n) is out of range.
+static inline const uint8_t * vmCodeAt(AppVM &vm, uint32_t pc, uint32_t n) {
+    if (pc >= vm.codeSize || n > vm.codeSize - pc) return NULL;
+    const uint8_t * p = appImagePtr(vm.image, vm.codeBase + pc, n);
+    if (p) return p;
+    appImageRead(vm.image, vm.codeBase + pc, vm.fetch, n);
+    return vm.fetch;
+}
+
+static inline int16_t vmRead16(const uint8_t * p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static inline int32_t vmRead32(const uint8_t * p) {
+    return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                     ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static const char * vmString(AppVM &vm, int32_t offset) {
+    if (offset < 0 || (uint32_t)offset >= vm.stringsSize) {
+        vmFail(vm, "bad string offset");
+        return NULL;
+    }
+    return vm.strings + offset;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// NATIVE BINDINGS
+// ═══════════════════════════════════════════════════════════════
+
+typedef int32_t (*VmNativeFunc)(AppVM &vm, const int32_t * args);
+
+struct VmNative {
+    const char * name;
+    uint8_t argc;
+    VmNativeFunc fn;
+};
+
+static lv_obj_t * vmObject(AppVM &vm, int32_t handle) {
+    if (handle < 0 || handle >= vm.objectCount) {
+        vmFail(vm, "bad widget handle");
+        return NULL;
+    }
+    return vm.objects[handle];
+}
+
+static int32_t vmAddObject(AppVM &vm, lv_obj_t * obj, lv_obj_t * label) {
+    vm.objects[vm.objectCount] = obj;
+    vm.labels[vm.objectCount] = label;
+    return vm.objectCount++;
+}
+
+// Widgets can only be created while running on the UI task (setup)
+static bool vmCanCreate(AppVM &vm) {
+    if (!vm.uiTask) {
+        vmFail(vm, "widgets can only be created in setup");
+        return false;
+    }
+    if (vm.objectCount >= VM_MAX_OBJECTS) {
+        vmFail(vm, "too many widgets");
+        return false;
+    }
+    return true;
+}
+
+static void vm_button_event(lv_event_t * e) {
+    uint32_t handle = (uint32_t)(uintptr_t)lv_event_get_user_data(e);
+    appVm.clicked.fetch_or(1u << handle);
+}
+
+static int32_t vmn_print_int(AppVM &vm, const int32_t * a) {
+    Serial.printf("[app] %ld\n", a[0]);
+    return 0;
+}
+
+static int32_t vmn_print_str(AppVM &vm, const int32_t * a) {
+    const char * s = vmString(vm, a[0]);
+    if (s) Serial.printf("[app] %s\n", s);
+    return 0;
+}
+
+static int32_t vmn_millis(AppVM &vm, const int32_t * a) {
+    return (int32_t)millis();
+}
+
+static int32_t vmn_random(AppVM &vm, const int32_t * a) {
+    return a[0] > 0 ? (int32_t)(esp_random() % (uint32_t)a[0]) : 0;
+}
+
+// label(x, y, text) -> handle
+static int32_t vmn_label(AppVM &vm, const int32_t * a) {
+    const char * text = vmString(vm, a[2]);
+    if (!text || !vmCanCreate(vm)) return -1;
+    lv_obj_t * label = lv_label_create(vm.root);
+    lv_label_set_text(label, text);
+    lv_obj_set_pos(label, a[0], a[1]);
+    return vmAddObject(vm, label, label);
+}
+
+// button(x, y, w, h, text) -> handle, poll with clicked(handle)
+static int32_t vmn_button(AppVM &vm, const int32_t * a) {
+    const char * text = vmString(vm, a[4]);
+    if (!text || !vmCanCreate(vm)) return -1;
+    lv_obj_t * btn = lv_btn_create(vm.root);
+    lv_obj_set_pos(btn, a[0], a[1]);
+    lv_obj_set_size(btn, a[2], a[3]);
+    lv_obj_t * label = lv_label_create(btn);
+    lv_label_set_text(label, text);
+    lv_obj_center(label);
+    lv_obj_add_event_cb(btn, vm_button_event, LV_EVENT_CLICKED, (void *)(uintptr_t)vm.objectCount);
+    return vmAddObject(vm, btn, label);
+}
+
+// bar(x, y, w, h, max) -> handle
+static int32_t vmn_bar(AppVM &vm, const int32_t * a) {
+    if (!vmCanCreate(vm)) return -1;
+    lv_obj_t * bar = lv_bar_create(vm.root);
+    lv_obj_set_pos(bar, a[0], a[1]);
+    lv_obj_set_size(bar, a[2], a[3]);
+    lv_bar_set_range(bar, 0, a[4]);
+    return vmAddObject(vm, bar, NULL);
+}
+
+static void vmSetText(AppVM &vm, int32_t handle, const char * text) {
+    if (!vmObject(vm, handle)) return;
+    lv_obj_t * label = vm.labels[handle];
+    if (!label) return;
+    // From the worker, mutations go through the UI queue
+    if (vm.uiTask) lv_label_set_text(label, text);
+    else ui_post_text(label, text);
+}
+
+// set_text(handle, text)
+static int32_t vmn_set_text(AppVM &vm, const int32_t * a) {
+    const char * text = vmString(vm, a[1]);
+    if (text) vmSetText(vm, a[0], text);
+    return 0;
+}
+
+// set_num(handle, n)
+static int32_t vmn_set_num(AppVM &vm, const int32_t * a) {
+    char text[12];
+    snprintf(text, sizeof(text), "%ld", (long)a[1]);
+    vmSetText(vm, a[0], text);
+    return 0;
+}
+
+// set_value(handle, value) for bars
+static int32_t vmn_set_value(AppVM &vm, const int32_t * a) {
+    lv_obj_t * obj = vmObject(vm, a[0]);
+    if (!obj) return 0;
+    if (vm.uiTask) lv_bar_set_value(obj, a[1], LV_ANIM_OFF);
+    else ui_post_value(obj, a[1]);
+    return 0;
+}
+
+// clicked(handle) -> 1 once per click
+static int32_t vmn_clicked(AppVM &vm, const int32_t * a) {
+    if (!vmObject(vm, a[0])) return 0;
+    uint32_t bit = 1u << a[0];
+    return (vm.clicked.fetch_and(~bit) & bit) ? 1 : 0;
+}
+
+static int32_t vmn_touch_down(AppVM &vm, const int32_t * a) {
+    return touch_down ? 1 : 0;
+}
+
+static int32_t vmn_touch_x(AppVM &vm, const int32_t * a) {
+    return touch_last_x;
+}
+
+static int32_t vmn_touch_y(AppVM &vm, const int32_t * a) {
+    return touch_last_y;
+}
+
+// gesture() -> next GestureType from the gesture engine, 0 when none;
+// gesture_info(field) then reads that event
+static int32_t vmn_gesture(AppVM &vm, const int32_t * a) {
+    if (!gesture_poll(&vm.gesture)) {
+        memset(&vm.gesture, 0, sizeof(vm.gesture));
+        return GESTURE_NONE;
+    }
+    return vm.gesture.type;
+}
+
+enum VmGestureField {
+    VM_GESTURE_PHASE = 0, VM_GESTURE_DIR, VM_GESTURE_FINGERS,
+    VM_GESTURE_X, VM_GESTURE_Y, VM_GESTURE_DX, VM_GESTURE_DY,
+    VM_GESTURE_VX, VM_GESTURE_VY, VM_GESTURE_SCALE
+};
+
+static int32_t vmn_gesture_info(AppVM &vm, const int32_t * a) {
+    const GestureEvent &g = vm.gesture;
+    switch (a[0]) {
+        case VM_GESTURE_PHASE:   return g.phase;
+        case VM_GESTURE_DIR:     return g.dir;
+        case VM_GESTURE_FINGERS: return g.fingers;
+        case VM_GESTURE_X:       return g.x;
+        case VM_GESTURE_Y:       return g.y;
+        case VM_GESTURE_DX:      return g.dx;
+        case VM_GESTURE_DY:      return g.dy;
+        case VM_GESTURE_VX:      return g.vx;
+        case VM_GESTURE_VY:      return g.vy;
+        case VM_GESTURE_SCALE:   return g.scale;
+    }
+    return 0;
+}
+
+// Index is the NATIVE operand, append only so compiled apps keep working
+static const VmNative vmNatives[] = {
+    { "print_int",  1, vmn_print_int },
+    { "print_str",  1, vmn_print_str },
+    { "millis",     0, vmn_millis },
+    { "random",     1, vmn_random },
+    { "label",      3, vmn_label },
+    { "button",     5, vmn_button },
+    { "bar",        5, vmn_bar },
+    { "set_text",   2, vmn_set_text },
+    { "set_num",    2, vmn_set_num },
+    { "set_value",  2, vmn_set_value },
+    { "clicked",    1, vmn_clicked },
+    { "touch_down", 0, vmn_touch_down },
+    { "touch_x",    0, vmn_touch_x },
+    { "touch_y",    0, vmn_touch_y },
+    { "gesture",    0, vmn_gesture },
+    { "gesture_info", 1, vmn_gesture_info },
+};
+
+#define VM_NATIVE_COUNT (sizeof(vmNatives) / sizeof(vmNatives[0]))
+
+// ═══════════════════════════════════════════════════════════════
+// INTERPRETER
+// ═══════════════════════════════════════════════════════════════
+
+static bool vmStart(AppVM &vm, uint32_t entry) {
+    if (entry == PBC_NO_ENTRY || entry >= vm.codeSize) return false;
+    vm.sp = 0;
+    vm.depth = 1;
+    vm.frames[0].ret = PBC_NO_ENTRY;
+    vm.frames[0].fp = 0;
+    vm.pc = entry;
+    vm.active = true;
+    return true;
+}
+
+#define VM_FAIL(msg)  do { result = vmFail(vm, msg); goto done; } while (0)
+#define VM_NEED(n)    if (vm.sp < fp + (n)) VM_FAIL("stack underflow")
+#define VM_ROOM(n)    if (vm.sp + (n) > VM_STACK_SIZE) VM_FAIL("stack overflow")
+#define VM_BINOP(expr) { \
+        VM_NEED(2); \
+        int32_t b = vm.stack[--vm.sp]; \
+        int32_t a = vm.stack[vm.sp - 1]; \
+        vm.stack[vm.sp - 1] = (expr); \
+        break; \
+    }
+
+// Execute up to budget instructions of the call started by vmStart()
+static VmResult vmRun(AppVM &vm, uint32_t budget) {
+    if (vm.failed) return VM_ERROR;
+    if (!vm.active) return VM_DONE;
+
+    uint32_t start = micros();
+    uint32_t executed = 0;
+    uint16_t fp = vm.frames[vm.depth - 1].fp;
+    VmResult result = VM_SUSPENDED;
+
+    while (executed < budget) {
+        const uint8_t * ip = vmCodeAt(vm, vm.pc, 1);
+        if (!ip) VM_FAIL("pc out of range");
+        uint8_t op = ip[0];
+        if (op >= VM_OP_COUNT) VM_FAIL("bad opcode");
+
+        const uint8_t * arg = NULL;
+        uint8_t n = vmOperandBytes[op];
+        if (n) {
+            arg = vmCodeAt(vm, vm.pc + 1, n);
+            if (!arg) VM_FAIL("truncated instruction");
+        }
+        vm.pc += 1 + n;
+        executed++;
+
+        switch (op) {
+            case OP_NOP:
+                break;
+            case OP_HALT:
+                vm.halted = true;
+                vm.active = false;
+                result = VM_DONE;
+                goto done;
+            case OP_YIELD:
+                goto done;
+
+            case OP_PUSH8:
+                VM_ROOM(1);
+                vm.stack[vm.sp++] = (int8_t)arg[0];
+                break;
+            case OP_PUSH32:
+                VM_ROOM(1);
+                vm.stack[vm.sp++] = vmRead32(arg);
+                break;
+            case OP_PUSHS:
+                VM_ROOM(1);
+                vm.stack[vm.sp++] = (uint16_t)vmRead16(arg);
+                break;
+            case OP_POP:
+                VM_NEED(1);
+                vm.sp--;
+                break;
+            case OP_DUP:
+                VM_NEED(1);
+                VM_ROOM(1);
+                vm.stack[vm.sp] = vm.stack[vm.sp - 1];
+                vm.sp++;
+                break;
+            case OP_SWAP: {
+                VM_NEED(2);
+                int32_t t = vm.stack[vm.sp - 1];
+                vm.stack[vm.sp - 1] = vm.stack[vm.sp - 2];
+                vm.stack[vm.sp - 2] = t;
+                break;
+            }
+
+            case OP_LOADG:
+                if (arg[0] >= vm.globalCount) VM_FAIL("bad global");
+                VM_ROOM(1);
+                vm.stack[vm.sp++] = vm.globals[arg[0]];
+                break;
+            case OP_STOREG:
+                if (arg[0] >= vm.globalCount) VM_FAIL("bad global");
+                VM_NEED(1);
+                vm.globals[arg[0]] = vm.stack[--vm.sp];
+                break;
+            case OP_LOADL:
+                if (fp + arg[0] >= vm.sp) VM_FAIL("bad local");
+                VM_ROOM(1);
+                vm.stack[vm.sp] = vm.stack[fp + arg[0]];
+                vm.sp++;
+                break;
+            case OP_STOREL:
+                VM_NEED(1);
+                vm.sp--;
+                if (fp + arg[0] >= vm.sp) VM_FAIL("bad local");
+                vm.stack[fp + arg[0]] = vm.stack[vm.sp];
+                break;
+            case OP_RESERVE:
+                VM_ROOM(arg[0]);
+                memset(&vm.stack[vm.sp], 0, arg[0] * sizeof(int32_t));
+                vm.sp += arg[0];
+                break;
+
+            // Wrapping arithmetic, no signed overflow
+            case OP_ADD: VM_BINOP((int32_t)((uint32_t)a + (uint32_t)b))
+            case OP_SUB: VM_BINOP((int32_t)((uint32_t)a - (uint32_t)b))
+            case OP_MUL: VM_BINOP((int32_t)((uint32_t)a * (uint32_t)b))
+            case OP_DIV:
+                VM_NEED(2);
+                if (vm.stack[vm.sp - 1] == 0) VM_FAIL("division by zero");
+                VM_BINOP(b == -1 ? (int32_t)(0u - (uint32_t)a) : a / b)
+            case OP_MOD:
+                VM_NEED(2);
+                if (vm.stack[vm.sp - 1] == 0) VM_FAIL("division by zero");
+                VM_BINOP(b == -1 ? 0 : a % b)
+            case OP_NEG:
+                VM_NEED(1);
+                vm.stack[vm.sp - 1] = (int32_t)(0u - (uint32_t)vm.stack[vm.sp - 1]);
+                break;
+            case OP_AND: VM_BINOP(a & b)
+            case OP_OR:  VM_BINOP(a | b)
+            case OP_XOR: VM_BINOP(a ^ b)
+            case OP_NOT:
+                VM_NEED(1);
+                vm.stack[vm.sp - 1] = !vm.stack[vm.sp - 1];
+                break;
+            case OP_SHL: VM_BINOP((int32_t)((uint32_t)a << (b & 31)))
+            case OP_SHR: VM_BINOP(a >> (b & 31))
+            case OP_EQ:  VM_BINOP(a == b)
+            case OP_NE:  VM_BINOP(a != b)
+            case OP_LT:  VM_BINOP(a < b)
+            case OP_LE:  VM_BINOP(a <= b)
+            case OP_GT:  VM_BINOP(a > b)
+            case OP_GE:  VM_BINOP(a >= b)
+
+            case OP_JMP:
+                vm.pc += vmRead16(arg);
+                break;
+            case OP_JZ:
+                VM_NEED(1);
+                if (vm.stack[--vm.sp] == 0) vm.pc += vmRead16(arg);
+                break;
+            case OP_JNZ:
+                VM_NEED(1);
+                if (vm.stack[--vm.sp] != 0) vm.pc += vmRead16(arg);
+                break;
+
+            case OP_CALL: {
+                uint32_t target = (uint32_t)vmRead32(arg);
+                uint8_t argc = arg[4];
+                if (target >= vm.codeSize) VM_FAIL("bad call target");
+                if (vm.depth >= VM_MAX_FRAMES) VM_FAIL("call depth exceeded");
+                VM_NEED(argc);
+                VmFrame &frame = vm.frames[vm.depth++];
+                frame.ret = vm.pc;
+                frame.fp = vm.sp - argc;
+                fp = frame.fp;
+                vm.pc = target;
+                break;
+            }
+            case OP_RET: {
+                VM_NEED(1);
+                int32_t value = vm.stack[vm.sp - 1];
+                VmFrame &frame = vm.frames[--vm.depth];
+                vm.sp = frame.fp;
+                if (vm.depth == 0) {
+                    vm.result = value;
+                    vm.active = false;
+                    result = VM_DONE;
+                    goto done;
+                }
+                vm.pc = frame.ret;
+                fp = vm.frames[vm.depth - 1].fp;
+                vm.stack[vm.sp++] = value;
+                break;
+            }
+
+            case OP_NATIVE: {
+                if (arg[0] >= VM_NATIVE_COUNT) VM_FAIL("bad native");
+                const VmNative &native = vmNatives[arg[0]];
+                VM_NEED(native.argc);
+                vm.sp -= native.argc;
+                int32_t value = native.fn(vm, &vm.stack[vm.sp]);
+                if (vm.failed) {
+                    result = VM_ERROR;
+                    goto done;
+                }
+                vm.stack[vm.sp++] = value;
+                break;
+            }
+        }
+    }
+
+done:
+    if (result == VM_SUSPENDED && executed >= budget) vm.stats.suspends++;
+    vm.stats.instructions += executed;
+    vm.stats.micros += micros() - start;
+    return result;
+}
+
+#undef VM_FAIL
+#undef VM_NEED
+#undef VM_ROOM
+#undef VM_BINOP
+
+// ═══════════════════════════════════════════════════════════════
+// LOADING
+// ═══════════════════════════════════════════════════════════════
+
+static bool vmLoadImage(AppVM &vm, const AppImage * image) {
+    memset(&vm.stats, 0, sizeof(vm.stats));
+    vm.loaded = vm.active = vm.halted = vm.failed = vm.uiTask = false;
+    vm.error[0] = '\0';
+    vm.objectCount = 0;
+    vm.clicked = 0;
+    vm.root = NULL;
+
+    uint32_t size = image->size;
+    PbcHeader h;
+    if (!appImageRead(image, 0, &h, sizeof(h))) {
+        vmFail(vm, "image too small");
+        return false;
+    }
+
+    if (h.magic != PBC_MAGIC || h.version != PBC_VERSION) {
+        vmFail(vm, "not a PBC1 image");
+        return false;
+    }
+    if (h.globals > VM_MAX_GLOBALS) {
+        vmFail(vm, "too many globals");
+        return false;
+    }
+    if (h.codeSize > size - sizeof(h) || h.stringsSize > size - sizeof(h) - h.codeSize) {
+        vmFail(vm, "truncated image");
+        return false;
+    }
+    if (h.stringsSize > VM_MAX_STRINGS) {
+        vmFail(vm, "string pool too large");
+        return false;
+    }
+    appImageRead(image, sizeof(h) + h.codeSize, vm.strings, h.stringsSize);
+    if (h.stringsSize > 0 && vm.strings[h.stringsSize - 1] != '\0') {
+        vmFail(vm, "unterminated string pool");
+        return false;
+    }
+
+    vm.image = image;
+    vm.codeBase = sizeof(h);
+    vm.codeSize = h.codeSize;
+    vm.stringsSize = h.stringsSize;
+    vm.entry[VM_ENTRY_SETUP] = h.entrySetup;
+    vm.entry[VM_ENTRY_LOOP] = h.entryLoop;
+    vm.entry[VM_ENTRY_CLEANUP] = h.entryCleanup;
+    vm.globalCount = h.globals;
+    memset(vm.globals, 0, sizeof(vm.globals));
+
+    for (int i = 0; i < 3; i++) {
+        if (vm.entry[i] != PBC_NO_ENTRY && vm.entry[i] >= vm.codeSize) {
+            vmFail(vm, "bad entry point");
+            return false;
+        }
+    }
+
+    vm.loaded = true;
+    return true;
+}
+
+bool vmLoad(const AppImage * image) {
+    return vmLoadImage(appVm, image);
+}
+
+void vmUnload() {
+    appVm.loaded = false;
+    appVm.active = false;
+    appVm.image = NULL;
+    appVm.objectCount = 0;
+}
+
+// Run one entry point to completion on the calling (UI) task
+static void vmRunEntry(int entry, const char * what) {
+    if (!appVm.loaded || appVm.failed) return;
+    if (!vmStart(appVm, appVm.entry[entry])) return;
+
+    appVm.uiTask = true;
+    if (vmRun(appVm, VM_SETUP_BUDGET) == VM_SUSPENDED) {
+        vmFail(appVm, "setup/cleanup exceeded budget");
+    }
+    appVm.uiTask = false;
+    Serial.printf("VM %s: %s\n", what, appVm.failed ? appVm.error : "ok");
+}
+
+// AppEntry entry points for .pbc apps
+
+void vm_app_setup() {
+    appVm.root = lv_scr_act();
+    vmRunEntry(VM_ENTRY_SETUP, "setup");
+}
+
+// Worker core, one budgeted slice per tick
+void vm_app_loop() {
+    if (!appVm.loaded || appVm.failed || appVm.halted) return;
+    if (!appVm.active && !vmStart(appVm, appVm.entry[VM_ENTRY_LOOP])) return;
+
+    appVm.stats.ticks++;
+    vmRun(appVm, VM_TICK_BUDGET);
+}
+
+// UI task, after worker_stop_app_loop()
+void vm_app_cleanup() {
+    appVm.active = false;
+    vmRunEntry(VM_ENTRY_CLEANUP, "cleanup");
+    appVm.objectCount = 0;
+}
+
+void printVmStats() {
+    Serial.println("\n=== App VM ===");
+    Serial.printf("Instructions: %llu in %llu us, ticks: %lu (%lu out of budget)\n",
+                  appVm.stats.instructions, appVm.stats.micros,
+                  appVm.stats.ticks, appVm.stats.suspends);
+    if (appVm.stats.micros > 0) {
+        Serial.printf("Throughput: %llu instr/ms\n", appVm.stats.instructions * 1000 / appVm.stats.micros);
+    }
+    if (appVm.failed) Serial.printf("Error: %s\n", appVm.error);
+    Serial.println("==============\n");
+}
+
+// Interpreter checks and throughput on a counting loop: the result run
+// straight through and in VM_TICK_BUDGET slices, with the loop straddling
+// a page boundary, then images and code the VM must reject. Uses its own
+// VM instance so a running app is not disturbed. Returns the number of
+// failures.
+uint32_t runVmBenchmark(int32_t iterations = 100000) {
+    uint32_t failures = 0;
+    static AppImage image;
+    static AppVM bench;
+
+    const uint8_t loop[26] = {
+        OP_RESERVE, 1,                      //  0: local i
+        OP_LOADL, 0,                        //  2: loop: i
+        OP_PUSH32, (uint8_t)iterations, (uint8_t)(iterations >> 8),
+                   (uint8_t)(iterations >> 16), (uint8_t)(iterations >> 24),
+        OP_LT,                              //  9
+        OP_JZ, 10, 0,                       // 10: -> 23
+        OP_LOADL, 0,                        // 13: i = i + 1
+        OP_PUSH8, 1,
+        OP_ADD,
+        OP_STOREL, 0,
+        OP_JMP, (uint8_t)-21, 0xFF,         // 20: -> 2
+        OP_LOADL, 0,                        // 23: return i
+        OP_RET
+    };
+
+    // NOPs in front put the PUSH32 across the first page boundary, so
+    // every iteration fetches through the split-instruction path
+    const uint32_t pad = APP_PAGE_SIZE - sizeof(PbcHeader) - 6;
+    const uint32_t size = sizeof(PbcHeader) + pad + sizeof(loop);
+    uint8_t * buffer = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    if (!buffer) return 1;
+
+    PbcHeader h = { PBC_MAGIC, PBC_VERSION, 0, pad + (uint32_t)sizeof(loop), 0, 0, PBC_NO_ENTRY, PBC_NO_ENTRY };
+    memcpy(buffer, &h, sizeof(h));
+    memset(buffer + sizeof(h), OP_NOP, pad);
+    memcpy(buffer + sizeof(h) + pad, loop, sizeof(loop));
+    appImageWrap(&image, buffer, size);
+
+    VmResult result = VM_ERROR;
+    if (vmLoadImage(bench, &image) && vmStart(bench, 0)) {
+        while ((result = vmRun(bench, 0xFFFFFFFF)) == VM_SUSPENDED) {}
+    }
+    TEST_CHECK(result == VM_DONE && bench.result == iterations, "result %ld (%s), expected %ld",
+               (long)bench.result, bench.failed ? bench.error : "ok", (long)iterations);
+    uint64_t instructions = bench.stats.instructions;
+    uint64_t us = bench.stats.micros ? bench.stats.micros : 1;
+
+    // The same call a tick at a time must resume where it stopped
+    uint32_t slices = 0;
+    result = VM_ERROR;
+    if (vmLoadImage(bench, &image) && vmStart(bench, 0)) {
+        do {
+            result = vmRun(bench, VM_TICK_BUDGET);
+            slices++;
+        } while (result == VM_SUSPENDED);
+    }
+    uint32_t expected = (uint32_t)((instructions + VM_TICK_BUDGET - 1) / VM_TICK_BUDGET);
+    TEST_CHECK(result == VM_DONE && bench.result == iterations && bench.stats.instructions == instructions,
+               "sliced run gave %ld after %llu instructions, expected %ld after %llu",
+               (long)bench.result, bench.stats.instructions, (long)iterations, instructions);
+    TEST_CHECK(slices == expected, "%lu slices of %d instructions, expected %lu",
+               slices, VM_TICK_BUDGET, expected);
+
+    // One byte short of the header's sizes, and a bad magic
+    appImageWrap(&image, buffer, size - 1);
+    TEST_CHECK(!vmLoadImage(bench, &image), "truncated image loaded");
+    buffer[0] ^= 0xFF;
+    appImageWrap(&image, buffer, size);
+    TEST_CHECK(!vmLoadImage(bench, &image), "image with a bad magic loaded");
+
+    // Code that underflows the stack or runs off its end fails cleanly
+    static const uint8_t badCode[2][2] = { { OP_ADD, OP_RET }, { OP_NOP, OP_NOP } };
+    for (int i = 0; i < 2; i++) {
+        h.codeSize = sizeof(badCode[i]);
+        memcpy(buffer, &h, sizeof(h));
+        memcpy(buffer + sizeof(h), badCode[i], sizeof(badCode[i]));
+        appImageWrap(&image, buffer, sizeof(h) + sizeof(badCode[i]));
+        result = VM_DONE;
+        if (vmLoadImage(bench, &image) && vmStart(bench, 0)) result = vmRun(bench, VM_TICK_BUDGET);
+        TEST_CHECK(result == VM_ERROR && bench.failed, "bad code %d ran (%s)", i, bench.error);
+    }
+    heap_caps_free(buffer);
+
+    Serial.printf("VM benchmark: %ld iterations, %llu instructions in %llu us (%llu instr/ms), %lu ticks\n",
+                  (long)iterations, instructions, us, instructions * 1000 / us, slices);
+    return failures;
+}
+
+#endif // APP_VM_H
@@ -0,0 +1,384 @@
+/*
+ * Backlight
+ *
+ * PWM backlight with perceptual brightness, timed fades and auto-dim.
+ * - Levels are perceptual (0..255); a CIE 1931 lightness table turns
+ *   them into LEDC duty, so equal slider steps look equally bright
+ * - Fades are non-blocking: backlight_tick() advances them from the
+ *   loop scheduler, interpolating in perceptual space
+ * - Auto-dim: after BACKLIGHT_DIM_AFTER_MS without touch the panel
+ *   fades to BACKLIGHT_DIM_LEVEL, after BACKLIGHT_OFF_AFTER_MS it turns
+ *   off. The touch read path reports activity with backlight_touch();
+ *   the touch that wakes a dark screen is swallowed so it cannot click
+ *   whatever is under the finger
+ * - Duty goes through a backend; the default drives LEDC (Arduino core
+ *   2.x channel API or 3.x pin API), a mock backend records every write
+ *   with its time so fade timing can be checked without hardware
+ *
+ * Call backlight_init() after the display is initialised. Without a
+ * backlight pin (BACKLIGHT_PIN -1) the driver runs on the mock backend
+ * and auto-dim is off: the panel stays lit whatever the state says, so
+ * dimming would only swallow the next touch.
+ *
+ * runBacklightFadeTest() checks the timing on the mock backend, as host
+ * test and device check "backlight".
+ *
+ * File: backlight.h
+ */
+
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include <stdint.h>
+#include <math.h>
+#include "test_check.h"
+
+#ifndef BACKLIGHT_PIN
+#ifdef TFT_BL
+#define BACKLIGHT_PIN TFT_BL
+#else
+#define BACKLIGHT_PIN -1
+#endif
+#endif
+
+#define BACKLIGHT_LEDC_CHANNEL   0       // Arduino core 2.x only
+#define BACKLIGHT_PWM_FREQ       5000    // Hz, above visible flicker and below most coil whine
+#define BACKLIGHT_PWM_BITS       12
+#define BACKLIGHT_DUTY_MAX       ((1 << BACKLIGHT_PWM_BITS) - 1)
+
+#define BACKLIGHT_DIM_AFTER_MS   30000
+#define BACKLIGHT_OFF_AFTER_MS   60000
+#define BACKLIGHT_DIM_LEVEL      40
+#define BACKLIGHT_DIM_FADE_MS    600     // Fading down is slow, it should not catch the eye
+#define BACKLIGHT_WAKE_FADE_MS   150     // Fading up is quick, the user is waiting
+#define BACKLIGHT_FADE_STEP_MS   16      // Scheduler wake period while a fade runs
+
+#define BACKLIGHT_MOCK_LOG       256
+
+// Writes one duty value to the hardware
+typedef void (*BacklightWriteFunc)(uint16_t duty, uint32_t now);
+
+enum BacklightState : uint8_t {
+    BACKLIGHT_ACTIVE,
+    BACKLIGHT_DIMMED,
+    BACKLIGHT_OFF,
+};
+
+struct BacklightFade {
+    uint8_t from;
+    uint8_t to;
+    uint32_t start;
+    uint32_t duration;        // 0 when no fade runs
+};
+
+struct BacklightStats {
+    uint32_t writes;          // Duty changes sent to the backend
+    uint32_t fades;
+    uint32_t dims;
+    uint32_t offs;
+    uint32_t wakes;
+    uint32_t swallowed;       // Wake touches kept from LVGL
+};
+
+struct BacklightMockWrite {
+    uint32_t time;
+    uint16_t duty;
+};
+
+static uint16_t backlightLut[256];
+static BacklightWriteFunc backlightWrite = NULL;
+static bool backlightControlsPanel = false;  // Backend really drives the panel's light
+static BacklightState backlightState = BACKLIGHT_ACTIVE;
+static BacklightFade backlightFade = {0, 0, 0, 0};
+static uint8_t backlightUserLevel = 128;    // What the brightness setting asks for
+static uint8_t backlightLevel = 0;          // Perceptual level on the panel now
+static uint16_t backlightDuty = 0xFFFF;     // Last duty written, forces the first write
+static uint32_t backlightDimAfter = BACKLIGHT_DIM_AFTER_MS;
+static uint32_t backlightOffAfter = BACKLIGHT_OFF_AFTER_MS;
+static uint32_t backlightLastActivity = 0;
+static bool backlightSwallowing = false;    // Wake touch held down
+static BacklightStats backlightStats = {0, 0, 0, 0, 0, 0};
+
+static BacklightMockWrite backlightMockLog[BACKLIGHT_MOCK_LOG];
+static uint32_t backlightMockCount = 0;
+
+// CIE 1931 lightness: perceived brightness L* (0..100) -> luminance
+static void backlight_build_lut() {
+    for (int i = 0; i < 256; i++) {
+        float l = i * 100.0f / 255.0f;
+        float y = l > 8.0f ? powf((l + 16.0f) / 116.0f, 3.0f) : l / 903.3f;
+        uint16_t duty = (uint16_t)lroundf(y * BACKLIGHT_DUTY_MAX);
+        backlightLut[i] = (i > 0 && duty == 0) ? 1 : duty;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// BACKENDS
+// ═══════════════════════════════════════════════════════════════
+
+#if defined(ARDUINO)
+// The time is only for the mock log
+static void backlight_ledc_write(uint16_t duty, uint32_t) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcWrite(BACKLIGHT_PIN, duty);
+#else
+    ledcWrite(BACKLIGHT_LEDC_CHANNEL, duty);
+#endif
+}
+
+static bool backlight_ledc_begin() {
+    if (BACKLIGHT_PIN < 0) return false;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    return ledcAttach(BACKLIGHT_PIN, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_BITS);
+#else
+    ledcSetup(BACKLIGHT_LEDC_CHANNEL, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_BITS);
+    ledcAttachPin(BACKLIGHT_PIN, BACKLIGHT_LEDC_CHANNEL);
+    return true;
+#endif
+}
+#endif
+
+// Records writes instead of driving a pin
+static void backlight_mock_write(uint16_t duty, uint32_t now) {
+    if (backlightMockCount < BACKLIGHT_MOCK_LOG) {
+        backlightMockLog[backlightMockCount].time = now;
+        backlightMockLog[backlightMockCount].duty = duty;
+    }
+    backlightMockCount++;
+}
+
+// controlsPanel: writes change what the user sees, auto-dim may run
+void backlight_set_backend(BacklightWriteFunc write, bool controlsPanel = true) {
+    backlightWrite = write;
+    backlightControlsPanel = write && controlsPanel;
+    backlightDuty = 0xFFFF;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// OUTPUT AND FADES
+// ═══════════════════════════════════════════════════════════════
+
+static void backlight_apply(uint8_t level, uint32_t now) {
+    backlightLevel = level;
+    uint16_t duty = backlightLut[level];
+    if (duty == backlightDuty) return;
+    backlightDuty = duty;
+    backlightStats.writes++;
+    backlightWrite(duty, now);
+}
+
+// Fade from the current level to level over ms (0 = at once)
+void backlight_fade_to(uint8_t level, uint32_t ms, uint32_t now = millis()) {
+    if (ms == 0 || level == backlightLevel) {
+        backlightFade.duration = 0;
+        backlight_apply(level, now);
+        return;
+    }
+    backlightFade.from = backlightLevel;
+    backlightFade.to = level;
+    backlightFade.start = now;
+    backlightFade.duration = ms;
+    backlightStats.fades++;
+}
+
+bool backlight_fading() {
+    return backlightFade.duration != 0;
+}
+
+static void backlight_fade_step(uint32_t now) {
+    if (!backlightFade.duration) return;
+    uint32_t elapsed = now - backlightFade.start;
+    if (elapsed >= backlightFade.duration) {
+        backlightFade.duration = 0;
+        backlight_apply(backlightFade.to, now);
+        return;
+    }
+    int32_t delta = (int32_t)backlightFade.to - backlightFade.from;
+    backlight_apply(backlightFade.from + delta * (int32_t)elapsed / (int32_t)backlightFade.duration, now);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API
+// ═══════════════════════════════════════════════════════════════
+
+void backlight_init(uint8_t level) {
+    backlight_build_lut();
+    backlightUserLevel = level;
+    backlight_set_backend(backlight_mock_write, false);
+#if defined(ARDUINO)
+    if (backlight_ledc_begin()) backlight_set_backend(backlight_ledc_write);
+    else Serial.println("Backlight: no PWM pin, using the mock backend, auto-dim off");
+#endif
+    backlightState = BACKLIGHT_ACTIVE;
+    backlightLastActivity = millis();
+    backlight_fade_to(level, BACKLIGHT_WAKE_FADE_MS, backlightLastActivity);
+}
+
+// Brightness setting; shown at once unless the screen is dimmed or off.
+// Before backlight_init() it only sets the level init fades in to.
+void backlight_set_level(uint8_t level, uint32_t now = millis()) {
+    backlightUserLevel = level;
+    if (backlightWrite && backlightState == BACKLIGHT_ACTIVE) backlight_fade_to(level, 0, now);
+}
+
+// 0 disables a stage
+void backlight_set_timeouts(uint32_t dimAfterMs, uint32_t offAfterMs) {
+    backlightDimAfter = dimAfterMs;
+    backlightOffAfter = offAfterMs;
+}
+
+// Touch read path: report every sample. Returns true while the touch
+// that woke a dark screen is down; it must not reach LVGL.
+bool backlight_touch(bool pressed, uint32_t now = millis()) {
+    if (!backlightControlsPanel) return false;
+    if (!pressed) {
+        backlightSwallowing = false;
+        return false;
+    }
+    backlightLastActivity = now;
+
+    if (backlightState != BACKLIGHT_ACTIVE) {
+        if (backlightState == BACKLIGHT_OFF && !backlightSwallowing) {
+            backlightSwallowing = true;
+            backlightStats.swallowed++;
+        }
+        backlightState = BACKLIGHT_ACTIVE;
+        backlightStats.wakes++;
+        backlight_fade_to(backlightUserLevel, BACKLIGHT_WAKE_FADE_MS, now);
+    }
+    return backlightSwallowing;
+}
+
+// Loop scheduler: advance fades and the auto-dim timers. Auto-dim needs a
+// backend that really lights the panel.
+void backlight_tick(uint32_t now) {
+    if (!backlightWrite) return;
+    uint32_t idle = now - backlightLastActivity;
+
+    if (backlightControlsPanel && backlightState == BACKLIGHT_ACTIVE && backlightDimAfter && idle >= backlightDimAfter) {
+        backlightState = BACKLIGHT_DIMMED;
+        backlightStats.dims++;
+        uint8_t dim = backlightUserLevel < BACKLIGHT_DIM_LEVEL ? backlightUserLevel : BACKLIGHT_DIM_LEVEL;
+        backlight_fade_to(dim, BACKLIGHT_DIM_FADE_MS, now);
+    }
+    if (backlightControlsPanel && backlightState != BACKLIGHT_OFF && backlightOffAfter && idle >= backlightOffAfter) {
+        backlightState = BACKLIGHT_OFF;
+        backlightStats.offs++;
+        backlight_fade_to(0, BACKLIGHT_DIM_FADE_MS, now);
+    }
+    backlight_fade_step(now);
+}
+
+BacklightState backlight_state() {
+    return backlightState;
+}
+
+void printBacklightStats() {
+    static const char * states[] = { "active", "dimmed", "off" };
+    Serial.println("\n=== Backlight ===");
+    Serial.printf("State: %s, level %u (setting %u), duty %u / %u\n",
+                  states[backlightState], backlightLevel, backlightUserLevel,
+                  backlightDuty == 0xFFFF ? 0 : backlightDuty, BACKLIGHT_DUTY_MAX);
+    Serial.printf("Dim after %lu ms, off after %lu ms, idle %lu ms\n",
+                  backlightDimAfter, backlightOffAfter, millis() - backlightLastActivity);
+    Serial.printf("Writes: %lu, fades: %lu, dims: %lu, offs: %lu, wakes: %lu (%lu touches swallowed)\n",
+                  backlightStats.writes, backlightStats.fades, backlightStats.dims,
+                  backlightStats.offs, backlightStats.wakes, backlightStats.swallowed);
+    Serial.println("=================\n");
+}
+
+// ═══════════════════════════════════════════════════════════════
+// FADE TIMING TEST
+// ═══════════════════════════════════════════════════════════════
+
+// Drives the state machine on a synthetic clock against the mock
+// backend and checks fade and auto-dim timing. Restores the live
+// backend afterwards. Returns the number of failures.
+uint32_t runBacklightFadeTest() {
+    uint32_t failures = 0;
+    BacklightWriteFunc liveWrite = backlightWrite;
+    bool liveControls = backlightControlsPanel;
+    uint8_t liveLevel = backlightUserLevel;
+    uint32_t liveDim = backlightDimAfter, liveOff = backlightOffAfter;
+    if (!backlightLut[255]) backlight_build_lut();
+
+    // 1. Fade 0 -> 255 over 300 ms, ticked every 16 ms
+    backlight_set_backend(backlight_mock_write);
+    backlightMockCount = 0;
+    backlightState = BACKLIGHT_ACTIVE;
+    backlight_set_timeouts(0, 0);
+    uint32_t t = 1000;
+    backlight_fade_to(0, 0, t);
+    backlightMockCount = 0;
+    backlight_fade_to(255, 300, t);
+    uint8_t mid = 0;
+    for (uint32_t now = t; now <= t + 400; now += BACKLIGHT_FADE_STEP_MS) {
+        backlight_tick(now);
+        if (now - t <= 150) mid = backlightLevel;
+    }
+    bool monotonic = true;
+    for (uint32_t i = 1; i < backlightMockCount && i < BACKLIGHT_MOCK_LOG; i++) {
+        if (backlightMockLog[i].duty < backlightMockLog[i - 1].duty) monotonic = false;
+    }
+    const BacklightMockWrite &last = backlightMockLog[(backlightMockCount - 1) % BACKLIGHT_MOCK_LOG];
+    TEST_CHECK(monotonic, "fade up is not monotonic");
+    TEST_CHECK(last.duty == BACKLIGHT_DUTY_MAX, "fade ended at duty %u", last.duty);
+    TEST_CHECK(last.time >= t + 300 && last.time < t + 300 + BACKLIGHT_FADE_STEP_MS,
+               "fade ended after %lu ms", last.time - t);
+    TEST_CHECK(mid >= 120 && mid <= 135, "level %u half way, expected ~127", mid);
+    TEST_CHECK(!backlight_fading(), "fade still running");
+
+    // 2. Auto-dim at 1 s, off at 2 s, a touch wakes it and is swallowed
+    backlight_set_timeouts(1000, 2000);
+    backlightUserLevel = 200;
+    t = 10000;
+    backlight_touch(true, t);
+    backlight_touch(false, t);
+    backlight_fade_to(200, 0, t);
+    uint32_t dimmedAt = 0, offAt = 0;
+    for (uint32_t now = t; now <= t + 3000; now += 50) {
+        backlight_tick(now);
+        if (!dimmedAt && backlightState == BACKLIGHT_DIMMED) dimmedAt = now - t;
+        if (!offAt && backlightState == BACKLIGHT_OFF) offAt = now - t;
+    }
+    TEST_CHECK(dimmedAt >= 1000 && dimmedAt < 1050, "dimmed after %lu ms", dimmedAt);
+    TEST_CHECK(offAt >= 2000 && offAt < 2050, "off after %lu ms", offAt);
+    TEST_CHECK(backlightDuty == 0, "duty %u once off", backlightDuty);
+
+    t += 3000;
+    bool swallowed = backlight_touch(true, t);
+    bool held = true;
+    for (uint32_t now = t; now <= t + 200; now += BACKLIGHT_FADE_STEP_MS) {
+        held = held && backlight_touch(true, now);
+        backlight_tick(now);
+    }
+    bool released = backlight_touch(false, t + 200);
+    TEST_CHECK(swallowed && held && !released, "wake touch not swallowed until release");
+    TEST_CHECK(backlightState == BACKLIGHT_ACTIVE && backlightLevel == 200,
+               "woke to level %u", backlightLevel);
+    TEST_CHECK(!backlight_touch(true, t + 300), "touch on a lit screen swallowed");
+    backlight_touch(false, t + 320);
+
+    // 3. A backend that does not light the panel never dims or swallows
+    backlight_set_backend(backlight_mock_write, false);
+    t += 1000;
+    backlight_touch(true, t);
+    backlight_touch(false, t);
+    for (uint32_t now = t; now <= t + 3000; now += 50) backlight_tick(now);
+    TEST_CHECK(backlightState == BACKLIGHT_ACTIVE, "dimmed without a real backend");
+    TEST_CHECK(!backlight_touch(true, t + 3000), "touch swallowed without a real backend");
+    backlight_touch(false, t + 3020);
+
+    Serial.printf("Backlight fade test: %lu mock writes, %lu failures\n", backlightMockCount, failures);
+
+    // Back to the live panel
+    backlight_set_backend(liveWrite, liveControls);
+    backlight_set_timeouts(liveDim, liveOff);
+    backlightUserLevel = liveLevel;
+    backlightState = BACKLIGHT_ACTIVE;
+    backlightLastActivity = millis();
+    if (backlightWrite) backlight_fade_to(liveLevel, 0);
+    return failures;
+}
+
+#endif // BACKLIGHT_H
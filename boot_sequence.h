@@ -0,0 +1,267 @@
+/*
+ * Boot Sequence
+ *
+ * Staged boot: the home screen first, everything else after.
+ * - setup() marks the synchronous stages (display, LVGL, UI) with
+ *   boot_mark(); each stage is timed from the previous mark
+ * - Work that is not needed for the first frame is registered as a
+ *   deferred job with the jobs it depends on. A job starts once all of
+ *   them have finished; when one fails, its dependents are skipped
+ * - Worker jobs (pure I/O, like mounting the SD card) run on the worker
+ *   core while the UI task brings up the display. UI jobs (anything that
+ *   shares state with LVGL or the launchers) run on the UI task, one per
+ *   LVGL timer pass, so frames keep coming in between
+ * - Time to first pixel is when the first frame has finished transferring
+ *   to the panel (display_flush.h); printBootProfile() shows it together
+ *   with every stage and job
+ *
+ * UI task only, except for the worker side of worker jobs.
+ *
+ * File: boot_sequence.h
+ */
+
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <lvgl.h>
+#include "task_model.h"
+#include "display_flush.h"
+
+#define BOOT_MAX_STAGES  12
+#define BOOT_MAX_JOBS    8
+#define BOOT_JOB_PERIOD_MS  1    // UI job timer, one job per run
+
+// Returns false when the job failed; its dependents are skipped
+typedef bool (*BootJobFunc)();
+typedef void (*BootDoneFunc)();
+
+enum BootJobState : uint8_t {
+    BOOT_JOB_WAITING,
+    BOOT_JOB_RUNNING,
+    BOOT_JOB_DONE,
+    BOOT_JOB_FAILED,
+    BOOT_JOB_SKIPPED,       // A dependency failed
+};
+
+enum BootJobContext : uint8_t {
+    BOOT_ON_UI,
+    BOOT_ON_WORKER,
+};
+
+struct BootStage {
+    const char * name;
+    uint32_t endMicros;
+    uint32_t micros;
+};
+
+struct BootJob {
+    const char * name;
+    BootJobFunc fn;
+    uint32_t deps;          // Bit per job index
+    BootJobContext context;
+    BootJobState state;     // UI task only
+    bool ok;                // Result, written by the job's own task
+    uint32_t readyMicros;   // All dependencies finished
+    uint32_t startMicros;
+    uint32_t endMicros;
+};
+
+static BootStage bootStages[BOOT_MAX_STAGES];
+static int bootStageCount = 0;
+static BootJob bootJobs[BOOT_MAX_JOBS];
+static int bootJobCount = 0;
+static uint32_t bootStartMicros = 0;
+static uint32_t bootLastMark = 0;
+static uint32_t bootCompleteMicros = 0;
+static lv_timer_t * bootTimer = NULL;
+static BootDoneFunc bootDone = NULL;
+
+static const char * const bootJobStateNames[] = { "waiting", "running", "done", "FAILED", "skipped" };
+
+// ═══════════════════════════════════════════════════════════════
+// STAGES
+// ═══════════════════════════════════════════════════════════════
+
+// Call first thing in setup()
+void boot_begin() {
+    bootStartMicros = bootLastMark = micros();
+    bootStageCount = 0;
+    bootJobCount = 0;
+    bootCompleteMicros = 0;
+}
+
+// The stage name ends now, it started at the previous mark
+void boot_mark(const char * name) {
+    uint32_t now = micros();
+    if (bootStageCount < BOOT_MAX_STAGES) {
+        bootStages[bootStageCount].name = name;
+        bootStages[bootStageCount].endMicros = now;
+        bootStages[bootStageCount].micros = now - bootLastMark;
+        bootStageCount++;
+    }
+    bootLastMark = now;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DEFERRED JOBS
+// ═══════════════════════════════════════════════════════════════
+
+static void boot_dispatch();
+
+static bool boot_finished(const BootJob &job) {
+    return job.state >= BOOT_JOB_DONE;
+}
+
+// UI task: a worker job has finished
+static void boot_job_done(void * arg) {
+    BootJob * job = (BootJob *)arg;
+    job->state = job->ok ? BOOT_JOB_DONE : BOOT_JOB_FAILED;
+    boot_dispatch();
+}
+
+// Worker side of a worker job
+static void boot_worker_job(void * arg) {
+    BootJob * job = (BootJob *)arg;
+    job->startMicros = micros();
+    job->ok = job->fn();
+    job->endMicros = micros();
+    while (!ui_post_call(boot_job_done, job)) delay(5);
+}
+
+static void boot_timer_cb(lv_timer_t * timer) {
+    // One ready UI job per run, frames render in between
+    for (int i = 0; i < bootJobCount; i++) {
+        BootJob &job = bootJobs[i];
+        if (job.context != BOOT_ON_UI || job.state != BOOT_JOB_RUNNING || job.startMicros) continue;
+        job.startMicros = micros();
+        job.ok = job.fn();
+        job.endMicros = micros();
+        job.state = job.ok ? BOOT_JOB_DONE : BOOT_JOB_FAILED;
+        break;
+    }
+    boot_dispatch();
+}
+
+// Start every job whose dependencies are met; finish when none are left
+static void boot_dispatch() {
+    uint32_t now = micros();
+
+    // Skipping a job can make its own dependents skippable, repeat until stable
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int i = 0; i < bootJobCount; i++) {
+            BootJob &job = bootJobs[i];
+            if (job.state != BOOT_JOB_WAITING) continue;
+            bool ready = true;
+            bool failed = false;
+            for (int d = 0; d < bootJobCount; d++) {
+                if (!(job.deps & (1u << d))) continue;
+                if (!boot_finished(bootJobs[d])) ready = false;
+                else if (bootJobs[d].state != BOOT_JOB_DONE) failed = true;
+            }
+            if (failed) {
+                job.state = BOOT_JOB_SKIPPED;
+                changed = true;
+            } else if (ready) {
+                job.readyMicros = now;
+                job.state = BOOT_JOB_RUNNING;
+                if (job.context == BOOT_ON_WORKER && !worker_post(boot_worker_job, &job)) {
+                    job.state = BOOT_JOB_WAITING;   // Retried next dispatch
+                }
+                // UI jobs are picked up by boot_timer_cb
+            }
+        }
+    }
+
+    bool pendingUi = false;
+    bool unfinished = false;
+    for (int i = 0; i < bootJobCount; i++) {
+        if (bootJobs[i].context == BOOT_ON_UI && bootJobs[i].state == BOOT_JOB_RUNNING) pendingUi = true;
+        if (!boot_finished(bootJobs[i])) unfinished = true;
+    }
+
+    // UI jobs need LVGL's timers; before lv_init() they wait for the next boot_start()
+    if (pendingUi && lv_is_initialized()) {
+        if (!bootTimer) bootTimer = lv_timer_create(boot_timer_cb, BOOT_JOB_PERIOD_MS, NULL);
+        lv_timer_resume(bootTimer);
+    } else if (bootTimer) {
+        lv_timer_pause(bootTimer);
+    }
+
+    if (!unfinished && bootJobCount && !bootCompleteMicros) {
+        bootCompleteMicros = micros();
+        if (bootTimer) {
+            lv_timer_del(bootTimer);
+            bootTimer = NULL;
+        }
+        if (bootDone) bootDone();
+    }
+}
+
+// Register a deferred job; deps is a mask of the job indexes it waits
+// for (1 << index). Returns the job's index, -1 when the table is full.
+int boot_add_job(const char * name, BootJobFunc fn, uint32_t deps, BootJobContext context) {
+    if (bootJobCount >= BOOT_MAX_JOBS) return -1;
+    BootJob &job = bootJobs[bootJobCount];
+    memset(&job, 0, sizeof(job));
+    job.name = name;
+    job.fn = fn;
+    job.deps = deps;
+    job.context = context;
+    return bootJobCount++;
+}
+
+// Start the jobs that are ready. Call once the jobs are registered (worker
+// jobs start right away) and again after lv_init() for the UI jobs.
+void boot_start() {
+    boot_dispatch();
+}
+
+// Called on the UI task once every job has finished
+void boot_on_complete(BootDoneFunc done) {
+    bootDone = done;
+}
+
+bool boot_complete() {
+    return bootCompleteMicros != 0;
+}
+
+// Job finished successfully
+bool boot_job_ok(int index) {
+    return index >= 0 && index < bootJobCount && bootJobs[index].state == BOOT_JOB_DONE;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PROFILE
+// ═══════════════════════════════════════════════════════════════
+
+void printBootProfile() {
+    uint32_t firstPixel = display_first_frame_micros();
+    Serial.println("\n=== Boot Profile ===");
+    Serial.printf("setup() entered at %lu ms after reset\n", bootStartMicros / 1000);
+    for (int i = 0; i < bootStageCount; i++) {
+        const BootStage &s = bootStages[i];
+        Serial.printf("  %-16s %6lu.%lu ms  (at %lu ms)\n", s.name, s.micros / 1000, (s.micros / 100) % 10,
+                      (s.endMicros - bootStartMicros) / 1000);
+    }
+    if (firstPixel) Serial.printf("Time to first pixel: %lu ms after setup(), %lu ms after reset\n",
+                                  (firstPixel - bootStartMicros) / 1000, firstPixel / 1000);
+    else Serial.println("Time to first pixel: no frame yet");
+
+    Serial.println("Deferred jobs:");
+    for (int i = 0; i < bootJobCount; i++) {
+        const BootJob &j = bootJobs[i];
+        Serial.printf("  %-16s %-7s %-6s", j.name, bootJobStateNames[j.state],
+                      j.context == BOOT_ON_WORKER ? "worker" : "ui");
+        if (j.startMicros) Serial.printf(" %6lu.%lu ms  (start %lu ms, waited %lu ms)",
+                                         (j.endMicros - j.startMicros) / 1000, ((j.endMicros - j.startMicros) / 100) % 10,
+                                         (j.startMicros - bootStartMicros) / 1000,
+                                         (j.startMicros - j.readyMicros) / 1000);
+        Serial.println();
+    }
+    if (bootCompleteMicros) Serial.printf("Boot complete: %lu ms after setup()\n",
+                                          (bootCompleteMicros - bootStartMicros) / 1000);
+    Serial.println("====================\n");
+}
+
+#endif // BOOT_SEQUENCE_H
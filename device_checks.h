@@ -0,0 +1,138 @@
+/*
+ * Device Checks
+ *
+ * One serial command for the self-tests and benchmarks that need the
+ * board itself (panel, card, PSRAM, a running UI). The pure logic is
+ * checked on the host instead, see tools/host_tests.cpp.
+ *
+ * With DEBUG_MODE on, send "checks" over serial to run all of them, or
+ * "checks <name>" for one. Run them from the home screen with no app
+ * open; every check restores the state it changes.
+ *
+ * File: device_checks.h
+ */
+
+#ifndef DEVICE_CHECKS_H
+#define DEVICE_CHECKS_H
+
+#include "display_flush.h"
+#include "task_model.h"
+#include "modular_app_loader.h"
+#include "eez_sd_bridge.h"
+#include "settings_store.h"
+#include "backlight.h"
+#include "radio_manager.h"
+#include "image_assets.h"
+
+#define DEVICE_CHECK_LINE_MAX 32
+
+struct DeviceCheck {
+    const char * name;
+    uint32_t (*run)();      // Returns the number of failures
+};
+
+// ═══════════════════════════════════════════════════════════════
+// CHECKS
+// ═══════════════════════════════════════════════════════════════
+
+static uint32_t device_check_display() {
+    runDisplayBenchmark(30);
+    return runDisplayOverlapTest();
+}
+
+// The host runs these on std::thread, here they cover the FreeRTOS queues
+static uint32_t device_check_tasks() {
+    return runTaskModelAppLoopTest() + runTaskModelStressTest();
+}
+
+// Index matching on a synthetic listing, then the real launcher open path
+static uint32_t device_check_apps() {
+    return runAppIndexBenchmark() + runLauncherOpenBenchmark();
+}
+
+// Same as the host test, here it measures the interpreter on the target
+static uint32_t device_check_vm() {
+    return runVmBenchmark();
+}
+
+static uint32_t device_check_widgets() {
+    return runWidgetRegistryTest() + run_widget_lookup_benchmark();
+}
+
+// Replay as on the host, then the compaction cut points on the card
+static uint32_t device_check_settings() {
+    return runSettingsPowerLossTest();
+}
+
+// Runs on the mock backend, then fades the live panel back in
+static uint32_t device_check_backlight() {
+    return runBacklightFadeTest();
+}
+
+// Simulated radios on the real worker; the live backend is restored
+static uint32_t device_check_radio() {
+    return runRadioManagerTest();
+}
+
+// Decoder checks as on the host, then decode times from flash into PSRAM
+static uint32_t device_check_images() {
+    return runImageAssetDecodeTest() + runImageAssetBenchmark();
+}
+
+static const DeviceCheck deviceChecks[] = {
+    { "display", device_check_display },
+    { "tasks", device_check_tasks },
+    { "apps", device_check_apps },
+    { "vm", device_check_vm },
+    { "widgets", device_check_widgets },
+    { "settings", device_check_settings },
+    { "backlight", device_check_backlight },
+    { "radio", device_check_radio },
+    { "images", device_check_images },
+};
+
+#define DEVICE_CHECK_COUNT (sizeof(deviceChecks) / sizeof(deviceChecks[0]))
+
+// ═══════════════════════════════════════════════════════════════
+// COMMAND
+// ═══════════════════════════════════════════════════════════════
+
+// Run every check, or only the one called name. Returns the failures.
+uint32_t runDeviceChecks(const char * name = NULL) {
+    uint32_t failures = 0, ran = 0;
+    uint32_t start = millis();
+    for (size_t i = 0; i < DEVICE_CHECK_COUNT; i++) {
+        if (name && strcmp(name, deviceChecks[i].name) != 0) continue;
+        Serial.printf("\n--- %s ---\n", deviceChecks[i].name);
+        failures += deviceChecks[i].run();
+        ran++;
+    }
+    if (!ran) {
+        Serial.printf("No check called %s, have:", name);
+        for (size_t i = 0; i < DEVICE_CHECK_COUNT; i++) Serial.printf(" %s", deviceChecks[i].name);
+        Serial.println();
+        return 0;
+    }
+    Serial.printf("\nDevice checks: %lu run, %lu failures (%lu ms)\n", ran, failures, millis() - start);
+    return failures;
+}
+
+// Read the serial command, UI task (called from loop() in debug builds)
+void deviceChecksPoll() {
+    static char line[DEVICE_CHECK_LINE_MAX];
+    static size_t len = 0;
+
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (len < sizeof(line) - 1) line[len++] = c;
+            continue;
+        }
+        line[len] = '\0';
+        len = 0;
+        if (strcmp(line, "checks") == 0) runDeviceChecks();
+        else if (strncmp(line, "checks ", 7) == 0) runDeviceChecks(line + 7);
+    }
+}
+
+#endif // DEVICE_CHECKS_H
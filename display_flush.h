@@ -0,0 +1,480 @@
+/*
+ * Display Flush Pipeline
+ *
+ * Double-buffered LVGL flush with asynchronous panel transfers.
+ * LVGL renders into one draw buffer while the other one is still
+ * being sent to the panel over SPI DMA. lv_disp_flush_ready() is only
+ * called from the completion path (display_flush_poll), never from
+ * inside the flush callback itself.
+ *
+ * Draw buffer strategies (pick per board variant):
+ * - PARTIAL_STRIP:   2 x 10 lines in internal RAM (~12KB, old default)
+ * - LARGE_PARTIAL:   2 x 80 lines in internal RAM (~100KB)
+ * - FULL_FRAME_PSRAM: 2 full frames in PSRAM, LVGL direct mode, only
+ *                     dirty areas are sent to the panel
+ *
+ * The panel is reached through a small backend struct so the same
+ * pipeline can drive TFT_eSPI or a mock panel that only simulates
+ * transfer time; runDisplayOverlapTest() uses it to measure how much
+ * rendering overlaps the transfers.
+ *
+ * File: display_flush.h
+ */
+
+#ifndef DISPLAY_FLUSH_H
+#define DISPLAY_FLUSH_H
+
+#include <lvgl.h>
+#include <TFT_eSPI.h>
+#include <esp_heap_caps.h>
+#include "test_check.h"
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+enum DisplayBufferStrategy {
+    DISPLAY_BUF_PARTIAL_STRIP = 0,
+    DISPLAY_BUF_LARGE_PARTIAL,
+    DISPLAY_BUF_FULL_FRAME_PSRAM
+};
+
+// Default strategy for this board (override before including)
+#ifndef DISPLAY_BUFFER_STRATEGY
+#define DISPLAY_BUFFER_STRATEGY DISPLAY_BUF_PARTIAL_STRIP
+#endif
+
+#define DISPLAY_STRIP_LINES 10
+#define DISPLAY_LARGE_LINES 80
+
+// Internal RAM bounce buffer used to DMA strided or PSRAM pixels
+#define DISPLAY_BOUNCE_PIXELS (320 * 16)
+
+// Last resort single draw buffer when no strategy could allocate,
+// static so it never depends on the heap
+#define DISPLAY_FALLBACK_PIXELS (320 * 4)
+
+// Panel backend - start() must not block on the last chunk of the transfer.
+// stride is the row pitch of pixels in pixels (equals the area width
+// unless LVGL renders straight into a full frame buffer).
+struct DisplayFlushBackend {
+    void (*begin)();
+    void (*start)(const lv_area_t * area, const uint16_t * pixels, uint32_t stride);
+    bool (*busy)();
+    void (*wait)();
+};
+
+// Pipeline statistics (reset with resetDisplayFlushStats)
+struct DisplayFlushStats {
+    uint32_t frames;          // Completed refreshes (last area flushed)
+    uint32_t flushes;         // Areas sent to the panel
+    uint64_t pixels;          // Pixels sent to the panel
+    uint32_t transferMicros;  // Time spent with a transfer in flight
+    uint32_t stallMicros;     // Time LVGL waited for a transfer
+    uint32_t refreshMillis;   // Total refresh time reported by LVGL
+    uint32_t refreshes;       // Refreshes reported by LVGL
+    uint32_t startMillis;     // Start of the measuring window
+    uint32_t blockingFlushes; // Areas pushed without DMA (no bounce buffers)
+};
+
+static DisplayFlushStats flushStats = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+static uint32_t flushFirstFrameMicros = 0;   // First frame on the panel, micros() since reset
+static const DisplayFlushBackend * flushBackend = NULL;
+
+// Active buffer configuration
+static DisplayBufferStrategy flushStrategy = DISPLAY_BUF_PARTIAL_STRIP;
+static lv_color_t * flushBuf1 = NULL;
+static lv_color_t * flushBuf2 = NULL;
+static size_t flushBufBytes = 0;
+static lv_color_t flushFallbackBuf[DISPLAY_FALLBACK_PIXELS];
+
+// Transfer currently in flight (NULL when the panel is idle)
+static lv_disp_drv_t * volatile flushPendingDrv = NULL;
+static bool flushPendingLast = false;
+static uint32_t flushStartMicros = 0;
+
+static const char * displayBufferStrategyName(DisplayBufferStrategy s) {
+    switch (s) {
+        case DISPLAY_BUF_PARTIAL_STRIP:    return "partial strip";
+        case DISPLAY_BUF_LARGE_PARTIAL:    return "large partial";
+        case DISPLAY_BUF_FULL_FRAME_PSRAM: return "full frame (PSRAM)";
+    }
+    return "?";
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TFT_eSPI DMA BACKEND
+// ═══════════════════════════════════════════════════════════════
+
+extern TFT_eSPI my_lcd;
+
+static uint16_t * tftBounce[2] = {NULL, NULL};
+
+static void tft_dma_begin() {
+    my_lcd.initDMA();
+    my_lcd.setSwapBytes(true);  // pushColors(..., true) did this before
+    my_lcd.startWrite();        // Keep the bus claimed for DMA transfers
+}
+
+static void tft_dma_start(const lv_area_t * area, const uint16_t * pixels, uint32_t stride) {
+    uint32_t w = (area->x2 - area->x1 + 1);
+    uint32_t h = (area->y2 - area->y1 + 1);
+
+    if (stride == w && esp_ptr_dma_capable(pixels)) {
+        // Bytes are swapped in place, LVGL overwrites the buffer next frame anyway
+        my_lcd.pushImageDMA(area->x1, area->y1, w, h, (uint16_t *)pixels);
+        return;
+    }
+
+    // Strided or PSRAM source: gather rows into the two internal bounce
+    // buffers so one chunk is copied while the previous one transfers
+    if (!tftBounce[0]) {
+        tftBounce[0] = (uint16_t *)heap_caps_malloc(DISPLAY_BOUNCE_PIXELS * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        tftBounce[1] = (uint16_t *)heap_caps_malloc(DISPLAY_BOUNCE_PIXELS * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!tftBounce[0] || !tftBounce[1]) {
+            heap_caps_free(tftBounce[0]);
+            heap_caps_free(tftBounce[1]);
+            tftBounce[0] = tftBounce[1] = NULL;
+        }
+    }
+
+    // No DMA-capable memory left: blocking push straight from the source
+    if (!tftBounce[0]) {
+        flushStats.blockingFlushes++;
+        my_lcd.dmaWait();
+        my_lcd.setAddrWindow(area->x1, area->y1, w, h);
+        for (uint32_t y = 0; y < h; y++) {
+            my_lcd.pushPixels(pixels + y * stride, w);
+        }
+        return;
+    }
+
+    uint32_t rowsPerChunk = DISPLAY_BOUNCE_PIXELS / w;
+    int toggle = 0;
+    for (uint32_t y = 0; y < h; y += rowsPerChunk) {
+        uint32_t rows = min(rowsPerChunk, h - y);
+        uint16_t * dst = tftBounce[toggle];
+        for (uint32_t r = 0; r < rows; r++) {
+            memcpy(dst + r * w, pixels + (y + r) * stride, w * 2);
+        }
+        my_lcd.dmaWait();
+        my_lcd.pushImageDMA(area->x1, area->y1 + y, w, rows, dst);
+        toggle ^= 1;
+    }
+}
+
+static bool tft_dma_busy() {
+    return my_lcd.dmaBusy();
+}
+
+static void tft_dma_wait() {
+    my_lcd.dmaWait();
+}
+
+static const DisplayFlushBackend tftDmaBackend = {
+    tft_dma_begin,
+    tft_dma_start,
+    tft_dma_busy,
+    tft_dma_wait
+};
+
+// ═══════════════════════════════════════════════════════════════
+// MOCK PANEL BACKEND
+// ═══════════════════════════════════════════════════════════════
+
+// Nothing is sent, a transfer just stays busy for as long as the SPI bus
+// would need, so the pipeline can be measured without the panel
+#define DISPLAY_MOCK_NS_PER_PIXEL 400   // 16 bit pixels at 40 MHz
+
+static uint32_t mockPanelDoneMicros = 0;
+static bool mockPanelBlocking = false;  // start() returns when the transfer is done
+
+static void mock_panel_begin() {
+}
+
+static void mock_panel_start(const lv_area_t * area, const uint16_t * pixels, uint32_t stride) {
+    uint32_t us = (uint32_t)((uint64_t)lv_area_get_size(area) * DISPLAY_MOCK_NS_PER_PIXEL / 1000);
+    mockPanelDoneMicros = micros() + us;
+    if (mockPanelBlocking) {
+        while ((int32_t)(micros() - mockPanelDoneMicros) < 0) {}
+    }
+}
+
+static bool mock_panel_busy() {
+    return (int32_t)(micros() - mockPanelDoneMicros) < 0;
+}
+
+static void mock_panel_wait() {
+    while (mock_panel_busy()) {}
+}
+
+static const DisplayFlushBackend mockPanelBackend = {
+    mock_panel_begin,
+    mock_panel_start,
+    mock_panel_busy,
+    mock_panel_wait
+};
+
+// ═══════════════════════════════════════════════════════════════
+// FLUSH PIPELINE
+// ═══════════════════════════════════════════════════════════════
+
+// Signal LVGL once the in-flight transfer is done.
+// Called from wait_cb while LVGL renders and from loop() when idle.
+void display_flush_poll() {
+    lv_disp_drv_t * drv = flushPendingDrv;
+    if (!drv || flushBackend->busy()) return;
+
+    uint32_t now = micros();
+    flushStats.transferMicros += now - flushStartMicros;
+    if (flushPendingLast) {
+        if (!flushFirstFrameMicros) flushFirstFrameMicros = now;
+        flushStats.frames++;
+    }
+
+    flushPendingDrv = NULL;
+    lv_disp_flush_ready(drv);
+}
+
+// When the first complete frame reached the panel (micros() since
+// reset), 0 before that. The boot profile's time to first pixel.
+uint32_t display_first_frame_micros() {
+    return flushFirstFrameMicros;
+}
+
+// LVGL calls this while it has nothing to render but the
+// previous buffer is still flushing
+static void display_flush_wait_cb(lv_disp_drv_t * drv) {
+    uint32_t start = micros();
+    if (flushBackend->busy()) flushBackend->wait();
+    display_flush_poll();
+    flushStats.stallMicros += micros() - start;
+}
+
+static void display_flush_monitor_cb(lv_disp_drv_t * drv, uint32_t time, uint32_t px) {
+    flushStats.refreshMillis += time;
+    flushStats.refreshes++;
+}
+
+// Direct mode with two frame buffers: after the last area of a frame the
+// buffers swap, so copy this frame's dirty areas into the other buffer
+// to keep both in sync before LVGL draws the next frame there
+static void syncDirtyAreas(lv_disp_drv_t * drv, const lv_color_t * from) {
+    lv_color_t * to = (from == flushBuf1) ? flushBuf2 : flushBuf1;
+    lv_disp_t * disp = _lv_refr_get_disp_refreshing();
+    lv_coord_t stride = drv->hor_res;
+
+    for (uint16_t i = 0; i < disp->inv_p; i++) {
+        if (disp->inv_area_joined[i]) continue;
+
+        const lv_area_t * a = &disp->inv_areas[i];
+        uint32_t w = lv_area_get_width(a);
+        for (lv_coord_t y = a->y1; y <= a->y2; y++) {
+            memcpy(to + y * stride + a->x1, from + y * stride + a->x1, w * sizeof(lv_color_t));
+        }
+    }
+}
+
+void display_flush_cb(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_p) {
+    // LVGL only hands us a new area after the previous one was released,
+    // so the panel is idle here and the other buffer is free to render into
+    flushStartMicros = micros();
+    flushPendingLast = lv_disp_flush_is_last(drv);
+    flushPendingDrv = drv;
+
+    flushStats.flushes++;
+    flushStats.pixels += (uint32_t)lv_area_get_size(area);
+
+    if (drv->direct_mode) {
+        // color_p is the whole frame buffer, send only the dirty rectangle
+        const lv_color_t * first = color_p + area->y1 * drv->hor_res + area->x1;
+        flushBackend->start(area, (const uint16_t *)&first->full, drv->hor_res);
+        if (flushPendingLast) syncDirtyAreas(drv, color_p);
+    } else {
+        flushBackend->start(area, (const uint16_t *)&color_p->full, lv_area_get_width(area));
+    }
+}
+
+// Allocate both draw buffers for a strategy, returns pixels per buffer
+static uint32_t allocDrawBuffers(DisplayBufferStrategy strategy, lv_coord_t w, lv_coord_t h) {
+    uint32_t pixels;
+    uint32_t caps;
+
+    switch (strategy) {
+        case DISPLAY_BUF_FULL_FRAME_PSRAM:
+            pixels = (uint32_t)w * h;
+            caps = MALLOC_CAP_SPIRAM;
+            break;
+        case DISPLAY_BUF_LARGE_PARTIAL:
+            pixels = (uint32_t)w * DISPLAY_LARGE_LINES;
+            caps = MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL;
+            break;
+        default:
+            pixels = (uint32_t)w * DISPLAY_STRIP_LINES;
+            caps = MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL;
+            break;
+    }
+
+    flushBuf1 = (lv_color_t *)heap_caps_malloc(pixels * sizeof(lv_color_t), caps);
+    flushBuf2 = (lv_color_t *)heap_caps_malloc(pixels * sizeof(lv_color_t), caps);
+    if (!flushBuf1 || !flushBuf2) {
+        free(flushBuf1);
+        free(flushBuf2);
+        flushBuf1 = flushBuf2 = NULL;
+        return 0;
+    }
+
+    if (strategy == DISPLAY_BUF_FULL_FRAME_PSRAM) {
+        // Both frames start identical so syncDirtyAreas only has to copy deltas
+        memset(flushBuf1, 0, pixels * sizeof(lv_color_t));
+        memset(flushBuf2, 0, pixels * sizeof(lv_color_t));
+    }
+
+    flushBufBytes = 2 * pixels * sizeof(lv_color_t);
+    return pixels;
+}
+
+// Set up both draw buffers and hook the pipeline into a display driver.
+// hor_res/ver_res must already be set. Falls back to a smaller strategy
+// when the requested memory is not available (e.g. no PSRAM).
+void initDisplayFlush(lv_disp_drv_t * drv, lv_disp_draw_buf_t * draw_buf,
+                      const DisplayFlushBackend * backend,
+                      DisplayBufferStrategy strategy = (DisplayBufferStrategy)DISPLAY_BUFFER_STRATEGY) {
+    flushBackend = backend ? backend : &tftDmaBackend;
+    flushBackend->begin();
+
+    uint32_t pixels = 0;
+    for (int s = strategy; s >= DISPLAY_BUF_PARTIAL_STRIP && pixels == 0; s--) {
+        flushStrategy = (DisplayBufferStrategy)s;
+        pixels = allocDrawBuffers(flushStrategy, drv->hor_res, drv->ver_res);
+    }
+    if (pixels == 0) {
+        // LVGL must never get a NULL buffer, render slowly instead
+        Serial.printf("Draw buffer: out of memory, using a static %u pixel buffer\n",
+                      DISPLAY_FALLBACK_PIXELS);
+        flushStrategy = DISPLAY_BUF_PARTIAL_STRIP;
+        flushBuf1 = flushFallbackBuf;
+        flushBuf2 = NULL;
+        flushBufBytes = sizeof(flushFallbackBuf);
+        pixels = DISPLAY_FALLBACK_PIXELS;
+    } else if (flushStrategy != strategy) {
+        Serial.printf("Draw buffer: %s unavailable, using %s\n",
+                      displayBufferStrategyName(strategy),
+                      displayBufferStrategyName(flushStrategy));
+    }
+
+    lv_disp_draw_buf_init(draw_buf, flushBuf1, flushBuf2, pixels);
+    drv->draw_buf = draw_buf;
+    drv->direct_mode = (flushStrategy == DISPLAY_BUF_FULL_FRAME_PSRAM);
+    drv->flush_cb = display_flush_cb;
+    drv->wait_cb = display_flush_wait_cb;
+    drv->monitor_cb = display_flush_monitor_cb;
+
+    flushStats.startMillis = millis();
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STATISTICS / BENCHMARK
+// ═══════════════════════════════════════════════════════════════
+
+void resetDisplayFlushStats() {
+    memset(&flushStats, 0, sizeof(flushStats));
+    flushStats.startMillis = millis();
+}
+
+void printDisplayFlushStats() {
+    uint32_t elapsed = millis() - flushStats.startMillis;
+    if (elapsed == 0) elapsed = 1;
+    uint32_t refreshes = flushStats.refreshes ? flushStats.refreshes : 1;
+    uint32_t flushes = flushStats.flushes ? flushStats.flushes : 1;
+
+    Serial.println("\n=== Display Flush ===");
+    Serial.printf("Strategy: %s, buffers: %u KB\n",
+                  displayBufferStrategyName(flushStrategy), flushBufBytes / 1024);
+    Serial.printf("Frames: %lu (%lu.%lu fps)\n", flushStats.frames,
+                  flushStats.frames * 1000 / elapsed,
+                  (flushStats.frames * 10000 / elapsed) % 10);
+    Serial.printf("Areas: %lu, Pixels: %llu\n", flushStats.flushes, flushStats.pixels);
+    if (flushStats.blockingFlushes) Serial.printf("Blocking pushes (no bounce buffers): %lu\n", flushStats.blockingFlushes);
+    Serial.printf("Refresh: %lu ms avg, flush: %lu us avg per area\n",
+                  flushStats.refreshMillis / refreshes, flushStats.transferMicros / flushes);
+    Serial.printf("Transfer: %lu ms, LVGL stalled: %lu ms\n",
+                  flushStats.transferMicros / 1000, flushStats.stallMicros / 1000);
+    // Transfer time not spent stalling is time rendering overlapped the SPI bus
+    Serial.printf("Overlap: %lu ms\n",
+                  (flushStats.transferMicros - min(flushStats.transferMicros, flushStats.stallMicros)) / 1000);
+    Serial.printf("Free heap: %lu KB, free PSRAM: %lu KB\n",
+                  ESP.getFreeHeap() / 1024, ESP.getFreePsram() / 1024);
+    Serial.println("=====================\n");
+}
+
+// Force full-screen redraws of the active screen and print the result.
+// Run once per strategy to compare them on a given board.
+void runDisplayBenchmark(uint32_t frames) {
+    resetDisplayFlushStats();
+    for (uint32_t i = 0; i < frames; i++) {
+        lv_obj_invalidate(lv_scr_act());
+        lv_refr_now(NULL);
+    }
+    flushBackend->wait();
+    display_flush_poll();
+    printDisplayFlushStats();
+}
+
+// ═══════════════════════════════════════════════════════════════
+// OVERLAP TEST
+// ═══════════════════════════════════════════════════════════════
+
+// Redraws the active screen on the mock panel, first with transfers that
+// block inside the flush, then asynchronous ones. The asynchronous run
+// has to deliver every frame and be faster by the time rendering
+// overlapped the bus. The live backend is restored and the real panel
+// redrawn afterwards. Returns the number of failures.
+uint32_t runDisplayOverlapTest(uint32_t frames = 30) {
+    uint32_t failures = 0;
+    const DisplayFlushBackend * liveBackend = flushBackend;
+    liveBackend->wait();
+    display_flush_poll();
+    flushBackend = &mockPanelBackend;
+
+    // [0] asynchronous, [1] blocking
+    uint32_t runMicros[2];
+    uint32_t runFrames[2];
+    uint32_t stallMicros = 0;
+    for (int blocking = 1; blocking >= 0; blocking--) {
+        mockPanelBlocking = blocking;
+        resetDisplayFlushStats();
+        uint32_t start = micros();
+        for (uint32_t i = 0; i < frames; i++) {
+            lv_obj_invalidate(lv_scr_act());
+            lv_refr_now(NULL);
+        }
+        mock_panel_wait();
+        display_flush_poll();
+        runMicros[blocking] = micros() - start;
+        runFrames[blocking] = flushStats.frames;
+        if (!blocking) stallMicros = flushStats.stallMicros;
+    }
+
+    TEST_CHECK(runFrames[1] == frames, "blocking run delivered %lu of %lu frames", runFrames[1], frames);
+    TEST_CHECK(runFrames[0] == frames, "asynchronous run delivered %lu of %lu frames", runFrames[0], frames);
+    TEST_CHECK(runMicros[0] < runMicros[1], "no overlap: %lu us asynchronous vs %lu us blocking",
+               runMicros[0], runMicros[1]);
+
+    Serial.printf("Display overlap test (%s, %d ns/pixel): blocking %lu.%lu fps, asynchronous %lu.%lu fps, "
+                  "overlap %ld ms, stalled %lu ms, %lu failures\n",
+                  displayBufferStrategyName(flushStrategy), DISPLAY_MOCK_NS_PER_PIXEL,
+                  (uint32_t)(frames * 1000000ull / runMicros[1]), (uint32_t)(frames * 10000000ull / runMicros[1] % 10),
+                  (uint32_t)(frames * 1000000ull / runMicros[0]), (uint32_t)(frames * 10000000ull / runMicros[0] % 10),
+                  ((int32_t)runMicros[1] - (int32_t)runMicros[0]) / 1000, stallMicros / 1000, failures);
+
+    // Back to the live panel
+    mockPanelBlocking = false;
+    flushBackend = liveBackend;
+    resetDisplayFlushStats();
+    lv_obj_invalidate(lv_scr_act());
+    return failures;
+}
+
+#endif // DISPLAY_FLUSH_H
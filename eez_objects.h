@@ -0,0 +1,26 @@
+/*
+ * EEZ object names, generated by tools/eez_objects.py - do not edit
+ *
+ * Source: screens.h (objects_t, 8 fields)
+ *
+ * File: eez_objects.h
+ */
+
+#ifndef EEZ_OBJECTS_H
+#define EEZ_OBJECTS_H
+
+#define EEZ_OBJECT_COUNT 8
+
+// objects_t field names, in field order
+static const char * const eezObjectNames[EEZ_OBJECT_COUNT] = {
+    "main",        // 0
+    "test_screen", // 1
+    "rtc",         // 2
+    "obj0",        // 3
+    "obj1",        // 4
+    "obj2",        // 5
+    "obj3",        // 6
+    "success",     // 7
+};
+
+#endif // EEZ_OBJECTS_H
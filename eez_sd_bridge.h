@@ -5,6 +5,17 @@
  * with app functions stored on SD card
  * 
  * Add this to your project as: eez_sd_bridge.h
+ * 
+ * Widgets are looked up through the hashed widget registry
+ * (widget_registry.h), which holds the EEZ objects of the screen on
+ * display by field name. A name that is not registered falls back to
+ * the label on the active screen showing that text; the label is then
+ * registered until its screen is unloaded, so later lookups are O(1)
+ * and a hidden screen is never updated.
+ * 
+ * Events reach SD apps through per-app routing tables indexed by an
+ * integer action ID, so dispatch is an array index whatever the number
+ * of apps or buttons (see ACTION ROUTER).
  */
 
 #ifndef EEZ_SD_BRIDGE_H
@@ -12,44 +23,56 @@
 
 #include <lvgl.h>
 #include "ui.h"
+#include "screens.h"
+#include "widget_registry.h"
+#include "test_check.h"
+#include <esp_heap_caps.h>
 
 // ═══════════════════════════════════════════════════════════════
 // WIDGET FINDER - Get EEZ widgets by name/type
 // ═══════════════════════════════════════════════════════════════
 
-// Find a label widget on current screen by searching
-lv_obj_t * find_label_by_text(const char* text) {
-    lv_obj_t * screen = lv_scr_act();
-    
-    // Iterate through all children
-    uint32_t child_cnt = lv_obj_get_child_cnt(screen);
+// Find a label below root showing text, at any depth
+static lv_obj_t * find_label_in(lv_obj_t * root, const char * text) {
+    uint32_t child_cnt = lv_obj_get_child_cnt(root);
     for(uint32_t i = 0; i < child_cnt; i++) {
-        lv_obj_t * child = lv_obj_get_child(screen, i);
+        lv_obj_t * child = lv_obj_get_child(root, i);
         
         // Check if it's a label
         if(lv_obj_check_type(child, &lv_label_class)) {
-            const char * label_text = lv_label_get_text(child);
-            if(strcmp(label_text, text) == 0) {
+            if(strcmp(lv_label_get_text(child), text) == 0) {
                 return child;
             }
         }
         
         // Search recursively
-        uint32_t subchild_cnt = lv_obj_get_child_cnt(child);
-        for(uint32_t j = 0; j < subchild_cnt; j++) {
-            lv_obj_t * subchild = lv_obj_get_child(child, j);
-            if(lv_obj_check_type(subchild, &lv_label_class)) {
-                const char * label_text = lv_label_get_text(subchild);
-                if(strcmp(label_text, text) == 0) {
-                    return subchild;
-                }
-            }
-        }
+        lv_obj_t * found = find_label_in(child, text);
+        if (found) return found;
     }
-    
     return NULL;
 }
 
+// Find a label widget on current screen by searching (walks the tree,
+// prefer find_widget() for anything called repeatedly)
+lv_obj_t * find_label_by_text(const char* text) {
+    return find_label_in(lv_scr_act(), text);
+}
+
+// Find a widget by EEZ object name or label text on the active screen,
+// O(1) after the first call until the screen is unloaded
+lv_obj_t * find_widget(const char * name) {
+    lv_obj_t * obj = widget_find(name);
+    if (obj) return obj;
+
+    obj = find_label_by_text(name);
+    if (obj) {
+        // Cleared with the rest of the screen's entries when it unloads
+        widget_attach_screen(lv_scr_act());
+        widget_register(name, obj);
+    }
+    return obj;
+}
+
 // Store reference to frequently used widgets
 static lv_obj_t * cached_widgets[20];
 static int cached_widget_count = 0;
@@ -72,10 +95,13 @@ void clear_widget_cache() {
 static int currentAppScreenId = -1;
 static char currentAppName[32] = "";
 
+static void sd_app_activate_routes(const char* app_name);
+
 void set_current_app(const char* app_name, int screen_id) {
     strncpy(currentAppName, app_name, 31);
     currentAppScreenId = screen_id;
     clear_widget_cache();
+    sd_app_activate_routes(app_name);
     
     Serial.printf("Current app: %s (Screen %d)\n", app_name, screen_id);
 }
@@ -96,6 +122,81 @@ int get_current_app_screen_id() {
 typedef void (*SDAppEventHandler)(lv_event_t * e);
 typedef void (*SDAppButtonHandler)(const char* button_data);
 typedef void (*SDAppVoidHandler)();
+typedef void (*SDAppActionHandler)(lv_event_t * e, uint16_t action);
+
+#define SD_APP_ROUTE_APPS   32      // Apps with routing tables
+#define SD_ACTION_MAX       256     // Action IDs per app, 0..SD_ACTION_MAX-1
+
+// One app's routes. Tables are allocated in PSRAM the first time an app
+// registers a route and kept, so reloading an app just overwrites them.
+struct SDAppRoutes {
+    uint32_t nameHash;              // kvKeyRuntime() of the app name
+    SDAppButtonHandler button;      // Label-text handler for generic buttons
+    SDAppActionHandler actions[SD_ACTION_MAX];
+};
+
+static SDAppRoutes * sdAppRoutes[SD_APP_ROUTE_APPS];
+static int sdAppRouteCount = 0;
+static SDAppRoutes * activeRoutes = NULL;   // Routes of currentAppName
+static uint32_t sdAppDispatched = 0;
+static uint32_t sdAppUnrouted = 0;
+
+// Routing table of an app, created on first use. Called when apps load
+// and switch, never per event.
+static SDAppRoutes * sd_app_routes(const char* app_name, bool create) {
+    uint32_t hash = kvKeyRuntime(app_name, strlen(app_name));
+    for (int i = 0; i < sdAppRouteCount; i++) {
+        if (sdAppRoutes[i]->nameHash == hash) return sdAppRoutes[i];
+    }
+    if (!create || sdAppRouteCount >= SD_APP_ROUTE_APPS) return NULL;
+    
+    SDAppRoutes * routes = (SDAppRoutes *)heap_caps_calloc(1, sizeof(SDAppRoutes), MALLOC_CAP_SPIRAM);
+    if (!routes) routes = (SDAppRoutes *)heap_caps_calloc(1, sizeof(SDAppRoutes), MALLOC_CAP_8BIT);
+    if (!routes) return NULL;
+    routes->nameHash = hash;
+    sdAppRoutes[sdAppRouteCount++] = routes;
+    return routes;
+}
+
+static void sd_app_activate_routes(const char* app_name) {
+    activeRoutes = sd_app_routes(app_name, false);
+}
+
+// Register a handler for an action ID, typically in the app's setup
+bool sd_app_register_action(const char* app_name, uint16_t action, SDAppActionHandler handler) {
+    if (action >= SD_ACTION_MAX) return false;
+    SDAppRoutes * routes = sd_app_routes(app_name, true);
+    if (!routes) return false;
+    routes->actions[action] = handler;
+    if (strcmp(app_name, currentAppName) == 0) activeRoutes = routes;
+    return true;
+}
+
+// Register the handler generic_app_button_handler() routes to
+bool sd_app_register_button_handler(const char* app_name, SDAppButtonHandler handler) {
+    SDAppRoutes * routes = sd_app_routes(app_name, true);
+    if (!routes) return false;
+    routes->button = handler;
+    if (strcmp(app_name, currentAppName) == 0) activeRoutes = routes;
+    return true;
+}
+
+// Dispatch an action of the current app: one bounds check, one index
+void sd_app_dispatch(uint16_t action, lv_event_t * e) {
+    SDAppActionHandler handler = (activeRoutes && action < SD_ACTION_MAX) ? activeRoutes->actions[action] : NULL;
+    if (!handler) {
+        sdAppUnrouted++;
+        return;
+    }
+    sdAppDispatched++;
+    handler(e, action);
+}
+
+// LVGL event callback for widgets built in code: the action ID is the
+// user data, lv_obj_add_event_cb(btn, sd_app_event_cb, LV_EVENT_CLICKED, (void*)ACTION_ID)
+void sd_app_event_cb(lv_event_t * e) {
+    sd_app_dispatch((uint16_t)(uintptr_t)lv_event_get_user_data(e), e);
+}
 
 // Action router for button clicks
 void route_to_sd_app(lv_event_t * e, SDAppButtonHandler handler) {
@@ -118,17 +219,12 @@ void route_to_sd_app(lv_event_t * e, SDAppButtonHandler handler) {
 // SIMPLIFIED ACTION HANDLERS
 // ═══════════════════════════════════════════════════════════════
 
-// Example: Generic button handler that routes to SD app
+// Generic button handler: routes to the current app's button handler
+// (sd_app_register_button_handler), no per-app string comparisons
 void generic_app_button_handler(lv_event_t * e) {
-    if (strcmp(currentAppName, "Calculator") == 0) {
-        extern void calc_handle_button(const char* btn);
-        route_to_sd_app(e, calc_handle_button);
+    if (activeRoutes && activeRoutes->button) {
+        route_to_sd_app(e, activeRoutes->button);
     }
-    else if (strcmp(currentAppName, "Keyboard") == 0) {
-        extern void keyboard_handle_button(const char* btn);
-        route_to_sd_app(e, keyboard_handle_button);
-    }
-    // Add more apps as needed
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -146,10 +242,22 @@ void on_screen_loaded(int screen_id) {
     }
 }
 
-// Update a label by searching for it
+// Update a label found by EEZ name or by the text it showed first.
+// The first call resolves it, later ones are a hash lookup, so the
+// label keeps being found after its text changed, as long as its
+// screen stays on display.
 void update_label(const char* search_text, const char* new_text) {
-    lv_obj_t * label = find_label_by_text(search_text);
-    if (label) {
+    lv_obj_t * label = find_widget(search_text);
+    if (label && lv_obj_check_type(label, &lv_label_class)) {
+        lv_label_set_text(label, new_text);
+    }
+}
+
+// Same with a compile-time key, e.g. update_label_id(kvKey("display"), "display", text),
+// for EEZ objects and labels registered with widget_register(); never walks
+void update_label_id(uint32_t key, const char* name, const char* new_text) {
+    lv_obj_t * label = widget_find_key(key, name);
+    if (label && lv_obj_check_type(label, &lv_label_class)) {
         lv_label_set_text(label, new_text);
     }
 }
@@ -164,7 +272,7 @@ void update_label(const char* search_text, const char* new_text) {
 
 #include "eez_sd_bridge.h"
 
-// When calculator app launches
+// When calculator app launches (its setup registers the routes below)
 void action_launch_calculator() {
     set_current_app("Calculator", 5);  // Screen ID 5
     loadScreen(5);
@@ -173,6 +281,12 @@ void action_launch_calculator() {
     calculator_app_setup();
 }
 
+// EEZ actions with a fixed ID dispatch straight into the table
+enum { CALC_ACTION_CLEAR = 1, CALC_ACTION_EQUALS = 2 };
+void action_calc_clear(lv_event_t * e) {
+    sd_app_dispatch(CALC_ACTION_CLEAR, e);
+}
+
 // Calculator number buttons (0-9, all use same action)
 void action_calc_number(lv_event_t * e) {
     extern void calc_handle_number(const char* digit);
@@ -200,6 +314,13 @@ void action_calc_button(lv_event_t * e) {
 
 // In /apps/calculator_app.h on SD card:
 
+// Register handlers once at load time
+void calculator_app_setup() {
+    sd_app_register_button_handler("Calculator", calc_handle_button);
+    sd_app_register_action("Calculator", CALC_ACTION_CLEAR, calc_clear);
+    sd_app_register_action("Calculator", CALC_ACTION_EQUALS, calc_equals);
+}
+
 // Calculator uses the bridge to update display
 void calc_handle_button(const char* btn) {
     static char display[32] = "0";
@@ -230,6 +351,14 @@ void calc_handle_button(const char* btn) {
 // DEBUGGING HELPERS
 // ═══════════════════════════════════════════════════════════════
 
+void print_sd_app_routes() {
+    Serial.println("\n=== SD App Routes ===");
+    Serial.printf("Apps with routes: %d / %d (active: %s)\n", sdAppRouteCount, SD_APP_ROUTE_APPS,
+                  activeRoutes ? currentAppName : "none");
+    Serial.printf("Dispatched: %lu, unrouted: %lu\n", sdAppDispatched, sdAppUnrouted);
+    Serial.println("=====================\n");
+}
+
 void debug_print_screen_widgets() {
     lv_obj_t * screen = lv_scr_act();
     Serial.println("\n=== Current Screen Widgets ===");
@@ -252,4 +381,52 @@ void debug_print_screen_widgets() {
     Serial.println("==============================\n");
 }
 
+// Compare the tree walk with registry lookups on a throwaway screen of
+// `labels` labels nested three deep, `lookups` lookups each. Also checks
+// that a lookup under the same key with another name misses and that
+// clearing the screen drops its entries. Returns the number of failures.
+uint32_t run_widget_lookup_benchmark(int labels = 200, int lookups = 1000) {
+    uint32_t failures = 0;
+    lv_obj_t * screen = lv_obj_create(NULL);
+    lv_obj_t * parent = screen;
+    char text[16];
+    for (int i = 0; i < labels; i++) {
+        if (i % 8 == 0) {
+            parent = lv_obj_create(lv_obj_create(screen));
+        }
+        snprintf(text, sizeof(text), "label %d", i);
+        lv_obj_t * label = lv_label_create(parent);
+        lv_label_set_text(label, text);
+        if (i == labels - 1) widget_register(text, label);
+    }
+    
+    // Worst case for the walk: the last label, the only one registered
+    snprintf(text, sizeof(text), "label %d", labels - 1);
+    uint32_t key = kvKeyRuntime(text, strlen(text));
+    
+    uint32_t start = micros();
+    lv_obj_t * walked = NULL;
+    for (int i = 0; i < lookups; i++) walked = find_label_in(screen, text);
+    uint32_t walkUs = micros() - start;
+    
+    start = micros();
+    lv_obj_t * hashed = NULL;
+    for (int i = 0; i < lookups; i++) hashed = widget_find_key(key, text);
+    uint32_t hashUs = micros() - start;
+    
+    TEST_CHECK(walked && walked == hashed, "walk and registry found different labels");
+    TEST_CHECK(!widget_find_key(key, "label x"), "a different name under the same key was a hit");
+    widget_clear_screen(screen);
+    TEST_CHECK(!widget_find(text), "entry survived clearing its screen");
+    
+    Serial.println("\n=== Widget Lookup Benchmark ===");
+    Serial.printf("%d labels, %d lookups\n", labels, lookups);
+    Serial.printf("Tree walk: %lu us (%lu ns each)\n", walkUs, walkUs * 1000 / lookups);
+    Serial.printf("Registry:  %lu us (%lu ns each)\n", hashUs, hashUs * 1000 / lookups);
+    Serial.println("===============================\n");
+    
+    lv_obj_del(screen);
+    return failures;
+}
+
 #endif // EEZ_SD_BRIDGE_H
@@ -0,0 +1,378 @@
+/*
+ * App Icon Atlas
+ *
+ * Packs every launcher icon into one pre-scaled RGB565 cache file so
+ * scrolling the launcher never opens or decodes individual images.
+ * - Apps declare icon=<file> in their .app or .manifest file
+ *   (relative to /apps/, see app_registry.h)
+ * - iconAtlasSync() runs on the worker: when the set of icons changed
+ *   (signature over paths and file sizes), the atlas is rebuilt into
+ *   ICON_ATLAS_TMP and renamed over ICON_ATLAS_PATH
+ * - Icons are ICON_SIZE x ICON_SIZE, native RGB565 (LV_IMG_CF_TRUE_COLOR)
+ * - A small atlas is read into PSRAM once and rows point straight into
+ *   it; a larger one stays on SD and single icons are streamed
+ *
+ * The device builds icons from uncompressed BMP (16/24/32 bit) or raw
+ * 40x40 .rgb565 files. PNG icons need tools/icon_atlas.py, which writes
+ * the same file format and signature from the PC.
+ *
+ * Layout: IconAtlasHeader, count IconAtlasEntry sorted by key, then
+ * count icons of ICON_BYTES each.
+ *
+ * File: icon_atlas.h
+ */
+
+#ifndef ICON_ATLAS_H
+#define ICON_ATLAS_H
+
+#include <lvgl.h>
+#include "SD_MMC.h"
+#include <FS.h>
+#include <esp_heap_caps.h>
+#include "kv_parser.h"
+#include "task_model.h"
+#include "storage_stats.h"
+
+#define ICON_ATLAS_PATH     "/apps/.icons.atlas"
+#define ICON_ATLAS_TMP      "/apps/.icons.tmp"
+#define ICON_ATLAS_MAGIC    0x31414349   // "ICA1"
+#define ICON_ATLAS_VERSION  1
+#define ICON_SIZE           40
+#define ICON_BYTES          (ICON_SIZE * ICON_SIZE * 2)
+#define ICON_ATLAS_MAX      64
+#define ICON_ATLAS_MAP_MAX  (128 * 1024)  // Read into PSRAM up to this size
+#define ICON_BG_COLOR       0xF8F8F8      // Alpha is blended onto the row colour
+
+struct IconAtlasHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint16_t iconW;
+    uint16_t iconH;
+    uint32_t signature;
+};
+
+struct IconAtlasEntry {
+    uint32_t key;           // kvKeyRuntime() of the full icon path
+    uint32_t offset;        // From the start of the file
+};
+
+struct IconAtlasStats {
+    uint32_t builds;
+    uint32_t buildMs;
+    uint32_t hits;          // Icons served from the PSRAM copy
+    uint32_t streamed;      // Icons read from SD
+    uint32_t missing;
+};
+
+// Icons wanted by the launcher, set by iconAtlasSync()
+static char iconAtlasPaths[ICON_ATLAS_MAX][64];
+static int iconAtlasPathCount = 0;
+
+static IconAtlasEntry iconAtlasEntries[ICON_ATLAS_MAX];
+static int iconAtlasCount = 0;
+static uint8_t * iconAtlasMap = NULL;           // Whole file in PSRAM, or NULL
+static fs::File iconAtlasFile;                  // Streaming when not mapped
+static std::atomic<bool> iconAtlasReady(false);
+static std::atomic<bool> iconAtlasBusy(false);
+static TaskJobFunc iconAtlasOnReady = NULL;     // Called on the UI task
+static IconAtlasStats iconAtlasStats = {0, 0, 0, 0, 0};
+
+// ═══════════════════════════════════════════════════════════════
+// DECODING
+// ═══════════════════════════════════════════════════════════════
+
+static inline uint16_t iconRgb565(uint8_t r, uint8_t g, uint8_t b) {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+static inline uint8_t iconBlend(uint8_t c, uint8_t bg, uint8_t a) {
+    return (c * a + bg * (255 - a)) / 255;
+}
+
+static inline uint32_t iconLe32(const uint8_t * p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Nearest-neighbour scale a BMP to ICON_SIZE, one source row read per icon row
+static bool iconDecodeBmp(fs::File &file, uint16_t * out) {
+    uint8_t hdr[54];
+    if (file.read(hdr, sizeof(hdr)) != sizeof(hdr) || hdr[0] != 'B' || hdr[1] != 'M') return false;
+
+    uint32_t dataOffset = iconLe32(hdr + 10);
+    int32_t w = (int32_t)iconLe32(hdr + 18);
+    int32_t h = (int32_t)iconLe32(hdr + 22);
+    uint16_t bpp = hdr[28] | (hdr[29] << 8);
+    uint32_t compression = iconLe32(hdr + 30);
+
+    bool topDown = h < 0;
+    if (topDown) h = -h;
+    if (w <= 0 || h <= 0 || w > 1024 || h > 1024) return false;
+    if (bpp != 16 && bpp != 24 && bpp != 32) return false;
+    if (compression != 0 && compression != 3) return false;
+    bool rgb555 = (bpp == 16 && compression == 0);
+
+    uint32_t stride = ((w * bpp + 31) / 32) * 4;
+    uint8_t * row = (uint8_t *)malloc(stride);
+    if (!row) return false;
+
+    const uint8_t bgR = (ICON_BG_COLOR >> 16) & 0xFF, bgG = (ICON_BG_COLOR >> 8) & 0xFF, bgB = ICON_BG_COLOR & 0xFF;
+    bool ok = true;
+    for (int y = 0; y < ICON_SIZE && ok; y++) {
+        int sy = y * h / ICON_SIZE;
+        int fileRow = topDown ? sy : h - 1 - sy;
+        ok = file.seek(dataOffset + fileRow * stride) && file.read(row, stride) == stride;
+
+        for (int x = 0; ok && x < ICON_SIZE; x++) {
+            const uint8_t * p = row + (x * w / ICON_SIZE) * (bpp / 8);
+            uint16_t c;
+            if (bpp == 16) {
+                uint16_t v = p[0] | (p[1] << 8);
+                c = rgb555 ? ((v & 0x7FE0) << 1) | (v & 0x1F) : v;
+            } else if (bpp == 24) {
+                c = iconRgb565(p[2], p[1], p[0]);
+            } else {
+                uint8_t a = p[3];
+                c = iconRgb565(iconBlend(p[2], bgR, a), iconBlend(p[1], bgG, a), iconBlend(p[0], bgB, a));
+            }
+            out[y * ICON_SIZE + x] = c;
+        }
+    }
+    free(row);
+    return ok;
+}
+
+// Decode one icon file into ICON_BYTES of RGB565
+static bool iconDecodeFile(const char * path, uint16_t * out) {
+    fs::File file = SD_MMC.open(path);
+    if (!file) return false;
+
+    bool ok = false;
+    size_t len = strlen(path);
+    if (len > 7 && strcasecmp(path + len - 7, ".rgb565") == 0) {
+        ok = file.size() == ICON_BYTES && file.read((uint8_t *)out, ICON_BYTES) == ICON_BYTES;
+    } else if (len > 4 && strcasecmp(path + len - 4, ".bmp") == 0) {
+        ok = iconDecodeBmp(file, out);
+    }
+    file.close();
+    return ok;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// BUILD (worker core)
+// ═══════════════════════════════════════════════════════════════
+
+// Order independent, so the PC tool does not need the SD directory order
+static uint32_t iconAtlasSignature() {
+    uint32_t sig = kvKey("icons") ^ iconAtlasPathCount;
+    for (int i = 0; i < iconAtlasPathCount; i++) {
+        fs::File f = SD_MMC.open(iconAtlasPaths[i]);
+        uint32_t size = f ? f.size() : 0;
+        if (f) f.close();
+        uint32_t h = kvKeyRuntime(iconAtlasPaths[i], strlen(iconAtlasPaths[i]));
+        sig += (h ^ size) * 2654435761u;
+    }
+    return sig;
+}
+
+static int iconEntryCompare(const void * a, const void * b) {
+    uint32_t ka = ((const IconAtlasEntry *)a)->key, kb = ((const IconAtlasEntry *)b)->key;
+    return ka < kb ? -1 : ka > kb ? 1 : 0;
+}
+
+static bool iconAtlasBuild(uint32_t signature) {
+    uint32_t start = millis();
+    uint16_t * pixels = (uint16_t *)malloc(ICON_BYTES);
+    if (!pixels) return false;
+
+    // Table first so the icons can be written in table order
+    IconAtlasHeader header = {ICON_ATLAS_MAGIC, ICON_ATLAS_VERSION, 0, ICON_SIZE, ICON_SIZE, signature};
+    IconAtlasEntry entries[ICON_ATLAS_MAX];
+    for (int i = 0; i < iconAtlasPathCount; i++) {
+        entries[i].key = kvKeyRuntime(iconAtlasPaths[i], strlen(iconAtlasPaths[i]));
+        entries[i].offset = i;   // Path index until sorted
+    }
+    qsort(entries, iconAtlasPathCount, sizeof(IconAtlasEntry), iconEntryCompare);
+    header.count = iconAtlasPathCount;
+
+    fs::File out = SD_MMC.open(ICON_ATLAS_TMP, FILE_WRITE);
+    if (!out) {
+        free(pixels);
+        return false;
+    }
+
+    uint32_t dataStart = sizeof(header) + header.count * sizeof(IconAtlasEntry);
+    int pathIndex[ICON_ATLAS_MAX];
+    for (int i = 0; i < header.count; i++) {
+        pathIndex[i] = entries[i].offset;
+        entries[i].offset = dataStart + i * ICON_BYTES;
+    }
+    uint32_t tableBytes = header.count * sizeof(IconAtlasEntry);
+    bool ok = out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              out.write((const uint8_t *)entries, tableBytes) == tableBytes;
+
+    for (int i = 0; i < header.count && ok; i++) {
+        const char * path = iconAtlasPaths[pathIndex[i]];
+        if (!iconDecodeFile(path, pixels)) {
+            // Keep the slot so offsets stay fixed; placeholder colour
+            Serial.printf("Icon atlas: cannot decode %s (PNG needs tools/icon_atlas.py)\n", path);
+            for (int p = 0; p < ICON_SIZE * ICON_SIZE; p++) pixels[p] = iconRgb565(0x21, 0x96, 0xF3);
+        }
+        ok = out.write((const uint8_t *)pixels, ICON_BYTES) == ICON_BYTES;
+    }
+    out.close();
+    free(pixels);
+    if (!ok) {
+        Serial.println("Icon atlas: write failed");
+        SD_MMC.remove(ICON_ATLAS_TMP);
+        return false;
+    }
+
+    if (!storage_replace_file(ICON_ATLAS_TMP, ICON_ATLAS_PATH)) return false;
+
+    iconAtlasStats.builds++;
+    iconAtlasStats.buildMs = millis() - start;
+    Serial.printf("Icon atlas: built %d icons in %lu ms\n", header.count, iconAtlasStats.buildMs);
+    return true;
+}
+
+// Open the atlas and load its table, mapping it into PSRAM when small
+static bool iconAtlasOpen(uint32_t signature) {
+    fs::File file = SD_MMC.open(ICON_ATLAS_PATH);
+    if (!file) return false;
+
+    IconAtlasHeader header;
+    bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == ICON_ATLAS_MAGIC && header.version == ICON_ATLAS_VERSION &&
+              header.iconW == ICON_SIZE && header.iconH == ICON_SIZE &&
+              header.signature == signature && header.count <= ICON_ATLAS_MAX;
+    if (ok) {
+        uint32_t tableBytes = header.count * sizeof(IconAtlasEntry);
+        ok = file.read((uint8_t *)iconAtlasEntries, tableBytes) == tableBytes;
+    }
+    if (!ok) {
+        file.close();
+        return false;
+    }
+    iconAtlasCount = header.count;
+
+    uint32_t size = file.size();
+    if (size <= ICON_ATLAS_MAP_MAX) {
+        iconAtlasMap = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+        if (iconAtlasMap && (!file.seek(0) || file.read(iconAtlasMap, size) != size)) {
+            heap_caps_free(iconAtlasMap);
+            iconAtlasMap = NULL;
+        }
+    }
+    if (iconAtlasMap) file.close();
+    else iconAtlasFile = file;
+    return true;
+}
+
+static void iconAtlasClose() {
+    iconAtlasReady = false;
+    if (iconAtlasMap) {
+        heap_caps_free(iconAtlasMap);
+        iconAtlasMap = NULL;
+    }
+    if (iconAtlasFile) iconAtlasFile.close();
+    iconAtlasCount = 0;
+}
+
+static void iconAtlasSyncJob(void * arg) {
+    uint32_t signature = iconAtlasSignature();
+    if (!iconAtlasOpen(signature)) {
+        if (iconAtlasPathCount > 0 && iconAtlasBuild(signature)) iconAtlasOpen(signature);
+    }
+    iconAtlasReady = iconAtlasCount > 0;
+    iconAtlasBusy = false;
+    if (iconAtlasReady && iconAtlasOnReady) ui_post_call(iconAtlasOnReady, NULL);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API
+// ═══════════════════════════════════════════════════════════════
+
+// Set the icons the launcher needs and bring the atlas up to date on
+// the worker. onReady runs on the UI task once icons can be drawn.
+// Call from the UI task; ignored while a previous sync is running.
+// An unchanged icon list keeps the open atlas; an icon file replaced
+// under the same name is picked up after a reboot.
+bool iconAtlasSync(const char * const * paths, int count, TaskJobFunc onReady) {
+    if (iconAtlasBusy.exchange(true)) return false;
+
+    // Unique non-empty paths, and whether they differ from the last sync
+    static char wanted[ICON_ATLAS_MAX][64];
+    int wantedCount = 0;
+    for (int i = 0; i < count && wantedCount < ICON_ATLAS_MAX; i++) {
+        if (!paths[i] || !paths[i][0]) continue;
+        bool seen = false;
+        for (int j = 0; j < wantedCount && !seen; j++) {
+            seen = strcmp(wanted[j], paths[i]) == 0;
+        }
+        if (seen) continue;
+        strncpy(wanted[wantedCount], paths[i], sizeof(wanted[0]) - 1);
+        wanted[wantedCount][sizeof(wanted[0]) - 1] = '\0';
+        wantedCount++;
+    }
+    bool changed = wantedCount != iconAtlasPathCount;
+    for (int i = 0; i < wantedCount && !changed; i++) {
+        changed = strcmp(wanted[i], iconAtlasPaths[i]) != 0;
+    }
+    iconAtlasOnReady = onReady;
+
+    // Same icons as last time: keep the open atlas, no SD access
+    if (!changed && iconAtlasReady) {
+        iconAtlasBusy = false;
+        return true;
+    }
+
+    iconAtlasClose();
+    memcpy(iconAtlasPaths, wanted, sizeof(wanted));
+    iconAtlasPathCount = wantedCount;
+
+    if (!worker_post(iconAtlasSyncJob, NULL)) {
+        iconAtlasBusy = false;
+        return false;
+    }
+    return true;
+}
+
+// Pixels of the icon with this key: a pointer into the PSRAM copy, or
+// scratch (ICON_BYTES) filled from SD. NULL when not in the atlas.
+const uint8_t * iconAtlasGet(uint32_t key, uint8_t * scratch) {
+    if (!iconAtlasReady) return NULL;
+
+    int lo = 0, hi = iconAtlasCount - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t k = iconAtlasEntries[mid].key;
+        if (k == key) {
+            uint32_t offset = iconAtlasEntries[mid].offset;
+            if (iconAtlasMap) {
+                iconAtlasStats.hits++;
+                return iconAtlasMap + offset;
+            }
+            if (!scratch || !iconAtlasFile.seek(offset) ||
+                iconAtlasFile.read(scratch, ICON_BYTES) != ICON_BYTES) return NULL;
+            iconAtlasStats.streamed++;
+            return scratch;
+        }
+        if (k < key) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    iconAtlasStats.missing++;
+    return NULL;
+}
+
+void printIconAtlasStats() {
+    Serial.println("\n=== Icon Atlas ===");
+    Serial.printf("Icons: %d (%s)\n", iconAtlasCount,
+                  !iconAtlasReady ? "not ready" : iconAtlasMap ? "PSRAM" : "streamed from SD");
+    Serial.printf("Builds: %lu, last %lu ms\n", iconAtlasStats.builds, iconAtlasStats.buildMs);
+    Serial.printf("Lookups: %lu PSRAM, %lu SD, %lu missing\n",
+                  iconAtlasStats.hits, iconAtlasStats.streamed, iconAtlasStats.missing);
+    Serial.println("==================\n");
+}
+
+#endif // ICON_ATLAS_H
@@ -0,0 +1,498 @@
+/*
+ * Image Assets
+ *
+ * Display-sized, compressed images built by tools/image_asset.py.
+ * - The tool resamples a source image to fit the panel and stores it as
+ *   a LIMG stream (RLE plus a QOI-style table of recent pixels) in an
+ *   lv_img_dsc_t with cf = LV_IMG_CF_RAW
+ * - initImageAssets() adds an LVGL image decoder for these. It reports
+ *   the image as LV_IMG_CF_TRUE_COLOR (RGB565 streams) or
+ *   LV_IMG_CF_ALPHA_8BIT (alpha streams, drawn in the recolor), so LVGL
+ *   draws the decoded pixels like any built-in image
+ * - Decoded pixels are cached in PSRAM, per image. LVGL opens the decoder
+ *   for every draw when its own image cache is off, so after the first
+ *   decode an open is a table lookup. Unused entries are evicted, least
+ *   recently used first, once the cache is over IMAGE_CACHE_BYTES
+ *
+ * Stream, after the ImageAssetHeader, ops over pixels (u8 for A8,
+ * little-endian RGB565 otherwise):
+ *   00nnnnnn            run of n+1 copies of the previous pixel
+ *   01iiiiii            pixel from the 64 entry table
+ *   10nnnnnn <pixels>   n+1 literal pixels
+ *   11nnnnnn nnnnnnnn   run of n+65 copies of the previous pixel
+ * Literal and table pixels become the previous pixel and are stored in
+ * the table at imageAssetHash(). The previous pixel starts at 0.
+ *
+ * runImageAssetDecodeTest() checks the decoder on hand-built streams and
+ * the EEZ images through the LVGL callbacks (host test and device check
+ * "images"); the device check also times them, runImageAssetBenchmark().
+ *
+ * UI task only.
+ *
+ * File: image_assets.h
+ */
+
+#ifndef IMAGE_ASSETS_H
+#define IMAGE_ASSETS_H
+
+#include <lvgl.h>
+#include <esp_heap_caps.h>
+#include "images.h"
+#include "test_check.h"
+
+#define IMAGE_ASSET_MAGIC     0x474D494C   // "LIMG"
+#define IMAGE_ASSET_VERSION   1
+#define IMAGE_CACHE_MAX       8
+#define IMAGE_CACHE_BYTES     (512 * 1024)
+
+enum ImageAssetFormat : uint8_t {
+    IMAGE_ASSET_RGB565 = 0,
+    IMAGE_ASSET_A8     = 1,
+};
+
+struct ImageAssetHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t format;         // ImageAssetFormat
+    uint16_t w;
+    uint16_t h;
+    uint16_t reserved;
+    uint32_t rawBytes;      // Decoded size
+} __attribute__((packed));
+
+struct ImageCacheEntry {
+    const lv_img_dsc_t * src;
+    uint8_t * pixels;       // NULL = free slot
+    uint32_t bytes;
+    uint16_t refs;          // Open in LVGL
+    uint32_t lastUsed;
+    uint32_t decodeMicros;
+};
+
+struct ImageAssetStats {
+    uint32_t opens;
+    uint32_t hits;
+    uint32_t decodes;
+    uint32_t decodeMicros;
+    uint32_t evictions;
+    uint32_t failures;      // Corrupt stream or out of memory
+};
+
+static ImageCacheEntry imageCache[IMAGE_CACHE_MAX];
+static uint32_t imageCacheBytes = 0;
+static uint32_t imageCacheClock = 0;
+static ImageAssetStats imageAssetStats = {0, 0, 0, 0, 0, 0};
+static lv_img_decoder_t * imageDecoder = NULL;
+
+static const char * const imageAssetFormatNames[] = { "RGB565", "A8" };
+
+// ═══════════════════════════════════════════════════════════════
+// DECODER
+// ═══════════════════════════════════════════════════════════════
+
+static inline uint8_t imageAssetHash(uint32_t px) {
+    return (uint8_t)((px * 0x9E3779B1u) >> 26);
+}
+
+// The header when the descriptor holds a LIMG stream LVGL can draw
+static const ImageAssetHeader * imageAssetHeader(const lv_img_dsc_t * dsc) {
+    if (!dsc || dsc->header.cf != LV_IMG_CF_RAW || dsc->data_size < sizeof(ImageAssetHeader)) return NULL;
+    const ImageAssetHeader * h = (const ImageAssetHeader *)dsc->data;
+    if (h->magic != IMAGE_ASSET_MAGIC || h->version != IMAGE_ASSET_VERSION) return NULL;
+    if (h->format == IMAGE_ASSET_A8) {
+        if (h->rawBytes != (uint32_t)h->w * h->h) return NULL;
+    } else if (h->format == IMAGE_ASSET_RGB565 && LV_COLOR_DEPTH == 16) {
+        if (h->rawBytes != (uint32_t)h->w * h->h * 2) return NULL;
+    } else {
+        return NULL;
+    }
+    return h;
+}
+
+// T is the pixel unit: uint8_t (A8) or uint16_t (RGB565)
+template <typename T>
+static bool imageAssetDecodeUnits(const uint8_t * in, const uint8_t * end, T * out, uint32_t count) {
+    T table[64];
+    memset(table, 0, sizeof(table));
+    T prev = 0;
+    T * const outEnd = out + count;
+
+    while (out < outEnd) {
+        if (in >= end) return false;
+        uint8_t op = *in++;
+        uint32_t n;
+        switch (op & 0xC0) {
+            case 0x00:
+                n = (op & 0x3F) + 1;
+                if (n > (uint32_t)(outEnd - out)) return false;
+                while (n--) *out++ = prev;
+                break;
+            case 0xC0:
+                if (in >= end) return false;
+                n = (((uint32_t)(op & 0x3F) << 8) | *in++) + 65;
+                if (n > (uint32_t)(outEnd - out)) return false;
+                while (n--) *out++ = prev;
+                break;
+            case 0x40:
+                prev = table[op & 0x3F];
+                *out++ = prev;
+                break;
+            default:
+                n = (op & 0x3F) + 1;
+                if (n > (uint32_t)(outEnd - out) || n * sizeof(T) > (uint32_t)(end - in)) return false;
+                while (n--) {
+                    prev = sizeof(T) == 1 ? (T)in[0] : (T)(in[0] | (in[1] << 8));
+                    in += sizeof(T);
+                    table[imageAssetHash(prev)] = prev;
+                    *out++ = prev;
+                }
+                break;
+        }
+    }
+    return in == end;
+}
+
+// Decode into out (rawBytes). RGB565 comes out as lv_color_t.
+bool imageAssetDecode(const lv_img_dsc_t * dsc, uint8_t * out) {
+    const ImageAssetHeader * h = imageAssetHeader(dsc);
+    if (!h) return false;
+    const uint8_t * in = dsc->data + sizeof(ImageAssetHeader);
+    const uint8_t * end = dsc->data + dsc->data_size;
+    uint32_t count = (uint32_t)h->w * h->h;
+
+    if (h->format == IMAGE_ASSET_A8) return imageAssetDecodeUnits<uint8_t>(in, end, out, count);
+    if (!imageAssetDecodeUnits<uint16_t>(in, end, (uint16_t *)out, count)) return false;
+#if LV_COLOR_16_SWAP
+    uint16_t * px = (uint16_t *)out;
+    for (uint32_t i = 0; i < count; i++) px[i] = (uint16_t)((px[i] >> 8) | (px[i] << 8));
+#endif
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PSRAM CACHE
+// ═══════════════════════════════════════════════════════════════
+
+static void imageCacheFree(ImageCacheEntry &e) {
+    heap_caps_free(e.pixels);
+    imageCacheBytes -= e.bytes;
+    memset(&e, 0, sizeof(e));
+}
+
+// Drop unused entries, oldest first, until bytes more fit
+static void imageCacheMakeRoom(uint32_t bytes) {
+    while (imageCacheBytes + bytes > IMAGE_CACHE_BYTES) {
+        ImageCacheEntry * oldest = NULL;
+        for (int i = 0; i < IMAGE_CACHE_MAX; i++) {
+            ImageCacheEntry &e = imageCache[i];
+            if (e.pixels && !e.refs && (!oldest || e.lastUsed < oldest->lastUsed)) oldest = &e;
+        }
+        if (!oldest) return;        // Everything is on screen, go over budget
+        imageCacheFree(*oldest);
+        imageAssetStats.evictions++;
+    }
+}
+
+// Decoded pixels for dsc, decoding on a miss. Takes a reference.
+static ImageCacheEntry * imageCacheAcquire(const lv_img_dsc_t * dsc) {
+    imageAssetStats.opens++;
+    ImageCacheEntry * slot = NULL;
+    for (int i = 0; i < IMAGE_CACHE_MAX; i++) {
+        ImageCacheEntry &e = imageCache[i];
+        if (e.pixels && e.src == dsc) {
+            e.refs++;
+            e.lastUsed = ++imageCacheClock;
+            imageAssetStats.hits++;
+            return &e;
+        }
+        if (!e.pixels && !slot) slot = &e;
+    }
+
+    const ImageAssetHeader * h = imageAssetHeader(dsc);
+    if (!h) return NULL;
+    imageCacheMakeRoom(h->rawBytes);
+    if (!slot) {
+        // Table full: reuse the least recently used free entry
+        for (int i = 0; i < IMAGE_CACHE_MAX; i++) {
+            ImageCacheEntry &e = imageCache[i];
+            if (!e.refs && (!slot || e.lastUsed < slot->lastUsed)) slot = &e;
+        }
+        if (!slot) {
+            imageAssetStats.failures++;
+            return NULL;
+        }
+        imageCacheFree(*slot);
+        imageAssetStats.evictions++;
+    }
+
+    uint8_t * pixels = (uint8_t *)heap_caps_malloc(h->rawBytes, MALLOC_CAP_SPIRAM);
+    if (!pixels) pixels = (uint8_t *)heap_caps_malloc(h->rawBytes, MALLOC_CAP_8BIT);
+    if (!pixels) {
+        imageAssetStats.failures++;
+        return NULL;
+    }
+    uint32_t start = micros();
+    if (!imageAssetDecode(dsc, pixels)) {
+        heap_caps_free(pixels);
+        imageAssetStats.failures++;
+        Serial.printf("Image: corrupt LIMG stream (%ux%u)\n", h->w, h->h);
+        return NULL;
+    }
+    slot->decodeMicros = micros() - start;
+    slot->src = dsc;
+    slot->pixels = pixels;
+    slot->bytes = h->rawBytes;
+    slot->refs = 1;
+    slot->lastUsed = ++imageCacheClock;
+    imageCacheBytes += h->rawBytes;
+    imageAssetStats.decodes++;
+    imageAssetStats.decodeMicros += slot->decodeMicros;
+    return slot;
+}
+
+// Free every decoded image that is not open, e.g. under memory pressure
+void imageCacheTrim() {
+    for (int i = 0; i < IMAGE_CACHE_MAX; i++) {
+        if (imageCache[i].pixels && !imageCache[i].refs) imageCacheFree(imageCache[i]);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// LVGL DECODER CALLBACKS
+// ═══════════════════════════════════════════════════════════════
+
+static lv_res_t image_decoder_info(lv_img_decoder_t * decoder, const void * src, lv_img_header_t * header) {
+    LV_UNUSED(decoder);
+    if (lv_img_src_get_type(src) != LV_IMG_SRC_VARIABLE) return LV_RES_INV;
+    const ImageAssetHeader * h = imageAssetHeader((const lv_img_dsc_t *)src);
+    if (!h) return LV_RES_INV;
+    header->always_zero = 0;
+    header->w = h->w;
+    header->h = h->h;
+    header->cf = h->format == IMAGE_ASSET_A8 ? LV_IMG_CF_ALPHA_8BIT : LV_IMG_CF_TRUE_COLOR;
+    return LV_RES_OK;
+}
+
+static lv_res_t image_decoder_open(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
+    LV_UNUSED(decoder);
+    if (dsc->src_type != LV_IMG_SRC_VARIABLE) return LV_RES_INV;
+    ImageCacheEntry * e = imageCacheAcquire((const lv_img_dsc_t *)dsc->src);
+    if (!e) return LV_RES_INV;
+    dsc->img_data = e->pixels;
+    dsc->user_data = e;
+    dsc->time_to_open = 0;      // Cached here, LVGL need not keep it
+    return LV_RES_OK;
+}
+
+static void image_decoder_close(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
+    LV_UNUSED(decoder);
+    ImageCacheEntry * e = (ImageCacheEntry *)dsc->user_data;
+    if (e && e->refs) e->refs--;
+    dsc->user_data = NULL;
+    dsc->img_data = NULL;
+}
+
+// Call after lv_init(), before the first screen with an image is created
+void initImageAssets() {
+    if (imageDecoder) return;
+    imageDecoder = lv_img_decoder_create();
+    if (!imageDecoder) return;
+    lv_img_decoder_set_info_cb(imageDecoder, image_decoder_info);
+    lv_img_decoder_set_open_cb(imageDecoder, image_decoder_open);
+    lv_img_decoder_set_close_cb(imageDecoder, image_decoder_close);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DECODE TEST
+// ═══════════════════════════════════════════════════════════════
+
+// A descriptor over header + ops, built in buf
+static const lv_img_dsc_t * imageAssetTestDsc(lv_img_dsc_t * dsc, uint8_t * buf, uint8_t format,
+                                              uint16_t w, uint16_t h, const uint8_t * ops, size_t opsLen) {
+    ImageAssetHeader header = { IMAGE_ASSET_MAGIC, IMAGE_ASSET_VERSION, format, w, h, 0,
+                                (uint32_t)w * h * (format == IMAGE_ASSET_A8 ? 1 : 2) };
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), ops, opsLen);
+    memset(dsc, 0, sizeof(*dsc));
+    dsc->header.cf = LV_IMG_CF_RAW;
+    dsc->header.w = w;
+    dsc->header.h = h;
+    dsc->data_size = sizeof(header) + opsLen;
+    dsc->data = buf;
+    return dsc;
+}
+
+// Every op on small A8 and RGB565 streams, streams that are cut short,
+// overrun the image or carry trailing bytes, then every image in the EEZ
+// images[] table through the registered LVGL decoder and the cache.
+// Returns the number of failures.
+uint32_t runImageAssetDecodeTest() {
+    uint32_t failures = 0;
+    lv_img_dsc_t dsc;
+    uint8_t buf[64];
+    uint8_t out[160];
+
+    // A8 8x10: run of the initial 0, two literals, short run, table, long run
+    uint8_t a10 = imageAssetHash(10), a20 = imageAssetHash(20);
+    TEST_CHECK(a10 != a20, "test pixels share a table slot");
+    const uint8_t a8[] = { 0x00, 0x81, 10, 20, 0x02, (uint8_t)(0x40 | a10), 0xC0, 73 - 65 };
+    uint8_t a8Want[80] = { 0, 10, 20, 20, 20, 20 };
+    memset(a8Want + 6, 10, 74);
+    bool ok = imageAssetDecode(imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_A8, 8, 10, a8, sizeof(a8)), out);
+    TEST_CHECK(ok && memcmp(out, a8Want, sizeof(a8Want)) == 0, "A8 stream decoded wrong");
+
+    // RGB565 4x4: literals are little-endian, table and run keep the unit
+    uint8_t c1234 = imageAssetHash(0x1234);
+    const uint8_t rgb[] = { 0x81, 0x34, 0x12, 0xCD, 0xAB, (uint8_t)(0x40 | c1234), 0x0C };
+    uint16_t rgbWant[16] = { 0x1234, 0xABCD };
+    for (int i = 2; i < 16; i++) rgbWant[i] = 0x1234;
+#if LV_COLOR_16_SWAP
+    for (int i = 0; i < 16; i++) rgbWant[i] = (uint16_t)((rgbWant[i] >> 8) | (rgbWant[i] << 8));
+#endif
+    ok = imageAssetDecode(imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_RGB565, 4, 4, rgb, sizeof(rgb)), out);
+    TEST_CHECK(ok && memcmp(out, rgbWant, sizeof(rgbWant)) == 0, "RGB565 stream decoded wrong");
+
+    // Damaged streams are refused, never written past the image
+    uint8_t rgbBad[sizeof(rgb) + 1];
+    memcpy(rgbBad, rgb, sizeof(rgb));
+    for (size_t cut = 0; cut < sizeof(a8); cut++) {
+        TEST_CHECK(!imageAssetDecode(imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_A8, 8, 10, a8, cut), out),
+                   "A8 stream cut at %u decoded", (unsigned)cut);
+    }
+    rgbBad[sizeof(rgb) - 1] = 0x0D;     // Run one pixel too long
+    TEST_CHECK(!imageAssetDecode(imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_RGB565, 4, 4, rgbBad, sizeof(rgb)), out),
+               "run past the last pixel decoded");
+    rgbBad[sizeof(rgb) - 1] = 0x0C;
+    rgbBad[sizeof(rgb)] = 0x00;         // Trailing op
+    TEST_CHECK(!imageAssetDecode(imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_RGB565, 4, 4, rgbBad, sizeof(rgb) + 1), out),
+               "stream with trailing bytes decoded");
+    const uint8_t literalShort[] = { 0x8F, 0x34, 0x12 };
+    TEST_CHECK(!imageAssetDecode(imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_RGB565, 4, 4, literalShort, sizeof(literalShort)), out),
+               "literal past the end of the stream decoded");
+    imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_A8, 8, 10, a8, sizeof(a8));
+    buf[0] ^= 0xFF;
+    TEST_CHECK(!imageAssetHeader(&dsc), "bad magic accepted");
+    imageAssetTestDsc(&dsc, buf, IMAGE_ASSET_A8, 8, 10, a8, sizeof(a8));
+    ((ImageAssetHeader *)buf)->rawBytes++;
+    TEST_CHECK(!imageAssetHeader(&dsc), "raw size not matching the image accepted");
+
+    // The EEZ images as LVGL sees them: info, a decoding open, a cached open
+    initImageAssets();
+    TEST_CHECK(imageDecoder && imageDecoder->info_cb == image_decoder_info, "decoder not registered");
+    for (size_t i = 0; imageDecoder && i < sizeof(images) / sizeof(images[0]); i++) {
+        const lv_img_dsc_t * img = images[i].img_dsc;
+        const ImageAssetHeader * h = imageAssetHeader(img);
+        if (!h) continue;
+
+        lv_img_header_t header;
+        memset(&header, 0, sizeof(header));
+        bool info = imageDecoder->info_cb(imageDecoder, img, &header) == LV_RES_OK;
+        TEST_CHECK(info && header.w == h->w && header.h == h->h &&
+                   header.cf == (h->format == IMAGE_ASSET_A8 ? LV_IMG_CF_ALPHA_8BIT : LV_IMG_CF_TRUE_COLOR),
+                   "%s: info %ux%u cf %u", images[i].name, header.w, header.h, header.cf);
+
+        lv_img_decoder_dsc_t first, second;
+        memset(&first, 0, sizeof(first));
+        first.src = img;
+        first.src_type = LV_IMG_SRC_VARIABLE;
+        second = first;
+        uint32_t hits = imageAssetStats.hits;
+        bool opened = imageDecoder->open_cb(imageDecoder, &first) == LV_RES_OK;
+        bool again = imageDecoder->open_cb(imageDecoder, &second) == LV_RES_OK;
+        TEST_CHECK(opened && again && first.img_data && second.img_data == first.img_data,
+                   "%s: open failed or decoded twice", images[i].name);
+        TEST_CHECK(imageAssetStats.hits - hits >= 1, "%s: second open missed the cache", images[i].name);
+
+        uint8_t * scratch = (uint8_t *)heap_caps_malloc(h->rawBytes, MALLOC_CAP_SPIRAM);
+        if (!scratch) scratch = (uint8_t *)heap_caps_malloc(h->rawBytes, MALLOC_CAP_8BIT);
+        if (opened && scratch) {
+            TEST_CHECK(imageAssetDecode(img, scratch) && memcmp(scratch, first.img_data, h->rawBytes) == 0,
+                       "%s: cached pixels differ from a fresh decode", images[i].name);
+        }
+        heap_caps_free(scratch);
+        if (again) imageDecoder->close_cb(imageDecoder, &second);
+        if (opened) imageDecoder->close_cb(imageDecoder, &first);
+    }
+
+    // img_bg is a fully opaque mask
+    const ImageAssetHeader * bg = imageAssetHeader(&img_bg);
+    uint8_t * mask = bg ? (uint8_t *)heap_caps_malloc(bg->rawBytes, MALLOC_CAP_8BIT) : NULL;
+    bool opaque = mask && imageAssetDecode(&img_bg, mask);
+    for (uint32_t i = 0; opaque && i < bg->rawBytes; i++) opaque = mask[i] == 0xFF;
+    heap_caps_free(mask);
+    TEST_CHECK(opaque, "img_bg did not decode to an opaque %ux%u mask", img_bg.header.w, img_bg.header.h);
+
+    Serial.printf("Image asset decode test: %lu failures\n", failures);
+    return failures;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STATS AND BENCHMARK
+// ═══════════════════════════════════════════════════════════════
+
+void printImageAssetStats() {
+    Serial.println("\n=== Image Assets ===");
+    Serial.printf("Cache: %lu KB of %lu KB", imageCacheBytes / 1024, (uint32_t)IMAGE_CACHE_BYTES / 1024);
+    for (int i = 0; i < IMAGE_CACHE_MAX; i++) {
+        const ImageCacheEntry &e = imageCache[i];
+        if (!e.pixels) continue;
+        Serial.printf("\n  %ux%u, %lu B, decoded in %lu us, %u open",
+                      e.src->header.w, e.src->header.h, e.bytes, e.decodeMicros, e.refs);
+    }
+    Serial.println();
+    uint32_t hitRate = imageAssetStats.opens ? imageAssetStats.hits * 100 / imageAssetStats.opens : 0;
+    Serial.printf("Opens: %lu, hits: %lu (%lu%%), decodes: %lu (%lu us total), evictions: %lu, failures: %lu\n",
+                  imageAssetStats.opens, imageAssetStats.hits, hitRate, imageAssetStats.decodes,
+                  imageAssetStats.decodeMicros, imageAssetStats.evictions, imageAssetStats.failures);
+    Serial.println("====================\n");
+}
+
+// Flash size and decode time of every image in the EEZ images[] table.
+// Decodes into a scratch buffer in PSRAM (where the cache lives), the
+// cache itself is left alone. Returns the images that failed to decode.
+uint32_t runImageAssetBenchmark(int rounds = 10) {
+    uint32_t failures = 0;
+    Serial.println("\n=== Image Asset Benchmark ===");
+    Serial.printf("%-12s %-14s %9s %9s %6s %10s %10s\n", "image", "size", "flash B", "raw B", "ratio", "min us", "avg us");
+    for (size_t i = 0; i < sizeof(images) / sizeof(images[0]); i++) {
+        const lv_img_dsc_t * dsc = images[i].img_dsc;
+        const ImageAssetHeader * h = imageAssetHeader(dsc);
+        if (!h) {
+            Serial.printf("%-12s %4ux%-9u %9lu  (not a LIMG asset)\n", images[i].name,
+                          dsc->header.w, dsc->header.h, dsc->data_size);
+            continue;
+        }
+        uint8_t * scratch = (uint8_t *)heap_caps_malloc(h->rawBytes, MALLOC_CAP_SPIRAM);
+        if (!scratch) scratch = (uint8_t *)heap_caps_malloc(h->rawBytes, MALLOC_CAP_8BIT);
+        if (!scratch) {
+            Serial.printf("%-12s no memory for %lu B\n", images[i].name, h->rawBytes);
+            failures++;
+            continue;
+        }
+        uint32_t best = UINT32_MAX;
+        uint32_t total = 0;
+        bool ok = true;
+        for (int r = 0; r < rounds && ok; r++) {
+            uint32_t start = micros();
+            ok = imageAssetDecode(dsc, scratch);
+            uint32_t us = micros() - start;
+            total += us;
+            if (us < best) best = us;
+        }
+        heap_caps_free(scratch);
+
+        char size[16];
+        snprintf(size, sizeof(size), "%ux%u %s", h->w, h->h, imageAssetFormatNames[h->format]);
+        if (!ok) {
+            Serial.printf("%-12s %-14s CORRUPT\n", images[i].name, size);
+            failures++;
+            continue;
+        }
+        Serial.printf("%-12s %-14s %9lu %9lu %5lux %10lu %10lu\n", images[i].name, size,
+                      dsc->data_size, h->rawBytes, h->rawBytes / dsc->data_size, best, total / rounds);
+    }
+    Serial.println("=============================\n");
+    return failures;
+}
+
+#endif // IMAGE_ASSETS_H
@@ -0,0 +1,304 @@
+/*
+ * Key/Value Parser
+ *
+ * Streaming, allocation-free parser for the "key=value" text files used
+ * by app manifests, .app files and the legacy /data/settings.txt.
+ *
+ * - Reads the file in small chunks into a fixed stack buffer
+ * - Hands out slices (pointer + length) into that buffer, no String
+ * - Keys are dispatched through kvKey(), a constexpr FNV-1a hash, so
+ *   handlers can switch on compile-time constants:
+ *
+ *     static void onKey(void * ctx, uint32_t key, KvSlice value) {
+ *         switch (key) {
+ *             case kvKey("name"): kvSliceCopy(value, app->name, sizeof(app->name)); break;
+ *             case kvKey("enabled"): app->enabled = value.equals("true"); break;
+ *         }
+ *     }
+ *     kvParseFile(file, onKey, app);
+ *
+ * Lines are trimmed, empty lines and lines starting with '#' are
+ * skipped, and lines longer than KV_LINE_MAX are dropped whole.
+ * KvParser::feed() takes arbitrary byte chunks, so the same code path
+ * is fuzzed from memory by runKvParserTest() (host test "kv").
+ *
+ * File: kv_parser.h
+ */
+
+#ifndef KV_PARSER_H
+#define KV_PARSER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "test_check.h"
+
+#define KV_LINE_MAX   128   // Longest accepted line, including the key
+#define KV_CHUNK_SIZE 64    // Bytes read from the file per call
+
+// Compile-time key hash (FNV-1a), usable in case labels
+constexpr uint32_t kvKey(const char * s, uint32_t h = 2166136261u) {
+    return *s ? kvKey(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+static inline uint32_t kvKeyRuntime(const char * s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+// View into the parser's line buffer, only valid inside the handler
+struct KvSlice {
+    const char * ptr;
+    size_t len;
+
+    bool equals(const char * s) const {
+        size_t n = strlen(s);
+        return n == len && memcmp(ptr, s, n) == 0;
+    }
+};
+
+// Copy a slice into a fixed char array, always NUL terminated
+static inline void kvSliceCopy(const KvSlice & s, char * dst, size_t size) {
+    if (size == 0) return;
+    size_t n = s.len < size - 1 ? s.len : size - 1;
+    memcpy(dst, s.ptr, n);
+    dst[n] = '\0';
+}
+
+static inline long kvSliceToInt(const KvSlice & s) {
+    long value = 0;
+    bool negative = false;
+    size_t i = 0;
+    if (i < s.len && (s.ptr[i] == '-' || s.ptr[i] == '+')) {
+        negative = s.ptr[i] == '-';
+        i++;
+    }
+    for (; i < s.len && s.ptr[i] >= '0' && s.ptr[i] <= '9'; i++) {
+        value = value * 10 + (s.ptr[i] - '0');
+    }
+    return negative ? -value : value;
+}
+
+// Called once per "key=value" line
+typedef void (*KvHandler)(void * ctx, uint32_t key, KvSlice value);
+
+// ═══════════════════════════════════════════════════════════════
+// PARSER
+// ═══════════════════════════════════════════════════════════════
+
+class KvParser {
+public:
+    KvParser(KvHandler handler, void * ctx) : handler(handler), ctx(ctx) {}
+
+    // Feed any number of bytes, lines are dispatched as they complete
+    void feed(const char * data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            char c = data[i];
+            if (c == '\n') {
+                endLine();
+            } else if (lineLen < KV_LINE_MAX) {
+                line[lineLen++] = c;
+            } else {
+                overflow = true;
+            }
+        }
+    }
+
+    // Flush a last line without trailing newline
+    void finish() {
+        endLine();
+    }
+
+    uint32_t lines = 0;      // Lines dispatched to the handler
+    uint32_t dropped = 0;    // Overlong or malformed lines
+
+private:
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    void endLine() {
+        if (overflow) {
+            dropped++;
+        } else {
+            dispatch();
+        }
+        lineLen = 0;
+        overflow = false;
+    }
+
+    void dispatch() {
+        size_t start = 0, end = lineLen;
+        while (start < end && isSpace(line[start])) start++;
+        while (end > start && isSpace(line[end - 1])) end--;
+        if (start == end || line[start] == '#') return;
+
+        const char * eq = (const char *)memchr(line + start, '=', end - start);
+        if (!eq) {
+            dropped++;
+            return;
+        }
+
+        // The whole trimmed line starts with the key, matching the old
+        // startsWith("key=") checks; the value is everything after '='
+        size_t keyLen = eq - (line + start);
+        KvSlice value = { eq + 1, (size_t)(line + end - (eq + 1)) };
+
+        lines++;
+        handler(ctx, kvKeyRuntime(line + start, keyLen), value);
+    }
+
+    KvHandler handler;
+    void * ctx;
+    char line[KV_LINE_MAX];
+    size_t lineLen = 0;
+    bool overflow = false;
+};
+
+// Parse a whole stream (fs::File or anything with read(uint8_t*, size_t))
+template <typename Source>
+uint32_t kvParseFile(Source & file, KvHandler handler, void * ctx) {
+    KvParser parser(handler, ctx);
+    char chunk[KV_CHUNK_SIZE];
+    for (;;) {
+        int n = file.read((uint8_t *)chunk, sizeof(chunk));
+        if (n <= 0) break;
+        parser.feed(chunk, n);
+    }
+    parser.finish();
+    return parser.lines;
+}
+
+// Parse an in-memory buffer
+static inline uint32_t kvParseBuffer(const char * data, size_t len, KvHandler handler, void * ctx) {
+    KvParser parser(handler, ctx);
+    parser.feed(data, len);
+    parser.finish();
+    return parser.lines;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TEST
+// ═══════════════════════════════════════════════════════════════
+
+// What the test handler saw: a hash over every key and value in order
+struct KvTestTrace {
+    uint32_t hash;
+    uint32_t calls;
+    char name[16];
+};
+
+static void kv_test_handler(void * ctx, uint32_t key, KvSlice value) {
+    KvTestTrace * t = (KvTestTrace *)ctx;
+    t->hash = (t->hash ^ key) * 16777619u;
+    for (size_t i = 0; i < value.len; i++) t->hash = (t->hash ^ (uint8_t)value.ptr[i]) * 16777619u;
+    t->hash = (t->hash ^ (uint32_t)value.len) * 16777619u;
+    t->calls++;
+    if (key == kvKey("name")) kvSliceCopy(value, t->name, sizeof(t->name));
+}
+
+// Fixed cases, every split of a manifest into two chunks, random chunking
+// of random bytes, and the cost per line. Returns the number of failures.
+uint32_t runKvParserTest(uint32_t rounds = 2000) {
+    uint32_t failures = 0;
+    static const char doc[] =
+        "# comment\r\n"
+        "  name=Clock  \r\n"
+        "\n"
+        "enabled=true\n"
+        "no equals sign\n"
+        "description=a=b, c\n"
+        "empty=\n"
+        "x=" "0123456789012345678901234567890123456789012345678901234567890123"
+             "0123456789012345678901234567890123456789012345678901234567890123\n"
+        "codefile=clock.pbc";   // No trailing newline
+    const size_t docLen = sizeof(doc) - 1;
+
+    KvTestTrace whole = {2166136261u, 0, ""};
+    KvParser parser(kv_test_handler, &whole);
+    parser.feed(doc, docLen);
+    parser.finish();
+    TEST_CHECK(parser.lines == 5 && whole.calls == 5, "%lu lines dispatched, expected 5", parser.lines);
+    TEST_CHECK(parser.dropped == 2, "%lu lines dropped, expected 2 (no '=', overlong)", parser.dropped);
+    TEST_CHECK(strcmp(whole.name, "Clock") == 0, "name is \"%s\", expected \"Clock\"", whole.name);
+
+    KvSlice number = { "-1234x", 6 };
+    TEST_CHECK(kvSliceToInt(number) == -1234, "kvSliceToInt gave %ld", kvSliceToInt(number));
+    TEST_CHECK(kvKeyRuntime("enabled", 7) == kvKey("enabled"), "runtime and constexpr key hashes differ");
+
+    // Where a chunk ends must not change what is dispatched
+    uint32_t splitMismatches = 0;
+    for (size_t cut = 0; cut <= docLen; cut++) {
+        KvTestTrace t = {2166136261u, 0, ""};
+        KvParser p(kv_test_handler, &t);
+        p.feed(doc, cut);
+        p.feed(doc + cut, docLen - cut);
+        p.finish();
+        if (t.hash != whole.hash || t.calls != whole.calls) splitMismatches++;
+    }
+    TEST_CHECK(splitMismatches == 0, "%lu of %lu chunk splits changed the result",
+               splitMismatches, (uint32_t)docLen + 1);
+
+    // Random bytes in random chunks: same result as in one piece, and
+    // every line is either dispatched, dropped or skipped
+    uint32_t seed = 12345, fuzzMismatches = 0, lost = 0;
+    char buf[512];
+    for (uint32_t r = 0; r < rounds; r++) {
+        size_t len = 0, newlines = 0;
+        seed = seed * 1103515245u + 12345u;
+        size_t want = (seed >> 16) % sizeof(buf);
+        while (len < want) {
+            seed = seed * 1103515245u + 12345u;
+            uint8_t c = seed >> 16;
+            // Mostly printable with plenty of separators
+            if ((c & 7) == 0) c = '\n';
+            else if ((c & 7) == 1) c = '=';
+            else if ((c & 7) == 2) c = ' ';
+            buf[len++] = c;
+            if (c == '\n') newlines++;
+        }
+
+        KvTestTrace one = {2166136261u, 0, ""};
+        KvParser a(kv_test_handler, &one);
+        a.feed(buf, len);
+        a.finish();
+
+        KvTestTrace chunked = {2166136261u, 0, ""};
+        KvParser b(kv_test_handler, &chunked);
+        for (size_t pos = 0; pos < len;) {
+            seed = seed * 1103515245u + 12345u;
+            size_t n = 1 + (seed >> 16) % 17;
+            if (n > len - pos) n = len - pos;
+            b.feed(buf + pos, n);
+            pos += n;
+        }
+        b.finish();
+
+        if (one.hash != chunked.hash || a.lines != b.lines || a.dropped != b.dropped) fuzzMismatches++;
+        if (a.lines + a.dropped > newlines + 1) lost++;
+    }
+    TEST_CHECK(fuzzMismatches == 0, "%lu of %lu fuzz rounds differ by chunking", fuzzMismatches, rounds);
+    TEST_CHECK(lost == 0, "%lu fuzz rounds reported more lines than the input has", lost);
+
+    // Cost per line, manifest-sized input fed like kvParseFile() does
+    uint32_t lines = 0;
+    uint32_t start = micros();
+    for (uint32_t r = 0; r < rounds; r++) {
+        KvTestTrace t = {2166136261u, 0, ""};
+        KvParser p(kv_test_handler, &t);
+        for (size_t pos = 0; pos < docLen; pos += KV_CHUNK_SIZE) {
+            p.feed(doc + pos, docLen - pos < KV_CHUNK_SIZE ? docLen - pos : KV_CHUNK_SIZE);
+        }
+        p.finish();
+        lines += p.lines + p.dropped;
+    }
+    uint32_t elapsed = micros() - start;
+    Serial.printf("KV parser: %lu lines in %lu us (%lu ns per line)\n",
+                  lines, elapsed, lines ? (uint32_t)((uint64_t)elapsed * 1000 / lines) : 0);
+    return failures;
+}
+
+#endif // KV_PARSER_H
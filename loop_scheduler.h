@@ -0,0 +1,128 @@
+/*
+ * Frame-Paced Loop Scheduler
+ *
+ * Replaces the fixed delay(5) in loop(). Each pass runs input, LVGL and
+ * the EEZ flow, then blocks the loop task until the earliest of:
+ * - the next LVGL timer deadline (lv_timer_handler return value)
+ * - pending EEZ flow work (no sleep at all)
+ * - a touch interrupt (the ISR notifies the loop task)
+ * - a message from the worker task (task_model.h)
+ *
+ * While blocked the IDLE task runs, so the CPU is free for WiFi/BT and
+ * can enter automatic light sleep when power management is enabled.
+ *
+ * File: loop_scheduler.h
+ */
+
+#ifndef LOOP_SCHEDULER_H
+#define LOOP_SCHEDULER_H
+
+#include <lvgl.h>
+#include "touch.h"
+#include "touch_gestures.h"
+#include "backlight.h"
+#include "display_flush.h"
+#include "task_model.h"
+#include "ui.h"
+
+// Upper bound for one sleep, keeps the EEZ flow and clock screens ticking
+#define SCHED_MAX_SLEEP_MS 100
+// Sleep while a DMA transfer is still in flight
+#define SCHED_FLUSH_SLEEP_MS 1
+
+#if defined(EEZ_FOR_LVGL)
+namespace eez { namespace flow { extern unsigned g_numNonContinuousTaskInQueue; } }
+#endif
+
+// Per-phase timing counters (reset with resetSchedulerStats)
+struct SchedulerStats {
+    uint32_t passes;
+    uint32_t wakeups;          // Sleeps cut short by touch or a worker message
+    uint64_t inputMicros;      // UI messages + touch_service + gestures + backlight
+    uint64_t lvglMicros;       // lv_timer_handler + flush completion
+    uint64_t flowMicros;       // ui_tick (EEZ flow + screen tick)
+    uint64_t idleMicros;       // Blocked waiting for the next deadline
+    uint32_t startMillis;
+};
+
+static SchedulerStats schedStats;
+
+static bool schedulerFlowPending() {
+#if defined(EEZ_FOR_LVGL)
+    // Continuous tasks stay queued forever, only real work counts
+    return eez::flow::g_numNonContinuousTaskInQueue > 0;
+#else
+    return false;
+#endif
+}
+
+void resetSchedulerStats() {
+    memset(&schedStats, 0, sizeof(schedStats));
+    schedStats.startMillis = millis();
+}
+
+void initLoopScheduler() {
+    resetSchedulerStats();
+    // Let the touch ISR wake this (the loop) task
+    touch_notify_task = xTaskGetCurrentTaskHandle();
+}
+
+// One scheduler pass, call from loop()
+void runLoopScheduler() {
+    uint32_t t0 = micros();
+
+    ui_queue_drain();
+    touch_service();
+    gesture_tick(millis());
+    backlight_tick(millis());
+    uint32_t t1 = micros();
+
+    uint32_t nextTimerMs = lv_timer_handler();
+    display_flush_poll();
+    uint32_t t2 = micros();
+
+    ui_tick();
+    uint32_t t3 = micros();
+
+    // Earliest deadline wins
+    uint32_t sleepMs = min(nextTimerMs, (uint32_t)SCHED_MAX_SLEEP_MS);
+    if (touch_down) sleepMs = min(sleepMs, (uint32_t)TOUCH_ACTIVE_POLL_MS);
+    if (backlight_fading()) sleepMs = min(sleepMs, (uint32_t)BACKLIGHT_FADE_STEP_MS);
+    if (flushPendingDrv) sleepMs = min(sleepMs, (uint32_t)SCHED_FLUSH_SLEEP_MS);
+    if (schedulerFlowPending() || !touch_queue_empty() || !uiQueue.empty()) sleepMs = 0;
+
+    if (sleepMs > 0) {
+        // Returns early when the touch ISR or the worker gives a notification
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs)) > 0) {
+            schedStats.wakeups++;
+        }
+    } else {
+        taskYIELD();
+    }
+    uint32_t t4 = micros();
+
+    schedStats.passes++;
+    schedStats.inputMicros += t1 - t0;
+    schedStats.lvglMicros += t2 - t1;
+    schedStats.flowMicros += t3 - t2;
+    schedStats.idleMicros += t4 - t3;
+}
+
+void printSchedulerStats() {
+    uint32_t elapsed = millis() - schedStats.startMillis;
+    if (elapsed == 0) elapsed = 1;
+    uint64_t total = schedStats.inputMicros + schedStats.lvglMicros +
+                     schedStats.flowMicros + schedStats.idleMicros;
+    if (total == 0) total = 1;
+
+    Serial.println("\n=== Loop Scheduler ===");
+    Serial.printf("Passes: %lu (%lu/s), early wakeups: %lu\n",
+                  schedStats.passes, schedStats.passes * 1000 / elapsed, schedStats.wakeups);
+    Serial.printf("Input: %llu ms, LVGL: %llu ms, Flow: %llu ms\n",
+                  schedStats.inputMicros / 1000, schedStats.lvglMicros / 1000, schedStats.flowMicros / 1000);
+    Serial.printf("Idle: %llu ms (%llu%%)\n",
+                  schedStats.idleMicros / 1000, schedStats.idleMicros * 100 / total);
+    Serial.println("======================\n");
+}
+
+#endif // LOOP_SCHEDULER_H
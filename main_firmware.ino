@@ -16,13 +16,28 @@
 #include <lvgl.h>
 #include <TFT_eSPI.h>
 #include "touch.h"
+#include "touch_gestures.h"
+#include "backlight.h"            // PWM backlight, fades and auto-dim
+#include "touch_calibration.h"
+
+// Draw buffer strategy for this board variant (see display_flush.h):
+// DISPLAY_BUF_PARTIAL_STRIP, DISPLAY_BUF_LARGE_PARTIAL or DISPLAY_BUF_FULL_FRAME_PSRAM
+#define DISPLAY_BUFFER_STRATEGY DISPLAY_BUF_PARTIAL_STRIP
+#include "display_flush.h"
 #include "ui.h"
+#include "loop_scheduler.h"
 #include "SD_MMC.h"
 #include <FS.h>
+#include "task_model.h"           // UI core / worker core split
+#include "screen_manager.h"       // Lazy screen creation, hot screen cache
+#include "image_assets.h"         // LIMG image decoder, PSRAM cache
+#include "bg.h"                   // img_bg, built by tools/image_asset.py
 
 // Include modular systems
 #include "modular_app_loader.h"  // App loader from SD card
 #include "settings_menu.h"        // Settings menu
+#include "boot_sequence.h"        // Staged boot, boot profile
+#include "device_checks.h"        // "checks" serial command, debug builds
 
 // Debug mode
 #define DEBUG_MODE false
@@ -40,30 +55,32 @@
 static const uint16_t screenWidth  = 320;
 static const uint16_t screenHeight = 240;
 static lv_disp_draw_buf_t disp_buf;
-static lv_color_t buf[screenWidth*10];
 
 TFT_eSPI my_lcd = TFT_eSPI();
 
 // SD Card status
 bool sdCardAvailable = false;
 
-void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
-{
-    uint32_t w = (area->x2 - area->x1 + 1);
-    uint32_t h = (area->y2 - area->y1 + 1);
-    my_lcd.setAddrWindow(area->x1, area->y1, w, h);
-    my_lcd.pushColors((uint16_t *)&color_p->full, w*h, true);
-    lv_disp_flush_ready(disp);
-}
-
 void my_touchpad_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data)
 {
-    if (touch_touched()) {
-        data->state = LV_INDEV_STATE_PR;
+    // Drain one queued sample per call, LVGL calls back while more are left
+    TouchSample sample;
+    if (touch_queue_pop(&sample)) {
+        static lv_point_t last_point = {0, 0};
+        if (sample.count > 0) {
+            last_point.x = sample.x[0];
+            last_point.y = sample.y[0];
+        }
+        data->point = last_point;
+        data->state = sample.count > 0 ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+        // Touches keep the backlight up; the one waking a dark screen stays here
+        if (backlight_touch(sample.count > 0)) data->state = LV_INDEV_STATE_REL;
+        data->continue_reading = !touch_queue_empty();
+    } else {
+        // No new samples - report the last known state
         data->point.x = touch_last_x;
         data->point.y = touch_last_y;
-    } else {
-        data->state = LV_INDEV_STATE_REL;
+        data->state = touch_down && !backlight_touch(touch_down) ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
     }
 }
 
@@ -73,7 +90,6 @@ bool initSDCard()
         return false;
     }
     
-    delay(50);
     if (!SD_MMC.begin("/sdcard", true)) {
         return false;
     }
@@ -86,50 +102,109 @@ bool initSDCard()
     return true;
 }
 
+// ═══════════════════════════════════════════════════════════════
+// DEFERRED BOOT JOBS (boot_sequence.h)
+// ═══════════════════════════════════════════════════════════════
+
+// Worker: mount the card while the UI task brings up the display
+static bool bootMountSd() {
+    sdCardAvailable = initSDCard();
+    if (!sdCardAvailable) {
+        DEBUG_PRINTLN("✗ No SD Card - limited functionality");
+        return false;
+    }
+    DEBUG_PRINTLN("✓ SD Card OK");
+    
+    // Create required directories
+    if (!SD_MMC.exists("/apps")) SD_MMC.mkdir("/apps");
+    if (!SD_MMC.exists("/data")) SD_MMC.mkdir("/data");
+    return true;
+}
+
+static bool bootTouchCalibration() {
+    loadTouchCalibration();     // Takes effect at once, touch_init already ran
+    return true;
+}
+
+static bool bootSettings() {
+    initSettings();
+    return true;
+}
+
+static bool bootStorageStats() {
+    // SD usage from /data/storage.dat, or measured on the worker
+    initStorageStats();
+    return true;
+}
+
+// UI task: the launchers read the registry there
+static bool bootIndexApps() {
+    initModularAppSystem();
+    return true;
+}
+
+static void bootFinished() {
+    if (!DEBUG_MODE) return;
+    Serial.println("\n=== SYSTEM INFO ===");
+    Serial.printf("Flash: %lu MB\n", ESP.getFlashChipSize() / 1024 / 1024);
+    Serial.printf("Free Heap: %lu KB\n", ESP.getFreeHeap() / 1024);
+    Serial.printf("PSRAM: %lu KB\n", ESP.getPsramSize() / 1024);
+    
+    if (sdCardAvailable) {
+        Serial.printf("SD Card: %llu MB\n", SD_MMC.cardSize() / 1024 / 1024);
+        Serial.printf("Apps Found: %d\n", appCount);
+    }
+    Serial.println("===================\n");
+    printBootProfile();
+    printScreenManagerStats();
+    printBacklightStats();
+    printImageAssetStats();
+    if (sdCardAvailable) printSettingsStoreStats();
+    printStorageStats();
+}
+
 void setup()
 {
+    boot_begin();
     if (DEBUG_MODE) {
         Serial.begin(115200);
         delay(500);
         Serial.println("\n=== MODULAR SYSTEM BOOT ===");
+        boot_mark("serial");
     }
     
-    // Initialize SD Card FIRST
-    sdCardAvailable = initSDCard();
+    // Queues and worker task first, boot jobs run on it
+    initTaskModel();
     
-    if (sdCardAvailable) {
-        DEBUG_PRINTLN("✓ SD Card OK");
-        
-        // Create required directories
-        if (!SD_MMC.exists("/apps")) SD_MMC.mkdir("/apps");
-        if (!SD_MMC.exists("/data")) SD_MMC.mkdir("/data");
-        
-        // Initialize modular app system
-        initModularAppSystem();
-        
-        // Initialize settings (loads from SD card)
-        initSettings();
-    } else {
-        DEBUG_PRINTLN("✗ No SD Card - limited functionality");
-    }
+    // Only the home screen is needed for the first frame, the SD card
+    // and everything on it come after, in dependency order
+    int sd = boot_add_job("sd mount", bootMountSd, 0, BOOT_ON_WORKER);
+    boot_add_job("touch cal", bootTouchCalibration, 1 << sd, BOOT_ON_UI);
+    boot_add_job("settings", bootSettings, 1 << sd, BOOT_ON_UI);
+    boot_add_job("storage", bootStorageStats, 1 << sd, BOOT_ON_UI);
+    boot_add_job("app index", bootIndexApps, 1 << sd, BOOT_ON_UI);
+    boot_on_complete(bootFinished);
+    boot_start();   // The card mounts on the worker from here
+    boot_mark("tasks");
     
-    // Initialize display
+    // Initialize display. The backlight stays dark until the loop ticks
+    // its fade in, after the first frame, so the panel needs no clearing
     my_lcd.init();
-    my_lcd.fillScreen(0xFFFF);
+    backlight_init(screenBrightness);   // Saved brightness follows with the settings job
     my_lcd.setRotation(1);
     touch_init(my_lcd.width(), my_lcd.height(), my_lcd.getRotation());
+    gestures_init();
     DEBUG_PRINTLN("✓ Display initialized");
+    boot_mark("display");
     
     // Initialize LVGL
     lv_init();
-    lv_disp_draw_buf_init(&disp_buf, buf, NULL, screenWidth*10);
     
     static lv_disp_drv_t disp_drv;
     lv_disp_drv_init(&disp_drv);
     disp_drv.hor_res = my_lcd.width();
     disp_drv.ver_res = my_lcd.height();
-    disp_drv.flush_cb = my_disp_flush;
-    disp_drv.draw_buf = &disp_buf;
+    initDisplayFlush(&disp_drv, &disp_buf, NULL);  // Double-buffered DMA flush, buffers per DISPLAY_BUFFER_STRATEGY
     lv_disp_drv_register(&disp_drv);
     
     static lv_indev_drv_t indev_drv;
@@ -137,38 +212,43 @@ void setup()
     indev_drv.type = LV_INDEV_TYPE_POINTER;
     indev_drv.read_cb = my_touchpad_read;
     lv_indev_drv_register(&indev_drv);
+    initImageAssets();      // Before ui_init(), the home screen shows img_bg
     DEBUG_PRINTLN("✓ LVGL initialized");
+    boot_mark("lvgl");
     
     // Initialize EEZ Studio UI (your custom home screen)
     ui_init();
-    delay(50);
     
-    // Print system info
-    if (DEBUG_MODE) {
-        Serial.println("\n=== SYSTEM INFO ===");
-        Serial.printf("Flash: %lu MB\n", ESP.getFlashChipSize() / 1024 / 1024);
-        Serial.printf("Free Heap: %lu KB\n", ESP.getFreeHeap() / 1024);
-        Serial.printf("PSRAM: %lu KB\n", ESP.getPsramSize() / 1024);
-        
-        if (sdCardAvailable) {
-            Serial.printf("SD Card: %llu MB\n", SD_MMC.cardSize() / 1024 / 1024);
-            Serial.printf("Apps Found: %d\n", appCount);
-        }
-        Serial.println("===================\n");
-    }
+    // From here on screens are created on first show and cold ones are
+    // deleted again (screen_manager.h)
+    screenManagerRegisterEez(SCREEN_ID_MAIN, "main", create_screen_main, SCREEN_KEEP);
+    screenManagerRegisterEez(SCREEN_ID_TEST_SCREEN, "test_screen", create_screen_test_screen);
+    screenManagerRegisterEez(SCREEN_ID_RTC, "rtc", create_screen_rtc);
+    registerSettingsScreen();
+    registerModularAppScreens();
+    registerTouchCalibrationScreen();
+    initScreenManager();
+    boot_mark("ui");
     
+    // Render the home screen now rather than on the first loop pass; the
+    // last transfer completes in display_flush_poll()
+    lv_refr_now(NULL);
+    boot_mark("first frame");
+    
+    initLoopScheduler();
+    boot_start();   // UI jobs run from the loop, between frames
     DEBUG_PRINTLN("✓ System ready");
 }
 
 void loop()
 {
-    lv_task_handler();
-    ui_tick();
+    // Input, LVGL and EEZ flow, then sleep until the next LVGL deadline,
+    // pending flow work or a touch interrupt (see loop_scheduler.h)
+    runLoopScheduler();
+    if (DEBUG_MODE) deviceChecksPoll();
     
     // Run current app loop if one is active
     // (Apps handle their own loop functions)
-    
-    delay(5);
 }
 
 // ═══════════════════════════════════════════════════════════════
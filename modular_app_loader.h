@@ -6,6 +6,26 @@
  * 
  * This frees up flash memory on the ESP32-S3
  * 
+ * Code files are streamed into pages on the worker core (app_pages.h),
+ * the launcher footer shows the load progress. One launch runs at a time;
+ * the worker works on a copy of the entry and the code is attached to
+ * the registry on the UI task. Closed apps stay warm in
+ * the LRU cache (app_cache.h) until budget or heap pressure evicts them.
+ * 
+ * Apps whose codefile ends in .pbc are bytecode images run by the VM
+ * in app_vm.h, .o files are native modules linked at load time by
+ * native_module_loader.h; other code files are only loaded and shown.
+ * 
+ * Apps come from the shared registry (app_registry.h); launching by
+ * name goes through its hashed name index.
+ * 
+ * The launcher stays hot in the screen manager (screen_manager.h) and
+ * is only rebuilt when the registry changed; each app gets a transient
+ * screen that is deleted once the app is left.
+ * 
+ * runLauncherOpenBenchmark() times opening the launcher, after a noted
+ * change to /apps and with the registry current.
+ * 
  * File: modular_app_loader.h
  */
 
@@ -15,175 +35,114 @@
 #include <lvgl.h>
 #include "SD_MMC.h"
 #include <FS.h>
+#include "task_model.h"
+#include "app_registry.h"
+#include "app_vm.h"
+#include "native_module_loader.h"
+#include "app_pages.h"
+#include "app_cache.h"
+#include "virtual_list.h"
+#include "screen_manager.h"
 
-#define MAX_APPS 20
-#define MAX_APP_NAME 32
-#define MAX_APP_CODE_SIZE 50000  // 50KB max per app
+int currentAppIndex = -1;
+static bool appLaunching = false;   // A load is in flight, taps are ignored until it lands
 
-// App function pointer types
-typedef void (*AppSetupFunc)();
-typedef void (*AppLoopFunc)();
-typedef void (*AppCleanupFunc)();
+static lv_obj_t * launcher_footer = NULL;
 
-// App structure
-struct ModularApp {
+// One launch, owned by the worker until it is posted back to the UI task.
+// The worker only sees copies, never the registry it may be rebuilt under.
+struct AppLoadJob {
     char name[MAX_APP_NAME];
-    char description[64];
     char filepath[64];
-    bool enabled;
-    bool loaded;
-    
-    // Function pointers
-    AppSetupFunc setup;
-    AppLoopFunc loop;
-    AppCleanupFunc cleanup;
-    
-    // Code storage
-    char* codeBuffer;
-    size_t codeSize;
+    uint32_t lastPercent;       // Progress already reported
+    AppCacheEntry * code;       // Pinned result, NULL if loading failed
 };
 
-// Global app registry
-ModularApp appRegistry[MAX_APPS];
-int appCount = 0;
-int currentAppIndex = -1;
-
 // ═══════════════════════════════════════════════════════════════
 // APP LOADING SYSTEM
 // ═══════════════════════════════════════════════════════════════
 
-// Scan SD card for app manifest files
+// Scan /apps through the shared registry
 void scanForModularApps() {
-    appCount = 0;
-    
-    Serial.println("\n=== Scanning for Modular Apps ===");
-    
-    fs::File root = SD_MMC.open("/apps");
-    if (!root || !root.isDirectory()) {
-        Serial.println("No /apps directory");
-        return;
-    }
+    static uint32_t seenGeneration = 0;
+    scanApps();
     
-    fs::File file = root.openNextFile();
-    while (file && appCount < MAX_APPS) {
-        String filename = String(file.name());
-        
-        // Look for .manifest files
-        if (!file.isDirectory() && filename.endsWith(".manifest")) {
-            Serial.printf("Found manifest: %s\n", filename.c_str());
-            
-            // Read manifest
-            fs::File manifest = SD_MMC.open(file.path());
-            
-            String name = "";
-            String desc = "";
-            String codefile = "";
-            bool enabled = true;
-            
-            while (manifest.available()) {
-                String line = manifest.readStringUntil('\n');
-                line.trim();
-                
-                if (line.startsWith("name=")) {
-                    name = line.substring(5);
-                } else if (line.startsWith("description=")) {
-                    desc = line.substring(12);
-                } else if (line.startsWith("codefile=")) {
-                    codefile = line.substring(9);
-                } else if (line.startsWith("enabled=")) {
-                    enabled = (line.substring(8) == "true");
-                }
-            }
-            manifest.close();
-            
-            if (name.length() > 0 && codefile.length() > 0 && enabled) {
-                // Register app
-                strncpy(appRegistry[appCount].name, name.c_str(), MAX_APP_NAME - 1);
-                strncpy(appRegistry[appCount].description, desc.c_str(), 63);
-                
-                // Build full path to code file
-                char fullpath[64];
-                snprintf(fullpath, sizeof(fullpath), "/apps/%s", codefile.c_str());
-                strncpy(appRegistry[appCount].filepath, fullpath, 63);
-                
-                appRegistry[appCount].enabled = enabled;
-                appRegistry[appCount].loaded = false;
-                appRegistry[appCount].codeBuffer = NULL;
-                appRegistry[appCount].setup = NULL;
-                appRegistry[appCount].loop = NULL;
-                appRegistry[appCount].cleanup = NULL;
-                
-                Serial.printf("  Registered: %s -> %s\n", name.c_str(), fullpath);
-                appCount++;
-            }
-        }
-        file = root.openNextFile();
+    // Cached code may be stale once manifests changed, whoever rescanned
+    if (appRegistryGeneration != seenGeneration) {
+        seenGeneration = appRegistryGeneration;
+        worker_post([](void *) { appCacheFlush(); }, NULL);
     }
-    
-    Serial.printf("Found %d modular apps\n", appCount);
 }
 
-// Load app code from SD card into RAM
-bool loadAppCode(int appIndex) {
-    if (appIndex < 0 || appIndex >= appCount) return false;
-    if (appRegistry[appIndex].loaded) return true;  // Already loaded
-    
-    Serial.printf("Loading app: %s\n", appRegistry[appIndex].name);
-    
-    // Open code file
-    fs::File file = SD_MMC.open(appRegistry[appIndex].filepath);
-    if (!file) {
-        Serial.printf("Failed to open: %s\n", appRegistry[appIndex].filepath);
-        return false;
-    }
-    
-    size_t fileSize = file.size();
-    
-    if (fileSize > MAX_APP_CODE_SIZE) {
-        Serial.printf("App too large: %d bytes (max %d)\n", fileSize, MAX_APP_CODE_SIZE);
-        file.close();
-        return false;
-    }
-    
-    // Allocate memory for code
-    appRegistry[appIndex].codeBuffer = (char*)malloc(fileSize + 1);
-    if (!appRegistry[appIndex].codeBuffer) {
-        Serial.println("Failed to allocate memory");
-        file.close();
-        return false;
-    }
+// Worker core: show load progress in the launcher footer
+static void appLoadProgress(void * user, uint32_t loaded, uint32_t total) {
+    AppLoadJob * job = (AppLoadJob *)user;
+    uint32_t percent = total ? loaded * 100 / total : 100;
+    if (percent != 100 && percent < job->lastPercent + 10 && loaded > APP_PAGE_SIZE) return;
+    job->lastPercent = percent;
+    
+    char text[64];
+    snprintf(text, sizeof(text), "Loading %s... %lu%%", job->name, percent);
+    ui_post_text(launcher_footer, text);
+}
+
+static bool isNativeApp(const char * path) {
+    size_t len = strlen(path);
+    return len > 2 && strcmp(path + len - 2, ".o") == 0;
+}
+
+// Get app code from the warm cache or stream it from SD (worker core)
+static bool loadAppCode(AppLoadJob * job) {
+    if (job->filepath[0] == '\0') return true;   // .app descriptor, nothing to load
     
-    // Read code into buffer
-    file.read((uint8_t*)appRegistry[appIndex].codeBuffer, fileSize);
-    appRegistry[appIndex].codeBuffer[fileSize] = '\0';
-    appRegistry[appIndex].codeSize = fileSize;
-    file.close();
+    Serial.printf("Loading app: %s\n", job->name);
+    uint32_t start = millis();
     
-    appRegistry[appIndex].loaded = true;
+    job->code = appCacheAcquire(job->filepath, isNativeApp(job->filepath), appLoadProgress, job);
+    if (!job->code) return false;
     
-    Serial.printf("Loaded %d bytes into RAM\n", fileSize);
+    Serial.printf("Loaded %lu bytes in %lu ms\n", job->code->bytes, millis() - start);
     Serial.printf("Free heap: %d bytes\n", ESP.getFreeHeap());
     
     return true;
 }
 
-// Unload app code from RAM
+// The registry may have been rescanned during the load, so the app is
+// looked up again by name (UI task). -1 if it is gone or changed.
+static int findLoadedApp(AppLoadJob * job) {
+    int appIndex = appRegistryFind(job->name);
+    if (appIndex < 0 || strcmp(appRegistry[appIndex].filepath, job->filepath) != 0) return -1;
+    return appIndex;
+}
+
+// Hand loaded code to its registry entry (UI task)
+static void attachAppCode(int appIndex, AppLoadJob * job) {
+    AppEntry &app = appRegistry[appIndex];
+    app.code = job->code;
+    if (!app.code) return;
+    
+    // Native modules bring their own entry points
+    if (isNativeApp(app.filepath)) {
+        app.setup = app.code->module.setup;
+        app.loop = app.code->module.loop;
+        app.cleanup = app.code->module.cleanup;
+    }
+    app.codeSize = app.code->bytes;
+}
+
+// Release app code, it stays in the cache until evicted
 void unloadAppCode(int appIndex) {
     if (appIndex < 0 || appIndex >= appCount) return;
-    if (!appRegistry[appIndex].loaded) return;
+    if (!appRegistry[appIndex].code) return;
     
-    if (appRegistry[appIndex].codeBuffer) {
-        free(appRegistry[appIndex].codeBuffer);
-        appRegistry[appIndex].codeBuffer = NULL;
-    }
+    appCacheRelease(appRegistry[appIndex].code);
     
-    appRegistry[appIndex].loaded = false;
+    appRegistry[appIndex].code = NULL;
     appRegistry[appIndex].setup = NULL;
     appRegistry[appIndex].loop = NULL;
     appRegistry[appIndex].cleanup = NULL;
     
-    Serial.printf("Unloaded app: %s\n", appRegistry[appIndex].name);
-    Serial.printf("Free heap: %d bytes\n", ESP.getFreeHeap());
+    Serial.printf("Released app: %s\n", appRegistry[appIndex].name);
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -192,22 +151,68 @@ void unloadAppCode(int appIndex) {
 
 void launchModularApp(int appIndex);
 
-static void app_button_event(lv_event_t * e) {
-    if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
-    
-    int appIndex = (int)(intptr_t)lv_event_get_user_data(e);
+static VirtualList modularAppList;
+static lv_style_t launcher_title_style;
+static lv_style_t launcher_desc_style;
+
+static void initLauncherStyles() {
+    static bool ready = false;
+    if (ready) return;
+    lv_style_init(&launcher_title_style);
+    lv_style_set_text_font(&launcher_title_style, &lv_font_montserrat_20);
+    lv_style_init(&launcher_desc_style);
+    lv_style_set_text_font(&launcher_desc_style, &lv_font_montserrat_10);
+    lv_style_set_text_color(&launcher_desc_style, lv_color_hex(0x666666));
+    ready = true;
+}
+
+// One pooled row: name, description and resident indicator
+static lv_obj_t * createAppRow(lv_obj_t * parent, void * user) {
+    lv_obj_t * app_btn = lv_btn_create(parent);
+    lv_obj_set_size(app_btn, 280, 50);
+    lv_obj_set_x(app_btn, 5);
+    lv_obj_set_style_bg_color(app_btn, lv_color_hex(0xF8F8F8), 0);
+    
+    lv_obj_t * app_name = lv_label_create(app_btn);
+    lv_obj_align(app_name, LV_ALIGN_TOP_LEFT, 10, 8);
+    
+    lv_obj_t * app_desc = lv_label_create(app_btn);
+    lv_obj_align(app_desc, LV_ALIGN_BOTTOM_LEFT, 10, -8);
+    lv_obj_add_style(app_desc, &launcher_desc_style, 0);
+    
+    lv_obj_t * loaded_ind = lv_label_create(app_btn);
+    lv_label_set_text(loaded_ind, "●");
+    lv_obj_align(loaded_ind, LV_ALIGN_RIGHT_MID, -10, 0);
+    lv_obj_set_style_text_color(loaded_ind, lv_color_hex(0x4CAF50), 0);
+    return app_btn;
+}
+
+static void bindAppRow(lv_obj_t * row, int i, void * user) {
+    lv_label_set_text_static(lv_obj_get_child(row, 0), appRegistry[i].name);
+    lv_label_set_text_static(lv_obj_get_child(row, 1), appRegistry[i].description);
+    
+    // Resident in the warm cache
+    lv_obj_t * loaded_ind = lv_obj_get_child(row, 2);
+    if (appCacheContains(appRegistry[i].filepath)) lv_obj_clear_flag(loaded_ind, LV_OBJ_FLAG_HIDDEN);
+    else lv_obj_add_flag(loaded_ind, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void app_row_click(int appIndex, void * user) {
     launchModularApp(appIndex);
 }
 
-void createModularAppLauncher() {
-    Serial.println("Creating modular app launcher...");
-    
-    // Rescan apps
-    scanForModularApps();
-    
-    lv_obj_clean(lv_scr_act());
-    lv_obj_t * screen = lv_scr_act();
+static uint32_t launcherGeneration = 0;   // Registry the launcher rows were built for
+
+static void launcher_screen_delete_event(lv_event_t * e) {
+    launcher_footer = NULL;
+}
+
+// Build the launcher into its screen (once per creation)
+static void buildModularAppLauncher(lv_obj_t * screen) {
+    initLauncherStyles();
+    launcherGeneration = appRegistryGeneration;
     lv_obj_set_style_bg_color(screen, lv_color_hex(0xF0F0F0), 0);
+    lv_obj_add_event_cb(screen, launcher_screen_delete_event, LV_EVENT_DELETE, NULL);
     
     // Title bar
     lv_obj_t * title_bar = lv_obj_create(screen);
@@ -222,10 +227,7 @@ void createModularAppLauncher() {
     lv_obj_align(title, LV_ALIGN_LEFT_MID, 15, 0);
     lv_obj_set_style_text_color(title, lv_color_hex(0xFFFFFF), 0);
     
-    static lv_style_t title_style;
-    lv_style_init(&title_style);
-    lv_style_set_text_font(&title_style, &lv_font_montserrat_20);
-    lv_obj_add_style(title, &title_style, 0);
+    lv_obj_add_style(title, &launcher_title_style, 0);
     
     // Home button
     lv_obj_t * home_btn = lv_btn_create(title_bar);
@@ -240,19 +242,16 @@ void createModularAppLauncher() {
     
     lv_obj_add_event_cb(home_btn, [](lv_event_t * e) {
         if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
-            extern void loadScreen(int screenId);
-            loadScreen(1);
+            screenManagerShowHome();
         }
     }, LV_EVENT_CLICKED, NULL);
     
-    // App list container
-    lv_obj_t * container = lv_obj_create(screen);
-    lv_obj_set_size(container, 300, 165);
-    lv_obj_set_pos(container, 10, 60);
-    lv_obj_set_style_bg_color(container, lv_color_hex(0xFFFFFF), 0);
-    lv_obj_set_style_pad_all(container, 5, 0);
-    
     if (appCount == 0) {
+        lv_obj_t * container = lv_obj_create(screen);
+        lv_obj_set_size(container, 300, 165);
+        lv_obj_set_pos(container, 10, 60);
+        lv_obj_set_style_bg_color(container, lv_color_hex(0xFFFFFF), 0);
+        
         lv_obj_t * no_apps = lv_label_create(container);
         lv_label_set_text(no_apps, 
             "No apps found\n\n"
@@ -260,85 +259,90 @@ void createModularAppLauncher() {
         lv_obj_center(no_apps);
         lv_obj_set_style_text_align(no_apps, LV_TEXT_ALIGN_CENTER, 0);
     } else {
-        for (int i = 0; i < appCount && i < 3; i++) {  // Show max 3 apps
-            lv_obj_t * app_btn = lv_btn_create(container);
-            lv_obj_set_size(app_btn, 280, 50);
-            lv_obj_set_pos(app_btn, 5, i * 55);
-            lv_obj_set_style_bg_color(app_btn, lv_color_hex(0xF8F8F8), 0);
-            lv_obj_add_event_cb(app_btn, app_button_event, LV_EVENT_CLICKED, 
-                               (void*)(intptr_t)i);
-            
-            // App name
-            lv_obj_t * app_name = lv_label_create(app_btn);
-            lv_label_set_text(app_name, appRegistry[i].name);
-            lv_obj_align(app_name, LV_ALIGN_TOP_LEFT, 10, 8);
-            
-            // App description
-            lv_obj_t * app_desc = lv_label_create(app_btn);
-            lv_label_set_text(app_desc, appRegistry[i].description);
-            lv_obj_align(app_desc, LV_ALIGN_BOTTOM_LEFT, 10, -8);
-            
-            static lv_style_t desc_style;
-            lv_style_init(&desc_style);
-            lv_style_set_text_font(&desc_style, &lv_font_montserrat_10);
-            lv_style_set_text_color(&desc_style, lv_color_hex(0x666666));
-            lv_obj_add_style(app_desc, &desc_style, 0);
-            
-            // Size indicator
-            if (appRegistry[i].loaded) {
-                lv_obj_t * loaded_ind = lv_label_create(app_btn);
-                lv_label_set_text(loaded_ind, "●");
-                lv_obj_align(loaded_ind, LV_ALIGN_RIGHT_MID, -10, 0);
-                lv_obj_set_style_text_color(loaded_ind, lv_color_hex(0x4CAF50), 0);
-            }
-        }
+        // Only visible rows exist, they are rebound while scrolling
+        lv_obj_t * container = virtualListCreate(&modularAppList, screen, 300, 165, 55, appCount,
+                                                 createAppRow, bindAppRow, app_row_click, NULL);
+        lv_obj_set_pos(container, 10, 60);
+        lv_obj_set_style_bg_color(container, lv_color_hex(0xFFFFFF), 0);
+        lv_obj_set_style_pad_all(container, 5, 0);
     }
     
-    // Footer
-    lv_obj_t * footer = lv_label_create(screen);
+    // Footer (also shows load progress)
+    launcher_footer = lv_label_create(screen);
+    lv_obj_align(launcher_footer, LV_ALIGN_BOTTOM_MID, 0, -5);
+    lv_obj_set_style_text_color(launcher_footer, lv_color_hex(0x888888), 0);
+}
+
+// Bring a hot launcher up to date before it is shown
+static void showModularAppLauncher(lv_obj_t * screen) {
     char footer_text[64];
     uint32_t freeHeap = ESP.getFreeHeap() / 1024;
     snprintf(footer_text, sizeof(footer_text), 
              "%d apps | Free RAM: %lu KB", appCount, freeHeap);
-    lv_label_set_text(footer, footer_text);
-    lv_obj_align(footer, LV_ALIGN_BOTTOM_MID, 0, -5);
-    lv_obj_set_style_text_color(footer, lv_color_hex(0x888888), 0);
+    lv_label_set_text(launcher_footer, footer_text);
+    
+    // Resident indicators change as apps are closed and evicted
+    if (modularAppList.container) virtualListRefresh(&modularAppList);
 }
 
-// Launch an app
-void launchModularApp(int appIndex) {
-    if (appIndex < 0 || appIndex >= appCount) return;
+void createModularAppLauncher() {
+    Serial.println("Opening modular app launcher...");
     
-    Serial.printf("Launching: %s\n", appRegistry[appIndex].name);
+    // Rescan only after a change to /apps was noted or when a rebuild
+    // waited for the last app to close, otherwise no SD access
+    if (appRegistryRebuildPending || appIndexNeedsRefresh()) scanForModularApps();
     
-    // Load app code if not loaded
-    if (!loadAppCode(appIndex)) {
-        Serial.println("Failed to load app");
-        return;
+    // Rows index the registry, rebuild them once it was rebuilt
+    if (launcherGeneration != appRegistryGeneration) {
+        screenManagerInvalidate(SCREEN_ID_MODULAR_LAUNCHER);
+    }
+    screenManagerShow(SCREEN_ID_MODULAR_LAUNCHER);
+}
+
+static bool isBytecodeApp(const char * path) {
+    size_t len = strlen(path);
+    return len > 4 && strcmp(path + len - 4, ".pbc") == 0;
+}
+
+// Stop the running app and release its code (UI task)
+static void closeModularApp() {
+    if (currentAppIndex < 0) return;
+    
+    worker_stop_app_loop();
+    if (appRegistry[currentAppIndex].cleanup) appRegistry[currentAppIndex].cleanup();
+    if (isBytecodeApp(appRegistry[currentAppIndex].filepath)) vmUnload();
+    unloadAppCode(currentAppIndex);
+    currentAppIndex = -1;
+    appRegistryRelease();
+}
+
+static int appScreenIndex = -1;
+static bool appScreenRunnable = false;
+static const char * appScreenStatus = NULL;
+
+// Build the screen of the app being shown, it is transient and goes
+// away once the app is left
+static void buildModularAppScreen(lv_obj_t * screen) {
+    AppEntry &app = appRegistry[appScreenIndex];
+    
+    if (!appScreenRunnable) {
+        lv_obj_t * msg = lv_label_create(screen);
+        char msgText[256];
+        snprintf(msgText, sizeof(msgText),
+                 "App: %s\n\n"
+                 "%s\n\n"
+                 "Code loaded: %d bytes\n"
+                 "Free RAM: %d KB\n\n"
+                 "%s",
+                 app.name,
+                 app.description,
+                 app.codeSize,
+                 ESP.getFreeHeap() / 1024,
+                 appScreenStatus);
+        lv_label_set_text(msg, msgText);
+        lv_obj_center(msg);
+        lv_obj_set_style_text_align(msg, LV_TEXT_ALIGN_CENTER, 0);
     }
-    
-    // For now, show that the app is loaded
-    // In a real implementation, you would parse and execute the code
-    currentAppIndex = appIndex;
-    
-    lv_obj_clean(lv_scr_act());
-    lv_obj_t * screen = lv_scr_act();
-    
-    lv_obj_t * msg = lv_label_create(screen);
-    char msgText[256];
-    snprintf(msgText, sizeof(msgText),
-             "App: %s\n\n"
-             "%s\n\n"
-             "Code loaded: %d bytes\n"
-             "Free RAM: %d KB\n\n"
-             "App execution coming soon!",
-             appRegistry[appIndex].name,
-             appRegistry[appIndex].description,
-             appRegistry[appIndex].codeSize,
-             ESP.getFreeHeap() / 1024);
-    lv_label_set_text(msg, msgText);
-    lv_obj_center(msg);
-    lv_obj_set_style_text_align(msg, LV_TEXT_ALIGN_CENTER, 0);
     
     // Back button
     lv_obj_t * back_btn = lv_btn_create(screen);
@@ -351,25 +355,177 @@ void launchModularApp(int appIndex) {
     
     lv_obj_add_event_cb(back_btn, [](lv_event_t * e) {
         if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
-            // Unload current app
-            if (currentAppIndex >= 0) {
-                unloadAppCode(currentAppIndex);
-                currentAppIndex = -1;
-            }
+            closeModularApp();
             createModularAppLauncher();
         }
     }, LV_EVENT_CLICKED, NULL);
 }
 
+// Report a launch that did not make it (UI task)
+static void failModularApp(void * arg) {
+    AppLoadJob * job = (AppLoadJob *)arg;
+    appLaunching = false;
+    appRegistryRelease();
+    appCacheRelease(job->code);
+    
+    Serial.printf("Failed to load app: %s\n", job->name);
+    if (launcher_footer) {
+        char text[64];
+        snprintf(text, sizeof(text), "Could not load %s", job->name);
+        lv_label_set_text(launcher_footer, text);
+    }
+    free(job);
+}
+
+// Show a loaded app (UI task)
+static void showModularApp(void * arg) {
+    AppLoadJob * job = (AppLoadJob *)arg;
+    int appIndex = findLoadedApp(job);
+    if (appIndex < 0) {
+        Serial.printf("%s changed while loading\n", job->name);
+        failModularApp(job);
+        return;
+    }
+    
+    // Launched by name while another app runs: that one goes first, its
+    // cleanup runs and its pin is dropped
+    closeModularApp();
+    
+    attachAppCode(appIndex, job);
+    appLaunching = false;
+    free(job);
+    
+    AppEntry &app = appRegistry[appIndex];
+    currentAppIndex = appIndex;
+    
+    // Native modules already have entry points, bytecode apps get the VM's
+    bool runnable = app.setup != NULL || app.loop != NULL;
+    const char * status = app.filepath[0] ? "Not a .pbc or .o app" : "No code file (.app descriptor)";
+    if (isBytecodeApp(app.filepath)) {
+        runnable = vmLoad(&app.code->image);
+        status = appVm.error;
+        if (runnable) {
+            app.setup = vm_app_setup;
+            app.loop = vm_app_loop;
+            app.cleanup = vm_app_cleanup;
+        }
+    }
+    
+    // Always a fresh screen, never a previous app's leftovers
+    appScreenIndex = appIndex;
+    appScreenRunnable = runnable;
+    appScreenStatus = status;
+    screenManagerInvalidate(SCREEN_ID_MODULAR_APP);
+    screenManagerShow(SCREEN_ID_MODULAR_APP);
+    
+    // Setup builds the app UI on the active screen, its loop runs on
+    // the worker core. Gestures made before the app started are not its input.
+    gesture_flush();
+    if (app.setup) app.setup();
+    worker_set_app_loop(app.loop);
+}
+
+// Read the app from SD on the worker core, then show it on the UI task.
+// Either answer must arrive, it is what clears appLaunching.
+static void loadModularAppJob(void * arg) {
+    AppLoadJob * job = (AppLoadJob *)arg;
+    TaskJobFunc done = loadAppCode(job) ? showModularApp : failModularApp;
+    while (!ui_post_call(done, job)) delay(5);
+}
+
+// Launch an app
+void launchModularApp(int appIndex) {
+    if (appIndex < 0 || appIndex >= appCount) return;
+    if (appLaunching) {
+        Serial.println("Launch in progress, tap ignored");
+        return;
+    }
+    
+    AppLoadJob * job = (AppLoadJob *)calloc(1, sizeof(AppLoadJob));
+    if (!job) return;
+    strncpy(job->name, appRegistry[appIndex].name, sizeof(job->name) - 1);
+    strncpy(job->filepath, appRegistry[appIndex].filepath, sizeof(job->filepath) - 1);
+    
+    Serial.printf("Launching: %s\n", job->name);
+    
+    // Load app code if not loaded (SD read happens off the UI core).
+    // The registry hold passes to the app once it runs.
+    appLaunching = true;
+    appRegistryHold();
+    if (!worker_post(loadModularAppJob, job)) {
+        appLaunching = false;
+        appRegistryRelease();
+        free(job);
+    }
+}
+
+// Launch an app by its manifest name, O(1) through the registry index
+bool launchAppByName(const char * name) {
+    int appIndex = appRegistryFind(name);
+    if (appIndex < 0) {
+        Serial.printf("No app named %s\n", name);
+        return false;
+    }
+    launchModularApp(appIndex);
+    return true;
+}
+
 // Call from EEZ Studio action
 void action_open_modular_apps() {
     createModularAppLauncher();
 }
 
+// Call once in setup, both screens are built when first opened
+void registerModularAppScreens() {
+    screenManagerRegister(SCREEN_ID_MODULAR_LAUNCHER, "modular_launcher",
+                          buildModularAppLauncher, showModularAppLauncher);
+    screenManagerRegister(SCREEN_ID_MODULAR_APP, "modular_app",
+                          buildModularAppScreen, NULL, SCREEN_TRANSIENT);
+}
+
 // Initialize system
 void initModularAppSystem() {
     scanForModularApps();
     Serial.println("Modular app system initialized");
 }
 
+// ═══════════════════════════════════════════════════════════════
+// BENCHMARK
+// ═══════════════════════════════════════════════════════════════
+
+// Times createModularAppLauncher(), the path behind the Apps button. The
+// first open after a noted change walks /apps once, the others must not
+// touch the card. Goes back to the previous screen. Returns the number
+// of failures.
+uint32_t runLauncherOpenBenchmark(uint32_t opens = 20) {
+    uint32_t failures = 0;
+    int previous = screenManagerCurrent();
+
+    appIndexNoteChange();
+    uint32_t walks = appIndexStats.refreshes;
+    uint32_t start = micros();
+    createModularAppLauncher();
+    uint32_t changedMicros = micros() - start;
+    TEST_CHECK(appIndexStats.refreshes == walks + 1, "open after a change walked /apps %lu times, expected 1",
+               appIndexStats.refreshes - walks);
+
+    walks = appIndexStats.refreshes;
+    uint32_t total = 0, worst = 0;
+    for (uint32_t i = 0; i < opens; i++) {
+        start = micros();
+        createModularAppLauncher();
+        uint32_t elapsed = micros() - start;
+        total += elapsed;
+        if (elapsed > worst) worst = elapsed;
+    }
+    TEST_CHECK(appIndexStats.refreshes == walks, "%lu of %lu opens walked /apps with no change noted",
+               appIndexStats.refreshes - walks, opens);
+
+    if (previous) screenManagerShow(previous);
+
+    Serial.printf("Launcher open, %d apps: %lu us after a change, %lu us avg / %lu us worst unchanged (%lu opens)\n",
+                  appCount, changedMicros, opens ? total / opens : 0, worst, opens);
+    return failures;
+}
+
 #endif // MODULAR_APP_LOADER_H
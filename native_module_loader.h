@@ -0,0 +1,784 @@
+/*
+ * Native Module Loader
+ *
+ * Loads relocatable ELF objects (ET_REL, "gcc -c") from the SD card so
+ * apps run as native code without being linked into the firmware.
+ * - SHF_ALLOC sections are laid out into two regions: executable memory
+ *   for code and literals, ordinary heap for data/rodata/bss
+ * - Undefined symbols are resolved against moduleExports[], the table of
+ *   firmware functions and variables apps may use
+ * - REL and RELA relocations are applied, then the code region is copied
+ *   into executable RAM with 32-bit writes (IRAM is word addressed)
+ * - The module's app_setup / app_loop / app_cleanup symbols become the
+ *   AppEntry entry points
+ *
+ * Supported relocations:
+ *   Xtensa: R_XTENSA_32, R_XTENSA_32_PCREL, R_XTENSA_SLOT0_OP on
+ *           L32R, CALLn, J and the BRI8/BRI12/BEQZ.N branch formats
+ *   i386:   R_386_32, R_386_PC32, R_386_PLT32 (stand-in modules for
+ *           checking relocation and symbol resolution on a -m32 host build)
+ *
+ * Build modules with: -c -mlongcalls -mtext-section-literals -fno-common
+ * (-mlongcalls keeps calls into the firmware out of CALLn range limits).
+ * On the ESP32-S3, allocating executable RAM requires
+ * CONFIG_ESP_SYSTEM_MEMPROT_FEATURE to be disabled.
+ *
+ * All reads go through a ModuleSource so a module can come from a file,
+ * memory, or the paged app loader.
+ *
+ * Host check (i386 stand-in module, see tools/module_host_check.cpp):
+ *   gcc -m32 -c -O1 -fno-pic -fno-common tools/module_host_app.c -o app.o
+ *   g++ -m32 -I. tools/module_host_check.cpp -o module_host_check
+ *   ./module_host_check app.o
+ *
+ * File: native_module_loader.h
+ */
+
+#ifndef NATIVE_MODULE_LOADER_H
+#define NATIVE_MODULE_LOADER_H
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "test_check.h"
+
+#if defined(ARDUINO)
+#include <lvgl.h>
+#include "SD_MMC.h"
+#include <FS.h>
+#include <esp_heap_caps.h>
+#include "touch.h"
+#include "touch_gestures.h"
+#include "task_model.h"
+#else
+#include <sys/mman.h>
+#endif
+
+#define EM_386_ID       3
+#define EM_XTENSA_ID    94
+
+#define MODULE_NAME_MAX 64
+#define MODULE_RELOC_BATCH 32
+
+typedef void (*ModuleEntryFunc)();
+
+// ═══════════════════════════════════════════════════════════════
+// ELF32 STRUCTURES
+// ═══════════════════════════════════════════════════════════════
+
+struct Elf32Ehdr {
+    uint8_t ident[16];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+};
+
+struct Elf32Shdr {
+    uint32_t name;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t addr;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t link;
+    uint32_t info;
+    uint32_t addralign;
+    uint32_t entsize;
+};
+
+struct Elf32Sym {
+    uint32_t name;
+    uint32_t value;
+    uint32_t size;
+    uint8_t info;
+    uint8_t other;
+    uint16_t shndx;
+};
+
+struct Elf32Rela {
+    uint32_t offset;
+    uint32_t info;
+    int32_t addend;     // Not present in SHT_REL entries
+};
+
+enum {
+    ELF_ET_REL = 1,
+    ELF_SHT_SYMTAB = 2, ELF_SHT_RELA = 4, ELF_SHT_NOBITS = 8, ELF_SHT_REL = 9,
+    ELF_SHF_ALLOC = 0x2, ELF_SHF_EXECINSTR = 0x4,
+    ELF_SHN_UNDEF = 0, ELF_SHN_ABS = 0xFFF1, ELF_SHN_COMMON = 0xFFF2,
+    ELF_STB_LOCAL = 0, ELF_STB_WEAK = 2,
+    ELF_STT_SECTION = 3
+};
+
+enum {
+    R_XTENSA_NONE = 0, R_XTENSA_32 = 1, R_XTENSA_ASM_EXPAND = 11, R_XTENSA_ASM_SIMPLIFY = 12,
+    R_XTENSA_32_PCREL = 14, R_XTENSA_DIFF8 = 17, R_XTENSA_DIFF16 = 18, R_XTENSA_DIFF32 = 19,
+    R_XTENSA_SLOT0_OP = 20
+};
+
+enum {
+    R_386_NONE = 0, R_386_32 = 1, R_386_PC32 = 2, R_386_PLT32 = 4
+};
+
+// ═══════════════════════════════════════════════════════════════
+// SOURCES AND EXPORTS
+// ═══════════════════════════════════════════════════════════════
+
+// Random access reader, returns false on a short read
+struct ModuleSource {
+    bool (*read)(void * ctx, uint32_t offset, void * dst, uint32_t len);
+    void * ctx;
+};
+
+struct ModuleMemory {
+    const uint8_t * data;
+    uint32_t size;
+};
+
+static bool moduleMemoryRead(void * ctx, uint32_t offset, void * dst, uint32_t len) {
+    ModuleMemory * mem = (ModuleMemory *)ctx;
+    if (offset > mem->size || len > mem->size - offset) return false;
+    memcpy(dst, mem->data + offset, len);
+    return true;
+}
+
+#if defined(ARDUINO)
+static bool moduleFileRead(void * ctx, uint32_t offset, void * dst, uint32_t len) {
+    fs::File * file = (fs::File *)ctx;
+    return file->seek(offset) && file->read((uint8_t *)dst, len) == len;
+}
+#endif
+
+struct ModuleSymbol {
+    const char * name;
+    const void * addr;
+};
+
+#define MODULE_EXPORT(sym) { #sym, (const void *)&sym }
+
+#if defined(ARDUINO)
+extern "C" {
+long long __divdi3(long long, long long);
+long long __moddi3(long long, long long);
+unsigned long long __udivdi3(unsigned long long, unsigned long long);
+unsigned long long __umoddi3(unsigned long long, unsigned long long);
+}
+
+// Firmware API visible to native apps
+static const ModuleSymbol moduleExports[] = {
+    // C library and compiler runtime
+    MODULE_EXPORT(malloc), MODULE_EXPORT(free),
+    MODULE_EXPORT(memcpy), MODULE_EXPORT(memmove), MODULE_EXPORT(memset),
+    MODULE_EXPORT(strlen), MODULE_EXPORT(strcmp), MODULE_EXPORT(strncpy),
+    MODULE_EXPORT(snprintf), MODULE_EXPORT(printf),
+    MODULE_EXPORT(__divdi3), MODULE_EXPORT(__moddi3),
+    MODULE_EXPORT(__udivdi3), MODULE_EXPORT(__umoddi3),
+    // Arduino
+    MODULE_EXPORT(millis), MODULE_EXPORT(micros), MODULE_EXPORT(delay),
+    // LVGL (UI task only, i.e. from app_setup / app_cleanup)
+    MODULE_EXPORT(lv_scr_act), MODULE_EXPORT(lv_obj_create), MODULE_EXPORT(lv_obj_del),
+    MODULE_EXPORT(lv_obj_set_pos), MODULE_EXPORT(lv_obj_set_size),
+    MODULE_EXPORT(lv_obj_align), MODULE_EXPORT(lv_obj_center),
+    MODULE_EXPORT(lv_obj_add_event_cb), MODULE_EXPORT(lv_event_get_code),
+    MODULE_EXPORT(lv_event_get_user_data),
+    MODULE_EXPORT(lv_obj_set_style_bg_color), MODULE_EXPORT(lv_obj_set_style_text_color),
+    MODULE_EXPORT(lv_label_create), MODULE_EXPORT(lv_label_set_text),
+    MODULE_EXPORT(lv_btn_create), MODULE_EXPORT(lv_bar_create),
+    MODULE_EXPORT(lv_bar_set_range), MODULE_EXPORT(lv_bar_set_value),
+    // Worker -> UI messages (safe from app_loop)
+    MODULE_EXPORT(ui_post_text), MODULE_EXPORT(ui_post_value),
+    MODULE_EXPORT(ui_post_checked), MODULE_EXPORT(ui_post_call),
+    MODULE_EXPORT(worker_post),
+    // Touch state and gestures (GestureEvent layout from touch_gestures.h)
+    MODULE_EXPORT(touch_down), MODULE_EXPORT(touch_last_x), MODULE_EXPORT(touch_last_y),
+    MODULE_EXPORT(gesture_poll),
+};
+
+static const ModuleSymbol * moduleExportTable = moduleExports;
+static size_t moduleExportCount = sizeof(moduleExports) / sizeof(moduleExports[0]);
+#else
+static const ModuleSymbol * moduleExportTable = NULL;
+static size_t moduleExportCount = 0;
+#endif
+
+// Replace the export table (host checks use their own symbols)
+void module_set_exports(const ModuleSymbol * table, size_t count) {
+    moduleExportTable = table;
+    moduleExportCount = count;
+}
+
+static const void * moduleFindExport(const char * name, bool * found) {
+    for (size_t i = 0; i < moduleExportCount; i++) {
+        if (strcmp(moduleExportTable[i].name, name) == 0) {
+            *found = true;
+            return moduleExportTable[i].addr;
+        }
+    }
+    *found = false;
+    return NULL;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// MODULE
+// ═══════════════════════════════════════════════════════════════
+
+struct NativeModule {
+    uint8_t * exec;             // Code and literals
+    uint32_t execSize;
+    uint8_t * data;             // Data, rodata and bss
+    uint32_t dataSize;
+
+    ModuleEntryFunc setup;
+    ModuleEntryFunc loop;
+    ModuleEntryFunc cleanup;
+
+    bool loaded;
+    char error[80];
+
+    uint32_t relocations;
+    uint32_t imports;           // Symbols resolved from moduleExports
+    uint32_t micros;
+};
+
+static bool moduleFail(NativeModule * m, const char * fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(m->error, sizeof(m->error), fmt, args);
+    va_end(args);
+#if defined(ARDUINO)
+    Serial.printf("Module load failed: %s\n", m->error);
+#endif
+    return false;
+}
+
+static uint8_t * moduleAllocExec(uint32_t size) {
+#if defined(ARDUINO)
+    return (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_EXEC | MALLOC_CAP_32BIT);
+#else
+    // Heap pages are not executable on a host
+    void * p = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : (uint8_t *)p;
+#endif
+}
+
+static void moduleFreeExec(uint8_t * p, uint32_t size) {
+#if defined(ARDUINO)
+    heap_caps_free(p);
+#else
+    munmap(p, size);
+#endif
+}
+
+void nativeModuleUnload(NativeModule * m) {
+    if (m->exec) moduleFreeExec(m->exec, m->execSize);
+    if (m->data) free(m->data);
+    m->exec = m->data = NULL;
+    m->execSize = m->dataSize = 0;
+    m->setup = m->loop = m->cleanup = NULL;
+    m->loaded = false;
+}
+
+static inline uint32_t moduleAlign(uint32_t v, uint32_t align) {
+    if (align < 4) align = 4;
+    return (v + align - 1) & ~(align - 1);
+}
+
+static inline uint32_t moduleGet32(const uint8_t * p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void modulePut32(uint8_t * p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// RELOCATIONS
+// ═══════════════════════════════════════════════════════════════
+
+// PC-relative Xtensa instruction fields (little endian encodings)
+static bool moduleXtensaSlot0(NativeModule * m, uint8_t * loc, uint32_t P, uint32_t target) {
+    uint8_t op0 = loc[0] & 0x0F;
+    uint32_t insn = loc[0] | (loc[1] << 8) | (loc[2] << 16);
+
+    if (op0 == 0x1) {
+        // L32R: literal must be below the instruction, word aligned
+        int32_t off = (int32_t)(target - ((P + 3) & ~3u));
+        if (off >= 0 || off < -262144 || (off & 3)) {
+            return moduleFail(m, "L32R literal out of range at 0x%x", P);
+        }
+        uint32_t imm = ((uint32_t)off >> 2) & 0xFFFF;
+        loc[1] = imm;
+        loc[2] = imm >> 8;
+        return true;
+    }
+
+    if (op0 == 0x5) {
+        // CALL0/4/8/12
+        int32_t off = (int32_t)(target - ((P & ~3u) + 4));
+        if ((off & 3) || off < -(1 << 19) || off >= (1 << 19)) {
+            return moduleFail(m, "CALL out of range at 0x%x, build with -mlongcalls", P);
+        }
+        insn = (insn & 0x3F) | ((((uint32_t)off >> 2) & 0x3FFFF) << 6);
+    } else if (op0 == 0x6 && ((insn >> 4) & 3) == 0) {
+        // J
+        int32_t off = (int32_t)(target - (P + 4));
+        if (off < -(1 << 17) || off >= (1 << 17)) return moduleFail(m, "J out of range at 0x%x", P);
+        insn = (insn & 0x3F) | (((uint32_t)off & 0x3FFFF) << 6);
+    } else if (op0 == 0x6 && ((insn >> 4) & 3) == 1) {
+        // BEQZ/BNEZ/BLTZ/BGEZ (BRI12)
+        int32_t off = (int32_t)(target - (P + 4));
+        if (off < -2048 || off > 2047) return moduleFail(m, "branch out of range at 0x%x", P);
+        insn = (insn & 0xFFF) | (((uint32_t)off & 0xFFF) << 12);
+    } else if (op0 == 0x6 || op0 == 0x7) {
+        // BRI8 / RRI8 branches, offset in the top byte
+        int32_t off = (int32_t)(target - (P + 4));
+        if (off < -128 || off > 127) return moduleFail(m, "branch out of range at 0x%x", P);
+        insn = (insn & 0xFFFF) | (((uint32_t)off & 0xFF) << 16);
+    } else if (op0 == 0xC && (loc[0] & 0x80)) {
+        // BEQZ.N / BNEZ.N, 6-bit forward offset
+        uint32_t off = target - (P + 4);
+        if (off > 63) return moduleFail(m, "narrow branch out of range at 0x%x", P);
+        loc[0] = (loc[0] & 0xCF) | (off & 0x30);
+        loc[1] = (loc[1] & 0x0F) | ((off & 0x0F) << 4);
+        return true;
+    } else {
+        return moduleFail(m, "unsupported SLOT0_OP opcode 0x%x at 0x%x", loc[0], P);
+    }
+
+    loc[0] = insn;
+    loc[1] = insn >> 8;
+    loc[2] = insn >> 16;
+    return true;
+}
+
+// loc is where the bytes are now (avail bytes left in the section),
+// P their run-time address
+static bool moduleApplyReloc(NativeModule * m, uint16_t machine, uint32_t type,
+                             uint8_t * loc, uint32_t avail, uint32_t P, uint32_t S, int32_t A) {
+    // Field width: 32-bit words, 3-byte instructions, 2-byte narrow branches
+    uint32_t width = 4;
+    if (machine == EM_XTENSA_ID && type == R_XTENSA_SLOT0_OP) width = (loc[0] & 0x0F) == 0xC ? 2 : 3;
+    if (avail < width) return moduleFail(m, "relocation outside section");
+
+    if (machine == EM_XTENSA_ID) {
+        switch (type) {
+            case R_XTENSA_NONE:
+            case R_XTENSA_ASM_EXPAND:
+            case R_XTENSA_ASM_SIMPLIFY:
+            case R_XTENSA_DIFF8:
+            case R_XTENSA_DIFF16:
+            case R_XTENSA_DIFF32:
+                return true;    // Relaxation hints, values already final
+            case R_XTENSA_32:
+                modulePut32(loc, moduleGet32(loc) + S + A);
+                return true;
+            case R_XTENSA_32_PCREL:
+                modulePut32(loc, S + A - P);
+                return true;
+            case R_XTENSA_SLOT0_OP:
+                return moduleXtensaSlot0(m, loc, P, S + A);
+        }
+    } else {
+        // i386 uses REL, the addend is already in place
+        switch (type) {
+            case R_386_NONE:
+                return true;
+            case R_386_32:
+                modulePut32(loc, moduleGet32(loc) + S + A);
+                return true;
+            case R_386_PC32:
+            case R_386_PLT32:
+                modulePut32(loc, moduleGet32(loc) + S + A - P);
+                return true;
+        }
+    }
+    return moduleFail(m, "unsupported relocation type %lu", (unsigned long)type);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// LOADER
+// ═══════════════════════════════════════════════════════════════
+
+// Scratch state for one load, freed before returning
+struct ModuleLoadState {
+    Elf32Ehdr eh;
+    Elf32Shdr * sh;
+    uintptr_t * secAddr;        // Run-time address per section, 0 if not loaded
+    uint8_t ** secLoad;         // Where the bytes sit while relocating
+    uintptr_t * symAddr;        // Resolved address per symbol
+    uint32_t symCount;
+    uint8_t * execStage;        // Code is relocated here, then copied to exec
+};
+
+static bool moduleReadName(const ModuleSource * src, const Elf32Shdr &strtab, uint32_t offset, char * out) {
+    if (offset >= strtab.size) return false;
+    uint32_t len = strtab.size - offset;
+    if (len > MODULE_NAME_MAX - 1) len = MODULE_NAME_MAX - 1;
+    if (!src->read(src->ctx, strtab.offset + offset, out, len)) return false;
+    out[len] = '\0';
+    return true;
+}
+
+static bool isLiteralSection(const ModuleSource * src, const ModuleLoadState &st, const Elf32Shdr &s) {
+    char name[MODULE_NAME_MAX];
+    if (st.eh.shstrndx == 0 || st.eh.shstrndx >= st.eh.shnum) return false;
+    if (!moduleReadName(src, st.sh[st.eh.shstrndx], s.name, name)) return false;
+    return strncmp(name, ".literal", 8) == 0;
+}
+
+// Lay out SHF_ALLOC sections: literals before code (L32R reaches
+// backwards only), everything else into the data region
+static bool moduleLayout(NativeModule * m, const ModuleSource * src, ModuleLoadState &st) {
+    uint32_t execSize = 0, dataSize = 0;
+    uint32_t * offsets = (uint32_t *)calloc(st.eh.shnum, sizeof(uint32_t));
+    if (!offsets) return moduleFail(m, "out of memory");
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint16_t i = 0; i < st.eh.shnum; i++) {
+            const Elf32Shdr &s = st.sh[i];
+            if (!(s.flags & ELF_SHF_ALLOC) || s.size == 0) continue;
+            if (s.flags & ELF_SHF_EXECINSTR) {
+                bool literal = isLiteralSection(src, st, s);
+                if (literal != (pass == 0)) continue;
+                execSize = moduleAlign(execSize, s.addralign);
+                offsets[i] = execSize;
+                execSize += s.size;
+            } else if (pass == 0) {
+                dataSize = moduleAlign(dataSize, s.addralign);
+                offsets[i] = dataSize;
+                dataSize += s.size;
+            }
+        }
+    }
+    m->execSize = moduleAlign(execSize, 4);
+    m->dataSize = dataSize;
+
+    if (m->execSize) {
+        m->exec = moduleAllocExec(m->execSize);
+        st.execStage = (uint8_t *)calloc(1, m->execSize);
+        if (!m->exec || !st.execStage) {
+            free(offsets);
+            return moduleFail(m, "no executable memory for %lu bytes", (unsigned long)m->execSize);
+        }
+    }
+    if (m->dataSize) {
+        m->data = (uint8_t *)calloc(1, m->dataSize);
+        if (!m->data) {
+            free(offsets);
+            return moduleFail(m, "no memory for %lu data bytes", (unsigned long)m->dataSize);
+        }
+    }
+
+    for (uint16_t i = 0; i < st.eh.shnum; i++) {
+        const Elf32Shdr &s = st.sh[i];
+        if (!(s.flags & ELF_SHF_ALLOC) || s.size == 0) continue;
+        bool code = s.flags & ELF_SHF_EXECINSTR;
+        st.secAddr[i] = (uintptr_t)(code ? m->exec : m->data) + offsets[i];
+        st.secLoad[i] = (code ? st.execStage : m->data) + offsets[i];
+
+        // bss stays zeroed
+        if (s.type != ELF_SHT_NOBITS && !src->read(src->ctx, s.offset, st.secLoad[i], s.size)) {
+            free(offsets);
+            return moduleFail(m, "short read in section %u", i);
+        }
+    }
+    free(offsets);
+    return true;
+}
+
+static bool moduleResolveSymbols(NativeModule * m, const ModuleSource * src, ModuleLoadState &st) {
+    int symtab = -1;
+    for (uint16_t i = 0; i < st.eh.shnum; i++) {
+        if (st.sh[i].type == ELF_SHT_SYMTAB) {
+            symtab = i;
+            break;
+        }
+    }
+    if (symtab < 0) return moduleFail(m, "no symbol table");
+
+    const Elf32Shdr &symsec = st.sh[symtab];
+    if (symsec.link >= st.eh.shnum) return moduleFail(m, "bad string table");
+    const Elf32Shdr &strtab = st.sh[symsec.link];
+
+    st.symCount = symsec.size / sizeof(Elf32Sym);
+    st.symAddr = (uintptr_t *)calloc(st.symCount ? st.symCount : 1, sizeof(uintptr_t));
+    if (!st.symAddr) return moduleFail(m, "out of memory");
+
+    char name[MODULE_NAME_MAX];
+    for (uint32_t i = 1; i < st.symCount; i++) {
+        Elf32Sym sym;
+        if (!src->read(src->ctx, symsec.offset + i * sizeof(Elf32Sym), &sym, sizeof(sym))) {
+            return moduleFail(m, "short read in symbol table");
+        }
+        uint8_t bind = sym.info >> 4;
+        uint8_t type = sym.info & 0x0F;
+
+        if (sym.shndx == ELF_SHN_UNDEF) {
+            if (!moduleReadName(src, strtab, sym.name, name)) return moduleFail(m, "bad symbol name");
+            bool found;
+            st.symAddr[i] = (uintptr_t)moduleFindExport(name, &found);
+            if (!found && bind != ELF_STB_WEAK) return moduleFail(m, "undefined symbol %s", name);
+            m->imports++;
+            continue;
+        }
+        if (sym.shndx == ELF_SHN_COMMON) return moduleFail(m, "common symbol, build with -fno-common");
+        if (sym.shndx == ELF_SHN_ABS) {
+            st.symAddr[i] = sym.value;
+            continue;
+        }
+        if (sym.shndx >= st.eh.shnum) return moduleFail(m, "bad section index %u", sym.shndx);
+
+        uintptr_t base = st.secAddr[sym.shndx];
+        st.symAddr[i] = base ? base + (type == ELF_STT_SECTION ? 0 : sym.value) : 0;
+
+        // Entry points
+        if (bind != ELF_STB_LOCAL && base) {
+            if (!moduleReadName(src, strtab, sym.name, name)) return moduleFail(m, "bad symbol name");
+            if (strcmp(name, "app_setup") == 0) m->setup = (ModuleEntryFunc)st.symAddr[i];
+            else if (strcmp(name, "app_loop") == 0) m->loop = (ModuleEntryFunc)st.symAddr[i];
+            else if (strcmp(name, "app_cleanup") == 0) m->cleanup = (ModuleEntryFunc)st.symAddr[i];
+        }
+    }
+    return true;
+}
+
+static bool moduleRelocateSection(NativeModule * m, const ModuleSource * src, ModuleLoadState &st,
+                                  const Elf32Shdr &rs) {
+    uint32_t target = rs.info;
+    if (target >= st.eh.shnum || !st.secAddr[target]) return true;   // e.g. debug info
+    const Elf32Shdr &ts = st.sh[target];
+
+    bool rela = rs.type == ELF_SHT_RELA;
+    uint32_t entSize = rela ? 12 : 8;
+    uint32_t count = rs.size / entSize;
+    uint8_t batch[MODULE_RELOC_BATCH * 12];
+
+    for (uint32_t base = 0; base < count; base += MODULE_RELOC_BATCH) {
+        uint32_t n = count - base < MODULE_RELOC_BATCH ? count - base : MODULE_RELOC_BATCH;
+        if (!src->read(src->ctx, rs.offset + base * entSize, batch, n * entSize)) {
+            return moduleFail(m, "short read in relocations");
+        }
+        for (uint32_t k = 0; k < n; k++) {
+            const uint8_t * e = batch + k * entSize;
+            uint32_t offset = moduleGet32(e);
+            uint32_t info = moduleGet32(e + 4);
+            int32_t addend = rela ? (int32_t)moduleGet32(e + 8) : 0;
+            uint32_t sym = info >> 8;
+
+            if (offset >= ts.size) return moduleFail(m, "relocation outside section");
+            if (sym >= st.symCount) return moduleFail(m, "bad symbol index %lu", (unsigned long)sym);
+
+            uint8_t * loc = st.secLoad[target] + offset;
+            uint32_t P = (uint32_t)(st.secAddr[target] + offset);
+            if (!moduleApplyReloc(m, st.eh.machine, info & 0xFF, loc, ts.size - offset,
+                                  P, (uint32_t)st.symAddr[sym], addend)) {
+                return false;
+            }
+            m->relocations++;
+        }
+    }
+    return true;
+}
+
+static void moduleFreeState(ModuleLoadState &st) {
+    free(st.sh);
+    free(st.secAddr);
+    free(st.secLoad);
+    free(st.symAddr);
+    free(st.execStage);
+}
+
+// Load, link and relocate a module. On failure m->error says why.
+bool nativeModuleLoad(const ModuleSource * src, NativeModule * m) {
+#if defined(ARDUINO)
+    uint32_t start = micros();
+#endif
+    memset(m, 0, sizeof(*m));
+    ModuleLoadState st;
+    memset(&st, 0, sizeof(st));
+
+    bool ok = false;
+    do {
+        Elf32Ehdr &eh = st.eh;
+        if (!src->read(src->ctx, 0, &eh, sizeof(eh))) {
+            moduleFail(m, "file too small");
+            break;
+        }
+        if (memcmp(eh.ident, "\x7F" "ELF", 4) != 0 || eh.ident[4] != 1 || eh.ident[5] != 1) {
+            moduleFail(m, "not a little endian ELF32 file");
+            break;
+        }
+        if (eh.type != ELF_ET_REL) {
+            moduleFail(m, "not a relocatable object");
+            break;
+        }
+        if (eh.machine != EM_XTENSA_ID && eh.machine != EM_386_ID) {
+            moduleFail(m, "unsupported machine %u", eh.machine);
+            break;
+        }
+        if (eh.shentsize != sizeof(Elf32Shdr) || eh.shnum == 0) {
+            moduleFail(m, "bad section headers");
+            break;
+        }
+
+        st.sh = (Elf32Shdr *)malloc(eh.shnum * sizeof(Elf32Shdr));
+        st.secAddr = (uintptr_t *)calloc(eh.shnum, sizeof(uintptr_t));
+        st.secLoad = (uint8_t **)calloc(eh.shnum, sizeof(uint8_t *));
+        if (!st.sh || !st.secAddr || !st.secLoad) {
+            moduleFail(m, "out of memory");
+            break;
+        }
+        if (!src->read(src->ctx, eh.shoff, st.sh, eh.shnum * sizeof(Elf32Shdr))) {
+            moduleFail(m, "short read in section headers");
+            break;
+        }
+
+        if (!moduleLayout(m, src, st)) break;
+        if (!moduleResolveSymbols(m, src, st)) break;
+
+        bool relocated = true;
+        for (uint16_t i = 0; i < eh.shnum && relocated; i++) {
+            if (st.sh[i].type == ELF_SHT_REL || st.sh[i].type == ELF_SHT_RELA) {
+                relocated = moduleRelocateSection(m, src, st, st.sh[i]);
+            }
+        }
+        if (!relocated) break;
+
+        // Executable RAM only takes 32-bit accesses
+        volatile uint32_t * dst = (volatile uint32_t *)m->exec;
+        for (uint32_t i = 0; i < m->execSize / 4; i++) {
+            dst[i] = moduleGet32(st.execStage + i * 4);
+        }
+
+        if (!m->setup && !m->loop) {
+            moduleFail(m, "no app_setup or app_loop symbol");
+            break;
+        }
+        ok = true;
+    } while (0);
+
+    moduleFreeState(st);
+    if (!ok) {
+        nativeModuleUnload(m);
+        return false;
+    }
+
+    m->loaded = true;
+#if defined(ARDUINO)
+    m->micros = micros() - start;
+    Serial.printf("Module loaded: %lu code + %lu data bytes, %lu relocations, %lu imports in %lu us\n",
+                  m->execSize, m->dataSize, m->relocations, m->imports, m->micros);
+#endif
+    return true;
+}
+
+#if defined(ARDUINO)
+bool nativeModuleLoadFile(const char * path, NativeModule * m) {
+    fs::File file = SD_MMC.open(path);
+    if (!file) {
+        memset(m, 0, sizeof(*m));
+        return moduleFail(m, "cannot open %s", path);
+    }
+    ModuleSource src = { moduleFileRead, &file };
+    bool ok = nativeModuleLoad(&src, m);
+    file.close();
+    return ok;
+}
+#endif
+
+// ═══════════════════════════════════════════════════════════════
+// HOST CHECK
+// ═══════════════════════════════════════════════════════════════
+
+#if !defined(ARDUINO)
+
+// What tools/module_host_app.c reports back through its one import
+struct ModuleHostLog {
+    char keys[8][16];
+    int values[8];
+    int count;
+};
+
+static ModuleHostLog moduleHostLog;
+extern "C" int host_scale;
+int host_scale = 3;
+
+extern "C" void host_report(const char * key, int value) {
+    if (moduleHostLog.count >= 8) return;
+    strncpy(moduleHostLog.keys[moduleHostLog.count], key, 15);
+    moduleHostLog.values[moduleHostLog.count++] = value;
+}
+
+static bool moduleHostLogged(int i, const char * key, int value) {
+    return i < moduleHostLog.count && strcmp(moduleHostLog.keys[i], key) == 0 &&
+           moduleHostLog.values[i] == value;
+}
+
+// Links the stand-in module against a host export table and runs its
+// entry points; also checks that a missing import and a truncated file
+// are refused. Needs a -m32 build, the module is i386 code.
+uint32_t runNativeModuleHostCheck(const uint8_t * object, uint32_t size) {
+    uint32_t failures = 0;
+    static const ModuleSymbol hostExports[] = {
+        MODULE_EXPORT(host_report), MODULE_EXPORT(host_scale),
+    };
+
+    NativeModule m;
+    ModuleMemory mem = { object, size };
+    ModuleSource src = { moduleMemoryRead, &mem };
+    memset(&moduleHostLog, 0, sizeof(moduleHostLog));
+    module_set_exports(hostExports, 2);
+
+    bool loaded = nativeModuleLoad(&src, &m);
+    TEST_CHECK(loaded, "load failed: %s", m.error);
+    if (loaded) {
+        TEST_CHECK(m.setup && m.loop && m.cleanup, "entry points missing");
+        TEST_CHECK(m.imports == 2, "%lu imports, expected 2", (unsigned long)m.imports);
+        printf("Module: %lu code + %lu data bytes, %lu relocations\n", (unsigned long)m.execSize,
+               (unsigned long)m.dataSize, (unsigned long)m.relocations);
+
+        if (m.setup && m.loop && m.cleanup) {
+            // setup: (base + 1) * 2 * host_scale, loop: tick count, cleanup: ticks + base
+            m.setup();
+            for (int i = 0; i < 3; i++) m.loop();
+            m.cleanup();
+            TEST_CHECK(moduleHostLog.count == 5, "%d reports, expected 5", moduleHostLog.count);
+            TEST_CHECK(moduleHostLogged(0, "setup", 246), "setup report wrong");
+            TEST_CHECK(moduleHostLogged(1, "loop", 1) && moduleHostLogged(2, "loop", 2) &&
+                       moduleHostLogged(3, "loop", 3), "loop reports wrong");
+            TEST_CHECK(moduleHostLogged(4, "cleanup", 43), "cleanup report wrong");
+        }
+        nativeModuleUnload(&m);
+    }
+
+    // Without host_report the module must not link
+    module_set_exports(hostExports + 1, 1);
+    TEST_CHECK(!nativeModuleLoad(&src, &m), "linked with a missing import");
+    TEST_CHECK(strstr(m.error, "host_report") != NULL, "unexpected error: %s", m.error);
+
+    // A cut-off file is refused, not read past
+    module_set_exports(hostExports, 2);
+    mem.size = size / 2;
+    TEST_CHECK(!nativeModuleLoad(&src, &m), "loaded a truncated file");
+
+    module_set_exports(NULL, 0);
+
+    printf("Native module host check: %lu failures\n", (unsigned long)failures);
+    return failures;
+}
+
+#endif
+
+#endif // NATIVE_MODULE_LOADER_H
@@ -0,0 +1,393 @@
+/*
+ * Radio Manager
+ *
+ * WiFi and Bluetooth on/off as a small state machine, so a switch
+ * toggle never waits for a radio stack.
+ * - radio_set() only records the wanted state. After RADIO_DEBOUNCE_MS
+ *   without another toggle one transition is started on the worker
+ *   (task_model.h); a burst of toggles costs at most one transition
+ * - A radio runs one transition at a time. Toggles during a transition
+ *   are applied when it completes, so the last request always wins
+ * - Progress (starting, on, stopping, off, error) comes back through the
+ *   UI queue and is handed to the status listener on the UI task. A
+ *   failed start drops the request, the listener resets its switch
+ * - The backend does the actual radio work. The hardware backend uses
+ *   WiFi / BluetoothSerial; the simulated one takes RADIO_SIM_* time
+ *   and can be told to fail, see runRadioManagerTest()
+ *
+ * radio_set() and radio_poll() are UI task only. Before LVGL is
+ * initialised there is no timer to debounce with, requests start at once.
+ *
+ * runRadioManagerTest() runs as host test "radio", on the host build of
+ * task_model.h, and as device check "radio" on the FreeRTOS queues.
+ *
+ * File: radio_manager.h
+ */
+
+#ifndef RADIO_MANAGER_H
+#define RADIO_MANAGER_H
+
+#include <lvgl.h>
+#include "task_model.h"
+#include "test_check.h"
+
+#if defined(ARDUINO)
+#include <WiFi.h>
+#include <BluetoothSerial.h>
+#endif
+
+#define RADIO_DEBOUNCE_MS      300
+#define RADIO_REPORT_RETRY_MS  5       // Worker backs off while the UI queue is full
+#define RADIO_BT_NAME          "ESP32-S3 Device"
+#define RADIO_SIM_START_MS     40
+#define RADIO_SIM_STOP_MS      20
+
+enum RadioId : uint8_t {
+    RADIO_WIFI = 0,
+    RADIO_BLUETOOTH,
+    RADIO_COUNT
+};
+
+enum RadioState : uint8_t {
+    RADIO_OFF = 0,
+    RADIO_STARTING,
+    RADIO_ON,
+    RADIO_STOPPING,
+    RADIO_ERROR,        // Last start failed, the radio is off
+};
+
+// Blocking radio work, runs on the worker
+struct RadioBackend {
+    const char * name;
+    bool (*start)(uint8_t radio);
+    void (*stop)(uint8_t radio);
+};
+
+// UI task, called on every state change
+typedef void (*RadioStatusFunc)(uint8_t radio, RadioState state);
+
+struct RadioChannel {
+    const char * name;
+    RadioState state;
+    bool desired;          // Latest request
+    bool applied;          // Target of the last transition started
+    bool busy;             // Transition running on the worker
+    bool pending;          // Request waiting out the debounce
+    uint32_t requestAt;
+    uint32_t startedAt;
+
+    uint32_t requests;
+    uint32_t coalesced;    // Requests superseded before they were started
+    uint32_t transitions;
+    uint32_t failures;
+    uint32_t lastMillis;   // Duration of the last transition
+    uint32_t maxMillis;
+};
+
+static RadioChannel radioChannels[RADIO_COUNT] = {
+    { "WiFi" },
+    { "Bluetooth" },
+};
+static const RadioBackend * radioBackend = NULL;
+static RadioStatusFunc radioListener = NULL;
+static lv_timer_t * radioTimer = NULL;
+
+static const char * const radioStateNames[] = { "off", "starting", "on", "stopping", "error" };
+
+// ═══════════════════════════════════════════════════════════════
+// BACKENDS
+// ═══════════════════════════════════════════════════════════════
+
+#if defined(ARDUINO)
+BluetoothSerial SerialBT;
+
+static bool radio_hw_start(uint8_t radio) {
+    if (radio == RADIO_WIFI) return WiFi.mode(WIFI_STA);
+    return SerialBT.begin(RADIO_BT_NAME);
+}
+
+static void radio_hw_stop(uint8_t radio) {
+    if (radio == RADIO_WIFI) {
+        WiFi.disconnect(true);
+        WiFi.mode(WIFI_OFF);
+    } else {
+        SerialBT.end();
+    }
+}
+
+static const RadioBackend radioHardware = { "hardware", radio_hw_start, radio_hw_stop };
+#endif
+
+// Simulated radios: fixed start/stop time, optional failure
+static volatile bool radioSimFail[RADIO_COUNT] = { false, false };
+static volatile bool radioSimOn[RADIO_COUNT] = { false, false };
+static std::atomic<uint32_t> radioSimStarts(0);
+static std::atomic<uint32_t> radioSimStops(0);
+
+static bool radio_sim_start(uint8_t radio) {
+    radioSimStarts++;
+    delay(RADIO_SIM_START_MS);
+    if (radioSimFail[radio]) return false;
+    radioSimOn[radio] = true;
+    return true;
+}
+
+static void radio_sim_stop(uint8_t radio) {
+    radioSimStops++;
+    delay(RADIO_SIM_STOP_MS);
+    radioSimOn[radio] = false;
+}
+
+static const RadioBackend radioSimulated = { "simulated", radio_sim_start, radio_sim_stop };
+
+// ═══════════════════════════════════════════════════════════════
+// STATE MACHINE
+// ═══════════════════════════════════════════════════════════════
+
+static void radio_notify(uint8_t radio) {
+    if (radioListener) radioListener(radio, radioChannels[radio].state);
+}
+
+// Argument of a job / report: radio, target and (reports) result
+static inline void * radio_pack(uint8_t radio, bool enable, bool ok) {
+    return (void *)(uintptr_t)((radio << 2) | (enable << 1) | ok);
+}
+
+static void radio_report(void * arg);
+
+// Worker: run the transition, then report back to the UI task
+static void radio_job(void * arg) {
+    uintptr_t v = (uintptr_t)arg;
+    uint8_t radio = v >> 2;
+    bool enable = (v >> 1) & 1;
+
+    bool ok = true;
+    if (enable) ok = radioBackend->start(radio);
+    else radioBackend->stop(radio);
+    Serial.printf("%s %s%s\n", radioChannels[radio].name, enable ? "enabled" : "disabled",
+                  ok ? "" : " FAILED");
+
+    // The report must arrive, busy is only cleared by it
+    while (!ui_post_call(radio_report, radio_pack(radio, enable, ok))) delay(RADIO_REPORT_RETRY_MS);
+}
+
+// Start a transition towards the wanted state if none is running
+static void radio_kick(uint8_t radio) {
+    RadioChannel &ch = radioChannels[radio];
+    if (ch.busy || ch.desired == ch.applied) return;
+
+    RadioState before = ch.state;
+    ch.busy = true;
+    ch.applied = ch.desired;
+    ch.state = ch.desired ? RADIO_STARTING : RADIO_STOPPING;
+    ch.startedAt = millis();
+    if (!worker_post(radio_job, radio_pack(radio, ch.desired, false))) {
+        // Worker queue full, try again after another debounce period
+        ch.busy = false;
+        ch.applied = !ch.desired;
+        ch.state = before;
+        ch.pending = true;
+        ch.requestAt = ch.startedAt;
+        return;
+    }
+    ch.transitions++;
+    radio_notify(radio);
+}
+
+// UI task: a transition finished
+static void radio_report(void * arg) {
+    uintptr_t v = (uintptr_t)arg;
+    uint8_t radio = v >> 2;
+    bool enable = (v >> 1) & 1;
+    bool ok = v & 1;
+    RadioChannel &ch = radioChannels[radio];
+
+    ch.busy = false;
+    ch.lastMillis = millis() - ch.startedAt;
+    if (ch.lastMillis > ch.maxMillis) ch.maxMillis = ch.lastMillis;
+
+    if (ok) {
+        ch.state = enable ? RADIO_ON : RADIO_OFF;
+    } else {
+        // Radio stayed off; drop the request unless a newer one is waiting
+        ch.state = RADIO_ERROR;
+        ch.failures++;
+        ch.applied = false;
+        if (!ch.pending) ch.desired = false;
+    }
+    radio_notify(radio);
+
+    // Toggled during the transition; a pending request waits for radio_poll()
+    if (!ch.pending) radio_kick(radio);
+}
+
+// Start the requests that have waited out the debounce. Returns true
+// while some are still waiting.
+bool radio_poll(uint32_t now) {
+    bool waiting = false;
+    for (uint8_t r = 0; r < RADIO_COUNT; r++) {
+        RadioChannel &ch = radioChannels[r];
+        if (!ch.pending) continue;
+        if (now - ch.requestAt < RADIO_DEBOUNCE_MS) {
+            waiting = true;
+            continue;
+        }
+        ch.pending = false;
+        radio_kick(r);
+        waiting |= ch.pending;    // Worker queue was full
+    }
+    return waiting;
+}
+
+static void radio_timer_cb(lv_timer_t * timer) {
+    if (!radio_poll(millis())) lv_timer_pause(timer);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API
+// ═══════════════════════════════════════════════════════════════
+
+void radio_set_backend(const RadioBackend * backend) {
+    radioBackend = backend;
+}
+
+void radio_set_listener(RadioStatusFunc listener) {
+    radioListener = listener;
+}
+
+// Ask for a radio on or off; returns at once
+void radio_set(uint8_t radio, bool enable, uint32_t now = millis()) {
+    if (radio >= RADIO_COUNT) return;
+    RadioChannel &ch = radioChannels[radio];
+    if (!radioBackend) {
+#if defined(ARDUINO)
+        radioBackend = &radioHardware;
+#else
+        radioBackend = &radioSimulated;
+#endif
+    }
+
+    ch.requests++;
+    if (ch.pending) ch.coalesced++;
+    ch.desired = enable;
+
+    if (!lv_is_initialized()) {
+        // Boot: nothing to debounce, and no LVGL timer to do it with
+        ch.pending = false;
+        radio_kick(radio);
+        return;
+    }
+    ch.pending = true;
+    ch.requestAt = now;
+    if (!radioTimer) radioTimer = lv_timer_create(radio_timer_cb, RADIO_DEBOUNCE_MS / 3, NULL);
+    lv_timer_resume(radioTimer);
+}
+
+RadioState radio_state(uint8_t radio) {
+    return radioChannels[radio].state;
+}
+
+// Wanted state, what a switch for the radio should show
+bool radio_wanted(uint8_t radio) {
+    return radioChannels[radio].desired;
+}
+
+void printRadioManagerStats() {
+    Serial.println("\n=== Radio Manager ===");
+    Serial.printf("Backend: %s\n", radioBackend ? radioBackend->name : "none");
+    for (uint8_t r = 0; r < RADIO_COUNT; r++) {
+        const RadioChannel &ch = radioChannels[r];
+        Serial.printf("%-10s %-8s%s | requests %lu (%lu coalesced), transitions %lu, failures %lu | last %lu ms, max %lu ms\n",
+                      ch.name, radioStateNames[ch.state], ch.pending ? " [pending]" : "",
+                      ch.requests, ch.coalesced, ch.transitions, ch.failures,
+                      ch.lastMillis, ch.maxMillis);
+    }
+    Serial.println("=====================\n");
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STATE MACHINE TEST
+// ═══════════════════════════════════════════════════════════════
+
+// Pump the UI queue until the radio is settled
+static bool radio_test_settle(uint8_t radio) {
+    uint32_t start = millis();
+    while (millis() - start < 2000) {
+        ui_queue_drain();
+        const RadioChannel &ch = radioChannels[radio];
+        if (!ch.busy && !ch.pending && (ch.applied == ch.desired || ch.state == RADIO_ERROR)) return true;
+        delay(2);
+    }
+    return false;
+}
+
+// Runs the state machine against the simulated backend on the UI task:
+// debounce, toggles during a transition and a failed start. Radio and
+// listener state are restored afterwards. Returns the number of failures.
+uint32_t runRadioManagerTest() {
+    uint32_t failures = 0;
+    RadioChannel saved[RADIO_COUNT];
+    for (uint8_t r = 0; r < RADIO_COUNT; r++) {
+        if (!radio_test_settle(r)) Serial.printf("  %s did not settle\n", radioChannels[r].name);
+        saved[r] = radioChannels[r];
+    }
+    const RadioBackend * liveBackend = radioBackend;
+    RadioStatusFunc liveListener = radioListener;
+    radioBackend = &radioSimulated;
+    radioListener = NULL;
+
+    // Start from off
+    for (uint8_t r = 0; r < RADIO_COUNT; r++) {
+        RadioChannel &ch = radioChannels[r];
+        ch.state = RADIO_OFF;
+        ch.desired = ch.applied = ch.pending = false;
+        radioSimOn[r] = false;
+    }
+    RadioChannel &wifi = radioChannels[RADIO_WIFI];
+    RadioChannel &bt = radioChannels[RADIO_BLUETOOTH];
+
+    // 1. Five toggles inside the debounce window make one start
+    uint32_t starts = radioSimStarts, stops = radioSimStops, t = millis();
+    for (int i = 0; i < 5; i++) radio_set(RADIO_WIFI, i % 2 == 0, t + i * 50);
+    radio_poll(t + 250);
+    TEST_CHECK(!wifi.busy, "started inside the debounce window");
+    radio_poll(t + 200 + RADIO_DEBOUNCE_MS);
+    TEST_CHECK(wifi.busy && wifi.state == RADIO_STARTING, "not starting after the debounce");
+    TEST_CHECK(radio_test_settle(RADIO_WIFI), "start did not finish");
+    TEST_CHECK(radioSimStarts - starts == 1 && radioSimStops == stops,
+               "%lu starts, %lu stops for a toggle burst", radioSimStarts - starts, radioSimStops - stops);
+    TEST_CHECK(wifi.state == RADIO_ON && radioSimOn[RADIO_WIFI], "WiFi %s after the burst", radioStateNames[wifi.state]);
+
+    // 2. Off, then on again while the stop is still running
+    starts = radioSimStarts;
+    stops = radioSimStops;
+    t = millis();
+    radio_set(RADIO_WIFI, false, t);
+    radio_poll(t + RADIO_DEBOUNCE_MS);
+    TEST_CHECK(wifi.state == RADIO_STOPPING, "WiFi %s, expected stopping", radioStateNames[wifi.state]);
+    radio_set(RADIO_WIFI, true, t + RADIO_DEBOUNCE_MS);
+    radio_poll(t + 2 * RADIO_DEBOUNCE_MS);    // Busy, left to the report
+    TEST_CHECK(radio_test_settle(RADIO_WIFI), "stop + start did not finish");
+    TEST_CHECK(radioSimStops - stops == 1 && radioSimStarts - starts == 1,
+               "%lu stops, %lu starts for a toggle during a stop", radioSimStops - stops, radioSimStarts - starts);
+    TEST_CHECK(wifi.state == RADIO_ON && radioSimOn[RADIO_WIFI], "WiFi %s, last request was on", radioStateNames[wifi.state]);
+
+    // 3. A failed start ends in error and drops the request
+    radioSimFail[RADIO_BLUETOOTH] = true;
+    t = millis();
+    radio_set(RADIO_BLUETOOTH, true, t);
+    radio_poll(t + RADIO_DEBOUNCE_MS);
+    TEST_CHECK(radio_test_settle(RADIO_BLUETOOTH), "failed start did not finish");
+    TEST_CHECK(bt.state == RADIO_ERROR && !bt.desired && !radioSimOn[RADIO_BLUETOOTH],
+               "Bluetooth %s after a failed start", radioStateNames[bt.state]);
+    radioSimFail[RADIO_BLUETOOTH] = false;
+
+    Serial.printf("Radio manager test: %lu failures\n", failures);
+
+    for (uint8_t r = 0; r < RADIO_COUNT; r++) radioChannels[r] = saved[r];
+    radioBackend = liveBackend;
+    radioListener = liveListener;
+    return failures;
+}
+
+#endif // RADIO_MANAGER_H
@@ -0,0 +1,423 @@
+/*
+ * Screen Manager
+ *
+ * One lifecycle for every screen, generated EEZ screens and the
+ * hand-built menus alike.
+ * - Screens are created on first show, not all at boot, and each one
+ *   gets its own root object instead of rebuilding lv_scr_act()
+ * - Created screens stay hot in an LRU; past SCREEN_CACHE_HOT of them,
+ *   or when internal heap / LVGL memory runs low, the coldest ones are
+ *   deleted and rebuilt the next time they are shown
+ * - SCREEN_KEEP screens are never evicted (home), SCREEN_TRANSIENT ones
+ *   are deleted as soon as they are left (app screens)
+ * - The screen on display, the one being animated out and the EEZ
+ *   screen the flow still ticks are never deleted
+ * - Creation time and the RAM each screen took are kept per screen,
+ *   see printScreenManagerStats()
+ *
+ * EEZ screens are registered with their generated create_screen_*
+ * function. With EEZ_FOR_LVGL the manager installs itself as eez-flow's
+ * create/delete screen hooks, so flow navigation creates lazily too.
+ *
+ * Screens that keep widget pointers in globals should clear them from an
+ * LV_EVENT_DELETE handler on the root, the root can go away at any show.
+ * Every root is attached to the widget registry (widget_registry.h), so
+ * the EEZ objects of the screen on display can be found by name.
+ *
+ * UI task only, like every other LVGL call.
+ *
+ * File: screen_manager.h
+ */
+
+#ifndef SCREEN_MANAGER_H
+#define SCREEN_MANAGER_H
+
+#include <lvgl.h>
+#include "ui.h"
+#include "screens.h"
+#include "widget_registry.h"
+
+#define SCREEN_MAX             16
+#define SCREEN_CACHE_HOT       3              // Created screens kept besides SCREEN_KEEP ones
+#define SCREEN_HEAP_LOW_WATER  (48 * 1024)    // Evict below this much free internal heap
+#define SCREEN_LVGL_LOW_WATER  (8 * 1024)     // Evict below this much free LVGL memory
+
+// Registration flags
+#define SCREEN_KEEP        0x01    // Never evicted
+#define SCREEN_TRANSIENT   0x02    // Deleted when left
+#define SCREEN_EEZ         0x04    // Generated EEZ screen (set by screenManagerRegisterEez)
+
+// Hand-built screens, numbered after the generated ScreensEnum
+enum AppScreenId {
+    SCREEN_ID_SETTINGS = 100,
+    SCREEN_ID_APP_LAUNCHER,
+    SCREEN_ID_MODULAR_LAUNCHER,
+    SCREEN_ID_MODULAR_APP,
+    SCREEN_ID_SD_APP,
+    SCREEN_ID_TOUCH_CALIBRATION,
+};
+
+// Fill a freshly created root
+typedef void (*ScreenBuildFunc)(lv_obj_t * screen);
+// Refresh a hot screen just before it is loaded
+typedef void (*ScreenShowFunc)(lv_obj_t * screen);
+// Generated EEZ create_screen_* function
+typedef void (*ScreenCreateFunc)();
+
+struct ScreenSlot {
+    int id;
+    const char * name;
+    uint8_t flags;
+    ScreenBuildFunc build;
+    ScreenCreateFunc eezCreate;
+    ScreenShowFunc onShow;
+
+    lv_obj_t * root;          // NULL while not created
+    uint32_t lastUsed;        // LRU clock value of the last show
+
+    uint32_t creations;
+    uint32_t evictions;
+    uint32_t shows;
+    uint32_t lastCreateMicros;
+    uint64_t totalCreateMicros;
+    int32_t heapBytes;        // Internal heap taken by the last creation
+    int32_t lvglBytes;        // LVGL memory taken by the last creation
+};
+
+struct ScreenManagerStats {
+    uint32_t shows;
+    uint32_t hits;            // Shows of an already created screen
+    uint32_t pressureEvictions;
+    uint32_t transientDeletes;
+};
+
+static ScreenSlot screenSlots[SCREEN_MAX];
+static int screenSlotCount = 0;
+static uint32_t screenClock = 0;
+static ScreenSlot * screenCurrent = NULL;
+static int screenEezLoaded = SCREEN_ID_MAIN;    // Last EEZ screen loaded through loadScreen()
+static ScreenManagerStats screenStats = {0, 0, 0, 0};
+
+// EEZ screen ui_tick() ticks, even while a hand-built screen is shown
+static int screenEezCurrent() {
+#if defined(EEZ_FOR_LVGL)
+    return eez_flow_get_current_screen();
+#else
+    return screenEezLoaded;
+#endif
+}
+
+static ScreenSlot * screenFind(int id) {
+    for (int i = 0; i < screenSlotCount; i++) {
+        if (screenSlots[i].id == id) return &screenSlots[i];
+    }
+    return NULL;
+}
+
+static ScreenSlot * screenFindRoot(lv_obj_t * root) {
+    if (!root) return NULL;
+    for (int i = 0; i < screenSlotCount; i++) {
+        if (screenSlots[i].root == root) return &screenSlots[i];
+    }
+    return NULL;
+}
+
+// Screens are the first objects_t fields, in ScreensEnum order
+static inline lv_obj_t ** screenEezObject(int id) {
+    return &((lv_obj_t **)&objects)[id - 1];
+}
+
+static uint32_t screenLvglFree() {
+#if LV_MEM_CUSTOM == 0
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    return mon.free_size;
+#else
+    return 0;
+#endif
+}
+
+static bool screenMemoryLow() {
+    if (ESP.getFreeHeap() < SCREEN_HEAP_LOW_WATER) return true;
+#if LV_MEM_CUSTOM == 0
+    if (screenLvglFree() < SCREEN_LVGL_LOW_WATER) return true;
+#endif
+    return false;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// CREATE / DELETE
+// ═══════════════════════════════════════════════════════════════
+
+static bool screenCreate(ScreenSlot * s) {
+    if (s->root) return true;
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t lvglBefore = screenLvglFree();
+    uint32_t start = micros();
+
+    if (s->flags & SCREEN_EEZ) {
+        s->eezCreate();
+        s->root = *screenEezObject(s->id);
+    } else {
+        s->root = lv_obj_create(NULL);
+        if (s->root) s->build(s->root);
+    }
+
+    s->lastCreateMicros = micros() - start;
+    if (!s->root) {
+        Serial.printf("Screen %s: create failed\n", s->name);
+        return false;
+    }
+    s->totalCreateMicros += s->lastCreateMicros;
+    widget_attach_screen(s->root);
+    s->heapBytes = (int32_t)(heapBefore - ESP.getFreeHeap());
+    s->lvglBytes = (int32_t)(lvglBefore - screenLvglFree());
+    s->creations++;
+    return true;
+}
+
+static void screenDelete(ScreenSlot * s) {
+    if (!s->root) return;
+    lv_obj_t * root = s->root;
+    s->root = NULL;
+
+    if (s->flags & SCREEN_EEZ) {
+        // Clear every generated pointer into this screen, root included
+        lv_obj_t ** objs = (lv_obj_t **)&objects;
+        for (size_t i = 0; i < sizeof(objects) / sizeof(lv_obj_t *); i++) {
+            if (objs[i] && lv_obj_get_screen(objs[i]) == root) objs[i] = NULL;
+        }
+    }
+    lv_obj_del(root);
+    s->evictions++;
+}
+
+// Deleting the screen would pull it from under LVGL or the EEZ flow
+static bool screenInUse(const ScreenSlot * s) {
+    lv_disp_t * disp = lv_disp_get_default();
+    if (s->root == lv_scr_act()) return true;
+    if (disp && (s->root == disp->prev_scr || s->root == disp->scr_to_load)) return true;
+    if ((s->flags & SCREEN_EEZ) && s->id == screenEezCurrent()) return true;
+    return false;
+}
+
+static ScreenSlot * screenColdest() {
+    ScreenSlot * coldest = NULL;
+    for (int i = 0; i < screenSlotCount; i++) {
+        ScreenSlot * s = &screenSlots[i];
+        if (!s->root || (s->flags & SCREEN_KEEP) || screenInUse(s)) continue;
+        if (!coldest || s->lastUsed < coldest->lastUsed) coldest = s;
+    }
+    return coldest;
+}
+
+// Evict the coldest screens while over the hot limit or low on memory
+void screenManagerTrim() {
+    for (;;) {
+        int hot = 0;
+        for (int i = 0; i < screenSlotCount; i++) {
+            if (screenSlots[i].root && !(screenSlots[i].flags & SCREEN_KEEP)) hot++;
+        }
+        bool pressure = screenMemoryLow();
+        if (hot <= SCREEN_CACHE_HOT && !pressure) return;
+
+        ScreenSlot * s = screenColdest();
+        if (!s) return;
+        if (pressure) screenStats.pressureEvictions++;
+        Serial.printf("Screen %s evicted (%s)\n", s->name, pressure ? "low memory" : "cold");
+        screenDelete(s);
+    }
+}
+
+// Transient screens go once LVGL has finished loading the next one
+static void screenDeleteTransient(void * arg) {
+    ScreenSlot * s = (ScreenSlot *)arg;
+    if (!s->root || screenInUse(s)) return;
+    screenStats.transientDeletes++;
+    screenDelete(s);
+}
+
+static void screen_unloaded_event(lv_event_t * e) {
+    ScreenSlot * s = screenFindRoot(lv_event_get_target(e));
+    if (s && (s->flags & SCREEN_TRANSIENT)) lv_async_call(screenDeleteTransient, s);
+}
+
+#if defined(EEZ_FOR_LVGL)
+// eez-flow hooks, screenIndex is the ScreensEnum value minus one
+static void screenEezCreateHook(int screenIndex) {
+    ScreenSlot * s = screenFind(screenIndex + 1);
+    if (s) screenCreate(s);
+}
+
+static void screenEezDeleteHook(int screenIndex) {
+    ScreenSlot * s = screenFind(screenIndex + 1);
+    if (s && !screenInUse(s)) screenDelete(s);
+}
+#endif
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API
+// ═══════════════════════════════════════════════════════════════
+
+static ScreenSlot * screenRegisterSlot(int id, const char * name, uint8_t flags, ScreenShowFunc onShow) {
+    ScreenSlot * s = screenFind(id);
+    if (!s) {
+        if (screenSlotCount >= SCREEN_MAX) {
+            Serial.printf("Screen %s: registry full\n", name);
+            return NULL;
+        }
+        s = &screenSlots[screenSlotCount++];
+        memset(s, 0, sizeof(*s));
+        s->id = id;
+    }
+    s->name = name;
+    s->flags = flags;
+    s->onShow = onShow;
+    return s;
+}
+
+// Register a hand-built screen, build runs on its first show
+bool screenManagerRegister(int id, const char * name, ScreenBuildFunc build,
+                           ScreenShowFunc onShow = NULL, uint8_t flags = 0) {
+    ScreenSlot * s = screenRegisterSlot(id, name, flags & ~SCREEN_EEZ, onShow);
+    if (!s) return false;
+    s->build = build;
+    return true;
+}
+
+// Register a generated EEZ screen; one ui_init() already made is adopted
+bool screenManagerRegisterEez(int id, const char * name, ScreenCreateFunc create, uint8_t flags = 0) {
+    ScreenSlot * s = screenRegisterSlot(id, name, flags | SCREEN_EEZ, NULL);
+    if (!s) return false;
+    s->eezCreate = create;
+    s->root = *screenEezObject(id);
+    widget_attach_screen(s->root);
+    return true;
+}
+
+// Call after ui_init(). Drops the EEZ screens the generated code made
+// up front except the one on display; they come back on first show.
+void initScreenManager() {
+#if defined(EEZ_FOR_LVGL)
+    eez_flow_set_create_screen_func(screenEezCreateHook);
+    eez_flow_set_delete_screen_func(screenEezDeleteHook);
+#endif
+    for (int i = 0; i < screenSlotCount; i++) {
+        ScreenSlot * s = &screenSlots[i];
+        if (s->root == lv_scr_act()) screenCurrent = s;
+        if (s->root && !(s->flags & SCREEN_KEEP) && !screenInUse(s)) screenDelete(s);
+    }
+    Serial.printf("Screen manager: %d screens registered\n", screenSlotCount);
+}
+
+// Create the screen if needed and load it
+bool screenManagerShow(int id) {
+    ScreenSlot * s = screenFind(id);
+    if (!s) {
+        Serial.printf("Screen %d not registered\n", id);
+        return false;
+    }
+
+    screenStats.shows++;
+    if (s->root) screenStats.hits++;
+    else if (screenMemoryLow()) screenManagerTrim();    // Make room first
+    if (!screenCreate(s)) return false;
+
+    s->lastUsed = ++screenClock;
+    s->shows++;
+    if (s->onShow) s->onShow(s->root);
+
+    if (s->flags & SCREEN_TRANSIENT) {
+        lv_obj_remove_event_cb(s->root, screen_unloaded_event);
+        lv_obj_add_event_cb(s->root, screen_unloaded_event, LV_EVENT_SCREEN_UNLOADED, NULL);
+    }
+
+    if (s->flags & SCREEN_EEZ) {
+#if defined(EEZ_FOR_LVGL)
+        eez_flow_set_screen(id, LV_SCR_LOAD_ANIM_NONE, 0, 0);
+#else
+        screenEezLoaded = id;
+        loadScreen((enum ScreensEnum)id);
+#endif
+    } else {
+        lv_scr_load(s->root);
+    }
+    screenCurrent = s;
+
+    screenManagerTrim();
+    return true;
+}
+
+// Home screen, what the HOME / BACK buttons of the menus go to
+void screenManagerShowHome() {
+    screenManagerShow(SCREEN_ID_MAIN);
+}
+
+// Drop a created screen so its next show rebuilds it (e.g. stale data)
+void screenManagerInvalidate(int id) {
+    ScreenSlot * s = screenFind(id);
+    if (!s || !s->root) return;
+    if (screenInUse(s)) {
+        // On display: swap in a fresh root, cleaning the old one would keep
+        // the callbacks build() put on it and stack a second set. The old
+        // root is deleted before the build so its LV_EVENT_DELETE handlers
+        // clear the globals of the old widgets, not of the new ones.
+        if (s->flags & SCREEN_EEZ) return;
+        lv_obj_t * root = lv_obj_create(NULL);
+        if (!root) return;
+        lv_obj_t * old = s->root;
+        s->root = root;
+        lv_scr_load(root);
+        lv_obj_del(old);
+        s->evictions++;
+
+        uint32_t start = micros();
+        s->build(root);
+        s->lastCreateMicros = micros() - start;
+        s->totalCreateMicros += s->lastCreateMicros;
+        s->creations++;
+        widget_attach_screen(root);
+        if (s->flags & SCREEN_TRANSIENT) {
+            lv_obj_add_event_cb(root, screen_unloaded_event, LV_EVENT_SCREEN_UNLOADED, NULL);
+        }
+        return;
+    }
+    screenDelete(s);
+}
+
+bool screenManagerIsCreated(int id) {
+    ScreenSlot * s = screenFind(id);
+    return s && s->root;
+}
+
+// Root of a created screen, NULL otherwise
+lv_obj_t * screenManagerRoot(int id) {
+    ScreenSlot * s = screenFind(id);
+    return s ? s->root : NULL;
+}
+
+int screenManagerCurrent() {
+    return screenCurrent ? screenCurrent->id : 0;
+}
+
+void printScreenManagerStats() {
+    Serial.println("\n=== Screen Manager ===");
+    Serial.printf("Shows: %lu (%lu hot), evictions under pressure: %lu, transient deletes: %lu\n",
+                  screenStats.shows, screenStats.hits, screenStats.pressureEvictions,
+                  screenStats.transientDeletes);
+    Serial.printf("Free heap: %lu KB, LVGL free: %lu KB\n",
+                  ESP.getFreeHeap() / 1024, screenLvglFree() / 1024);
+    for (int i = 0; i < screenSlotCount; i++) {
+        const ScreenSlot &s = screenSlots[i];
+        Serial.printf("%-18s %s%s created %lu, evicted %lu, shown %lu | last %lu us, avg %lu us | heap %ld B, lvgl %ld B\n",
+                      s.name, s.root ? "[hot]" : "[   ]",
+                      s.flags & SCREEN_KEEP ? "[keep]" : (s.flags & SCREEN_TRANSIENT ? "[tran]" : "      "),
+                      s.creations, s.evictions, s.shows,
+                      s.lastCreateMicros, s.creations ? (uint32_t)(s.totalCreateMicros / s.creations) : 0,
+                      s.heapBytes, s.lvglBytes);
+    }
+    Serial.println("======================\n");
+}
+
+#endif // SCREEN_MANAGER_H
@@ -0,0 +1,287 @@
+/*
+ * Settings Log
+ *
+ * The on-card format of the settings store (settings_store.h) and the
+ * code that reads it, with no card or LVGL access:
+ * - SettingsTable, the small RAM table of typed values keyed by kvKey()
+ * - settingsEncode() turns one value into a checksummed record
+ * - settingsReplay() applies a log image and returns the length of the
+ *   valid prefix, stopping at the first torn or corrupt record
+ *
+ * settings_store.h does the file I/O around these. Keeping them apart
+ * lets runSettingsReplayTest() cut a log at every byte on the host
+ * (host test "settings"); the card half of the power loss test runs on
+ * the device (device check "settings").
+ *
+ * Log layout:
+ *   SettingsLogHeader
+ *   SettingsRecordHeader + value + uint32 checksum, repeated
+ *
+ * File: settings_log.h
+ */
+
+#ifndef SETTINGS_LOG_H
+#define SETTINGS_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "kv_parser.h"
+#include "test_check.h"
+
+#define SETTINGS_LOG_MAGIC         0x4C544553  // "SETL"
+#define SETTINGS_SCHEMA_VERSION    1
+#define SETTINGS_MAX               32
+#define SETTINGS_VALUE_MAX         32          // Longest string value, including the NUL
+
+enum SettingType : uint8_t {
+    SETTING_INT = 1,
+    SETTING_STRING = 2,
+};
+
+struct SettingsLogHeader {
+    uint32_t magic;
+    uint16_t schema;        // SETTINGS_SCHEMA_VERSION of the writer
+    uint16_t headerSize;    // sizeof(SettingsLogHeader), guards layout changes
+    uint32_t checksum;      // FNV-1a over the fields above
+};
+
+struct SettingsRecordHeader {
+    uint32_t key;
+    uint8_t type;
+    uint8_t len;            // Value bytes that follow
+    uint16_t reserved;      // Zero, keeps the record free of padding bytes
+};
+
+#define SETTINGS_RECORD_MAX (sizeof(SettingsRecordHeader) + SETTINGS_VALUE_MAX + sizeof(uint32_t))
+
+struct SettingValue {
+    uint32_t key;
+    uint8_t type;
+    uint8_t len;
+    bool dirty;             // Changed since the last batch
+    uint8_t data[SETTINGS_VALUE_MAX];
+};
+
+struct SettingsTable {
+    SettingValue values[SETTINGS_MAX];
+    uint32_t count;
+};
+
+static uint32_t settingsChecksum(const uint8_t * p, size_t len, uint32_t h = 2166136261u) {
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void settingsHeaderInit(SettingsLogHeader * header) {
+    header->magic = SETTINGS_LOG_MAGIC;
+    header->schema = SETTINGS_SCHEMA_VERSION;
+    header->headerSize = sizeof(SettingsLogHeader);
+    header->checksum = settingsChecksum((const uint8_t *)header, offsetof(SettingsLogHeader, checksum));
+}
+
+static bool settingsHeaderValid(const SettingsLogHeader * header) {
+    return header->magic == SETTINGS_LOG_MAGIC &&
+           header->headerSize == sizeof(SettingsLogHeader) &&
+           header->checksum == settingsChecksum((const uint8_t *)header, offsetof(SettingsLogHeader, checksum));
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TABLE
+// ═══════════════════════════════════════════════════════════════
+
+static SettingValue * settingsFind(SettingsTable * table, uint32_t key) {
+    for (uint32_t i = 0; i < table->count; i++) {
+        if (table->values[i].key == key) return &table->values[i];
+    }
+    return NULL;
+}
+
+// Store a value, returns false when it did not change (or no room)
+static bool settingsPut(SettingsTable * table, uint32_t key, uint8_t type, const void * data, uint8_t len) {
+    if (len > SETTINGS_VALUE_MAX) return false;
+    SettingValue * v = settingsFind(table, key);
+    if (v) {
+        if (v->type == type && v->len == len && memcmp(v->data, data, len) == 0) return false;
+    } else {
+        if (table->count >= SETTINGS_MAX) {
+            Serial.printf("Settings table full, key %08lx dropped\n", key);
+            return false;
+        }
+        v = &table->values[table->count++];
+        v->key = key;
+    }
+    v->type = type;
+    v->len = len;
+    memcpy(v->data, data, len);
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// RECORDS
+// ═══════════════════════════════════════════════════════════════
+
+// Serialize one record into out, returns its size
+static size_t settingsEncode(const SettingValue * v, uint8_t * out) {
+    SettingsRecordHeader rec = { v->key, v->type, v->len, 0 };
+    memcpy(out, &rec, sizeof(rec));
+    memcpy(out + sizeof(rec), v->data, v->len);
+    size_t n = sizeof(rec) + v->len;
+    uint32_t check = settingsChecksum(out, n);
+    memcpy(out + n, &check, sizeof(check));
+    return n + sizeof(check);
+}
+
+// Apply the records in a log image. Returns the length of the valid
+// prefix: replay stops at the first record that is cut short or whose
+// checksum does not match, which is where a power cut tore the log.
+static size_t settingsReplay(SettingsTable * table, const uint8_t * log, size_t len) {
+    if (len < sizeof(SettingsLogHeader)) return 0;
+    SettingsLogHeader header;
+    memcpy(&header, log, sizeof(header));
+    if (!settingsHeaderValid(&header)) return 0;
+
+    size_t pos = sizeof(SettingsLogHeader);
+    while (pos + sizeof(SettingsRecordHeader) + sizeof(uint32_t) <= len) {
+        SettingsRecordHeader rec;
+        memcpy(&rec, log + pos, sizeof(rec));
+        size_t n = sizeof(rec) + rec.len;
+        if (rec.len > SETTINGS_VALUE_MAX || pos + n + sizeof(uint32_t) > len) break;
+
+        uint32_t check;
+        memcpy(&check, log + pos + n, sizeof(check));
+        if (check != settingsChecksum(log + pos, n)) break;
+
+        settingsPut(table, rec.key, rec.type, log + pos + sizeof(rec), rec.len);
+        pos += n + sizeof(check);
+    }
+    return pos;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TEST
+// ═══════════════════════════════════════════════════════════════
+
+// A log image of random updates to four keys and the record boundaries
+// in it: ends[i] is the length after i records, ends[updates] the total
+struct SettingsTestLog {
+    uint8_t * data;
+    size_t * ends;
+    size_t len;
+    int updates;
+};
+
+static bool settingsTestLogBuild(SettingsTestLog * t, int updates) {
+    const uint32_t keys[] = { kvKey("t_wifi"), kvKey("t_bt"), kvKey("t_brightness"), kvKey("t_name") };
+    t->data = (uint8_t *)malloc(sizeof(SettingsLogHeader) + updates * SETTINGS_RECORD_MAX);
+    t->ends = (size_t *)malloc((updates + 1) * sizeof(size_t));
+    t->updates = updates;
+    if (!t->data || !t->ends) return false;
+
+    SettingsLogHeader header;
+    settingsHeaderInit(&header);
+    memcpy(t->data, &header, sizeof(header));
+    t->len = sizeof(header);
+    t->ends[0] = t->len;
+
+    uint32_t seed = 12345;
+    for (int i = 0; i < updates; i++) {
+        seed = seed * 1103515245u + 12345u;
+        SettingValue v;
+        v.key = keys[(seed >> 8) % 4];
+        if (v.key == kvKey("t_name")) {
+            v.type = SETTING_STRING;
+            v.len = snprintf((char *)v.data, SETTINGS_VALUE_MAX, "name-%lu", (unsigned long)(seed % 100000)) + 1;
+        } else {
+            int32_t n = (int32_t)(seed >> 16);
+            v.type = SETTING_INT;
+            v.len = sizeof(n);
+            memcpy(v.data, &n, sizeof(n));
+        }
+        t->len += settingsEncode(&v, t->data + t->len);
+        t->ends[i + 1] = t->len;
+    }
+    return true;
+}
+
+static void settingsTestLogFree(SettingsTestLog * t) {
+    free(t->data);
+    free(t->ends);
+}
+
+// Cut a log at every byte and check replay keeps exactly the records
+// written before the cut, with the rest of the image missing, erased
+// (0xFF) or holding stale data. Returns the number of failures.
+uint32_t runSettingsReplayTest(int updates = 64) {
+    uint32_t failures = 0;
+    uint32_t cuts = 0;
+
+    SettingsTestLog t;
+    bool built = settingsTestLogBuild(&t, updates);
+    uint8_t * torn = (uint8_t *)malloc(sizeof(SettingsLogHeader) + updates * SETTINGS_RECORD_MAX);
+    SettingsTable * expected = (SettingsTable *)malloc(sizeof(SettingsTable));
+    SettingsTable * replayed = (SettingsTable *)malloc(sizeof(SettingsTable));
+    if (!built || !torn || !expected || !replayed) {
+        Serial.println("Settings replay test: out of memory");
+        settingsTestLogFree(&t); free(torn); free(expected); free(replayed);
+        return 1;
+    }
+    const uint8_t * log = t.data;
+    size_t len = t.len;
+
+    uint32_t start = millis();
+    uint32_t mismatches = 0;
+    for (size_t cut = 0; cut <= len; cut++) {
+        // Cut alone, then the cut followed by erased and by stale bytes
+        for (int fill = 0; fill < 3; fill++) {
+            memcpy(torn, log, cut);
+            size_t tornLen = cut;
+            if (fill == 1) { memset(torn + cut, 0xFF, len - cut); tornLen = len; }
+            if (fill == 2) {
+                for (size_t i = cut; i < len; i++) torn[i] = (uint8_t)(log[i] ^ (i * 31 + 7));
+                tornLen = len;
+            }
+
+            // Records up to the first damaged byte must survive, no more
+            size_t intact = cut;
+            while (intact < tornLen && torn[intact] == log[intact]) intact++;
+            int whole = 0;
+            while (whole < updates && t.ends[whole + 1] <= intact) whole++;
+            expected->count = 0;
+            size_t expectLen = intact < sizeof(SettingsLogHeader) ? 0 : settingsReplay(expected, log, t.ends[whole]);
+
+            replayed->count = 0;
+            size_t got = settingsReplay(replayed, torn, tornLen);
+            cuts++;
+
+            bool same = got == expectLen && replayed->count == expected->count;
+            for (uint32_t k = 0; same && k < expected->count; k++) {
+                const SettingValue &a = expected->values[k];
+                SettingValue * b = settingsFind(replayed, a.key);
+                same = b && b->type == a.type && b->len == a.len && memcmp(b->data, a.data, a.len) == 0;
+            }
+            if (!same && mismatches++ < 8) {
+                TEST_CHECK(false, "cut at %u (fill %d): replayed %u bytes, expected %u",
+                           (unsigned)cut, fill, (unsigned)got, (unsigned)expectLen);
+            }
+        }
+    }
+    TEST_CHECK(mismatches <= 8, "%lu more torn images replayed wrong", mismatches - 8);
+
+    // The whole log holds the last value written to each key
+    replayed->count = 0;
+    TEST_CHECK(settingsReplay(replayed, log, len) == len && replayed->count == 4,
+               "whole log replayed to %lu values, expected 4", replayed->count);
+
+    Serial.printf("Settings replay: %lu torn images, %lu failures (%lu ms)\n",
+                  cuts, failures, millis() - start);
+
+    settingsTestLogFree(&t); free(torn); free(expected); free(replayed);
+    return failures;
+}
+
+#endif // SETTINGS_LOG_H
@@ -15,9 +15,14 @@
 #define SETTINGS_MENU_H
 
 #include <lvgl.h>
-#include <WiFi.h>
-#include <BluetoothSerial.h>
 #include "SD_MMC.h"
+#include "task_model.h"
+#include "kv_parser.h"
+#include "settings_store.h"
+#include "screen_manager.h"
+#include "backlight.h"
+#include "radio_manager.h"
+#include "storage_stats.h"
 
 // External reference to TFT for brightness control
 extern TFT_eSPI my_lcd;
@@ -27,9 +32,6 @@ bool wifiEnabled = false;
 bool bluetoothEnabled = false;
 uint8_t screenBrightness = 128; // 0-255
 
-// Bluetooth object
-BluetoothSerial SerialBT;
-
 // UI objects
 lv_obj_t * wifi_switch = NULL;
 lv_obj_t * bt_switch = NULL;
@@ -43,52 +45,49 @@ lv_obj_t * storage_label = NULL;
 // SYSTEM CONTROL FUNCTIONS
 // ═══════════════════════════════════════════════════════════════
 
+static const char * radioStatusText(uint8_t radio, RadioState state) {
+    static const char * const wifiText[] = { "WiFi: Off", "WiFi: Initializing...", "WiFi: On", "WiFi: Stopping...", "WiFi: Error" };
+    static const char * const btText[] = { "BT: Off", "BT: Starting...", "BT: " RADIO_BT_NAME, "BT: Stopping...", "BT: Error" };
+    return radio == RADIO_WIFI ? wifiText[state] : btText[state];
+}
+
+// Radio progress, delivered on the UI task (radio_manager.h)
+static void settings_radio_status(uint8_t radio, RadioState state) {
+    lv_obj_t * label = radio == RADIO_WIFI ? wifi_status_label : bt_status_label;
+    if (label) lv_label_set_text(label, radioStatusText(radio, state));
+    if (state != RADIO_ERROR) return;
+
+    // The start failed and the request was dropped, flip the switch back
+    lv_obj_t * sw = radio == RADIO_WIFI ? wifi_switch : bt_switch;
+    if (radio == RADIO_WIFI) wifiEnabled = false;
+    else bluetoothEnabled = false;
+    if (sw) lv_obj_clear_state(sw, LV_STATE_CHECKED);
+}
+
+// Both return at once, the radio manager debounces and runs the
+// transition on the worker core
 void setWiFi(bool enable) {
     wifiEnabled = enable;
-    
-    if (enable) {
-        WiFi.mode(WIFI_STA);
-        Serial.println("WiFi enabled");
-        lv_label_set_text(wifi_status_label, "WiFi: Initializing...");
-    } else {
-        WiFi.disconnect(true);
-        WiFi.mode(WIFI_OFF);
-        Serial.println("WiFi disabled");
-        lv_label_set_text(wifi_status_label, "WiFi: Off");
-    }
+    settingsSetInt(kvKey("wifi"), enable);
+    radio_set(RADIO_WIFI, enable);
 }
 
 void setBluetooth(bool enable) {
     bluetoothEnabled = enable;
-    
-    if (enable) {
-        if (!SerialBT.begin("ESP32-S3 Device")) {
-            Serial.println("Bluetooth init failed");
-            lv_label_set_text(bt_status_label, "BT: Error");
-            bluetoothEnabled = false;
-        } else {
-            Serial.println("Bluetooth enabled");
-            lv_label_set_text(bt_status_label, "BT: ESP32-S3 Device");
-        }
-    } else {
-        SerialBT.end();
-        Serial.println("Bluetooth disabled");
-        lv_label_set_text(bt_status_label, "BT: Off");
-    }
+    settingsSetInt(kvKey("bluetooth"), enable);
+    radio_set(RADIO_BLUETOOTH, enable);
 }
 
 void setScreenBrightness(uint8_t brightness) {
     screenBrightness = brightness;
-    
-    // TFT_eSPI doesn't have direct brightness control
-    // You can implement PWM on backlight pin if available
-    // For now, we'll store the value for other uses
+    settingsSetInt(kvKey("brightness"), brightness);   // Slider drags coalesce into one write
+    backlight_set_level(brightness);
     
     Serial.printf("Brightness set to: %d%%\n", (brightness * 100) / 255);
     
     static char text[32];
     snprintf(text, sizeof(text), "Brightness: %d%%", (brightness * 100) / 255);
-    lv_label_set_text(brightness_label, text);
+    if (brightness_label) lv_label_set_text(brightness_label, text);
 }
 
 // ═══════════════════════════════════════════════════════════════
@@ -105,21 +104,21 @@ void updateStorageInfo() {
     uint32_t freeHeap = ESP.getFreeHeap() / 1024;
     uint32_t totalHeap = ESP.getHeapSize() / 1024;
     
-    // SD Card info
-    uint64_t sdTotal = 0;
-    uint64_t sdUsed = 0;
-    
-    if (SD_MMC.cardType() != CARD_NONE) {
-        sdTotal = SD_MMC.totalBytes() / 1024 / 1024;
-        sdUsed = SD_MMC.usedBytes() / 1024 / 1024;
+    // SD Card info, measured in the background (storage_stats.h)
+    StorageSnapshot sd = storage_snapshot();
+    int len = snprintf(storage_text, sizeof(storage_text),
+                       "Flash: %lu MB\n"
+                       "Free RAM: %lu KB / %lu KB\n",
+                       flashSize, freeHeap, totalHeap);
+    if (!sd.mounted) {
+        snprintf(storage_text + len, sizeof(storage_text) - len, "SD Card: none");
+    } else if (!sd.valid) {
+        snprintf(storage_text + len, sizeof(storage_text) - len, "SD Card: measuring...");
+    } else {
+        snprintf(storage_text + len, sizeof(storage_text) - len, "SD Card: %llu MB / %llu MB used",
+                 sd.usedBytes / 1024 / 1024, sd.totalBytes / 1024 / 1024);
     }
     
-    snprintf(storage_text, sizeof(storage_text),
-             "Flash: %lu MB\n"
-             "Free RAM: %lu KB / %lu KB\n"
-             "SD Card: %llu MB / %llu MB used",
-             flashSize, freeHeap, totalHeap, sdUsed, sdTotal);
-    
     lv_label_set_text(storage_label, storage_text);
 }
 
@@ -150,11 +149,35 @@ static void brightness_slider_event(lv_event_t * e) {
     setScreenBrightness((uint8_t)value);
 }
 
-// Create settings menu
-void createSettingsMenu() {
-    lv_obj_clean(lv_scr_act());
-    lv_obj_t * screen = lv_scr_act();
+static lv_style_t settings_title_style;
+static lv_style_t settings_small_style;
+
+static void initSettingsStyles() {
+    static bool ready = false;
+    if (ready) return;
+    lv_style_init(&settings_title_style);
+    lv_style_set_text_font(&settings_title_style, &lv_font_montserrat_18);
+    lv_style_init(&settings_small_style);
+    lv_style_set_text_font(&settings_small_style, &lv_font_montserrat_10);
+    ready = true;
+}
+
+// The screen manager may delete the screen while it is not shown
+static void settings_screen_delete_event(lv_event_t * e) {
+    wifi_switch = NULL;
+    bt_switch = NULL;
+    brightness_slider = NULL;
+    brightness_label = NULL;
+    wifi_status_label = NULL;
+    bt_status_label = NULL;
+    storage_label = NULL;
+}
+
+// Build the settings menu into its screen (once per creation)
+static void buildSettingsMenu(lv_obj_t * screen) {
+    initSettingsStyles();
     lv_obj_set_style_bg_color(screen, lv_color_hex(0xF0F0F0), 0);
+    lv_obj_add_event_cb(screen, settings_screen_delete_event, LV_EVENT_DELETE, NULL);
     
     // Title bar
     lv_obj_t * title_bar = lv_obj_create(screen);
@@ -168,11 +191,7 @@ void createSettingsMenu() {
     lv_label_set_text(title, "⚙ Settings");
     lv_obj_align(title, LV_ALIGN_LEFT_MID, 15, 0);
     lv_obj_set_style_text_color(title, lv_color_hex(0xFFFFFF), 0);
-    
-    static lv_style_t title_style;
-    lv_style_init(&title_style);
-    lv_style_set_text_font(&title_style, &lv_font_montserrat_18);
-    lv_obj_add_style(title, &title_style, 0);
+    lv_obj_add_style(title, &settings_title_style, 0);
     
     // Back button
     lv_obj_t * back_btn = lv_btn_create(title_bar);
@@ -187,9 +206,7 @@ void createSettingsMenu() {
     
     lv_obj_add_event_cb(back_btn, [](lv_event_t * e) {
         if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
-            // Return to home - adjust based on your EEZ setup
-            extern void loadScreen(int screenId);
-            loadScreen(1);
+            screenManagerShowHome();
         }
     }, LV_EVENT_CLICKED, NULL);
     
@@ -210,17 +227,12 @@ void createSettingsMenu() {
     wifi_switch = lv_switch_create(content);
     lv_obj_set_pos(wifi_switch, 240, y_pos - 5);
     lv_obj_add_event_cb(wifi_switch, wifi_switch_event, LV_EVENT_VALUE_CHANGED, NULL);
-    if (wifiEnabled) lv_obj_add_state(wifi_switch, LV_STATE_CHECKED);
     
     wifi_status_label = lv_label_create(content);
-    lv_label_set_text(wifi_status_label, wifiEnabled ? "WiFi: On" : "WiFi: Off");
+    lv_label_set_text(wifi_status_label, radioStatusText(RADIO_WIFI, radio_state(RADIO_WIFI)));
     lv_obj_set_pos(wifi_status_label, 10, y_pos + 25);
     lv_obj_set_style_text_color(wifi_status_label, lv_color_hex(0x666666), 0);
-    
-    static lv_style_t small_style;
-    lv_style_init(&small_style);
-    lv_style_set_text_font(&small_style, &lv_font_montserrat_10);
-    lv_obj_add_style(wifi_status_label, &small_style, 0);
+    lv_obj_add_style(wifi_status_label, &settings_small_style, 0);
     
     y_pos += 50;
     
@@ -232,29 +244,23 @@ void createSettingsMenu() {
     bt_switch = lv_switch_create(content);
     lv_obj_set_pos(bt_switch, 240, y_pos - 5);
     lv_obj_add_event_cb(bt_switch, bt_switch_event, LV_EVENT_VALUE_CHANGED, NULL);
-    if (bluetoothEnabled) lv_obj_add_state(bt_switch, LV_STATE_CHECKED);
     
     bt_status_label = lv_label_create(content);
-    lv_label_set_text(bt_status_label, bluetoothEnabled ? "BT: On" : "BT: Off");
+    lv_label_set_text(bt_status_label, radioStatusText(RADIO_BLUETOOTH, radio_state(RADIO_BLUETOOTH)));
     lv_obj_set_pos(bt_status_label, 10, y_pos + 25);
     lv_obj_set_style_text_color(bt_status_label, lv_color_hex(0x666666), 0);
-    lv_obj_add_style(bt_status_label, &small_style, 0);
+    lv_obj_add_style(bt_status_label, &settings_small_style, 0);
     
     y_pos += 50;
     
     // ═══ Brightness Section ═══
     brightness_label = lv_label_create(content);
-    char bright_text[32];
-    snprintf(bright_text, sizeof(bright_text), "Brightness: %d%%", 
-             (screenBrightness * 100) / 255);
-    lv_label_set_text(brightness_label, bright_text);
     lv_obj_set_pos(brightness_label, 10, y_pos);
     
     brightness_slider = lv_slider_create(content);
     lv_obj_set_size(brightness_slider, 260, 10);
     lv_obj_set_pos(brightness_slider, 10, y_pos + 25);
     lv_slider_set_range(brightness_slider, 20, 255);
-    lv_slider_set_value(brightness_slider, screenBrightness, LV_ANIM_OFF);
     lv_obj_add_event_cb(brightness_slider, brightness_slider_event, 
                        LV_EVENT_VALUE_CHANGED, NULL);
     
@@ -264,39 +270,46 @@ void createSettingsMenu() {
     storage_label = lv_label_create(screen);
     lv_obj_set_pos(storage_label, 15, 230);
     lv_obj_set_style_text_color(storage_label, lv_color_hex(0x666666), 0);
-    lv_obj_add_style(storage_label, &small_style, 0);
-    
-    updateStorageInfo();
+    lv_obj_add_style(storage_label, &settings_small_style, 0);
     
     Serial.println("Settings menu created");
 }
 
+// Bring a hot settings screen up to date before it is shown
+static void showSettingsMenu(lv_obj_t * screen) {
+    if (wifiEnabled) lv_obj_add_state(wifi_switch, LV_STATE_CHECKED);
+    else lv_obj_clear_state(wifi_switch, LV_STATE_CHECKED);
+    if (bluetoothEnabled) lv_obj_add_state(bt_switch, LV_STATE_CHECKED);
+    else lv_obj_clear_state(bt_switch, LV_STATE_CHECKED);
+    
+    char bright_text[32];
+    snprintf(bright_text, sizeof(bright_text), "Brightness: %d%%", 
+             (screenBrightness * 100) / 255);
+    lv_label_set_text(brightness_label, bright_text);
+    lv_slider_set_value(brightness_slider, screenBrightness, LV_ANIM_OFF);
+    
+    updateStorageInfo();
+}
+
+// Call once in setup, the screen is built on first open
+void registerSettingsScreen() {
+    screenManagerRegister(SCREEN_ID_SETTINGS, "settings", buildSettingsMenu, showSettingsMenu);
+    radio_set_listener(settings_radio_status);
+    storage_set_listener(updateStorageInfo);    // Scan finished while the menu is open
+}
+
 // Call this from your EEZ Studio action
 void action_open_settings() {
-    createSettingsMenu();
+    screenManagerShow(SCREEN_ID_SETTINGS);
 }
 
-// Initialize settings (call in setup)
+// Initialize settings (call in setup, after the SD card is mounted)
 void initSettings() {
-    // Load saved settings from SD card if available
-    if (SD_MMC.exists("/data/settings.txt")) {
-        fs::File file = SD_MMC.open("/data/settings.txt");
-        if (file) {
-            while (file.available()) {
-                String line = file.readStringUntil('\n');
-                line.trim();
-                
-                if (line.startsWith("wifi=")) {
-                    wifiEnabled = (line.substring(5) == "1");
-                } else if (line.startsWith("bluetooth=")) {
-                    bluetoothEnabled = (line.substring(10) == "1");
-                } else if (line.startsWith("brightness=")) {
-                    screenBrightness = line.substring(11).toInt();
-                }
-            }
-            file.close();
-        }
-    }
+    // Load saved settings, imports /data/settings.txt of older firmware
+    initSettingsStore();
+    wifiEnabled = settingsGetInt(kvKey("wifi"), wifiEnabled) != 0;
+    bluetoothEnabled = settingsGetInt(kvKey("bluetooth"), bluetoothEnabled) != 0;
+    screenBrightness = (uint8_t)settingsGetInt(kvKey("brightness"), screenBrightness);
     
     // Apply settings
     if (wifiEnabled) setWiFi(true);
@@ -306,16 +319,10 @@ void initSettings() {
     Serial.println("Settings initialized");
 }
 
-// Save settings to SD card
+// Write pending changes now; they are saved on their own shortly after
+// each change (settings_store.h)
 void saveSettings() {
-    fs::File file = SD_MMC.open("/data/settings.txt", FILE_WRITE);
-    if (file) {
-        file.printf("wifi=%d\n", wifiEnabled ? 1 : 0);
-        file.printf("bluetooth=%d\n", bluetoothEnabled ? 1 : 0);
-        file.printf("brightness=%d\n", screenBrightness);
-        file.close();
-        Serial.println("Settings saved");
-    }
+    settingsFlush();
 }
 
 // Auto-save timer callback
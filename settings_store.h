@@ -0,0 +1,491 @@
+/*
+ * Settings Store
+ *
+ * Compact binary settings with batched, crash-safe writes.
+ * - Values are keyed by kvKey(name) and typed (int or short string),
+ *   kept in a small RAM table; reads never touch the card
+ * - Changes are appended to /data/settings.log as checksummed records,
+ *   never rewritten in place. Replay at boot stops at the first torn or
+ *   corrupt record, so a power cut loses at most the last batch
+ * - A burst of changes (dragging the brightness slider) is coalesced:
+ *   the batch is written SETTINGS_COMMIT_DELAY_MS after the last change,
+ *   or SETTINGS_COMMIT_MAX_MS after the first one at the latest, and
+ *   only the final value of each key goes into it
+ * - Once the log passes SETTINGS_LOG_COMPACT_BYTES it is compacted: one
+ *   record per key goes to a temp file, which then replaces the log.
+ *   initSettingsStore() finishes or discards an interrupted compaction
+ * - The header carries a schema version; older logs are migrated and
+ *   compacted on load. /data/settings.txt from older firmware is
+ *   imported once and kept as settings.txt.bak
+ *
+ * The record format, the table and replay live in settings_log.h, which
+ * has no card access and is tested on the host; this file is the card
+ * I/O, batching and migration around them.
+ *
+ * Values are set on the UI task; the card is written by worker jobs
+ * (task_model.h), so a slow SD write never stalls a frame.
+ *
+ * File: settings_store.h
+ */
+
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <lvgl.h>
+#include <atomic>
+#include "SD_MMC.h"
+#include <FS.h>
+#include "kv_parser.h"
+#include "settings_log.h"
+#include "task_model.h"
+#include "storage_stats.h"
+
+#define SETTINGS_LOG_FILE          "/data/settings.log"
+#define SETTINGS_LOG_TMP           "/data/settings.log.tmp"
+#define SETTINGS_TEXT_FILE         "/data/settings.txt"
+#define SETTINGS_TEXT_BACKUP       "/data/settings.txt.bak"
+#define SETTINGS_LOG_COMPACT_BYTES 2048
+#define SETTINGS_LOG_READ_MAX      16384       // Larger logs are only replayed this far
+#define SETTINGS_COMMIT_DELAY_MS   500
+#define SETTINGS_COMMIT_MAX_MS     2000
+
+// One write for the worker; compact batches carry every value
+struct SettingsBatch {
+    bool compact;
+    uint32_t records;
+    uint32_t len;
+    uint8_t data[];
+};
+
+struct SettingsStoreStats {
+    uint32_t sets;          // Calls that changed a value
+    uint32_t batches;       // Appends written
+    uint32_t records;       // Records appended
+    uint32_t compactions;
+    uint32_t failures;      // Writes that failed on the card
+    uint32_t tornBytes;     // Bytes dropped from a torn log tail at boot
+    uint32_t loadMicros;
+    uint32_t lastWriteMicros;
+};
+
+static SettingsTable settingsTable;
+static uint32_t settingsLogBytes = 0;      // Log size once queued writes land
+static uint32_t settingsFirstDirty = 0;    // millis() of the first unsaved change, 0 when clean
+static uint32_t settingsLastChange = 0;
+static bool settingsReady = false;         // Card available and log recovered
+static lv_timer_t * settingsTimer = NULL;
+static std::atomic<bool> settingsWriteFailed(false);
+static SettingsStoreStats settingsStats = {0, 0, 0, 0, 0, 0, 0, 0};
+
+// ═══════════════════════════════════════════════════════════════
+// FILES
+// ═══════════════════════════════════════════════════════════════
+
+// Replace path with a fresh log holding data, through tmp. A cut before
+// the rename leaves the old log; settingsRecover() handles the window
+// between removing the old log and the rename.
+static bool settingsWriteCompact(const char * path, const char * tmp, const uint8_t * data, size_t len) {
+    SettingsLogHeader header;
+    settingsHeaderInit(&header);
+
+    fs::File file = SD_MMC.open(tmp, FILE_WRITE);
+    if (!file) return false;
+    bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              file.write(data, len) == len;
+    file.close();
+
+    if (!ok) {
+        SD_MMC.remove(tmp);
+        return false;
+    }
+    return storage_replace_file(tmp, path);
+}
+
+static bool settingsAppend(const char * path, const uint8_t * data, size_t len) {
+    fs::File file = SD_MMC.open(path, FILE_APPEND);
+    if (!file) return false;
+    uint32_t oldBytes = file.size();
+    bool ok = file.write(data, len) == len;
+    file.close();   // Commits the FAT entry, the batch is durable from here
+    if (ok) storage_note_resize(oldBytes, oldBytes + len);
+    return ok;
+}
+
+// Worker core: write one batch
+static void settingsWriteJob(void * arg) {
+    SettingsBatch * batch = (SettingsBatch *)arg;
+    uint32_t start = micros();
+
+    bool ok = batch->compact
+        ? settingsWriteCompact(SETTINGS_LOG_FILE, SETTINGS_LOG_TMP, batch->data, batch->len)
+        : settingsAppend(SETTINGS_LOG_FILE, batch->data, batch->len);
+    if (!ok) {
+        Serial.println("Settings write failed, compacting next time");
+        settingsWriteFailed = true;
+        settingsStats.failures++;
+    }
+
+    settingsStats.lastWriteMicros = micros() - start;
+    free(batch);
+}
+
+// Finish or undo a compaction a power cut interrupted
+static void settingsRecover(const char * path, const char * tmp) {
+    if (!SD_MMC.exists(tmp)) return;
+
+    // Old log still there: the cut came before it was removed
+    if (SD_MMC.exists(path)) {
+        SD_MMC.remove(tmp);
+        Serial.println("Settings: dropped unfinished compaction");
+        return;
+    }
+
+    // Only the new log exists, keep it if it is whole
+    SettingsLogHeader header;
+    bool valid = false;
+    fs::File file = SD_MMC.open(tmp);
+    if (file) {
+        valid = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && settingsHeaderValid(&header);
+        file.close();
+    }
+    uint32_t bytes = storage_file_size(tmp);
+    if (valid && SD_MMC.rename(tmp, path)) {
+        // The cut came before storage_replace_file() counted the new log
+        storage_note_resize(0, bytes);
+        Serial.println("Settings: finished interrupted compaction");
+    } else {
+        SD_MMC.remove(tmp);
+    }
+}
+
+// Read and replay a log file into table. Returns the valid length,
+// *fileLen gets the size on the card.
+static size_t settingsLoadFile(const char * path, SettingsTable * table, size_t * fileLen, uint16_t * schema) {
+    *fileLen = 0;
+    fs::File file = SD_MMC.open(path);
+    if (!file) return 0;
+
+    *fileLen = file.size();
+    size_t len = *fileLen < SETTINGS_LOG_READ_MAX ? *fileLen : SETTINGS_LOG_READ_MAX;
+    uint8_t * buf = (uint8_t *)malloc(len ? len : 1);
+    size_t valid = 0;
+    if (buf && file.read(buf, len) == len) {
+        valid = settingsReplay(table, buf, len);
+        if (valid) *schema = ((const SettingsLogHeader *)buf)->schema;
+    }
+    free(buf);
+    file.close();
+    return valid;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// BATCHING
+// ═══════════════════════════════════════════════════════════════
+
+// Build the next write from the table (UI task). Unchanged values are
+// left out unless compacting.
+static SettingsBatch * settingsBuildBatch(bool compact) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < settingsTable.count; i++) {
+        if (compact || settingsTable.values[i].dirty) count++;
+    }
+    SettingsBatch * batch = (SettingsBatch *)malloc(sizeof(SettingsBatch) + count * SETTINGS_RECORD_MAX);
+    if (!batch) return NULL;
+
+    batch->compact = compact;
+    batch->records = count;
+    batch->len = 0;
+    for (uint32_t i = 0; i < settingsTable.count; i++) {
+        SettingValue * v = &settingsTable.values[i];
+        if (!compact && !v->dirty) continue;
+        batch->len += settingsEncode(v, batch->data + batch->len);
+        v->dirty = false;
+    }
+    return batch;
+}
+
+// Queue everything that changed, or rewrite the whole log when
+// compacting. sync writes on the calling task (boot only).
+static bool settingsCommit(bool compact, bool sync) {
+    if (!settingsReady) return false;
+    if (settingsWriteFailed.exchange(false)) compact = true;   // Log may be torn
+    if (!compact && !settingsFirstDirty) return false;
+
+    uint32_t dirtyBytes = 0;
+    for (uint32_t i = 0; i < settingsTable.count; i++) {
+        if (settingsTable.values[i].dirty) dirtyBytes += SETTINGS_RECORD_MAX;
+    }
+    if (settingsLogBytes + dirtyBytes > SETTINGS_LOG_COMPACT_BYTES) compact = true;
+
+    SettingsBatch * batch = settingsBuildBatch(compact);
+    if (!batch) {
+        settingsWriteFailed = compact;
+        return false;
+    }
+    settingsFirstDirty = 0;
+
+    // The worker frees the batch, take what the counters need first
+    uint32_t len = batch->len;
+    uint32_t records = batch->records;
+    if (sync) {
+        settingsWriteJob(batch);
+    } else if (!worker_post(settingsWriteJob, batch)) {
+        // Worker busy: every value goes out with the next attempt
+        free(batch);
+        settingsWriteFailed = true;
+        settingsFirstDirty = millis();
+        return false;
+    }
+
+    if (compact) {
+        settingsLogBytes = sizeof(SettingsLogHeader) + len;
+        settingsStats.compactions++;
+    } else {
+        settingsLogBytes += len;
+        settingsStats.batches++;
+        settingsStats.records += records;
+    }
+    return true;
+}
+
+static void settings_commit_timer(lv_timer_t * timer) {
+    if (!settingsFirstDirty) {
+        lv_timer_pause(timer);
+        return;
+    }
+    uint32_t now = millis();
+    if (now - settingsLastChange >= SETTINGS_COMMIT_DELAY_MS ||
+        now - settingsFirstDirty >= SETTINGS_COMMIT_MAX_MS) {
+        settingsCommit(false, false);
+    }
+}
+
+static void settingsMarkDirty(uint32_t key) {
+    settingsFind(&settingsTable, key)->dirty = true;
+    settingsStats.sets++;
+    settingsLastChange = millis();
+    if (!settingsFirstDirty) settingsFirstDirty = settingsLastChange ? settingsLastChange : 1;
+
+    // Without a card values stay in RAM; before LVGL is up (boot) the
+    // change waits for settingsFlush()
+    if (!settingsReady || !lv_is_initialized()) return;
+    if (!settingsTimer) settingsTimer = lv_timer_create(settings_commit_timer, SETTINGS_COMMIT_DELAY_MS / 5, NULL);
+    lv_timer_resume(settingsTimer);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// MIGRATION
+// ═══════════════════════════════════════════════════════════════
+
+// Bring values written by an older schema up to date. Nothing changed
+// meaning yet; add a case per version bump.
+static void settingsMigrate(uint16_t fromSchema) {
+    Serial.printf("Settings: migrating schema %u -> %u\n", fromSchema, SETTINGS_SCHEMA_VERSION);
+}
+
+// /data/settings.txt of older firmware holds integers only
+static void onLegacySettingsKey(void * ctx, uint32_t key, KvSlice value) {
+    int32_t v = (int32_t)kvSliceToInt(value);
+    settingsPut(&settingsTable, key, SETTING_INT, &v, sizeof(v));
+}
+
+static bool settingsImportText() {
+    if (!SD_MMC.exists(SETTINGS_TEXT_FILE)) return false;
+    fs::File file = SD_MMC.open(SETTINGS_TEXT_FILE);
+    if (!file) return false;
+    kvParseFile(file, onLegacySettingsKey, NULL);
+    file.close();
+
+    SD_MMC.remove(SETTINGS_TEXT_BACKUP);
+    SD_MMC.rename(SETTINGS_TEXT_FILE, SETTINGS_TEXT_BACKUP);
+    Serial.printf("Settings: imported %lu values from %s\n", settingsTable.count, SETTINGS_TEXT_FILE);
+    return true;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API
+// ═══════════════════════════════════════════════════════════════
+
+// Load settings, call once after the SD card is mounted. Without a card
+// values live in RAM only.
+bool initSettingsStore() {
+    uint32_t start = micros();
+    settingsTable.count = 0;
+
+    if (SD_MMC.cardType() == CARD_NONE) return false;
+    if (!SD_MMC.exists("/data")) SD_MMC.mkdir("/data");
+
+    settingsRecover(SETTINGS_LOG_FILE, SETTINGS_LOG_TMP);
+
+    size_t fileLen = 0;
+    uint16_t schema = SETTINGS_SCHEMA_VERSION;
+    size_t valid = settingsLoadFile(SETTINGS_LOG_FILE, &settingsTable, &fileLen, &schema);
+
+    bool compact = false;
+    if (!valid) {
+        // No usable log: first boot, old firmware or a destroyed header
+        if (fileLen) Serial.println("Settings: log header unreadable, starting over");
+        settingsImportText();
+        compact = true;
+    } else {
+        if (valid < fileLen) {
+            settingsStats.tornBytes = fileLen - valid;
+            Serial.printf("Settings: dropped %lu torn bytes at the log tail\n", settingsStats.tornBytes);
+            compact = true;
+        }
+        if (schema < SETTINGS_SCHEMA_VERSION) {
+            settingsMigrate(schema);
+            compact = true;
+        }
+        if (valid > SETTINGS_LOG_COMPACT_BYTES) compact = true;
+    }
+
+    settingsReady = true;
+    settingsLogBytes = valid;
+    // Rewrite now, before anything is appended to a torn tail
+    if (compact) settingsCommit(true, true);
+
+    settingsStats.loadMicros = micros() - start;
+    Serial.printf("Settings: %lu values loaded in %lu us\n", settingsTable.count, settingsStats.loadMicros);
+    return true;
+}
+
+int32_t settingsGetInt(uint32_t key, int32_t fallback) {
+    SettingValue * v = settingsFind(&settingsTable, key);
+    if (!v || v->type != SETTING_INT || v->len != sizeof(int32_t)) return fallback;
+    int32_t value;
+    memcpy(&value, v->data, sizeof(value));
+    return value;
+}
+
+// Valid until the key is set again
+const char * settingsGetString(uint32_t key, const char * fallback) {
+    SettingValue * v = settingsFind(&settingsTable, key);
+    if (!v || v->type != SETTING_STRING) return fallback;
+    return (const char *)v->data;
+}
+
+// Set a value (UI task); unchanged values cost nothing
+void settingsSetInt(uint32_t key, int32_t value) {
+    if (settingsPut(&settingsTable, key, SETTING_INT, &value, sizeof(value))) settingsMarkDirty(key);
+}
+
+void settingsSetString(uint32_t key, const char * value) {
+    size_t len = strlen(value);
+    if (len >= SETTINGS_VALUE_MAX) len = SETTINGS_VALUE_MAX - 1;
+    char buf[SETTINGS_VALUE_MAX];
+    memcpy(buf, value, len);
+    buf[len] = '\0';
+    if (settingsPut(&settingsTable, key, SETTING_STRING, buf, len + 1)) settingsMarkDirty(key);
+}
+
+// Queue pending changes now instead of after the coalescing delay
+void settingsFlush() {
+    settingsCommit(false, false);
+}
+
+void printSettingsStoreStats() {
+    Serial.println("\n=== Settings Store ===");
+    Serial.printf("Values: %lu / %d, log %lu bytes (compacts past %d)\n",
+                  settingsTable.count, SETTINGS_MAX, settingsLogBytes, SETTINGS_LOG_COMPACT_BYTES);
+    Serial.printf("Sets: %lu -> %lu batches, %lu records (%lu.%02lu sets per batch)\n",
+                  settingsStats.sets, settingsStats.batches, settingsStats.records,
+                  settingsStats.batches ? settingsStats.sets / settingsStats.batches : 0,
+                  settingsStats.batches ? settingsStats.sets * 100 / settingsStats.batches % 100 : 0);
+    Serial.printf("Compactions: %lu, failed writes: %lu, torn bytes at boot: %lu\n",
+                  settingsStats.compactions, settingsStats.failures, settingsStats.tornBytes);
+    Serial.printf("Load: %lu us, last write: %lu us\n", settingsStats.loadMicros, settingsStats.lastWriteMicros);
+    Serial.println("======================\n");
+}
+
+// ═══════════════════════════════════════════════════════════════
+// POWER LOSS TEST
+// ═══════════════════════════════════════════════════════════════
+
+// Remove a file the test wrote, counting the bytes it frees
+static void settingsTestRemove(const char * path) {
+    uint32_t bytes = storage_file_size(path);
+    if (!bytes && !SD_MMC.exists(path)) return;
+    storage_note_resize(bytes, 0);
+    SD_MMC.remove(path);
+}
+
+// The replay half (runSettingsReplayTest(), also a host test), then the
+// compaction cut points on the card: /data/settings.plt and its temp
+// file are removed again afterwards. Returns the number of failures.
+uint32_t runSettingsPowerLossTest(int updates = 64) {
+    uint32_t failures = runSettingsReplayTest(updates);
+    if (SD_MMC.cardType() == CARD_NONE) {
+        Serial.println("Settings power loss: no card, compaction cut points skipped");
+        return failures;
+    }
+
+    SettingsTestLog t;
+    SettingsTable * replayed = (SettingsTable *)malloc(sizeof(SettingsTable));
+    if (!settingsTestLogBuild(&t, updates) || !replayed) {
+        Serial.println("Settings power loss test: out of memory");
+        settingsTestLogFree(&t); free(replayed);
+        return failures + 1;
+    }
+
+    const char * path = "/data/settings.plt";
+    const char * tmp = "/data/settings.plt.tmp";
+    const uint8_t * records = t.data + sizeof(SettingsLogHeader);
+    size_t recordsLen = t.ends[updates / 2] - sizeof(SettingsLogHeader);
+    if (!SD_MMC.exists("/data")) SD_MMC.mkdir("/data");
+
+    // Temp files are not counted until they replace the log, like
+    // storage_replace_file() treats them
+    for (int stage = 0; stage < 4; stage++) {
+        settingsTestRemove(path);
+        SD_MMC.remove(tmp);
+        settingsWriteCompact(path, tmp, records, recordsLen);   // Old log
+        bool expectNew = false;
+
+        fs::File f;
+        switch (stage) {
+            case 0:     // Cut while writing the temp file
+                f = SD_MMC.open(tmp, FILE_WRITE);
+                f.write(t.data, sizeof(SettingsLogHeader) / 2);
+                f.close();
+                break;
+            case 1:     // Temp file complete, old log not removed yet
+                f = SD_MMC.open(tmp, FILE_WRITE);
+                f.write(t.data, t.len);
+                f.close();
+                break;
+            case 2:     // Old log removed, rename not done
+                f = SD_MMC.open(tmp, FILE_WRITE);
+                f.write(t.data, t.len);
+                f.close();
+                settingsTestRemove(path);
+                expectNew = true;
+                break;
+            case 3:     // Old log removed, temp file torn mid-header
+                f = SD_MMC.open(tmp, FILE_WRITE);
+                f.write(t.data, sizeof(SettingsLogHeader) / 2);
+                f.close();
+                settingsTestRemove(path);
+                break;
+        }
+
+        settingsRecover(path, tmp);
+        size_t fileLen = 0;
+        uint16_t schema = 0;
+        replayed->count = 0;
+        size_t got = settingsLoadFile(path, replayed, &fileLen, &schema);
+        size_t want = stage == 3 ? 0 : (expectNew ? t.len : t.ends[updates / 2]);
+        TEST_CHECK(got == want && !SD_MMC.exists(tmp),
+                   "compaction stage %d: log %u bytes, expected %u", stage, (unsigned)got, (unsigned)want);
+    }
+
+    settingsTestRemove(path);
+    SD_MMC.remove(tmp);
+    TEST_CHECK(!SD_MMC.exists(path) && !SD_MMC.exists(tmp), "test files left in /data");
+    Serial.println("Settings power loss: compaction cut points checked");
+
+    settingsTestLogFree(&t); free(replayed);
+    return failures;
+}
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,313 @@
+/*
+ * Storage Stats
+ *
+ * SD card usage without scanning the card on the UI task.
+ * - SD_MMC.usedBytes() walks the whole allocation table, seconds on a
+ *   large card. Usage is instead measured once on the worker with a
+ *   single f_getfree() and kept in /data/storage.dat, so later boots
+ *   (same card) have it without any scan
+ * - The firmware's own writes adjust the figure as they happen: code
+ *   that writes files reports the size change with storage_note_resize()
+ *   or replaces files through storage_replace_file(). Changes are
+ *   rounded to whole clusters, like the allocation table counts them
+ * - storage_snapshot() is a few loads, any UI can call it per frame
+ *
+ * The card is identified by its size; changes made elsewhere (a PC) are
+ * not seen until storage_rescan() or a different card. Until the first
+ * scan of a new card the snapshot reports the card as measuring.
+ *
+ * storage_snapshot() and the listener are UI task; storage_note_*() and
+ * storage_replace_file() can be called from any task.
+ *
+ * File: storage_stats.h
+ */
+
+#ifndef STORAGE_STATS_H
+#define STORAGE_STATS_H
+
+#include <atomic>
+#include "SD_MMC.h"
+#include <FS.h>
+#include "task_model.h"
+
+#if defined(ARDUINO)
+#include "ff.h"
+#endif
+
+#define STORAGE_STATS_FILE        "/data/storage.dat"
+#define STORAGE_STATS_MAGIC       0x54535453  // "STST"
+#define STORAGE_STATS_VERSION     1
+#define STORAGE_DEFAULT_CLUSTER   32768       // Until the first scan says otherwise
+#define STORAGE_PERSIST_STEP      (1024 * 1024)  // Rewrite the file after this much change
+
+struct StorageStatsFile {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t cardMB;          // SD_MMC.cardSize(), identifies the card
+    uint32_t clusterBytes;
+    uint64_t totalBytes;
+    uint64_t usedBytes;
+    uint32_t checksum;        // FNV-1a over the fields above
+};
+
+struct StorageSnapshot {
+    bool mounted;
+    bool valid;               // Usage known (scanned or persisted)
+    bool scanning;
+    uint64_t totalBytes;
+    uint64_t usedBytes;
+};
+
+struct StorageScanResult {
+    bool ok;
+    uint32_t clusterBytes;
+    uint64_t totalBytes;
+    uint64_t usedBytes;
+    int32_t deltaAtStart;     // Adjustments already counted by the scan
+    uint32_t millis;
+};
+
+struct StorageStatsCounters {
+    uint32_t scans;
+    uint32_t lastScanMillis;
+    uint32_t persists;
+    bool fromFile;            // Usage came from storage.dat at boot
+};
+
+typedef void (*StorageListener)();
+
+// UI task state
+static StorageSnapshot storageBase = {false, false, false, 0, 0};   // Last scan, persisted value
+static uint32_t storageCardMB = 0;
+static uint64_t storagePersistedUsed = 0;
+static StorageListener storageListener = NULL;
+static StorageStatsCounters storageCounters = {0, 0, 0, false};
+
+// Written from any task
+static std::atomic<int32_t> storageDelta(0);                // Bytes since storageBase
+static std::atomic<uint32_t> storageCluster(STORAGE_DEFAULT_CLUSTER);
+static std::atomic<uint32_t> storageAdjustments(0);          // Writes that changed usage
+
+static uint32_t storageChecksum(const StorageStatsFile &f) {
+    uint32_t h = 2166136261u;
+    const uint8_t * p = (const uint8_t *)&f;
+    for (size_t i = 0; i < offsetof(StorageStatsFile, checksum); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static inline int64_t storageClusters(uint64_t bytes, uint32_t cluster) {
+    return (int64_t)((bytes + cluster - 1) / cluster);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// WRITE ACCOUNTING (any task)
+// ═══════════════════════════════════════════════════════════════
+
+// A file went from oldBytes to newBytes (0 = created / removed)
+void storage_note_resize(uint32_t oldBytes, uint32_t newBytes) {
+    uint32_t cluster = storageCluster;
+    int64_t clusters = storageClusters(newBytes, cluster) - storageClusters(oldBytes, cluster);
+    if (clusters == 0) return;
+    storageDelta += (int32_t)(clusters * cluster);
+    storageAdjustments++;
+}
+
+uint32_t storage_file_size(const char * path) {
+    fs::File file = SD_MMC.open(path);
+    if (!file) return 0;
+    uint32_t size = file.size();
+    file.close();
+    return size;
+}
+
+// Replace dst with tmp (written completely beforehand, not yet counted),
+// accounting for the old and new size. If the rename fails only tmp is
+// left, which is the same change: dst's bytes out, tmp's in.
+bool storage_replace_file(const char * tmp, const char * dst) {
+    uint32_t oldBytes = storage_file_size(dst);
+    uint32_t newBytes = storage_file_size(tmp);
+    SD_MMC.remove(dst);
+    bool ok = SD_MMC.rename(tmp, dst);
+    storage_note_resize(oldBytes, newBytes);
+    return ok;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SCAN AND PERSISTENCE
+// ═══════════════════════════════════════════════════════════════
+
+static void storage_persist_job(void * arg) {
+    StorageStatsFile * f = (StorageStatsFile *)arg;
+    uint32_t oldBytes = storage_file_size(STORAGE_STATS_FILE);
+    fs::File file = SD_MMC.open(STORAGE_STATS_FILE, FILE_WRITE);
+    if (file) {
+        file.write((const uint8_t *)f, sizeof(*f));
+        file.close();
+        storage_note_resize(oldBytes, sizeof(*f));
+    }
+    free(f);
+}
+
+// UI task: write the current figure to the card on the worker
+static void storage_persist(uint64_t used) {
+    StorageStatsFile * f = (StorageStatsFile *)malloc(sizeof(StorageStatsFile));
+    if (!f) return;
+    memset(f, 0, sizeof(*f));
+    f->magic = STORAGE_STATS_MAGIC;
+    f->version = STORAGE_STATS_VERSION;
+    f->cardMB = storageCardMB;
+    f->clusterBytes = storageCluster;
+    f->totalBytes = storageBase.totalBytes;
+    f->usedBytes = used;
+    f->checksum = storageChecksum(*f);
+    if (!worker_post(storage_persist_job, f)) {
+        free(f);
+        return;
+    }
+    storagePersistedUsed = used;
+    storageCounters.persists++;
+}
+
+// UI task: scan finished
+static void storage_scan_done(void * arg) {
+    StorageScanResult * r = (StorageScanResult *)arg;
+    storageBase.scanning = false;
+    if (r->ok) {
+        storageBase.valid = true;
+        storageBase.totalBytes = r->totalBytes;
+        storageBase.usedBytes = r->usedBytes;
+        storageDelta -= r->deltaAtStart;
+        storageCluster = r->clusterBytes;
+        storageCounters.scans++;
+        storageCounters.lastScanMillis = r->millis;
+        Serial.printf("Storage: %llu / %llu MB used, scanned in %lu ms\n",
+                      r->usedBytes / 1024 / 1024, r->totalBytes / 1024 / 1024, r->millis);
+        storage_persist(r->usedBytes + storageDelta);
+    } else {
+        Serial.println("Storage: scan failed");
+    }
+    free(r);
+    if (storageListener) storageListener();
+}
+
+// Worker: the one slow call
+static void storage_scan_job(void * arg) {
+    StorageScanResult * r = (StorageScanResult *)arg;
+    uint32_t start = millis();
+    r->deltaAtStart = storageDelta;
+
+#if defined(ARDUINO)
+    // One f_getfree() gives total, free and the cluster size;
+    // SD_MMC.totalBytes() and usedBytes() would run it twice
+    FATFS * fs;
+    DWORD freeClusters;
+    r->ok = f_getfree("0:", &freeClusters, &fs) == FR_OK;
+    if (r->ok) {
+#if FF_MAX_SS != FF_MIN_SS
+        uint32_t sector = fs->ssize;
+#else
+        uint32_t sector = FF_MAX_SS;
+#endif
+        r->clusterBytes = fs->csize * sector;
+        r->totalBytes = (uint64_t)(fs->n_fatent - 2) * r->clusterBytes;
+        r->usedBytes = r->totalBytes - (uint64_t)freeClusters * r->clusterBytes;
+    }
+#else
+    r->clusterBytes = STORAGE_DEFAULT_CLUSTER;
+    r->totalBytes = SD_MMC.totalBytes();
+    r->usedBytes = SD_MMC.usedBytes();
+    r->ok = r->totalBytes > 0;
+#endif
+
+    r->millis = millis() - start;
+    while (!ui_post_call(storage_scan_done, r)) delay(5);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API (UI task)
+// ═══════════════════════════════════════════════════════════════
+
+// Measure the card again in the background
+void storage_rescan() {
+    if (!storageBase.mounted || storageBase.scanning) return;
+    StorageScanResult * r = (StorageScanResult *)malloc(sizeof(StorageScanResult));
+    if (!r) return;
+    memset(r, 0, sizeof(*r));
+    storageBase.scanning = true;
+    if (!worker_post(storage_scan_job, r)) {
+        storageBase.scanning = false;
+        free(r);
+    }
+}
+
+// Call after the SD card is mounted. Uses the persisted figure when it
+// belongs to this card, scans in the background otherwise.
+void initStorageStats() {
+    storageBase.mounted = SD_MMC.cardType() != CARD_NONE;
+    if (!storageBase.mounted) return;
+    storageCardMB = (uint32_t)(SD_MMC.cardSize() / 1024 / 1024);    // From the card registers, no scan
+
+    StorageStatsFile f;
+    bool loaded = false;
+    fs::File file = SD_MMC.open(STORAGE_STATS_FILE);
+    if (file) {
+        loaded = file.read((uint8_t *)&f, sizeof(f)) == sizeof(f);
+        file.close();
+    }
+    if (loaded && f.magic == STORAGE_STATS_MAGIC && f.version == STORAGE_STATS_VERSION &&
+        f.checksum == storageChecksum(f) && f.cardMB == storageCardMB && f.clusterBytes) {
+        storageBase.valid = true;
+        storageBase.totalBytes = f.totalBytes;
+        storageBase.usedBytes = f.usedBytes;
+        storageCluster = f.clusterBytes;
+        storagePersistedUsed = f.usedBytes;
+        storageCounters.fromFile = true;
+        return;
+    }
+    storage_rescan();
+}
+
+// Called on the UI task when a scan finishes
+void storage_set_listener(StorageListener listener) {
+    storageListener = listener;
+}
+
+// Current usage, no card access
+StorageSnapshot storage_snapshot() {
+    StorageSnapshot s = storageBase;
+    int64_t used = (int64_t)s.usedBytes + storageDelta;
+    if (used < 0) used = 0;
+    if (s.totalBytes && used > (int64_t)s.totalBytes) used = s.totalBytes;
+    s.usedBytes = used;
+
+    // Keep storage.dat roughly current
+    if (s.valid && !s.scanning) {
+        int64_t drift = (int64_t)s.usedBytes - (int64_t)storagePersistedUsed;
+        if (drift >= STORAGE_PERSIST_STEP || drift <= -STORAGE_PERSIST_STEP) storage_persist(s.usedBytes);
+    }
+    return s;
+}
+
+void printStorageStats() {
+    StorageSnapshot s = storage_snapshot();
+    Serial.println("\n=== Storage Stats ===");
+    if (!s.mounted) {
+        Serial.println("No SD card");
+    } else {
+        Serial.printf("Card: %lu MB, cluster %lu B%s\n", storageCardMB, (uint32_t)storageCluster,
+                      s.scanning ? ", scanning" : "");
+        if (s.valid) Serial.printf("Used: %llu / %llu MB (%ld KB adjusted since %s)\n",
+                                   s.usedBytes / 1024 / 1024, s.totalBytes / 1024 / 1024,
+                                   (int32_t)storageDelta / 1024,
+                                   storageCounters.scans ? "the scan" : "boot");
+        Serial.printf("Usage from: %s, scans: %lu (last %lu ms), adjustments: %lu, persisted: %lu\n",
+                      storageCounters.fromFile ? "storage.dat" : "scan", storageCounters.scans,
+                      storageCounters.lastScanMillis, (uint32_t)storageAdjustments, storageCounters.persists);
+    }
+    Serial.println("=====================\n");
+}
+
+#endif // STORAGE_STATS_H
@@ -0,0 +1,476 @@
+/*
+ * Task Model - UI core / worker core split
+ *
+ * Threading rules:
+ * - UI task (Arduino loop task, core 1): owns LVGL. Rendering, input and
+ *   the EEZ flow run here, because EEZ flow components call LVGL directly.
+ * - Worker task (core 0): app loop functions, SD card I/O and radio
+ *   work. It must never touch LVGL objects.
+ * - Worker -> UI: ui_post_*() queue LVGL mutations that the UI task
+ *   applies at the start of its next pass (ui_queue_drain).
+ * - UI -> worker: worker_post() runs a job on the worker core.
+ *
+ * On the device the queues are FreeRTOS queues; a host build uses
+ * std::thread / std::mutex stand-ins, and tools/host_tests.cpp runs
+ * runTaskModelStressTest() and runTaskModelAppLoopTest() on them, and
+ * runRadioManagerTest() (radio_manager.h) through them.
+ *
+ * File: task_model.h
+ */
+
+#ifndef TASK_MODEL_H
+#define TASK_MODEL_H
+
+#include <lvgl.h>
+#include <atomic>
+#include "test_check.h"
+
+#if defined(ARDUINO)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#endif
+
+#define UI_QUEUE_SIZE      32
+#define WORKER_QUEUE_SIZE  16
+#define UI_MSG_TEXT_LEN    64
+#define WORKER_STACK_SIZE  8192
+#define WORKER_CORE        0
+#define WORKER_TICK_MS     10     // App loop period when no jobs arrive
+
+#define TASK_WAIT_FOREVER  0xFFFFFFFF
+
+typedef void (*TaskJobFunc)(void * arg);
+typedef void (*WorkerAppLoopFunc)();
+
+// ═══════════════════════════════════════════════════════════════
+// MESSAGE QUEUE
+// ═══════════════════════════════════════════════════════════════
+
+#if defined(ARDUINO)
+
+template <typename T, size_t N>
+class MessageQueue {
+public:
+    void begin() {
+        handle = xQueueCreateStatic(N, sizeof(T), storage, &queueBuf);
+    }
+    bool send(const T & msg, uint32_t timeoutMs) {
+        TickType_t ticks = timeoutMs == TASK_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+        return xQueueSend(handle, &msg, ticks) == pdTRUE;
+    }
+    bool receive(T * msg, uint32_t timeoutMs) {
+        TickType_t ticks = timeoutMs == TASK_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+        return xQueueReceive(handle, msg, ticks) == pdTRUE;
+    }
+    bool empty() {
+        return uxQueueMessagesWaiting(handle) == 0;
+    }
+
+private:
+    StaticQueue_t queueBuf;
+    uint8_t storage[N * sizeof(T)];
+    QueueHandle_t handle = NULL;
+};
+
+#else
+
+template <typename T, size_t N>
+class MessageQueue {
+public:
+    void begin() {
+        head = tail = count = 0;
+    }
+    bool send(const T & msg, uint32_t timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!waitFor(notFull, lock, timeoutMs, [this] { return count < N; })) return false;
+        items[tail] = msg;
+        tail = (tail + 1) % N;
+        count++;
+        notEmpty.notify_one();
+        return true;
+    }
+    bool receive(T * msg, uint32_t timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!waitFor(notEmpty, lock, timeoutMs, [this] { return count > 0; })) return false;
+        *msg = items[head];
+        head = (head + 1) % N;
+        count--;
+        notFull.notify_one();
+        return true;
+    }
+    bool empty() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count == 0;
+    }
+
+private:
+    template <typename Pred>
+    bool waitFor(std::condition_variable & cv, std::unique_lock<std::mutex> & lock,
+                 uint32_t timeoutMs, Pred ready) {
+        if (timeoutMs == TASK_WAIT_FOREVER) {
+            cv.wait(lock, ready);
+            return true;
+        }
+        return cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready);
+    }
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    T items[N];
+    size_t head = 0, tail = 0, count = 0;
+};
+
+#endif
+
+// ═══════════════════════════════════════════════════════════════
+// UI MESSAGES (worker -> UI)
+// ═══════════════════════════════════════════════════════════════
+
+enum UiMessageType {
+    UI_MSG_SET_TEXT = 0,    // lv_label_set_text(obj, text)
+    UI_MSG_SET_CHECKED,     // Add/clear LV_STATE_CHECKED
+    UI_MSG_SET_VALUE,       // lv_slider/lv_bar value
+    UI_MSG_CALL             // Run fn(arg) on the UI task
+};
+
+struct UiMessage {
+    uint8_t type;
+    lv_obj_t * obj;
+    int32_t value;
+    TaskJobFunc fn;
+    void * arg;
+    char text[UI_MSG_TEXT_LEN];
+};
+
+struct WorkerJob {
+    TaskJobFunc fn;
+    void * arg;
+};
+
+struct TaskModelStats {
+    uint32_t uiMessages;
+    uint32_t uiDropped;
+    uint32_t jobs;
+    uint32_t jobsDropped;
+    uint32_t appTicks;
+};
+
+static MessageQueue<UiMessage, UI_QUEUE_SIZE> uiQueue;
+static MessageQueue<WorkerJob, WORKER_QUEUE_SIZE> workerQueue;
+static TaskModelStats taskStats = {0, 0, 0, 0, 0};
+static std::atomic<WorkerAppLoopFunc> workerAppLoop(NULL);
+static std::atomic<bool> workerInAppLoop(false);
+
+#if defined(ARDUINO)
+static TaskHandle_t uiTaskHandle = NULL;
+static TaskHandle_t workerTaskHandle = NULL;
+#endif
+
+static void ui_wake() {
+#if defined(ARDUINO)
+    // Cut the UI task's scheduler sleep short
+    if (uiTaskHandle) xTaskNotifyGive(uiTaskHandle);
+#endif
+}
+
+static bool ui_post(const UiMessage & msg) {
+    if (!uiQueue.send(msg, 0)) {
+        // Both cores post, so this counter is shared
+        __atomic_fetch_add(&taskStats.uiDropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    ui_wake();
+    return true;
+}
+
+bool ui_post_text(lv_obj_t * obj, const char * text) {
+    UiMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = UI_MSG_SET_TEXT;
+    msg.obj = obj;
+    strncpy(msg.text, text, UI_MSG_TEXT_LEN - 1);
+    return ui_post(msg);
+}
+
+bool ui_post_checked(lv_obj_t * obj, bool checked) {
+    UiMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = UI_MSG_SET_CHECKED;
+    msg.obj = obj;
+    msg.value = checked;
+    return ui_post(msg);
+}
+
+bool ui_post_value(lv_obj_t * obj, int32_t value) {
+    UiMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = UI_MSG_SET_VALUE;
+    msg.obj = obj;
+    msg.value = value;
+    return ui_post(msg);
+}
+
+bool ui_post_call(TaskJobFunc fn, void * arg) {
+    UiMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = UI_MSG_CALL;
+    msg.fn = fn;
+    msg.arg = arg;
+    return ui_post(msg);
+}
+
+// Apply queued mutations, UI task only (called by the loop scheduler)
+void ui_queue_drain() {
+    UiMessage msg;
+    while (uiQueue.receive(&msg, 0)) {
+        taskStats.uiMessages++;
+        // The target may have been deleted since the message was posted
+        if (msg.obj && !lv_obj_is_valid(msg.obj)) continue;
+        switch (msg.type) {
+            case UI_MSG_SET_TEXT:
+                if (msg.obj) lv_label_set_text(msg.obj, msg.text);
+                break;
+            case UI_MSG_SET_CHECKED:
+                if (!msg.obj) break;
+                if (msg.value) lv_obj_add_state(msg.obj, LV_STATE_CHECKED);
+                else lv_obj_clear_state(msg.obj, LV_STATE_CHECKED);
+                break;
+            case UI_MSG_SET_VALUE:
+                if (!msg.obj) break;
+                if (lv_obj_check_type(msg.obj, &lv_slider_class)) lv_slider_set_value(msg.obj, msg.value, LV_ANIM_OFF);
+                else if (lv_obj_check_type(msg.obj, &lv_bar_class)) lv_bar_set_value(msg.obj, msg.value, LV_ANIM_OFF);
+                break;
+            case UI_MSG_CALL:
+                if (msg.fn) msg.fn(msg.arg);
+                break;
+        }
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// WORKER (UI -> worker)
+// ═══════════════════════════════════════════════════════════════
+
+bool worker_post(TaskJobFunc fn, void * arg) {
+    WorkerJob job = { fn, arg };
+    if (!workerQueue.send(job, 0)) {
+        taskStats.jobsDropped++;
+        return false;
+    }
+    return true;
+}
+
+// App loop run on the worker core, NULL to stop
+void worker_set_app_loop(WorkerAppLoopFunc loop) {
+    workerAppLoop = loop;
+    // An idle worker waits for a job without a timeout; an empty job wakes
+    // it so the loop starts ticking. A full queue wakes it anyway.
+    WorkerJob wake = { NULL, NULL };
+    if (loop) workerQueue.send(wake, 0);
+}
+
+// Stop the app loop and wait for a tick in progress to finish.
+// Afterwards the app's code and data can be freed safely.
+static void task_sleep_ms(uint32_t ms) {
+#if defined(ARDUINO)
+    vTaskDelay(pdMS_TO_TICKS(ms) ? pdMS_TO_TICKS(ms) : 1);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+#endif
+}
+
+void worker_stop_app_loop() {
+    workerAppLoop = NULL;
+    while (workerInAppLoop) task_sleep_ms(1);
+}
+
+static void workerMain(void * param) {
+    WorkerJob job;
+    for (;;) {
+        uint32_t timeout = workerAppLoop ? WORKER_TICK_MS : TASK_WAIT_FOREVER;
+        if (workerQueue.receive(&job, timeout) && job.fn) {
+            taskStats.jobs++;
+            job.fn(job.arg);
+        }
+        // Flag first, then read the loop, so worker_stop_app_loop() either
+        // sees the flag or this tick sees NULL
+        workerInAppLoop = true;
+        WorkerAppLoopFunc loop = workerAppLoop;
+        if (loop) {
+            taskStats.appTicks++;
+            loop();
+        }
+        workerInAppLoop = false;
+    }
+}
+
+// Call from setup() on the UI (loop) task
+void initTaskModel() {
+    uiQueue.begin();
+    workerQueue.begin();
+
+#if defined(ARDUINO)
+    uiTaskHandle = xTaskGetCurrentTaskHandle();
+    xTaskCreatePinnedToCore(workerMain, "worker", WORKER_STACK_SIZE, NULL, 1,
+                            &workerTaskHandle, WORKER_CORE);
+#else
+    std::thread(workerMain, (void *)NULL).detach();
+#endif
+}
+
+void printTaskModelStats() {
+    Serial.println("\n=== Task Model ===");
+    Serial.printf("UI messages: %lu (dropped %lu)\n", taskStats.uiMessages, taskStats.uiDropped);
+    Serial.printf("Worker jobs: %lu (dropped %lu), app ticks: %lu\n",
+                  taskStats.jobs, taskStats.jobsDropped, taskStats.appTicks);
+    Serial.println("==================\n");
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STRESS TEST
+// ═══════════════════════════════════════════════════════════════
+
+#define TASK_STRESS_TIMEOUT_MS 10000
+
+enum TaskStressProducer {
+    TASK_STRESS_FROM_UI = 0,
+    TASK_STRESS_FROM_WORKER,
+    TASK_STRESS_PRODUCERS
+};
+
+static std::atomic<uint32_t> stressJobNext(0);
+static std::atomic<uint32_t> stressJobOrderErrors(0);
+static std::atomic<uint32_t> stressUiNext[TASK_STRESS_PRODUCERS];
+static std::atomic<uint32_t> stressUiOrderErrors(0);
+static lv_obj_t * stressBar = NULL;
+
+static void *stress_tag(uint32_t producer, uint32_t seq) {
+    return (void *)(uintptr_t)((producer << 24) | seq);
+}
+
+// UI task: every producer's calls must arrive in the order they were posted
+static void stress_ui_call(void * arg) {
+    uint32_t tag = (uint32_t)(uintptr_t)arg;
+    uint32_t producer = tag >> 24, seq = tag & 0xFFFFFF;
+    if (producer >= TASK_STRESS_PRODUCERS) {
+        stressUiOrderErrors++;
+        return;
+    }
+    if (seq != stressUiNext[producer]) stressUiOrderErrors++;
+    stressUiNext[producer] = seq + 1;
+}
+
+// Worker: check job order, then answer through the UI queue. The UI task
+// drains while it waits for worker queue space, so retrying can't deadlock.
+static void stress_worker_job(void * arg) {
+    uint32_t seq = (uint32_t)(uintptr_t)arg;
+    if (seq != stressJobNext) stressJobOrderErrors++;
+    stressJobNext = seq + 1;
+
+    while (!ui_post_value(stressBar, seq)) task_sleep_ms(1);
+    while (!ui_post_call(stress_ui_call, stress_tag(TASK_STRESS_FROM_WORKER, seq))) task_sleep_ms(1);
+}
+
+// Floods the worker queue from the UI task and the UI queue from both
+// cores, then checks that every message arrived exactly once and in order.
+// Run on the UI task with no app open. Returns the number of failures.
+uint32_t runTaskModelStressTest(uint32_t messages = 2000) {
+    uint32_t failures = 0;
+    TaskModelStats before = taskStats;
+
+    stressJobNext = 0;
+    stressJobOrderErrors = 0;
+    stressUiOrderErrors = 0;
+    for (int i = 0; i < TASK_STRESS_PRODUCERS; i++) stressUiNext[i] = 0;
+    stressBar = lv_bar_create(lv_layer_top());
+    lv_obj_add_flag(stressBar, LV_OBJ_FLAG_HIDDEN);
+    lv_bar_set_range(stressBar, 0, messages);
+
+    uint32_t start = millis();
+    for (uint32_t seq = 0; seq < messages; seq++) {
+        while (!worker_post(stress_worker_job, (void *)(uintptr_t)seq)) {
+            ui_queue_drain();
+            task_sleep_ms(1);
+        }
+        // Only drain when full, so both producers keep hitting a full queue
+        while (!ui_post_call(stress_ui_call, stress_tag(TASK_STRESS_FROM_UI, seq))) {
+            ui_queue_drain();
+        }
+    }
+    while (stressUiNext[TASK_STRESS_FROM_WORKER] < messages &&
+           millis() - start < TASK_STRESS_TIMEOUT_MS) {
+        ui_queue_drain();
+        task_sleep_ms(1);
+    }
+    ui_queue_drain();
+    uint32_t elapsed = millis() - start;
+
+    TEST_CHECK(stressJobNext == messages, "worker ran %lu of %lu jobs", (uint32_t)stressJobNext, messages);
+    TEST_CHECK(stressUiNext[TASK_STRESS_FROM_UI] == messages, "UI task got %lu of %lu of its own calls",
+               (uint32_t)stressUiNext[TASK_STRESS_FROM_UI], messages);
+    TEST_CHECK(stressUiNext[TASK_STRESS_FROM_WORKER] == messages, "UI task got %lu of %lu worker calls",
+               (uint32_t)stressUiNext[TASK_STRESS_FROM_WORKER], messages);
+    TEST_CHECK(stressJobOrderErrors == 0, "%lu worker jobs out of order", (uint32_t)stressJobOrderErrors);
+    TEST_CHECK(stressUiOrderErrors == 0, "%lu UI calls out of order", (uint32_t)stressUiOrderErrors);
+    TEST_CHECK(lv_bar_get_value(stressBar) == (int32_t)messages - 1, "last value %ld, expected %lu",
+               (long)lv_bar_get_value(stressBar), messages - 1);
+    TEST_CHECK(taskStats.jobs - before.jobs == messages, "job counter moved by %lu",
+               taskStats.jobs - before.jobs);
+    TEST_CHECK(taskStats.uiMessages - before.uiMessages == messages * 3, "UI message counter moved by %lu",
+               taskStats.uiMessages - before.uiMessages);
+
+    lv_obj_del(stressBar);
+    stressBar = NULL;
+
+    Serial.printf("Task model stress: %lu messages each way in %lu ms, %lu UI / %lu job retries\n",
+                  messages, elapsed, taskStats.uiDropped - before.uiDropped,
+                  taskStats.jobsDropped - before.jobsDropped);
+    Serial.printf("Task model stress test: %lu failures\n", failures);
+    return failures;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// APP LOOP TEST
+// ═══════════════════════════════════════════════════════════════
+
+#define TASK_APP_LOOP_TEST_MS (20 * WORKER_TICK_MS)
+
+static std::atomic<uint32_t> appLoopTestTicks(0);
+
+static void app_loop_test_tick() {
+    appLoopTestTicks++;
+}
+
+// Sets an app loop while no other job reaches the worker: it has to tick
+// every WORKER_TICK_MS from the start and stop with worker_stop_app_loop().
+// Run with no app open. Returns the number of failures.
+uint32_t runTaskModelAppLoopTest() {
+    uint32_t failures = 0;
+
+    // Let the worker go idle, waiting for a job without a timeout
+    task_sleep_ms(5 * WORKER_TICK_MS);
+    appLoopTestTicks = 0;
+    worker_set_app_loop(app_loop_test_tick);
+    task_sleep_ms(TASK_APP_LOOP_TEST_MS);
+    worker_stop_app_loop();
+    uint32_t ticks = appLoopTestTicks;
+    task_sleep_ms(3 * WORKER_TICK_MS);
+
+    TEST_CHECK(ticks >= TASK_APP_LOOP_TEST_MS / WORKER_TICK_MS / 2, "app loop ticked %lu times in %d ms",
+               ticks, TASK_APP_LOOP_TEST_MS);
+    TEST_CHECK(appLoopTestTicks == ticks, "app loop ticked %lu times after it was stopped",
+               (uint32_t)appLoopTestTicks - ticks);
+
+    Serial.printf("Task model app loop test: %lu ticks in %d ms, %lu failures\n",
+                  ticks, TASK_APP_LOOP_TEST_MS, failures);
+    return failures;
+}
+
+#endif // TASK_MODEL_H
@@ -0,0 +1,22 @@
+/*
+ * Test Checks
+ *
+ * Shared failure reporting for the self-tests in the headers, run on the
+ * device by device_checks.h and on the host by tools/host_tests.cpp.
+ * A test keeps a local uint32_t failures, checks with
+ *
+ *     TEST_CHECK(count == 3, "%lu items, expected 3", count);
+ *
+ * and returns failures. A failed check prints its message indented
+ * under the test's output.
+ *
+ * File: test_check.h
+ */
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#define TEST_CHECK(cond, ...) \
+    do { if (!(cond)) { Serial.printf("  " __VA_ARGS__); Serial.println(); failures++; } } while (0)
+
+#endif // TEST_CHECK_H
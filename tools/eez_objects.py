@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+EEZ object name table
+
+Reads the objects_t struct EEZ Studio generates in screens.h and writes
+the field names, in field order, as a table the widget registry
+(widget_registry.h) uses to register each screen's objects by name.
+
+    python3 tools/eez_objects.py screens.h eez_objects.h
+
+Run it whenever EEZ Studio regenerates screens.h. The header carries the
+field count and widget_registry.h checks it against sizeof(objects_t),
+so a stale table fails the build instead of naming the wrong widgets.
+
+File: tools/eez_objects.py
+"""
+
+import argparse
+import re
+import sys
+
+STRUCT = re.compile(r"typedef\s+struct\s+_objects_t\s*\{(.*?)\}\s*objects_t\s*;", re.S)
+FIELD = re.compile(r"lv_obj_t\s*\*\s*(\w+)\s*;")
+
+
+def parse(source):
+    match = STRUCT.search(source)
+    if not match:
+        raise ValueError("no objects_t struct found")
+    body = re.sub(r"/\*.*?\*/|//[^\n]*", "", match.group(1), flags=re.S)
+    names = []
+    for line in body.split(";"):
+        line = line.strip()
+        if not line:
+            continue
+        field = FIELD.fullmatch(line + ";")
+        if not field:
+            raise ValueError("objects_t field is not an lv_obj_t pointer: %s" % line)
+        names.append(field.group(1))
+    return names
+
+
+def render(names, source_name):
+    width = max(len(n) for n in names) + 4 if names else 0
+    lines = [
+        "/*",
+        " * EEZ object names, generated by tools/eez_objects.py - do not edit",
+        " *",
+        " * Source: %s (objects_t, %d fields)" % (source_name, len(names)),
+        " *",
+        " * File: eez_objects.h",
+        " */",
+        "",
+        "#ifndef EEZ_OBJECTS_H",
+        "#define EEZ_OBJECTS_H",
+        "",
+        "#define EEZ_OBJECT_COUNT %d" % len(names),
+        "",
+        "// objects_t field names, in field order",
+        "static const char * const eezObjectNames[EEZ_OBJECT_COUNT] = {",
+    ]
+    for i, name in enumerate(names):
+        lines.append("    %s// %d" % (('"%s",' % name).ljust(width), i))
+    lines += ["};", "", "#endif // EEZ_OBJECTS_H", ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write the objects_t field names of screens.h as a C table")
+    parser.add_argument("screens", help="EEZ generated screens.h")
+    parser.add_argument("output", help="header to write, e.g. eez_objects.h")
+    args = parser.parse_args()
+
+    try:
+        with open(args.screens) as f:
+            names = parse(f.read())
+    except (OSError, ValueError) as e:
+        print("error: %s: %s" % (args.screens, e), file=sys.stderr)
+        return 1
+
+    with open(args.output, "w") as f:
+        f.write(render(names, args.screens))
+    print("%s: %d objects" % (args.output, len(names)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,93 @@
+/*
+ * Host stand-in for the parts of the Arduino core the tested headers use:
+ * Serial, time, delay, critical sections and a few macros. Only for tools/host_tests.cpp and
+ * tools/module_host_check.cpp.
+ *
+ * File: tools/host/Arduino.h
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
+using std::min;
+using std::max;
+
+#define PI 3.1415926535897932384626433832795
+#define IRAM_ATTR
+#define constrain(v, lo, hi) ((v) < (lo) ? (lo) : ((v) > (hi) ? (hi) : (v)))
+
+#define INPUT_PULLUP 0x05
+#define FALLING      0x02
+
+static inline void pinMode(int, int) {}
+static inline int digitalPinToInterrupt(int pin) { return pin; }
+static inline void attachInterrupt(int, void (*)(), int) {}
+
+// FreeRTOS bits touch.h uses from its interrupt handler
+typedef void * TaskHandle_t;
+typedef int BaseType_t;
+#define pdFALSE 0
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+static inline void portYIELD_FROM_ISR() {}
+
+// Critical sections, one host mutex stands in for the spinlocks
+#include <mutex>
+typedef std::recursive_mutex portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->lock()
+#define portEXIT_CRITICAL(mux) (mux)->unlock()
+
+static inline uint32_t esp_random() { return (uint32_t)rand() << 16 ^ (uint32_t)rand(); }
+
+static inline uint32_t millis() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t micros() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// The firmware prints uint32_t with %lu (unsigned long on the ESP32).
+// 32-bit integers are widened so %lu and %u both read the right value
+// on a 64-bit host.
+class HostSerial {
+public:
+    template <typename... Args>
+    void printf(const char * fmt, Args... args) {
+        ::printf(fmt, widen(args)...);
+    }
+    void print(const char * s) { fputs(s, stdout); }
+    void println(const char * s = "") { puts(s); }
+
+private:
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 4 && std::is_signed<T>::value, long>::type
+    widen(T v) { return v; }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 4 && !std::is_signed<T>::value, unsigned long>::type
+    widen(T v) { return v; }
+    template <typename T>
+    static typename std::enable_if<!(std::is_integral<T>::value && sizeof(T) == 4), T>::type
+    widen(T v) { return v; }
+};
+
+static HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
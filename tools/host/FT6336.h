@@ -0,0 +1,36 @@
+/*
+ * Host stand-in for the FT6336 touch controller library. It never
+ * reports a touch; tests feed samples through touch_set_controller().
+ *
+ * File: tools/host/FT6336.h
+ */
+
+#ifndef HOST_FT6336_H
+#define HOST_FT6336_H
+
+#include "Arduino.h"
+
+enum {
+    ROTATION_NORMAL = 0,
+    ROTATION_LEFT,
+    ROTATION_INVERTED,
+    ROTATION_RIGHT
+};
+
+struct FT6336Point {
+    uint16_t x, y;
+};
+
+class FT6336 {
+public:
+    FT6336(int sda, int scl, int irq, int rst, int width, int height) {}
+    void begin() {}
+    void setRotation(int r) {}
+    void read() {}
+
+    bool isTouched = false;
+    uint8_t touches = 0;
+    FT6336Point points[2] = {};
+};
+
+#endif // HOST_FT6336_H
@@ -0,0 +1,25 @@
+/*
+ * Host stand-in for the ESP-IDF capability allocator: every heap is
+ * the C heap, and there is no PSRAM.
+ *
+ * File: tools/host/esp_heap_caps.h
+ */
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_EXEC     (1 << 0)
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+static inline void * heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+static inline void * heap_caps_realloc(void * p, size_t size, uint32_t caps) { return realloc(p, size); }
+static inline void heap_caps_free(void * p) { free(p); }
+
+#endif // HOST_ESP_HEAP_CAPS_H
@@ -0,0 +1,209 @@
+/*
+ * Host stand-in for the LVGL 8 API the host-tested headers touch:
+ * plain objects with a value (labels, bars, sliders), inert events and
+ * timers, and the image decoder hooks. Nothing is drawn.
+ *
+ * File: tools/host/lvgl.h
+ */
+
+#ifndef HOST_LVGL_H
+#define HOST_LVGL_H
+
+#include "Arduino.h"
+
+#define LV_COLOR_DEPTH 16
+#ifndef LV_COLOR_16_SWAP
+#define LV_COLOR_16_SWAP 0
+#endif
+#define LV_UNUSED(x) (void)(x)
+
+// ═══════════════════════════════════════════════════════════════
+// OBJECTS
+// ═══════════════════════════════════════════════════════════════
+
+struct lv_obj_class_t {
+    const char * name;
+};
+
+static const lv_obj_class_t lv_obj_class = { "obj" };
+static const lv_obj_class_t lv_label_class = { "label" };
+static const lv_obj_class_t lv_bar_class = { "bar" };
+static const lv_obj_class_t lv_slider_class = { "slider" };
+static const lv_obj_class_t lv_btn_class = { "btn" };
+
+struct lv_obj_t {
+    const lv_obj_class_t * cls;
+    lv_obj_t * parent;
+    int32_t value;
+    int32_t min, max;
+    uint32_t state;
+    uint32_t flags;
+    char text[64];
+};
+
+#define LV_STATE_CHECKED   0x0001
+#define LV_OBJ_FLAG_HIDDEN 0x0001
+#define LV_ANIM_OFF        0
+
+static inline lv_obj_t * lv_host_obj_create(const lv_obj_class_t * cls, lv_obj_t * parent) {
+    lv_obj_t * obj = (lv_obj_t *)calloc(1, sizeof(lv_obj_t));
+    obj->cls = cls;
+    obj->parent = parent;
+    return obj;
+}
+
+static inline lv_obj_t * lv_layer_top() {
+    static lv_obj_t layer = { &lv_obj_class };
+    return &layer;
+}
+
+static inline lv_obj_t * lv_scr_act() {
+    static lv_obj_t screen = { &lv_obj_class };
+    return &screen;
+}
+
+static inline lv_obj_t * lv_obj_create(lv_obj_t * parent) { return lv_host_obj_create(&lv_obj_class, parent); }
+static inline lv_obj_t * lv_btn_create(lv_obj_t * parent) { return lv_host_obj_create(&lv_btn_class, parent); }
+static inline lv_obj_t * lv_bar_create(lv_obj_t * parent) { return lv_host_obj_create(&lv_bar_class, parent); }
+static inline lv_obj_t * lv_slider_create(lv_obj_t * parent) { return lv_host_obj_create(&lv_slider_class, parent); }
+static inline lv_obj_t * lv_label_create(lv_obj_t * parent) { return lv_host_obj_create(&lv_label_class, parent); }
+static inline void lv_obj_del(lv_obj_t * obj) { free(obj); }
+
+static inline lv_obj_t * lv_obj_get_screen(const lv_obj_t * obj) {
+    while (obj->parent) obj = obj->parent;
+    return (lv_obj_t *)obj;
+}
+static inline bool lv_obj_is_valid(const lv_obj_t * obj) { return obj != NULL; }
+static inline bool lv_obj_check_type(const lv_obj_t * obj, const lv_obj_class_t * cls) { return obj->cls == cls; }
+
+static inline void lv_obj_set_pos(lv_obj_t *, int32_t, int32_t) {}
+static inline void lv_obj_set_size(lv_obj_t *, int32_t, int32_t) {}
+static inline void lv_obj_center(lv_obj_t *) {}
+static inline void lv_obj_add_flag(lv_obj_t * obj, uint32_t f) { obj->flags |= f; }
+static inline void lv_obj_add_state(lv_obj_t * obj, uint32_t s) { obj->state |= s; }
+static inline void lv_obj_clear_state(lv_obj_t * obj, uint32_t s) { obj->state &= ~s; }
+
+static inline void lv_label_set_text(lv_obj_t * obj, const char * text) {
+    strncpy(obj->text, text, sizeof(obj->text) - 1);
+}
+
+static inline void lv_bar_set_range(lv_obj_t * obj, int32_t min, int32_t max) { obj->min = min; obj->max = max; }
+static inline void lv_bar_set_value(lv_obj_t * obj, int32_t v, int) { obj->value = v; }
+static inline int32_t lv_bar_get_value(const lv_obj_t * obj) { return obj->value; }
+static inline void lv_slider_set_value(lv_obj_t * obj, int32_t v, int) { obj->value = v; }
+
+// ═══════════════════════════════════════════════════════════════
+// EVENTS (callbacks are accepted and never sent)
+// ═══════════════════════════════════════════════════════════════
+
+typedef enum {
+    LV_EVENT_ALL = 0,
+    LV_EVENT_CLICKED = 7,
+    LV_EVENT_SCREEN_UNLOADED = 37,
+    LV_EVENT_SCREEN_LOAD_START = 38,
+    LV_EVENT_DELETE = 39,
+} lv_event_code_t;
+
+struct lv_event_t {
+    lv_obj_t * target;
+    lv_event_code_t code;
+    void * user_data;
+};
+
+typedef void (*lv_event_cb_t)(lv_event_t *);
+
+static inline void lv_obj_add_event_cb(lv_obj_t *, lv_event_cb_t, lv_event_code_t, void *) {}
+static inline bool lv_obj_remove_event_cb(lv_obj_t *, lv_event_cb_t) { return false; }
+static inline bool lv_obj_remove_event_cb_with_user_data(lv_obj_t *, lv_event_cb_t, void *) { return false; }
+static inline lv_obj_t * lv_event_get_target(lv_event_t * e) { return e->target; }
+static inline lv_event_code_t lv_event_get_code(lv_event_t * e) { return e->code; }
+static inline void * lv_event_get_user_data(lv_event_t * e) { return e->user_data; }
+
+// ═══════════════════════════════════════════════════════════════
+// TIMERS (never fire, tests call the polled function themselves)
+// ═══════════════════════════════════════════════════════════════
+
+struct lv_timer_t;
+typedef void (*lv_timer_cb_t)(lv_timer_t *);
+
+struct lv_timer_t {
+    lv_timer_cb_t cb;
+    uint32_t period;
+    bool paused;
+};
+
+static inline bool lv_is_initialized() { return true; }
+
+static inline lv_timer_t * lv_timer_create(lv_timer_cb_t cb, uint32_t period, void *) {
+    lv_timer_t * t = (lv_timer_t *)calloc(1, sizeof(lv_timer_t));
+    t->cb = cb;
+    t->period = period;
+    return t;
+}
+
+static inline void lv_timer_pause(lv_timer_t * t) { t->paused = true; }
+static inline void lv_timer_resume(lv_timer_t * t) { t->paused = false; }
+
+// ═══════════════════════════════════════════════════════════════
+// IMAGES
+// ═══════════════════════════════════════════════════════════════
+
+enum {
+    LV_IMG_CF_RAW = 1,
+    LV_IMG_CF_TRUE_COLOR = 4,
+    LV_IMG_CF_ALPHA_8BIT = 14,
+};
+
+enum {
+    LV_IMG_SRC_VARIABLE = 0,
+    LV_IMG_SRC_FILE,
+};
+
+typedef enum {
+    LV_RES_INV = 0,
+    LV_RES_OK
+} lv_res_t;
+
+typedef struct {
+    uint32_t cf : 5;
+    uint32_t always_zero : 3;
+    uint32_t reserved : 2;
+    uint32_t w : 11;
+    uint32_t h : 11;
+} lv_img_header_t;
+
+typedef struct {
+    lv_img_header_t header;
+    uint32_t data_size;
+    const uint8_t * data;
+} lv_img_dsc_t;
+
+typedef struct {
+    const void * src;
+    uint8_t src_type;
+    const uint8_t * img_data;
+    void * user_data;
+    uint32_t time_to_open;
+} lv_img_decoder_dsc_t;
+
+struct lv_img_decoder_t;
+typedef lv_res_t (*lv_img_decoder_info_f_t)(lv_img_decoder_t *, const void *, lv_img_header_t *);
+typedef lv_res_t (*lv_img_decoder_open_f_t)(lv_img_decoder_t *, lv_img_decoder_dsc_t *);
+typedef void (*lv_img_decoder_close_f_t)(lv_img_decoder_t *, lv_img_decoder_dsc_t *);
+
+struct lv_img_decoder_t {
+    lv_img_decoder_info_f_t info_cb;
+    lv_img_decoder_open_f_t open_cb;
+    lv_img_decoder_close_f_t close_cb;
+};
+
+// One decoder, the tests reach its callbacks through lv_host_img_decoder
+static lv_img_decoder_t lv_host_img_decoder;
+
+static inline lv_img_decoder_t * lv_img_decoder_create() { return &lv_host_img_decoder; }
+static inline void lv_img_decoder_set_info_cb(lv_img_decoder_t * d, lv_img_decoder_info_f_t cb) { d->info_cb = cb; }
+static inline void lv_img_decoder_set_open_cb(lv_img_decoder_t * d, lv_img_decoder_open_f_t cb) { d->open_cb = cb; }
+static inline void lv_img_decoder_set_close_cb(lv_img_decoder_t * d, lv_img_decoder_close_f_t cb) { d->close_cb = cb; }
+static inline uint8_t lv_img_src_get_type(const void *) { return LV_IMG_SRC_VARIABLE; }
+
+#endif // HOST_LVGL_H
@@ -0,0 +1,137 @@
+/*
+ * Host tests
+ *
+ * Runs the self-tests whose logic does not need the board, against the
+ * stand-ins in tools/host/. Checks that need the panel, the card or
+ * PSRAM run on the device, see device_checks.h.
+ *
+ *   g++ -std=gnu++17 -O1 -Itools/host -I. tools/host_tests.cpp -o host_tests -pthread
+ *   ./host_tests            run everything
+ *   ./host_tests touch      run one test
+ *
+ * Exits with 1 when any check failed.
+ *
+ * File: tools/host_tests.cpp
+ */
+
+#include <Arduino.h>
+#include <unistd.h>
+#include "touch.h"
+#include "touch_gestures.h"
+#include "touch_calibration.h"
+#include "task_model.h"
+#include "kv_parser.h"
+#include "app_vm.h"
+#include "widget_registry.h"
+#include "settings_log.h"
+#include "backlight.h"
+#include "radio_manager.h"
+#include "image_assets.h"
+#include "bg.h"
+
+// Defined by the generated screens.c and images.c on the device
+objects_t objects;
+const ext_img_desc_t images[1] = {
+    { "bg", &img_bg },
+};
+
+struct HostTest {
+    const char * name;
+    uint32_t (*run)();      // Returns the number of failures
+};
+
+// ═══════════════════════════════════════════════════════════════
+// TESTS
+// ═══════════════════════════════════════════════════════════════
+
+static uint32_t host_test_touch() {
+    touch_init(320, 240, ROTATION_LEFT);
+    return runTouchReplayTest();
+}
+
+static uint32_t host_test_gestures() {
+    gestures_init();
+    return runGestureReplayTest();
+}
+
+static uint32_t host_test_calibration() {
+    touch_init(320, 240, ROTATION_LEFT);
+    return runTouchCalibrationBenchmark();
+}
+
+static uint32_t host_test_tasks() {
+    return runTaskModelAppLoopTest() + runTaskModelStressTest();
+}
+
+static uint32_t host_test_kv() {
+    return runKvParserTest();
+}
+
+static uint32_t host_test_vm() {
+    return runVmBenchmark();
+}
+
+static uint32_t host_test_widgets() {
+    return runWidgetRegistryTest();
+}
+
+static uint32_t host_test_settings() {
+    return runSettingsReplayTest();
+}
+
+// No pin here, so init leaves the mock backend in place
+static uint32_t host_test_backlight() {
+    backlight_init(128);
+    return runBacklightFadeTest();
+}
+
+// The simulated radios run on the worker thread, main() is the UI task
+static uint32_t host_test_radio() {
+    return runRadioManagerTest();
+}
+
+static uint32_t host_test_images() {
+    return runImageAssetDecodeTest();
+}
+
+static const HostTest hostTests[] = {
+    { "touch", host_test_touch },
+    { "gestures", host_test_gestures },
+    { "calibration", host_test_calibration },
+    { "tasks", host_test_tasks },
+    { "kv", host_test_kv },
+    { "vm", host_test_vm },
+    { "widgets", host_test_widgets },
+    { "settings", host_test_settings },
+    { "backlight", host_test_backlight },
+    { "radio", host_test_radio },
+    { "images", host_test_images },
+};
+
+// ═══════════════════════════════════════════════════════════════
+// DRIVER
+// ═══════════════════════════════════════════════════════════════
+
+int main(int argc, char ** argv) {
+    const char * only = argc > 1 ? argv[1] : NULL;
+    initTaskModel();
+    uint32_t failures = 0, ran = 0;
+
+    for (const HostTest & test : hostTests) {
+        if (only && strcmp(only, test.name) != 0) continue;
+        printf("\n--- %s ---\n", test.name);
+        failures += test.run();
+        ran++;
+    }
+    if (!ran) {
+        fprintf(stderr, "no test called %s\n", only);
+        fflush(stdout);
+        _exit(2);
+    }
+    printf("\nHost tests: %u run, %u failures\n", ran, failures);
+
+    // The worker thread never returns, skip the static destructors of
+    // the queues it is blocked on
+    fflush(stdout);
+    _exit(failures ? 1 : 0);
+}
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+App Icon Atlas tool
+
+Builds and checks /apps/.icons.atlas on a mounted SD card, in the same
+format icon_atlas.h builds on the device. Use it for icons the device
+cannot decode itself (PNG, JPEG, ...); any format Pillow reads works.
+build and --dump need Pillow, a plain verify does not.
+
+    python3 tools/icon_atlas.py build  /media/sdcard
+    python3 tools/icon_atlas.py verify /media/sdcard [--dump out_dir]
+
+The signature covers the icon paths and file sizes, so the device keeps
+an atlas built here as long as the icons on the card do not change.
+
+File: tools/icon_atlas.py
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+ATLAS_PATH = "/apps/.icons.atlas"
+MAGIC = 0x31414349          # "ICA1"
+VERSION = 1
+ICON_SIZE = 40
+ICON_BYTES = ICON_SIZE * ICON_SIZE * 2
+ATLAS_MAX = 64
+KV_LINE_MAX = 128           # kv_parser.h
+ENTRY_ICON_MAX = 47         # AppIndexEntry.icon[48] in app_index.h
+APP_ICON_MAX = 63           # AppEntry.icon[64] in app_registry.h
+BG_COLOR = (0xF8, 0xF8, 0xF8)
+PLACEHOLDER = (0x21, 0x96, 0xF3)
+
+HEADER = struct.Struct("<IHHHHI")
+ENTRY = struct.Struct("<II")
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def parse_app_file(path):
+    """Same rules as KvParser: trimmed lines, '#' comments, key=value."""
+    app = {"name": "", "icon": "", "codefile": "", "enabled": True}
+    with open(path, "rb") as f:
+        for raw in f.read().split(b"\n"):
+            if len(raw) >= KV_LINE_MAX:
+                continue
+            line = raw.strip(b" \t\r")
+            if not line or line.startswith(b"#") or b"=" not in line:
+                continue
+            key, raw = line.split(b"=", 1)
+            value = raw.decode("utf-8", "replace")
+            if key == b"name":
+                app["name"] = value
+            elif key == b"codefile":
+                app["codefile"] = value
+            elif key == b"enabled":
+                app["enabled"] = value == "true"
+            elif key == b"icon":
+                # The index keeps 47 bytes, the registry then adds "/apps/"
+                icon = raw[:ENTRY_ICON_MAX]
+                icon = (icon if icon.startswith(b"/") else b"/apps/" + icon)[:APP_ICON_MAX]
+                app["icon"] = icon.decode("utf-8", "replace")
+    return app
+
+
+def wanted_icons(root):
+    """Unique icon paths of the apps in the registry (app_registry.h)."""
+    apps_dir = os.path.join(root, "apps")
+    icons = []
+    for name in sorted(os.listdir(apps_dir)):
+        full = os.path.join(apps_dir, name)
+        manifest = name.endswith(".manifest") and len(name) > 9
+        descriptor = name.endswith(".app") and len(name) > 4
+        if not (manifest or descriptor) or os.path.isdir(full):
+            continue
+        app = parse_app_file(full)
+        if not app["name"] or not app["enabled"] or (manifest and not app["codefile"]):
+            continue
+        if app["icon"] and app["icon"] not in icons and len(icons) < ATLAS_MAX:
+            icons.append(app["icon"])
+    return icons
+
+
+def sd_file(root, path):
+    return os.path.join(root, path.lstrip("/"))
+
+
+def signature(root, icons):
+    sig = fnv1a(b"icons") ^ len(icons)
+    for path in icons:
+        try:
+            size = os.path.getsize(sd_file(root, path))
+        except OSError:
+            size = 0
+        h = fnv1a(path.encode())
+        sig = (sig + ((h ^ size) * 2654435761)) & 0xFFFFFFFF
+    return sig
+
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def require_pillow():
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit("Pillow is required for this command: pip install Pillow")
+    return Image
+
+
+def encode_icon(root, path):
+    Image = require_pillow()
+
+    try:
+        img = Image.open(sd_file(root, path)).convert("RGBA")
+    except (OSError, ValueError) as e:
+        print(f"  {path}: {e}, using placeholder", file=sys.stderr)
+        return struct.pack("<H", rgb565(*PLACEHOLDER)) * (ICON_SIZE * ICON_SIZE)
+
+    img = img.resize((ICON_SIZE, ICON_SIZE), Image.LANCZOS)
+    bg = Image.new("RGBA", img.size, BG_COLOR + (255,))
+    img = Image.alpha_composite(bg, img).convert("RGB")
+    return b"".join(struct.pack("<H", rgb565(*px)) for px in img.getdata())
+
+
+def build(root):
+    require_pillow()
+    icons = wanted_icons(root)
+    keys = sorted((fnv1a(p.encode()), p) for p in icons)
+    data_start = HEADER.size + len(keys) * ENTRY.size
+
+    out = bytearray(HEADER.pack(MAGIC, VERSION, len(keys), ICON_SIZE, ICON_SIZE, signature(root, icons)))
+    for i, (key, _) in enumerate(keys):
+        out += ENTRY.pack(key, data_start + i * ICON_BYTES)
+    for _, path in keys:
+        out += encode_icon(root, path)
+
+    dst = sd_file(root, ATLAS_PATH)
+    tmp = dst + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(out)
+    os.replace(tmp, dst)
+    print(f"Wrote {dst}: {len(keys)} icons, {len(out)} bytes")
+    return 0
+
+
+def verify(root, dump_dir=None):
+    path = sd_file(root, ATLAS_PATH)
+    if dump_dir:
+        require_pillow()
+    try:
+        with open(path, "rb") as f:
+            data = f.read()
+    except OSError as e:
+        print(f"{path}: {e.strerror}")
+        return 1
+
+    errors = []
+    if len(data) < HEADER.size:
+        print(f"{path}: truncated header")
+        return 1
+    magic, version, count, w, h, sig = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        errors.append(f"bad magic {magic:#x}")
+    if version != VERSION:
+        errors.append(f"version {version}, expected {VERSION}")
+    if (w, h) != (ICON_SIZE, ICON_SIZE):
+        errors.append(f"icon size {w}x{h}, expected {ICON_SIZE}x{ICON_SIZE}")
+    if count > ATLAS_MAX:
+        errors.append(f"{count} icons, device limit is {ATLAS_MAX}")
+
+    data_start = HEADER.size + count * ENTRY.size
+    entries = [ENTRY.unpack_from(data, HEADER.size + i * ENTRY.size) for i in range(count)]
+    if [k for k, _ in entries] != sorted(k for k, _ in entries):
+        errors.append("entries not sorted by key")
+    for i, (key, offset) in enumerate(entries):
+        if offset != data_start + i * ICON_BYTES:
+            errors.append(f"entry {i} ({key:#010x}) at offset {offset}")
+    if len(data) != data_start + count * ICON_BYTES:
+        errors.append(f"file is {len(data)} bytes, expected {data_start + count * ICON_BYTES}")
+
+    icons = wanted_icons(root)
+    expected = signature(root, icons)
+    if sig != expected:
+        errors.append(f"stale: signature {sig:#010x}, icons on card give {expected:#010x}")
+    present = {k for k, _ in entries}
+    for p in icons:
+        if fnv1a(p.encode()) not in present:
+            errors.append(f"missing icon {p}")
+
+    if dump_dir and not errors:
+        Image = require_pillow()
+
+        os.makedirs(dump_dir, exist_ok=True)
+        names = {fnv1a(p.encode()): p for p in icons}
+        for key, offset in entries:
+            img = Image.new("RGB", (ICON_SIZE, ICON_SIZE))
+            px = struct.unpack_from(f"<{ICON_SIZE * ICON_SIZE}H", data, offset)
+            img.putdata([((v >> 8) & 0xF8, (v >> 3) & 0xFC, (v << 3) & 0xF8) for v in px])
+            name = os.path.basename(names.get(key, f"{key:08x}"))
+            img.save(os.path.join(dump_dir, os.path.splitext(name)[0] + ".png"))
+
+    for e in errors:
+        print(f"{path}: {e}")
+    if not errors:
+        print(f"{path}: OK, {count} icons")
+    return 1 if errors else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build or verify the launcher icon atlas")
+    parser.add_argument("command", choices=["build", "verify"])
+    parser.add_argument("sd_root", help="Mounted SD card (the directory containing apps/)")
+    parser.add_argument("--dump", metavar="DIR", help="verify: write every icon as PNG")
+    args = parser.parse_args()
+
+    if args.command == "build":
+        return build(args.sd_root)
+    return verify(args.sd_root, args.dump)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,396 @@
+#!/usr/bin/env python3
+"""
+Image asset tool
+
+Turns a source image into a display-sized, compressed LVGL image that
+image_assets.h decodes on the device (once, into a PSRAM cache).
+
+    python3 tools/image_asset.py convert assets/bg_1920x1080.h bg.h --name img_bg
+    python3 tools/image_asset.py bench   assets/bg_1920x1080.h [more sources...]
+
+Sources are LVGL image converter C arrays (ALPHA_1/2/4/8BIT, 16-bit
+TRUE_COLOR) or, with Pillow installed, any image file Pillow reads.
+Images are scaled down to fit the panel (aspect kept, never enlarged)
+with an area average, so thin lines turn into soft alpha instead of
+disappearing.
+
+Formats: alpha sources become A8 (drawn in the image's recolor, like
+LVGL's alpha formats), colour sources RGB565.
+
+LIMG stream (after a 16 byte header, see image_assets.h), ops over
+pixels (u8 for A8, little-endian u16 for RGB565):
+    00nnnnnn            run of n+1 copies of the previous pixel
+    01iiiiii            pixel from the 64 entry table of recent pixels
+    10nnnnnn <pixels>   n+1 literal pixels
+    11nnnnnn nnnnnnnn   run of n+65 copies of the previous pixel
+Literal and table pixels become the previous pixel and go into the
+table at hash(px) = (px * 0x9E3779B1 mod 2^32) >> 26.
+
+`bench` prints flash size per stage. Decode time is a device figure,
+see runImageAssetBenchmark() in image_assets.h.
+
+File: tools/image_asset.py
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+
+MAGIC = 0x474D494C          # "LIMG"
+VERSION = 1
+FORMAT_RGB565 = 0
+FORMAT_A8 = 1
+FORMAT_NAMES = {FORMAT_RGB565: "RGB565", FORMAT_A8: "A8"}
+HEADER = struct.Struct("<IBBHHHI")
+PANEL_W = 320
+PANEL_H = 240
+
+OP_RUN = 0x00
+OP_INDEX = 0x40
+OP_LITERAL = 0x80
+OP_LONG_RUN = 0xC0
+RUN_MAX = 64
+LONG_RUN_MAX = 64 + (1 << 14)
+
+
+class Image:
+    """Pixels row-major: ints 0..255 (alpha) or (r, g, b) tuples."""
+
+    def __init__(self, w, h, pixels, alpha, desc, flash_bytes):
+        self.w, self.h, self.pixels, self.alpha = w, h, pixels, alpha
+        self.desc = desc
+        self.flash_bytes = flash_bytes
+
+
+# ═══════════════════════════════════════════════════════════════
+# SOURCES
+# ═══════════════════════════════════════════════════════════════
+
+def load_lvgl_array(path):
+    with open(path, "r", errors="replace") as f:
+        text = f.read()
+
+    def field(name):
+        m = re.search(r"\.header\." + name + r"\s*=\s*(\w+)", text)
+        if not m:
+            raise ValueError(f"{path}: no .header.{name}")
+        return m.group(1)
+
+    cf = field("cf")
+    w, h = int(field("w")), int(field("h"))
+    m = re.search(r"\w+_map\[\]\s*=\s*\{(.*?)\};", text, re.S)
+    if not m:
+        raise ValueError(f"{path}: no pixel array")
+    data = bytes(int(v, 16) for v in re.findall(r"0x([0-9a-fA-F]{1,2})", m.group(1)))
+
+    bits = {"LV_IMG_CF_ALPHA_1BIT": 1, "LV_IMG_CF_ALPHA_2BIT": 2,
+            "LV_IMG_CF_ALPHA_4BIT": 4, "LV_IMG_CF_ALPHA_8BIT": 8}.get(cf)
+    pixels = []
+    if bits:
+        stride = (w * bits + 7) // 8
+        if len(data) < stride * h:
+            raise ValueError(f"{path}: {len(data)} bytes, {cf} {w}x{h} needs {stride * h}")
+        top = (1 << bits) - 1
+        per_byte = 8 // bits
+        for y in range(h):
+            row = data[y * stride:(y + 1) * stride]
+            for x in range(w):
+                v = (row[x // per_byte] >> (8 - bits * (x % per_byte + 1))) & top
+                pixels.append(v * 255 // top)
+        alpha = True
+    elif cf == "LV_IMG_CF_TRUE_COLOR":
+        if len(data) < w * h * 2:
+            raise ValueError(f"{path}: only 16-bit TRUE_COLOR arrays are supported")
+        for i in range(w * h):
+            v = data[2 * i] | (data[2 * i + 1] << 8)
+            pixels.append(((v >> 8) & 0xF8, (v >> 3) & 0xFC, (v << 3) & 0xF8))
+        alpha = False
+    else:
+        raise ValueError(f"{path}: colour format {cf} not supported")
+    return Image(w, h, pixels, alpha, f"{w}x{h} {cf[10:]}", len(data))
+
+
+def load_image_file(path):
+    from PIL import Image as PILImage
+
+    img = PILImage.open(path)
+    if img.mode in ("L", "1", "LA") and img.mode != "LA":
+        img = img.convert("L")
+        pixels, alpha = list(img.getdata()), True
+    else:
+        img = img.convert("RGB")
+        pixels, alpha = list(img.getdata()), False
+    return Image(img.width, img.height, pixels, alpha,
+                 f"{img.width}x{img.height} {img.mode}", os.path.getsize(path))
+
+
+def load_source(path):
+    if path.endswith((".h", ".c")):
+        return load_lvgl_array(path)
+    return load_image_file(path)
+
+
+# ═══════════════════════════════════════════════════════════════
+# RESAMPLE
+# ═══════════════════════════════════════════════════════════════
+
+def fit_size(w, h, max_w, max_h):
+    scale = min(max_w / w, max_h / h, 1.0)
+    return max(1, round(w * scale)), max(1, round(h * scale))
+
+
+def resample(img, out_w, out_h):
+    """Area average: each output pixel is the mean of the source pixels it covers."""
+    if (out_w, out_h) == (img.w, img.h):
+        return img
+    channels = 1 if img.alpha else 3
+    col_bin = [x * out_w // img.w for x in range(img.w)]
+    col_count = [0] * out_w
+    for b in col_bin:
+        col_count[b] += 1
+
+    out = []
+    src_y = 0
+    for oy in range(out_h):
+        y_end = (oy + 1) * img.h // out_h
+        rows = y_end - src_y
+        acc = [[0] * out_w for _ in range(channels)]
+        for y in range(src_y, y_end):
+            row = img.pixels[y * img.w:(y + 1) * img.w]
+            if img.alpha:
+                a = acc[0]
+                for x, v in enumerate(row):
+                    a[col_bin[x]] += v
+            else:
+                for x, (r, g, b) in enumerate(row):
+                    c = col_bin[x]
+                    acc[0][c] += r
+                    acc[1][c] += g
+                    acc[2][c] += b
+        src_y = y_end
+        for ox in range(out_w):
+            n = col_count[ox] * rows
+            if img.alpha:
+                out.append((acc[0][ox] + n // 2) // n)
+            else:
+                out.append(tuple((acc[c][ox] + n // 2) // n for c in range(3)))
+    return Image(out_w, out_h, out, img.alpha, img.desc, img.flash_bytes)
+
+
+# ═══════════════════════════════════════════════════════════════
+# CODEC
+# ═══════════════════════════════════════════════════════════════
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def to_units(img, fmt):
+    if fmt == FORMAT_A8:
+        if img.alpha:
+            return list(img.pixels)
+        return [(r * 77 + g * 150 + b * 29) >> 8 for r, g, b in img.pixels]
+    if img.alpha:
+        return [rgb565(v, v, v) for v in img.pixels]
+    return [rgb565(*p) for p in img.pixels]
+
+
+def px_hash(px):
+    return ((px * 0x9E3779B1) & 0xFFFFFFFF) >> 26
+
+
+def encode(units, fmt):
+    unit = struct.Struct("<B" if fmt == FORMAT_A8 else "<H")
+    out = bytearray()
+    table = [0] * 64
+    prev = 0
+    i, n = 0, len(units)
+    while i < n:
+        run = 0
+        while i + run < n and units[i + run] == prev and run < LONG_RUN_MAX:
+            run += 1
+        if run:
+            if run <= RUN_MAX:
+                out.append(OP_RUN | (run - 1))
+            else:
+                v = run - 65
+                out += bytes((OP_LONG_RUN | (v >> 8), v & 0xFF))
+            i += run
+            continue
+
+        px = units[i]
+        h = px_hash(px)
+        if table[h] == px:
+            out.append(OP_INDEX | h)
+            prev = px
+            i += 1
+            continue
+
+        # Literals until a run or a table hit would be cheaper
+        start = i
+        while i < n and i - start < RUN_MAX:
+            px = units[i]
+            if i > start and (px == prev or table[px_hash(px)] == px):
+                break
+            table[px_hash(px)] = px
+            prev = px
+            i += 1
+        out.append(OP_LITERAL | (i - start - 1))
+        for px in units[start:i]:
+            out += unit.pack(px)
+    return bytes(out)
+
+
+def decode(data):
+    magic, version, fmt, w, h, _, raw = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a LIMG v1 stream")
+    size = 1 if fmt == FORMAT_A8 else 2
+    units = []
+    table = [0] * 64
+    prev = 0
+    pos = HEADER.size
+    total = w * h
+    while len(units) < total:
+        op = data[pos]
+        pos += 1
+        tag = op & 0xC0
+        if tag == OP_RUN:
+            units += [prev] * ((op & 0x3F) + 1)
+        elif tag == OP_LONG_RUN:
+            units += [prev] * ((((op & 0x3F) << 8) | data[pos]) + 65)
+            pos += 1
+        elif tag == OP_INDEX:
+            prev = table[op & 0x3F]
+            units.append(prev)
+        else:
+            for _ in range((op & 0x3F) + 1):
+                prev = data[pos] if size == 1 else data[pos] | (data[pos + 1] << 8)
+                pos += size
+                table[px_hash(prev)] = prev
+                units.append(prev)
+    if len(units) != total or pos != len(data):
+        raise ValueError("stream length mismatch")
+    return w, h, fmt, units
+
+
+def build_asset(img, fmt, max_w, max_h):
+    out_w, out_h = fit_size(img.w, img.h, max_w, max_h)
+    small = resample(img, out_w, out_h)
+    units = to_units(small, fmt)
+    raw_bytes = len(units) * (1 if fmt == FORMAT_A8 else 2)
+    stream = encode(units, fmt)
+    blob = HEADER.pack(MAGIC, VERSION, fmt, out_w, out_h, 0, raw_bytes) + stream
+    if decode(blob)[3] != units:
+        raise AssertionError("round trip failed")
+    return small, units, raw_bytes, blob
+
+
+def pick_format(img, name):
+    if name == "auto":
+        return FORMAT_A8 if img.alpha else FORMAT_RGB565
+    return FORMAT_A8 if name == "a8" else FORMAT_RGB565
+
+
+# ═══════════════════════════════════════════════════════════════
+# COMMANDS
+# ═══════════════════════════════════════════════════════════════
+
+def write_header(path, name, src_path, img, small, fmt, raw_bytes, blob):
+    base = os.path.basename(path)
+    guard = re.sub(r"\W", "_", base).upper()
+    lines = [
+        "/*",
+        f" * Image asset {name}, generated by tools/image_asset.py - do not edit",
+        " *",
+        f" * Source: {src_path} ({img.desc}, {img.flash_bytes} bytes)",
+        f" * Output: {small.w}x{small.h} {FORMAT_NAMES[fmt]}, LIMG {len(blob)} bytes "
+        f"({raw_bytes} decoded), see image_assets.h",
+        " *",
+        f" * File: {base}",
+        " */",
+        "",
+        f"#ifndef {guard}",
+        f"#define {guard}",
+        "",
+        "#include <lvgl.h>",
+        '#include "images.h"',
+        "",
+        "#ifndef LV_ATTRIBUTE_LARGE_CONST",
+        "#define LV_ATTRIBUTE_LARGE_CONST",
+        "#endif",
+        "",
+        f"static const LV_ATTRIBUTE_LARGE_CONST uint8_t {name}_limg[{len(blob)}] = {{",
+    ]
+    for i in range(0, len(blob), 16):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in blob[i:i + 16]) + ",")
+    lines += [
+        "};",
+        "",
+        "// LV_IMG_CF_RAW: the LIMG decoder in image_assets.h reports the real format",
+        f"const lv_img_dsc_t {name} = {{",
+        f"    {{ LV_IMG_CF_RAW, 0, 0, {small.w}, {small.h} }},",
+        f"    sizeof({name}_limg),",
+        f"    {name}_limg,",
+        "};",
+        "",
+        f"#endif // {guard}",
+        "",
+    ]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def convert(args):
+    img = load_source(args.source)
+    fmt = pick_format(img, args.format)
+    small, _, raw_bytes, blob = build_asset(img, fmt, args.width, args.height)
+    write_header(args.output, args.name, args.source, img, small, fmt, raw_bytes, blob)
+    print(f"{args.output}: {args.name} {small.w}x{small.h} {FORMAT_NAMES[fmt]}, "
+          f"{img.flash_bytes} -> {len(blob)} bytes of flash")
+    return 0
+
+
+def bench(args):
+    print(f"{'source':32} {'original':>18} {'resized':>18} {'raw':>9} {'LIMG':>9} {'ratio':>6} {'encode':>8}")
+    for path in args.sources:
+        img = load_source(path)
+        fmt = pick_format(img, args.format)
+        start = time.perf_counter()
+        small, _, raw_bytes, blob = build_asset(img, fmt, args.width, args.height)
+        ms = (time.perf_counter() - start) * 1000
+        print(f"{os.path.basename(path):32} {img.desc:>18} "
+              f"{f'{small.w}x{small.h} {FORMAT_NAMES[fmt]}':>18} {raw_bytes:>9} {len(blob):>9} "
+              f"{raw_bytes / len(blob):>5.1f}x {ms:>6.0f}ms")
+        print(f"{'':32} flash {img.flash_bytes} -> {len(blob)} bytes "
+              f"({100 - len(blob) * 100 / img.flash_bytes:.1f}% smaller)")
+    print("Decode time: runImageAssetBenchmark() on the device")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build display-sized, LIMG compressed LVGL images")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    c = sub.add_parser("convert", help="write a C header with the compressed image")
+    c.add_argument("source", help="LVGL C array (.h/.c) or an image file (needs Pillow)")
+    c.add_argument("output", help="header to write, e.g. bg.h")
+    c.add_argument("--name", required=True, help="lv_img_dsc_t symbol, e.g. img_bg")
+
+    b = sub.add_parser("bench", help="flash size per stage for one or more sources")
+    b.add_argument("sources", nargs="+")
+
+    for p in (c, b):
+        p.add_argument("--width", type=int, default=PANEL_W, help="fit inside this width")
+        p.add_argument("--height", type=int, default=PANEL_H, help="fit inside this height")
+        p.add_argument("--format", choices=["auto", "a8", "rgb565"], default="auto")
+
+    args = parser.parse_args()
+    return convert(args) if args.command == "convert" else bench(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,34 @@
+/*
+ * Stand-in native app for the module loader host check
+ *
+ * Built as an i386 object, it exercises what a real app needs from the
+ * loader: calls into the firmware (R_386_PC32), a firmware variable and
+ * pointers into rodata, data and code (R_386_32), data and bss.
+ *
+ *   gcc -m32 -c -O1 -fno-pic -fno-common tools/module_host_app.c -o app.o
+ *
+ * File: tools/module_host_app.c
+ */
+
+extern void host_report(const char * key, int value);
+extern int host_scale;
+
+static int ticks;                       /* .bss */
+int base = 40;                          /* .data */
+const char * names[] = { "setup", "loop", "cleanup" };     /* Pointers into rodata */
+
+static int twice(int v) { return v * 2; }
+int (* volatile op)(int) = twice;       /* Function pointer, not inlined */
+
+void app_setup(void) {
+    host_report(names[0], op(base + 1) * host_scale);
+}
+
+void app_loop(void) {
+    ticks++;
+    host_report(names[1], ticks);
+}
+
+void app_cleanup(void) {
+    host_report(names[2], ticks + base);
+}
@@ -0,0 +1,43 @@
+/*
+ * Native module loader host check
+ *
+ * Loads an i386 stand-in module (tools/module_host_app.c) through
+ * ModuleMemory and a host export table, then runs its entry points.
+ * See runNativeModuleHostCheck() in native_module_loader.h.
+ *
+ *   gcc -m32 -c -O1 -fno-pic -fno-common tools/module_host_app.c -o app.o
+ *   g++ -m32 -Itools/host -I. tools/module_host_check.cpp -o module_host_check
+ *   ./module_host_check app.o
+ *
+ * File: tools/module_host_check.cpp
+ */
+
+#include <Arduino.h>
+#include "native_module_loader.h"
+
+int main(int argc, char ** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s module.o\n", argv[0]);
+        return 2;
+    }
+
+    FILE * f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 2;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t * object = (uint8_t *)malloc(size);
+    bool ok = object && fread(object, 1, size, f) == (size_t)size;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+
+    uint32_t failures = runNativeModuleHostCheck(object, (uint32_t)size);
+    free(object);
+    return failures ? 1 : 0;
+}
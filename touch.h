@@ -1,4 +1,9 @@
+#ifndef TOUCH_H
+#define TOUCH_H
+
 #include <FT6336.h>
+#include <atomic>
+#include "test_check.h"
 
  #define TOUCH_FT6336
  #define TOUCH_FT6336_SCL 15
@@ -10,14 +15,292 @@
  #define TOUCH_MAP_Y1 0
  #define TOUCH_MAP_Y2 320
 
+// Sample queue between the controller reader and LVGL (power of two)
+#define TOUCH_QUEUE_SIZE 16
+// While a finger is down the INT line stays asserted, poll at this rate
+#define TOUCH_ACTIVE_POLL_MS 8
+
+// Jitter filter applied to mapped points (constant time per sample)
+#define TOUCH_FILTER_NONE     0
+#define TOUCH_FILTER_MEDIAN3  1
+#define TOUCH_FILTER_ONE_EURO 2
+#ifndef TOUCH_FILTER
+#define TOUCH_FILTER TOUCH_FILTER_ONE_EURO
+#endif
+
+// 1-euro filter tuning: lower MIN_CUTOFF = less jitter at rest,
+// higher BETA = less lag when moving fast
+#define TOUCH_EURO_MIN_CUTOFF 1.0f   // Hz
+#define TOUCH_EURO_BETA       0.01f
+#define TOUCH_EURO_D_CUTOFF   1.0f   // Hz
+
+// One controller read, already mapped to screen coordinates
+struct TouchSample {
+  uint32_t time;      // millis() when the controller was read
+  uint8_t count;      // Number of points, 0 = released
+  int16_t x[2];
+  int16_t y[2];
+};
+
+// Reads raw points from the controller, returns false on bus error.
+// Defaults to the FT6336, a host build can plug in a fake controller.
+typedef bool (*TouchControllerRead)(TouchSample *raw);
+
+// Sees every mapped sample as it is produced (e.g. the gesture engine)
+typedef void (*TouchSampleListener)(const TouchSample &s);
+
+// Raw controller point -> screen point, 16.16 fixed point:
+//   x' = (a*x + b*y + c) >> 16
+//   y' = (d*x + e*y + f) >> 16
+struct TouchTransform {
+  int32_t a, b, c;
+  int32_t d, e, f;
+};
+
+// One transform per controller rotation (ROTATION_NORMAL..ROTATION_RIGHT)
+#define TOUCH_ROTATIONS 4
+
+// User calibration per rotation, filled by touch_calibration.h before touch_init
+TouchTransform touch_cal[TOUCH_ROTATIONS];
+bool touch_cal_valid[TOUCH_ROTATIONS] = {false, false, false, false};
+
 int touch_last_x = 0, touch_last_y = 0;
 unsigned short int width=0, height=0, rotation,min_x=0,max_x=0,min_y=0,max_y=0;
 
 FT6336 ts = FT6336(TOUCH_FT6336_SDA, TOUCH_FT6336_SCL, TOUCH_FT6336_INT, TOUCH_FT6336_RST, max(TOUCH_MAP_X1, TOUCH_MAP_X2), max(TOUCH_MAP_Y1, TOUCH_MAP_Y2));
 
+// Set from the INT line, cleared when the controller has been read
+static volatile bool touch_irq_pending = false;
+static bool touch_down = false;
+static uint32_t touch_last_read = 0;
+static uint32_t touch_dropped = 0;
+
+// Last unmapped point, used while capturing a calibration
+int16_t touch_raw_x = 0, touch_raw_y = 0;
+
+// Transforms precomputed in touch_init, one per rotation
+static TouchTransform touch_xform[TOUCH_ROTATIONS];
+static const TouchTransform *touch_active_xform = &touch_xform[0];
+
+// Single producer (touch_service) / single consumer (LVGL read callback)
+static TouchSample touch_queue[TOUCH_QUEUE_SIZE];
+static std::atomic<uint32_t> touch_queue_head(0);  // Next slot to read
+static std::atomic<uint32_t> touch_queue_tail(0);  // Next slot to write
+
+static bool ft6336_read(TouchSample *raw)
+{
+  ts.read();
+  raw->count = 0;
+  if (ts.isTouched) raw->count = (ts.touches > 1) ? 2 : 1;
+  for (uint8_t i = 0; i < raw->count; i++) {
+    raw->x[i] = ts.points[i].x;
+    raw->y[i] = ts.points[i].y;
+  }
+  return true;
+}
+
+static TouchControllerRead touch_controller_read = ft6336_read;
+
+void touch_set_controller(TouchControllerRead reader)
+{
+  touch_controller_read = reader ? reader : ft6336_read;
+}
+
+static TouchSampleListener touch_listener = NULL;
+
+void touch_set_listener(TouchSampleListener listener)
+{
+  touch_listener = listener;
+}
+
+// Task woken by the touch interrupt (set by the loop scheduler)
+TaskHandle_t touch_notify_task = NULL;
+
+static void IRAM_ATTR touch_isr()
+{
+  touch_irq_pending = true;
+  if (touch_notify_task) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(touch_notify_task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SAMPLE QUEUE
+// ═══════════════════════════════════════════════════════════════
+
+static bool touch_queue_push(const TouchSample &s)
+{
+  uint32_t tail = touch_queue_tail.load(std::memory_order_relaxed);
+  uint32_t head = touch_queue_head.load(std::memory_order_acquire);
+  if (tail - head == TOUCH_QUEUE_SIZE) {
+    touch_dropped++;
+    return false;
+  }
+  touch_queue[tail & (TOUCH_QUEUE_SIZE - 1)] = s;
+  touch_queue_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+bool touch_queue_pop(TouchSample *s)
+{
+  uint32_t head = touch_queue_head.load(std::memory_order_relaxed);
+  uint32_t tail = touch_queue_tail.load(std::memory_order_acquire);
+  if (head == tail) return false;
+  *s = touch_queue[head & (TOUCH_QUEUE_SIZE - 1)];
+  touch_queue_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool touch_queue_empty(void)
+{
+  return touch_queue_head.load(std::memory_order_acquire) == touch_queue_tail.load(std::memory_order_acquire);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TRANSFORM & FILTER
+// ═══════════════════════════════════════════════════════════════
+
+// Same result as map(v, min, max, 0, size - 1) on both axes, as a matrix
+static TouchTransform touch_default_transform(unsigned char r, unsigned short int w, unsigned short int h)
+{
+  int32_t x1 = TOUCH_MAP_X1, x2 = TOUCH_MAP_X2, y1 = TOUCH_MAP_Y1, y2 = TOUCH_MAP_Y2;
+  if (r == ROTATION_LEFT || r == ROTATION_RIGHT) {
+    x1 = TOUCH_MAP_Y1; x2 = TOUCH_MAP_Y2;
+    y1 = TOUCH_MAP_X1; y2 = TOUCH_MAP_X2;
+  }
+
+  TouchTransform t;
+  t.a = ((int32_t)(w - 1) << 16) / (x2 - x1);
+  t.b = 0;
+  t.c = -x1 * t.a;
+  t.d = 0;
+  t.e = ((int32_t)(h - 1) << 16) / (y2 - y1);
+  t.f = -y1 * t.e;
+  return t;
+}
+
+static inline void touch_apply_transform(const TouchTransform *t, int16_t *x, int16_t *y)
+{
+  int32_t rx = *x, ry = *y;
+  int32_t sx = (t->a * rx + t->b * ry + t->c) >> 16;
+  int32_t sy = (t->d * rx + t->e * ry + t->f) >> 16;
+  *x = (int16_t)constrain(sx, 0, (int32_t)width - 1);
+  *y = (int16_t)constrain(sy, 0, (int32_t)height - 1);
+}
+
+// Per-point filter state (both FT6336 points)
+struct TouchFilterAxis {
+#if TOUCH_FILTER == TOUCH_FILTER_MEDIAN3
+  int16_t v[3];
+  uint8_t n;
+#else
+  float x;      // Filtered value
+  float dx;     // Filtered derivative
+#endif
+};
+
+struct TouchFilterPoint {
+  TouchFilterAxis ax, ay;
+  uint32_t t;
+  bool active;
+};
+
+static TouchFilterPoint touch_filter[2];
+
+static inline int16_t touch_median3(int16_t a, int16_t b, int16_t c)
+{
+  return max(min(a, b), min(max(a, b), c));
+}
+
+#if TOUCH_FILTER == TOUCH_FILTER_ONE_EURO
+static inline float touch_euro_alpha(float cutoff, float dt)
+{
+  float tau = 1.0f / (2.0f * PI * cutoff);
+  return 1.0f / (1.0f + tau / dt);
+}
+
+static inline int16_t touch_euro_step(TouchFilterAxis *f, int16_t value, float dt)
+{
+  float v = value;
+  float dx = (v - f->x) / dt;
+  f->dx += touch_euro_alpha(TOUCH_EURO_D_CUTOFF, dt) * (dx - f->dx);
+  float cutoff = TOUCH_EURO_MIN_CUTOFF + TOUCH_EURO_BETA * fabsf(f->dx);
+  f->x += touch_euro_alpha(cutoff, dt) * (v - f->x);
+  return (int16_t)lroundf(f->x);
+}
+#endif
+
+static void touch_filter_point(TouchFilterPoint *p, uint32_t now, int16_t *x, int16_t *y)
+{
+#if TOUCH_FILTER == TOUCH_FILTER_MEDIAN3
+  if (!p->active) {
+    p->ax.n = p->ay.n = 0;
+    p->active = true;
+  }
+  p->ax.v[p->ax.n % 3] = *x;
+  p->ay.v[p->ay.n % 3] = *y;
+  p->ax.n++;
+  p->ay.n++;
+  if (p->ax.n >= 3) {
+    *x = touch_median3(p->ax.v[0], p->ax.v[1], p->ax.v[2]);
+    *y = touch_median3(p->ay.v[0], p->ay.v[1], p->ay.v[2]);
+  }
+#elif TOUCH_FILTER == TOUCH_FILTER_ONE_EURO
+  if (!p->active) {
+    // First contact: no history, pass the point through
+    p->ax.x = *x; p->ax.dx = 0;
+    p->ay.x = *y; p->ay.dx = 0;
+    p->t = now;
+    p->active = true;
+    return;
+  }
+  float dt = (now - p->t) / 1000.0f;
+  if (dt <= 0) dt = TOUCH_ACTIVE_POLL_MS / 1000.0f;
+  p->t = now;
+  *x = touch_euro_step(&p->ax, *x, dt);
+  *y = touch_euro_step(&p->ay, *y, dt);
+#endif
+}
+
+// Precompute the transform for every rotation once, map() is gone from
+// the sample path. Uses the user calibration where one exists.
+static void touch_build_transforms(void)
+{
+  // LEFT/RIGHT swap width and height
+  bool cur_landscape = (rotation == ROTATION_LEFT || rotation == ROTATION_RIGHT);
+  unsigned short int w_portrait = cur_landscape ? height : width;
+  unsigned short int h_portrait = cur_landscape ? width : height;
+
+  for (unsigned char i = 0; i < TOUCH_ROTATIONS; i++) {
+    bool landscape = (i == ROTATION_LEFT || i == ROTATION_RIGHT);
+    if (touch_cal_valid[i]) {
+      touch_xform[i] = touch_cal[i];
+    } else {
+      touch_xform[i] = touch_default_transform(i, landscape ? h_portrait : w_portrait,
+                                               landscape ? w_portrait : h_portrait);
+    }
+  }
+  touch_active_xform = &touch_xform[rotation % TOUCH_ROTATIONS];
+}
+
+// Install (or clear with NULL) the calibration for a rotation
+void touch_set_calibration(unsigned char r, const TouchTransform *t)
+{
+  r %= TOUCH_ROTATIONS;
+  touch_cal_valid[r] = (t != NULL);
+  if (t) touch_cal[r] = *t;
+  if (width && height) touch_build_transforms();
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DRIVER
+// ═══════════════════════════════════════════════════════════════
+
 void touch_init(unsigned short int w, unsigned short int h,unsigned char r)
 {
-  width = w; 
+  width = w;
   height = h;
   switch (r){
     case ROTATION_NORMAL:
@@ -39,25 +322,60 @@ void touch_init(unsigned short int w, unsigned short int h,unsigned char r)
   }
   ts.begin();
   ts.setRotation(r);
+
+  rotation = r;
+  touch_build_transforms();
+
+  pinMode(TOUCH_FT6336_INT, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(TOUCH_FT6336_INT), touch_isr, FALLING);
+  touch_irq_pending = true;  // Pick up a finger that was already down
 }
 
-bool touch_touched(void)
+// Read the controller only when the INT line fired, or while a finger is
+// down to track motion and the release. Call often (from loop()).
+// Returns true when a new sample was queued.
+bool touch_service(void)
 {
-   ts.read();
-  if (ts.isTouched)
-  {
-//#if defined(TOUCH_SWAP_XY)
-//    touch_last_x = map(ts.points[0].y, TOUCH_MAP_X1, TOUCH_MAP_X2, 0, width - 1);
-//    touch_last_y = map(ts.points[0].x, TOUCH_MAP_Y1, TOUCH_MAP_Y2, 0, height - 1);
-//#else
-    touch_last_x = map(ts.points[0].x, min_x, max_x, 0, width - 1);
-    touch_last_y = map(ts.points[0].y, min_y, max_y, 0, height - 1);
-    return true;
-  }
-  else
-  {
-    return false;
+  uint32_t now = millis();
+  if (!touch_irq_pending) {
+    if (!touch_down || now - touch_last_read < TOUCH_ACTIVE_POLL_MS) return false;
+  }
+  touch_irq_pending = false;
+  touch_last_read = now;
+
+  TouchSample s;
+  if (!touch_controller_read(&s)) return false;
+  s.time = now;
+
+  if (s.count > 0) {
+    touch_raw_x = s.x[0];
+    touch_raw_y = s.y[0];
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    if (i >= s.count) {
+      touch_filter[i].active = false;
+      continue;
+    }
+    touch_apply_transform(touch_active_xform, &s.x[i], &s.y[i]);
+    touch_filter_point(&touch_filter[i], now, &s.x[i], &s.y[i]);
+  }
+
+  // Nothing changed while idle (spurious edge)
+  if (s.count == 0 && !touch_down) return false;
+
+  touch_down = s.count > 0;
+  if (touch_down) {
+    touch_last_x = s.x[0];
+    touch_last_y = s.y[0];
   }
+  if (touch_listener) touch_listener(s);
+  return touch_queue_push(s);
+}
+
+bool touch_touched(void)
+{
+  touch_service();
+  return touch_down;
 }
 
 bool touch_has_signal(void)
@@ -69,3 +387,157 @@ bool touch_released(void)
 {
   return true;
 }
+
+// ═══════════════════════════════════════════════════════════════
+// REPLAY TEST
+// ═══════════════════════════════════════════════════════════════
+
+#define TOUCH_REPLAY_MAX 48
+
+static TouchSample touch_replay_trace[TOUCH_REPLAY_MAX];
+static uint32_t touch_replay_len = 0, touch_replay_pos = 0;
+static TouchSample touch_replay_seen[TOUCH_REPLAY_MAX];   // Mapped samples, as produced
+static uint32_t touch_replay_seen_count = 0;
+
+// Fake controller: plays the trace, then reports no touch
+static bool touch_replay_read(TouchSample *raw)
+{
+  raw->count = 0;
+  if (touch_replay_pos < touch_replay_len) *raw = touch_replay_trace[touch_replay_pos++];
+  return true;
+}
+
+static void touch_replay_listen(const TouchSample &s)
+{
+  if (touch_replay_seen_count < TOUCH_REPLAY_MAX) touch_replay_seen[touch_replay_seen_count] = s;
+  touch_replay_seen_count++;
+}
+
+// Controller interrupts for the next n trace samples
+static void touch_replay_feed(uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++) {
+    touch_irq_pending = true;
+    touch_service();
+  }
+}
+
+// Consumer side the way the LVGL read callback works: one sample per
+// call, called again while continue_reading (queue not empty) is set
+static uint32_t touch_replay_drain(TouchSample *out, uint32_t max)
+{
+  uint32_t n = 0;
+  bool continue_reading = true;
+  TouchSample s;
+  while (continue_reading && touch_queue_pop(&s)) {
+    if (n < max) out[n] = s;
+    n++;
+    continue_reading = !touch_queue_empty();
+  }
+  return n;
+}
+
+static bool touch_sample_equal(const TouchSample &a, const TouchSample &b)
+{
+  if (a.count != b.count) return false;
+  for (uint8_t i = 0; i < a.count; i++) {
+    if (a.x[i] != b.x[i] || a.y[i] != b.y[i]) return false;
+  }
+  return true;
+}
+
+// Replays a synthetic swipe (one finger, then two, then release)
+// through touch_service with a fake controller and checks that the
+// queue hands out every produced sample in order: a burst up to the
+// queue size, small bursts drained in between, and an overflow that
+// must be counted rather than lost silently. Controller, listener and
+// queue are restored afterwards. Returns the number of failures.
+uint32_t runTouchReplayTest(void)
+{
+  uint32_t failures = 0;
+  TouchControllerRead live_read = touch_controller_read;
+  TouchSampleListener live_listener = touch_listener;
+  bool live_down = touch_down;
+  uint32_t live_dropped = touch_dropped;
+  int live_x = touch_last_x, live_y = touch_last_y;
+  TouchSample drained[TOUCH_REPLAY_MAX];
+  touch_replay_drain(drained, 0);   // Whatever the live controller queued
+
+  // Trace: 10 one-finger moves, 5 two-finger moves, release
+  touch_replay_len = 0;
+  for (int i = 0; i < 15; i++) {
+    TouchSample &t = touch_replay_trace[touch_replay_len++];
+    t.count = i < 10 ? 1 : 2;
+    t.x[0] = 20 + i * 12;  t.y[0] = 100 + i * 4;
+    t.x[1] = 200 - i * 6;  t.y[1] = 60;
+  }
+  touch_replay_trace[touch_replay_len++].count = 0;
+
+  touch_set_controller(touch_replay_read);
+  touch_set_listener(touch_replay_listen);
+
+  // 1. The whole gesture arrives before LVGL reads once
+  for (int pass = 0; pass < 2; pass++) {
+    touch_replay_pos = 0;
+    touch_replay_seen_count = 0;
+    touch_down = false;
+    touch_filter[0].active = touch_filter[1].active = false;
+    uint32_t dropped = touch_dropped;
+    uint32_t n = 0;
+
+    if (pass == 0) {
+      touch_replay_feed(touch_replay_len);
+      n = touch_replay_drain(drained, TOUCH_REPLAY_MAX);
+    } else {
+      // 2. Bursts of 3, drained between them
+      while (touch_replay_pos < touch_replay_len) {
+        touch_replay_feed(3);
+        n += touch_replay_drain(drained + n, TOUCH_REPLAY_MAX - n);
+      }
+    }
+    TEST_CHECK(touch_dropped == dropped, "pass %d: %lu samples dropped", pass + 1, touch_dropped - dropped);
+    TEST_CHECK(n == touch_replay_seen_count, "pass %d: %lu samples read, %lu produced",
+               pass + 1, n, touch_replay_seen_count);
+    bool ordered = n == touch_replay_seen_count;
+    for (uint32_t i = 0; ordered && i < n; i++) ordered = touch_sample_equal(drained[i], touch_replay_seen[i]);
+    TEST_CHECK(ordered, "pass %d: samples out of order", pass + 1);
+    TEST_CHECK(n > 0 && drained[n - 1].count == 0, "pass %d: release missing", pass + 1);
+    TEST_CHECK(touch_queue_empty(), "pass %d: queue not empty after continue_reading stopped", pass + 1);
+  }
+
+  // 3. More samples than the queue holds: the oldest stay, drops are counted
+  touch_replay_len = 0;
+  for (int i = 0; i < TOUCH_QUEUE_SIZE + 4; i++) {
+    TouchSample &t = touch_replay_trace[touch_replay_len++];
+    t.count = 1;
+    t.x[0] = 10 + i * 8;
+    t.y[0] = 50;
+  }
+  touch_replay_pos = 0;
+  touch_replay_seen_count = 0;
+  touch_down = false;
+  touch_filter[0].active = touch_filter[1].active = false;
+  uint32_t dropped = touch_dropped;
+  touch_replay_feed(touch_replay_len);
+  uint32_t n = touch_replay_drain(drained, TOUCH_REPLAY_MAX);
+  TEST_CHECK(n == TOUCH_QUEUE_SIZE && touch_dropped - dropped == 4,
+             "overflow: %lu read, %lu dropped", n, touch_dropped - dropped);
+  bool ordered = true;
+  for (uint32_t i = 0; i < n && i < TOUCH_QUEUE_SIZE; i++) ordered = ordered && touch_sample_equal(drained[i], touch_replay_seen[i]);
+  TEST_CHECK(ordered, "overflow: queued samples out of order");
+
+  Serial.printf("Touch replay test: %lu failures\n", failures);
+
+  // Back to the live controller
+  touch_set_controller(live_read);
+  touch_set_listener(live_listener);
+  touch_dropped = live_dropped;
+  touch_down = live_down;
+  touch_last_x = live_x;
+  touch_last_y = live_y;
+  touch_filter[0].active = touch_filter[1].active = false;
+  touch_irq_pending = true;
+  return failures;
+}
+
+#endif // TOUCH_H
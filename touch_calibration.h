@@ -0,0 +1,385 @@
+/*
+ * Touch Calibration
+ *
+ * 3-point affine calibration for the touch panel.
+ * - Shows three targets, averages the raw controller points while each
+ *   one is pressed, and solves the raw -> screen affine transform
+ * - Stores one transform per rotation in /data/touchcal.bin
+ * - touch.h turns them into fixed-point matrices in touch_init()
+ *
+ * Call loadTouchCalibration() once the SD card is mounted, before or after
+ * touch_init(), and open the capture screen with
+ * action_open_touch_calibration(). runTouchCalibrationBenchmark() checks
+ * the solver and jitter filter against noisy synthetic captures; the
+ * solver and benchmark also build on the host (tools/host_tests.cpp),
+ * storage and the capture screen are device only.
+ *
+ * File: touch_calibration.h
+ */
+
+#ifndef TOUCH_CALIBRATION_H
+#define TOUCH_CALIBRATION_H
+
+#include "touch.h"
+#include "test_check.h"
+
+#if defined(ARDUINO)
+#include <lvgl.h>
+#include "SD_MMC.h"
+#include <FS.h>
+#include "screen_manager.h"
+#include "storage_stats.h"
+
+#define TOUCH_CAL_FILE    "/data/touchcal.bin"
+#define TOUCH_CAL_MAGIC   0x4C414354  // "TCAL"
+#define TOUCH_CAL_VERSION 1
+
+struct TouchCalFile {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t validMask;     // Bit per rotation
+    TouchTransform transforms[TOUCH_ROTATIONS];
+    uint32_t checksum;      // FNV-1a over everything above
+};
+
+static uint32_t touchCalChecksum(const TouchCalFile &f) {
+    const uint8_t * p = (const uint8_t *)&f;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(TouchCalFile, checksum); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STORAGE
+// ═══════════════════════════════════════════════════════════════
+
+bool loadTouchCalibration() {
+    fs::File file = SD_MMC.open(TOUCH_CAL_FILE);
+    if (!file) return false;
+
+    TouchCalFile f;
+    bool ok = file.read((uint8_t *)&f, sizeof(f)) == sizeof(f) &&
+              f.magic == TOUCH_CAL_MAGIC &&
+              f.version == TOUCH_CAL_VERSION &&
+              f.checksum == touchCalChecksum(f);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Touch calibration invalid, using defaults");
+        return false;
+    }
+
+    for (int r = 0; r < TOUCH_ROTATIONS; r++) {
+        touch_set_calibration(r, (f.validMask & (1 << r)) ? &f.transforms[r] : NULL);
+    }
+    Serial.printf("Touch calibration loaded (mask 0x%x)\n", f.validMask);
+    return true;
+}
+
+bool saveTouchCalibration() {
+    TouchCalFile f;
+    memset(&f, 0, sizeof(f));
+    f.magic = TOUCH_CAL_MAGIC;
+    f.version = TOUCH_CAL_VERSION;
+    for (int r = 0; r < TOUCH_ROTATIONS; r++) {
+        if (touch_cal_valid[r]) {
+            f.validMask |= 1 << r;
+            f.transforms[r] = touch_cal[r];
+        }
+    }
+    f.checksum = touchCalChecksum(f);
+
+    uint32_t oldBytes = storage_file_size(TOUCH_CAL_FILE);
+    fs::File file = SD_MMC.open(TOUCH_CAL_FILE, FILE_WRITE);
+    if (!file) return false;
+    bool ok = file.write((const uint8_t *)&f, sizeof(f)) == sizeof(f);
+    file.close();
+    storage_note_resize(oldBytes, ok ? sizeof(f) : 0);
+
+    Serial.println(ok ? "Touch calibration saved" : "Touch calibration save failed");
+    return ok;
+}
+
+#endif
+
+// ═══════════════════════════════════════════════════════════════
+// SOLVER
+// ═══════════════════════════════════════════════════════════════
+
+// Solve screen = M * raw from three point pairs (Cramer's rule).
+// Returns false when the raw points are (nearly) collinear.
+bool solveTouchCalibration(const int16_t rawX[3], const int16_t rawY[3],
+                           const int16_t scrX[3], const int16_t scrY[3],
+                           TouchTransform * out) {
+    float x0 = rawX[0], x1 = rawX[1], x2 = rawX[2];
+    float y0 = rawY[0], y1 = rawY[1], y2 = rawY[2];
+
+    float det = x0 * (y1 - y2) - x1 * (y0 - y2) + x2 * (y0 - y1);
+    if (fabsf(det) < 1.0f) return false;
+
+    const int16_t * targets[2] = { scrX, scrY };
+    float m[2][3];
+    for (int k = 0; k < 2; k++) {
+        float s0 = targets[k][0], s1 = targets[k][1], s2 = targets[k][2];
+        m[k][0] = (s0 * (y1 - y2) - s1 * (y0 - y2) + s2 * (y0 - y1)) / det;
+        m[k][1] = (x0 * (s1 - s2) - x1 * (s0 - s2) + x2 * (s0 - s1)) / det;
+        m[k][2] = (x0 * (y1 * s2 - y2 * s1) - x1 * (y0 * s2 - y2 * s0) + x2 * (y0 * s1 - y1 * s0)) / det;
+    }
+
+    out->a = lroundf(m[0][0] * 65536.0f);
+    out->b = lroundf(m[0][1] * 65536.0f);
+    out->c = lroundf(m[0][2] * 65536.0f);
+    out->d = lroundf(m[1][0] * 65536.0f);
+    out->e = lroundf(m[1][1] * 65536.0f);
+    out->f = lroundf(m[1][2] * 65536.0f);
+    return true;
+}
+
+#if defined(ARDUINO)
+
+// ═══════════════════════════════════════════════════════════════
+// CAPTURE SCREEN
+// ═══════════════════════════════════════════════════════════════
+
+static int16_t calTargetX[3], calTargetY[3];
+static int16_t calRawX[3], calRawY[3];
+static int32_t calSumX = 0, calSumY = 0, calSamples = 0;
+static int calStep = 0;
+static lv_obj_t * cal_cross = NULL;
+static lv_obj_t * cal_label = NULL;
+
+static void showCalibrationTarget() {
+    lv_obj_set_pos(cal_cross, calTargetX[calStep] - 10, calTargetY[calStep] - 10);
+
+    static char text[48];
+    snprintf(text, sizeof(text), "Tap and hold the target (%d/3)", calStep + 1);
+    lv_label_set_text(cal_label, text);
+}
+
+static void finishTouchCalibration() {
+    TouchTransform t;
+    if (!solveTouchCalibration(calRawX, calRawY, calTargetX, calTargetY, &t)) {
+        Serial.println("Touch calibration failed, try again");
+        calStep = 0;
+        showCalibrationTarget();
+        return;
+    }
+
+    touch_set_calibration(rotation, &t);
+    saveTouchCalibration();
+
+    screenManagerShowHome();
+}
+
+static void calibration_screen_event(lv_event_t * e) {
+    lv_event_code_t code = lv_event_get_code(e);
+
+    if (code == LV_EVENT_PRESSED) {
+        calSumX = calSumY = calSamples = 0;
+    } else if (code == LV_EVENT_PRESSING) {
+        // Average the unmapped points while the finger rests on the target
+        calSumX += touch_raw_x;
+        calSumY += touch_raw_y;
+        calSamples++;
+    } else if (code == LV_EVENT_RELEASED && calSamples > 0) {
+        calRawX[calStep] = calSumX / calSamples;
+        calRawY[calStep] = calSumY / calSamples;
+        calStep++;
+
+        if (calStep == 3) {
+            finishTouchCalibration();
+        } else {
+            showCalibrationTarget();
+        }
+    }
+}
+
+static void buildTouchCalibrationScreen(lv_obj_t * screen) {
+    lv_obj_set_style_bg_color(screen, lv_color_hex(0x000000), 0);
+    lv_obj_add_event_cb(screen, calibration_screen_event, LV_EVENT_ALL, NULL);
+
+    // Targets spread over the screen, not on one line
+    calTargetX[0] = width / 10;      calTargetY[0] = height / 10;
+    calTargetX[1] = width * 9 / 10;  calTargetY[1] = height / 2;
+    calTargetX[2] = width / 2;       calTargetY[2] = height * 9 / 10;
+
+    cal_cross = lv_obj_create(screen);
+    lv_obj_set_size(cal_cross, 20, 20);
+    lv_obj_set_style_radius(cal_cross, LV_RADIUS_CIRCLE, 0);
+    lv_obj_set_style_bg_color(cal_cross, lv_color_hex(0xFF0000), 0);
+    lv_obj_set_style_border_width(cal_cross, 0, 0);
+    lv_obj_clear_flag(cal_cross, LV_OBJ_FLAG_CLICKABLE);
+
+    cal_label = lv_label_create(screen);
+    lv_obj_align(cal_label, LV_ALIGN_CENTER, 0, 0);
+    lv_obj_set_style_text_color(cal_label, lv_color_hex(0xFFFFFF), 0);
+}
+
+// Every visit starts over at the first target
+static void showTouchCalibrationScreen(lv_obj_t * screen) {
+    calStep = 0;
+    calSumX = calSumY = calSamples = 0;
+    showCalibrationTarget();
+}
+
+// Call once in setup; the screen is transient, it is rarely used
+void registerTouchCalibrationScreen() {
+    screenManagerRegister(SCREEN_ID_TOUCH_CALIBRATION, "touch_calibration",
+                          buildTouchCalibrationScreen, showTouchCalibrationScreen, SCREEN_TRANSIENT);
+}
+
+// Call this from your EEZ Studio action
+void action_open_touch_calibration() {
+    screenManagerShow(SCREEN_ID_TOUCH_CALIBRATION);
+}
+
+#endif
+
+// ═══════════════════════════════════════════════════════════════
+// ACCURACY BENCHMARK
+// ═══════════════════════════════════════════════════════════════
+
+#define TOUCH_CAL_BENCH_TRIALS   32
+#define TOUCH_CAL_BENCH_SAMPLES  16     // Raw points averaged per target
+#define TOUCH_CAL_BENCH_NOISE    6      // Raw units, per axis
+#define TOUCH_FILTER_BENCH_SAMPLES 2048
+
+static uint32_t touchCalBenchSeed = 1;
+
+// Roughly normal noise in [-amp, amp] (sum of two uniforms), repeatable
+static float touchCalNoise(float amp) {
+    float sum = 0;
+    for (int i = 0; i < 2; i++) {
+        touchCalBenchSeed = touchCalBenchSeed * 1664525u + 1013904223u;
+        sum += (float)(touchCalBenchSeed >> 8) / (float)(1u << 24);
+    }
+    return (sum - 1.0f) * amp;
+}
+
+// The synthetic panel: screen point -> raw controller point (slightly
+// rotated, scaled and with the Y axis flipped)
+static void touchCalBenchRaw(float sx, float sy, float * rx, float * ry) {
+    *rx = 12.0f + 0.70f * sx + 0.04f * sy;
+    *ry = 300.0f - 0.03f * sx - 1.25f * sy;
+}
+
+// Calibrates a synthetic panel from noisy captures and measures the
+// error of the solved fixed-point transform over the whole screen, then
+// runs a noisy drag through the transform and jitter filter and reports
+// the filter's effect and cost per sample. Live calibration and filter
+// state are not touched. Returns the number of failures.
+uint32_t runTouchCalibrationBenchmark() {
+    uint32_t failures = 0;
+    unsigned short int liveWidth = width, liveHeight = height;
+    if (!width || !height) {
+        width = 320;
+        height = 240;
+    }
+    touchCalBenchSeed = 1;
+
+    // 1. Calibration from noisy, averaged captures
+    int16_t targetX[3] = { (int16_t)(width / 10), (int16_t)(width * 9 / 10), (int16_t)(width / 2) };
+    int16_t targetY[3] = { (int16_t)(height / 10), (int16_t)(height / 2), (int16_t)(height * 9 / 10) };
+    float errSum = 0, errMax = 0;
+    uint32_t points = 0, solveMicros = 0, solved = 0;
+    for (int trial = 0; trial < TOUCH_CAL_BENCH_TRIALS; trial++) {
+        int16_t rawX[3], rawY[3];
+        for (int k = 0; k < 3; k++) {
+            float rx, ry, sumX = 0, sumY = 0;
+            touchCalBenchRaw(targetX[k], targetY[k], &rx, &ry);
+            for (int i = 0; i < TOUCH_CAL_BENCH_SAMPLES; i++) {
+                sumX += lroundf(rx + touchCalNoise(TOUCH_CAL_BENCH_NOISE));
+                sumY += lroundf(ry + touchCalNoise(TOUCH_CAL_BENCH_NOISE));
+            }
+            // Integer average, like the capture screen
+            rawX[k] = (int32_t)sumX / TOUCH_CAL_BENCH_SAMPLES;
+            rawY[k] = (int32_t)sumY / TOUCH_CAL_BENCH_SAMPLES;
+        }
+
+        TouchTransform t;
+        uint32_t start = micros();
+        bool ok = solveTouchCalibration(rawX, rawY, targetX, targetY, &t);
+        solveMicros += micros() - start;
+        if (!ok) continue;
+        solved++;
+
+        // Error on a 9 x 9 grid, away from the clamped edges
+        for (int gy = 1; gy <= 9; gy++) {
+            for (int gx = 1; gx <= 9; gx++) {
+                float sx = width * gx / 10.0f, sy = height * gy / 10.0f, rx, ry;
+                touchCalBenchRaw(sx, sy, &rx, &ry);
+                int16_t x = lroundf(rx), y = lroundf(ry);
+                touch_apply_transform(&t, &x, &y);
+                float err = sqrtf((x - sx) * (x - sx) + (y - sy) * (y - sy));
+                errSum += err;
+                if (err > errMax) errMax = err;
+                points++;
+            }
+        }
+    }
+    float errMean = points ? errSum / points : 0;
+
+    // 2. Noisy drag through transform + filter, against the true path
+    TouchFilterPoint filter;
+    memset(&filter, 0, sizeof(filter));
+    TouchTransform exact;
+    int16_t ex[3], ey[3], sx3[3] = { 0, 100, 0 }, sy3[3] = { 0, 0, 100 };
+    for (int k = 0; k < 3; k++) {
+        float rx, ry;
+        touchCalBenchRaw(sx3[k], sy3[k], &rx, &ry);
+        ex[k] = lroundf(rx);
+        ey[k] = lroundf(ry);
+    }
+    solveTouchCalibration(ex, ey, sx3, sy3, &exact);
+    double rawSq = 0, filteredSq = 0;
+    uint32_t filterMicros = 0;
+    for (uint32_t i = 0; i < TOUCH_FILTER_BENCH_SAMPLES; i++) {
+        // Resting half the time, then a slow drag (40 px/s)
+        uint32_t now = i * TOUCH_ACTIVE_POLL_MS;
+        float truthX = width / 2, truthY = height / 2;
+        if (i >= TOUCH_FILTER_BENCH_SAMPLES / 2) truthX += (i - TOUCH_FILTER_BENCH_SAMPLES / 2) * TOUCH_ACTIVE_POLL_MS * 0.04f;
+        if (truthX > width - 1) truthX = width - 1;
+        float rx, ry;
+        touchCalBenchRaw(truthX, truthY, &rx, &ry);
+        int16_t x = lroundf(rx + touchCalNoise(TOUCH_CAL_BENCH_NOISE));
+        int16_t y = lroundf(ry + touchCalNoise(TOUCH_CAL_BENCH_NOISE));
+
+        int16_t nx = x, ny = y;
+        touch_apply_transform(&exact, &nx, &ny);
+        uint32_t start = micros();
+        touch_apply_transform(&exact, &x, &y);
+        touch_filter_point(&filter, now, &x, &y);
+        filterMicros += micros() - start;
+
+        rawSq += (nx - truthX) * (nx - truthX) + (ny - truthY) * (ny - truthY);
+        filteredSq += (x - truthX) * (x - truthX) + (y - truthY) * (y - truthY);
+    }
+    float rawRms = sqrtf(rawSq / TOUCH_FILTER_BENCH_SAMPLES);
+    float filteredRms = sqrtf(filteredSq / TOUCH_FILTER_BENCH_SAMPLES);
+
+    TEST_CHECK(solved == TOUCH_CAL_BENCH_TRIALS, "%lu of %d calibrations solved", solved, TOUCH_CAL_BENCH_TRIALS);
+    TEST_CHECK(errMean < 2.0f && errMax < 8.0f, "calibration error %.2f px mean, %.2f px max", errMean, errMax);
+#if TOUCH_FILTER != TOUCH_FILTER_NONE
+    TEST_CHECK(filteredRms < rawRms, "filter does not reduce jitter (%.2f -> %.2f px)", rawRms, filteredRms);
+#endif
+
+    Serial.println("\n=== Touch Calibration Benchmark ===");
+    Serial.printf("Calibration: %d trials, %d samples per target, noise +-%d raw\n",
+                  TOUCH_CAL_BENCH_TRIALS, TOUCH_CAL_BENCH_SAMPLES, TOUCH_CAL_BENCH_NOISE);
+    Serial.printf("  error %.2f px mean, %.2f px max, solve %lu us avg\n",
+                  errMean, errMax, solved ? solveMicros / solved : 0);
+    Serial.printf("Filter: %d samples, RMS error %.2f px raw -> %.2f px filtered\n",
+                  TOUCH_FILTER_BENCH_SAMPLES, rawRms, filteredRms);
+    Serial.printf("  transform + filter %lu ns per sample\n",
+                  (uint32_t)((uint64_t)filterMicros * 1000 / TOUCH_FILTER_BENCH_SAMPLES));
+    Serial.printf("%lu failures\n", failures);
+    Serial.println("===================================\n");
+
+    width = liveWidth;
+    height = liveHeight;
+    return failures;
+}
+
+#endif // TOUCH_CALIBRATION_H
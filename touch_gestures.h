@@ -0,0 +1,483 @@
+/*
+ * Touch Gesture Engine
+ *
+ * Turns the timestamped TouchSample stream from touch.h (both FT6336
+ * points) into gestures: tap, long-press, swipe, pinch and two-finger
+ * scroll, each with velocity.
+ *
+ * It is a fixed-size state machine: no heap allocation, a short motion
+ * history ring and a small event queue. It only depends on TouchSample,
+ * so recorded touch traces can be replayed through gesture_feed(), see
+ * runGestureReplayTest().
+ *
+ * The engine runs on the UI task (fed by touch_service, ticked by the
+ * loop scheduler). The event queue is single producer / single consumer,
+ * so the running app reads it from the worker core: bytecode apps with
+ * the gesture natives (app_vm.h), native modules through the exported
+ * gesture_poll(). The loader flushes it before an app starts.
+ *
+ * Usage:
+ *   gestures_init();                 // after touch_init()
+ *   gesture_tick(millis());          // from loop(), for long-press
+ *   GestureEvent ev;
+ *   while (gesture_poll(&ev)) { ... }
+ *
+ * File: touch_gestures.h
+ */
+
+#ifndef TOUCH_GESTURES_H
+#define TOUCH_GESTURES_H
+
+#include <math.h>
+#include <atomic>
+#include "touch.h"
+#include "test_check.h"
+
+// Tuning (pixels / milliseconds)
+#define GESTURE_TAP_SLOP         10    // Max movement for tap / long-press
+#define GESTURE_TAP_MAX_MS       250
+#define GESTURE_LONG_PRESS_MS    500
+#define GESTURE_SWIPE_MIN_DIST   40
+#define GESTURE_SWIPE_MIN_SPEED  200   // px/s
+#define GESTURE_PINCH_SLOP       12    // Change of finger distance to start a pinch
+#define GESTURE_SCROLL_SLOP      10    // Centroid movement to start a scroll
+#define GESTURE_VELOCITY_MS      100   // Window used to compute velocity
+
+#define GESTURE_HISTORY_SIZE     8     // Power of two
+#define GESTURE_QUEUE_SIZE       8     // Power of two
+
+enum GestureType {
+    GESTURE_NONE = 0,
+    GESTURE_TAP,
+    GESTURE_LONG_PRESS,
+    GESTURE_SWIPE,
+    GESTURE_PINCH,
+    GESTURE_SCROLL
+};
+
+// Continuous gestures (pinch, scroll) report begin/update/end
+enum GesturePhase {
+    GESTURE_PHASE_BEGIN = 0,
+    GESTURE_PHASE_UPDATE,
+    GESTURE_PHASE_END
+};
+
+enum GestureDir {
+    GESTURE_DIR_NONE = 0,
+    GESTURE_DIR_LEFT,
+    GESTURE_DIR_RIGHT,
+    GESTURE_DIR_UP,
+    GESTURE_DIR_DOWN
+};
+
+struct GestureEvent {
+    uint8_t type;        // GestureType
+    uint8_t phase;       // GesturePhase
+    uint8_t dir;         // GestureDir (swipe / scroll)
+    uint8_t fingers;
+    uint32_t time;
+    int16_t x, y;        // Position (centroid for two fingers)
+    int16_t dx, dy;      // Movement since the gesture started
+    int16_t vx, vy;      // Velocity in px/s
+    uint16_t scale;      // Pinch scale in 1/256 (256 = unchanged)
+};
+
+enum GestureState {
+    GSTATE_IDLE = 0,
+    GSTATE_PRESSED,        // One finger down, inside tap slop
+    GSTATE_DRAGGING,       // One finger moved past the slop
+    GSTATE_LONG_PRESSED,   // Long-press fired, waiting for release
+    GSTATE_TWO_FINGER,     // Two fingers down, not yet classified
+    GSTATE_PINCHING,
+    GSTATE_SCROLLING,
+    GSTATE_WAIT_RELEASE    // Two-finger gesture over, wait for all fingers up
+};
+
+struct GestureHistoryPoint {
+    uint32_t time;
+    int16_t x, y;
+};
+
+struct GestureEngine {
+    uint8_t state;
+    uint32_t downTime;
+    int16_t startX, startY;      // Start position (or centroid)
+    int16_t lastX, lastY;
+    float startDist;             // Two-finger start distance
+    uint16_t lastScale;
+
+    GestureHistoryPoint history[GESTURE_HISTORY_SIZE];
+    uint8_t historyPos;
+    uint8_t historyCount;
+
+    GestureEvent queue[GESTURE_QUEUE_SIZE];
+    uint32_t dropped;
+};
+
+static GestureEngine gestures;
+
+// Event queue indices: written by the engine (tail) and the consumer (head)
+static std::atomic<uint8_t> gestureQueueHead(0);
+static std::atomic<uint8_t> gestureQueueTail(0);
+
+// ═══════════════════════════════════════════════════════════════
+// HELPERS
+// ═══════════════════════════════════════════════════════════════
+
+static void gesture_history_reset() {
+    gestures.historyPos = 0;
+    gestures.historyCount = 0;
+}
+
+static void gesture_history_add(uint32_t time, int16_t x, int16_t y) {
+    GestureHistoryPoint &p = gestures.history[gestures.historyPos];
+    p.time = time;
+    p.x = x;
+    p.y = y;
+    gestures.historyPos = (gestures.historyPos + 1) & (GESTURE_HISTORY_SIZE - 1);
+    if (gestures.historyCount < GESTURE_HISTORY_SIZE) gestures.historyCount++;
+}
+
+// Velocity between the newest point and the oldest one inside the window
+static void gesture_velocity(int16_t *vx, int16_t *vy) {
+    *vx = 0;
+    *vy = 0;
+    if (gestures.historyCount < 2) return;
+
+    uint8_t newestIdx = (gestures.historyPos - 1) & (GESTURE_HISTORY_SIZE - 1);
+    const GestureHistoryPoint &newest = gestures.history[newestIdx];
+    const GestureHistoryPoint *oldest = &newest;
+
+    for (uint8_t i = 1; i < gestures.historyCount; i++) {
+        const GestureHistoryPoint &p = gestures.history[(newestIdx - i) & (GESTURE_HISTORY_SIZE - 1)];
+        if (newest.time - p.time > GESTURE_VELOCITY_MS) break;
+        oldest = &p;
+    }
+
+    uint32_t dt = newest.time - oldest->time;
+    if (dt == 0) return;
+    *vx = (int16_t)constrain((int32_t)(newest.x - oldest->x) * 1000 / (int32_t)dt, -32767, 32767);
+    *vy = (int16_t)constrain((int32_t)(newest.y - oldest->y) * 1000 / (int32_t)dt, -32767, 32767);
+}
+
+static uint8_t gesture_direction(int16_t dx, int16_t dy) {
+    if (dx == 0 && dy == 0) return GESTURE_DIR_NONE;
+    if (abs(dx) >= abs(dy)) return dx < 0 ? GESTURE_DIR_LEFT : GESTURE_DIR_RIGHT;
+    return dy < 0 ? GESTURE_DIR_UP : GESTURE_DIR_DOWN;
+}
+
+static void gesture_emit(uint8_t type, uint8_t phase, uint8_t fingers, uint32_t time,
+                         int16_t x, int16_t y) {
+    uint8_t tail = gestureQueueTail.load(std::memory_order_relaxed);
+    uint8_t next = (tail + 1) & (GESTURE_QUEUE_SIZE - 1);
+    if (next == gestureQueueHead.load(std::memory_order_acquire)) {
+        gestures.dropped++;
+        return;
+    }
+
+    GestureEvent &ev = gestures.queue[tail];
+    ev.type = type;
+    ev.phase = phase;
+    ev.fingers = fingers;
+    ev.time = time;
+    ev.x = x;
+    ev.y = y;
+    ev.dx = x - gestures.startX;
+    ev.dy = y - gestures.startY;
+    gesture_velocity(&ev.vx, &ev.vy);
+    ev.dir = gesture_direction(ev.dx, ev.dy);
+    ev.scale = gestures.lastScale;
+
+    gestureQueueTail.store(next, std::memory_order_release);
+}
+
+static float gesture_distance(const TouchSample &s) {
+    float dx = s.x[1] - s.x[0];
+    float dy = s.y[1] - s.y[0];
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static bool gesture_outside(int16_t dx, int16_t dy, int16_t slop) {
+    return (int32_t)dx * dx + (int32_t)dy * dy > (int32_t)slop * slop;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STATE MACHINE
+// ═══════════════════════════════════════════════════════════════
+
+static void gesture_begin_two_finger(const TouchSample &s, int16_t cx, int16_t cy) {
+    gestures.state = GSTATE_TWO_FINGER;
+    gestures.startX = cx;
+    gestures.startY = cy;
+    gestures.startDist = gesture_distance(s);
+    gestures.lastScale = 256;
+    gesture_history_reset();
+    gesture_history_add(s.time, cx, cy);
+}
+
+// End whatever two-finger gesture is running
+static void gesture_end_two_finger(uint32_t time) {
+    if (gestures.state == GSTATE_PINCHING) {
+        gesture_emit(GESTURE_PINCH, GESTURE_PHASE_END, 2, time, gestures.lastX, gestures.lastY);
+    } else if (gestures.state == GSTATE_SCROLLING) {
+        gesture_emit(GESTURE_SCROLL, GESTURE_PHASE_END, 2, time, gestures.lastX, gestures.lastY);
+    }
+    gestures.state = GSTATE_WAIT_RELEASE;
+}
+
+// Feed one sample (in time order)
+void gesture_feed(const TouchSample &s) {
+    // Primary position: first point or centroid of both
+    int16_t x = s.x[0];
+    int16_t y = s.y[0];
+    if (s.count >= 2) {
+        x = (s.x[0] + s.x[1]) / 2;
+        y = (s.y[0] + s.y[1]) / 2;
+    }
+
+    switch (gestures.state) {
+        case GSTATE_IDLE:
+            if (s.count == 1) {
+                gestures.state = GSTATE_PRESSED;
+                gestures.downTime = s.time;
+                gestures.startX = x;
+                gestures.startY = y;
+                gestures.lastScale = 256;
+                gesture_history_reset();
+                gesture_history_add(s.time, x, y);
+            } else if (s.count >= 2) {
+                gestures.downTime = s.time;
+                gesture_begin_two_finger(s, x, y);
+            }
+            break;
+
+        case GSTATE_PRESSED:
+        case GSTATE_DRAGGING:
+        case GSTATE_LONG_PRESSED:
+            if (s.count >= 2) {
+                // Second finger landed: switch to two-finger tracking
+                gesture_begin_two_finger(s, x, y);
+                break;
+            }
+            if (s.count == 0) {
+                int16_t dx = gestures.lastX - gestures.startX;
+                int16_t dy = gestures.lastY - gestures.startY;
+                if (gestures.state == GSTATE_PRESSED) {
+                    if (s.time - gestures.downTime <= GESTURE_TAP_MAX_MS) {
+                        gesture_emit(GESTURE_TAP, GESTURE_PHASE_END, 1, s.time, gestures.lastX, gestures.lastY);
+                    }
+                } else if (gestures.state == GSTATE_DRAGGING) {
+                    int16_t vx, vy;
+                    gesture_velocity(&vx, &vy);
+                    int32_t speed2 = (int32_t)vx * vx + (int32_t)vy * vy;
+                    if (gesture_outside(dx, dy, GESTURE_SWIPE_MIN_DIST) &&
+                        speed2 >= (int32_t)GESTURE_SWIPE_MIN_SPEED * GESTURE_SWIPE_MIN_SPEED) {
+                        gesture_emit(GESTURE_SWIPE, GESTURE_PHASE_END, 1, s.time, gestures.lastX, gestures.lastY);
+                    }
+                }
+                gestures.state = GSTATE_IDLE;
+                return;
+            }
+            gesture_history_add(s.time, x, y);
+            if (gestures.state == GSTATE_PRESSED &&
+                gesture_outside(x - gestures.startX, y - gestures.startY, GESTURE_TAP_SLOP)) {
+                gestures.state = GSTATE_DRAGGING;
+            }
+            break;
+
+        case GSTATE_TWO_FINGER:
+        case GSTATE_PINCHING:
+        case GSTATE_SCROLLING:
+            if (s.count < 2) {
+                gesture_end_two_finger(s.time);
+                if (s.count == 0) gestures.state = GSTATE_IDLE;
+                return;
+            }
+            gesture_history_add(s.time, x, y);
+            if (gestures.startDist > 0) {
+                gestures.lastScale = (uint16_t)constrain(gesture_distance(s) * 256.0f / gestures.startDist, 1.0f, 65535.0f);
+            }
+
+            if (gestures.state == GSTATE_TWO_FINGER) {
+                float distChange = fabsf(gesture_distance(s) - gestures.startDist);
+                if (distChange > GESTURE_PINCH_SLOP) {
+                    gestures.state = GSTATE_PINCHING;
+                    gesture_emit(GESTURE_PINCH, GESTURE_PHASE_BEGIN, 2, s.time, x, y);
+                } else if (gesture_outside(x - gestures.startX, y - gestures.startY, GESTURE_SCROLL_SLOP)) {
+                    gestures.state = GSTATE_SCROLLING;
+                    gesture_emit(GESTURE_SCROLL, GESTURE_PHASE_BEGIN, 2, s.time, x, y);
+                }
+            } else if (x != gestures.lastX || y != gestures.lastY || gestures.state == GSTATE_PINCHING) {
+                gesture_emit(gestures.state == GSTATE_PINCHING ? GESTURE_PINCH : GESTURE_SCROLL,
+                             GESTURE_PHASE_UPDATE, 2, s.time, x, y);
+            }
+            break;
+
+        case GSTATE_WAIT_RELEASE:
+            if (s.count == 0) gestures.state = GSTATE_IDLE;
+            return;
+    }
+
+    gestures.lastX = x;
+    gestures.lastY = y;
+}
+
+// Time-driven transitions (long-press fires without a new sample)
+void gesture_tick(uint32_t now) {
+    if (gestures.state == GSTATE_PRESSED && now - gestures.downTime >= GESTURE_LONG_PRESS_MS) {
+        gestures.state = GSTATE_LONG_PRESSED;
+        gesture_emit(GESTURE_LONG_PRESS, GESTURE_PHASE_BEGIN, 1, now, gestures.lastX, gestures.lastY);
+    }
+}
+
+// Consumer side, any one task
+bool gesture_poll(GestureEvent *ev) {
+    uint8_t head = gestureQueueHead.load(std::memory_order_relaxed);
+    if (head == gestureQueueTail.load(std::memory_order_acquire)) return false;
+    *ev = gestures.queue[head];
+    gestureQueueHead.store((head + 1) & (GESTURE_QUEUE_SIZE - 1), std::memory_order_release);
+    return true;
+}
+
+// Drop pending events (consumer side, e.g. before an app starts reading)
+void gesture_flush() {
+    gestureQueueHead.store(gestureQueueTail.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void gestures_reset() {
+    memset(&gestures, 0, sizeof(gestures));
+    gestures.lastScale = 256;
+    gestureQueueHead = 0;
+    gestureQueueTail = 0;
+}
+
+// Attach the engine to the live touch stream
+void gestures_init() {
+    gestures_reset();
+    touch_set_listener(gesture_feed);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// REPLAY TEST
+// ═══════════════════════════════════════════════════════════════
+
+#define GESTURE_TRACE_MAX  16
+#define GESTURE_REPLAY_MAX 16
+
+struct GestureTrace {
+    TouchSample samples[GESTURE_TRACE_MAX];
+    uint8_t count;
+};
+
+static void gesture_trace_add(GestureTrace &t, uint32_t time, uint8_t fingers,
+                              int16_t x0, int16_t y0, int16_t x1 = 0, int16_t y1 = 0) {
+    if (t.count >= GESTURE_TRACE_MAX) return;
+    TouchSample &s = t.samples[t.count++];
+    s.time = time;
+    s.count = fingers;
+    s.x[0] = x0; s.y[0] = y0;
+    s.x[1] = x1; s.y[1] = y1;
+}
+
+// Feed a trace the way the live stream does (tick, then sample) and
+// collect the events like a consumer polling between samples
+static uint8_t gesture_replay(const GestureTrace &t, uint32_t tickUntil, GestureEvent * out) {
+    uint8_t n = 0;
+    GestureEvent ev;
+    for (uint8_t i = 0; i < t.count; i++) {
+        gesture_tick(t.samples[i].time);
+        gesture_feed(t.samples[i]);
+        while (gesture_poll(&ev)) if (n < GESTURE_REPLAY_MAX) out[n++] = ev;
+    }
+    uint32_t last = t.count ? t.samples[t.count - 1].time : 0;
+    for (uint32_t now = last; now <= tickUntil; now += 10) {
+        gesture_tick(now);
+        while (gesture_poll(&ev)) if (n < GESTURE_REPLAY_MAX) out[n++] = ev;
+    }
+    return n;
+}
+
+// Replays synthetic traces (tap, long-press, swipe, pinch, two-finger
+// scroll) through the engine and checks the events, their order,
+// direction, velocity and pinch scale. Run it while no app is reading
+// gestures; the engine is reset and pending events are dropped
+// afterwards. Returns the number of failures.
+uint32_t runGestureReplayTest() {
+    uint32_t failures = 0;
+    uint32_t dropped = gestures.dropped;
+    GestureTrace t;
+    GestureEvent ev[GESTURE_REPLAY_MAX];
+    uint8_t n;
+
+    // 1. Tap: a small wobble, released after 80 ms
+    gestures_reset();
+    t.count = 0;
+    gesture_trace_add(t, 1000, 1, 100, 100);
+    gesture_trace_add(t, 1030, 1, 102, 101);
+    gesture_trace_add(t, 1080, 0, 0, 0);
+    n = gesture_replay(t, 0, ev);
+    TEST_CHECK(n == 1 && ev[0].type == GESTURE_TAP && ev[0].x == 102 && ev[0].y == 101,
+               "tap: %u events, first type %u", n, n ? ev[0].type : 0);
+
+    // 2. Long-press: fires from the tick, the release adds nothing
+    gestures_reset();
+    t.count = 0;
+    gesture_trace_add(t, 2000, 1, 60, 60);
+    n = gesture_replay(t, 2000 + GESTURE_LONG_PRESS_MS - 10, ev);
+    TEST_CHECK(n == 0, "long-press: fired early (%u events)", n);
+    t.count = 0;
+    gesture_trace_add(t, 2000 + GESTURE_LONG_PRESS_MS, 1, 61, 60);
+    gesture_trace_add(t, 2000 + GESTURE_LONG_PRESS_MS + 200, 0, 0, 0);
+    n = gesture_replay(t, 0, ev);
+    TEST_CHECK(n == 1 && ev[0].type == GESTURE_LONG_PRESS, "long-press: %u events, first type %u",
+               n, n ? ev[0].type : 0);
+
+    // 3. Swipe right: 15 px every 10 ms, 1500 px/s
+    gestures_reset();
+    t.count = 0;
+    for (int i = 0; i < 10; i++) gesture_trace_add(t, 3000 + i * 10, 1, 40 + i * 15, 120);
+    gesture_trace_add(t, 3100, 0, 0, 0);
+    n = gesture_replay(t, 0, ev);
+    TEST_CHECK(n == 1 && ev[0].type == GESTURE_SWIPE && ev[0].dir == GESTURE_DIR_RIGHT,
+               "swipe: %u events, first type %u dir %u", n, n ? ev[0].type : 0, n ? ev[0].dir : 0);
+    TEST_CHECK(n == 1 && ev[0].vx >= 1400 && ev[0].vx <= 1600 && ev[0].dx == 135,
+               "swipe: vx %d px/s, dx %d", n ? ev[0].vx : 0, n ? ev[0].dx : 0);
+
+    // 4. Pinch out: fingers move apart 8 px per sample around a fixed centre
+    gestures_reset();
+    t.count = 0;
+    for (int i = 0; i < 8; i++) gesture_trace_add(t, 4000 + i * 10, 2, 130 - i * 4, 120, 170 + i * 4, 120);
+    gesture_trace_add(t, 4080, 0, 0, 0);
+    n = gesture_replay(t, 0, ev);
+    bool pinch = n == 7 && ev[0].type == GESTURE_PINCH && ev[0].phase == GESTURE_PHASE_BEGIN &&
+                 ev[n - 1].phase == GESTURE_PHASE_END;
+    for (uint8_t i = 1; pinch && i + 1 < n; i++) {
+        pinch = ev[i].type == GESTURE_PINCH && ev[i].phase == GESTURE_PHASE_UPDATE && ev[i].scale > ev[i - 1].scale;
+    }
+    TEST_CHECK(pinch, "pinch: %u events, expected begin, 5 growing updates, end", n);
+    TEST_CHECK(n && ev[n - 1].scale >= 600 && ev[n - 1].scale <= 630,
+               "pinch: final scale %u/256, expected ~614", n ? ev[n - 1].scale : 0);
+
+    // 5. Two-finger scroll down, constant finger distance
+    gestures_reset();
+    t.count = 0;
+    for (int i = 0; i < 8; i++) gesture_trace_add(t, 5000 + i * 10, 2, 100, 80 + i * 6, 160, 80 + i * 6);
+    gesture_trace_add(t, 5080, 0, 0, 0);
+    n = gesture_replay(t, 0, ev);
+    bool scroll = n == 7 && ev[0].type == GESTURE_SCROLL && ev[0].phase == GESTURE_PHASE_BEGIN &&
+                  ev[n - 1].phase == GESTURE_PHASE_END;
+    for (uint8_t i = 0; scroll && i < n; i++) scroll = ev[i].type == GESTURE_SCROLL && ev[i].dir == GESTURE_DIR_DOWN;
+    TEST_CHECK(scroll, "scroll: %u events, expected begin, 5 updates, end, all down", n);
+    TEST_CHECK(n && ev[n - 1].dy == 42 && ev[n - 1].vy > 0, "scroll: dy %d, vy %d",
+               n ? ev[n - 1].dy : 0, n ? ev[n - 1].vy : 0);
+
+    TEST_CHECK(gestures.dropped == 0, "%lu events dropped", gestures.dropped);
+
+    Serial.printf("Gesture replay test: %lu failures\n", failures);
+
+    gestures_reset();
+    gestures.dropped = dropped;
+    return failures;
+}
+
+#endif // TOUCH_GESTURES_H
@@ -0,0 +1,146 @@
+/*
+ * Virtual List
+ *
+ * Scrollable list that only builds widgets for the visible rows plus a
+ * few overscan rows, and rebinds them to new items while scrolling.
+ * - Rows are created once per pool slot by the create callback
+ * - The bind callback fills a row for an item index (labels, icon...)
+ * - Item i always lives in slot i % poolSize, so a scroll step rebinds
+ *   only the rows that changed; cost does not depend on the item count
+ * - A 1px spacer at the end gives the container its full scroll height
+ *
+ * Memory is flat: poolSize rows regardless of how many items exist.
+ *
+ * File: virtual_list.h
+ */
+
+#ifndef VIRTUAL_LIST_H
+#define VIRTUAL_LIST_H
+
+#include <lvgl.h>
+
+#define VLIST_MAX_ROWS   16
+#define VLIST_OVERSCAN   2     // Extra rows above and below the viewport
+
+// Build the widgets of one pooled row inside parent, return the row
+typedef lv_obj_t * (*VirtualListCreateFunc)(lv_obj_t * parent, void * user);
+// Show item index in a row created by the create callback
+typedef void (*VirtualListBindFunc)(lv_obj_t * row, int index, void * user);
+// Row clicked
+typedef void (*VirtualListClickFunc)(int index, void * user);
+
+struct VirtualList {
+    lv_obj_t * container;
+    lv_obj_t * spacer;
+    lv_obj_t * rows[VLIST_MAX_ROWS];
+    int rowIndex[VLIST_MAX_ROWS];   // Item bound to each slot, -1 if none
+    int poolSize;
+    int count;
+    lv_coord_t pitch;               // Row height plus gap
+
+    VirtualListCreateFunc create;
+    VirtualListBindFunc bind;
+    VirtualListClickFunc click;
+    void * user;
+
+    uint32_t binds;                 // Rebinds since creation
+};
+
+// Bind the rows for the current scroll position
+static void virtualListUpdate(VirtualList * list) {
+    if (!list->container) return;
+
+    int first = lv_obj_get_scroll_y(list->container) / list->pitch - VLIST_OVERSCAN;
+    if (first > list->count - list->poolSize) first = list->count - list->poolSize;
+    if (first < 0) first = 0;
+
+    for (int k = 0; k < list->poolSize; k++) {
+        int index = first + k;
+        int slot = index % list->poolSize;
+        lv_obj_t * row = list->rows[slot];
+
+        if (index >= list->count) {
+            lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+            list->rowIndex[slot] = -1;
+            continue;
+        }
+        if (list->rowIndex[slot] == index) continue;
+
+        list->rowIndex[slot] = index;
+        lv_obj_clear_flag(row, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_y(row, index * list->pitch);
+        list->bind(row, index, list->user);
+        list->binds++;
+    }
+}
+
+// Rebind every visible row, e.g. after item data changed
+void virtualListRefresh(VirtualList * list) {
+    for (int slot = 0; slot < list->poolSize; slot++) list->rowIndex[slot] = -1;
+    virtualListUpdate(list);
+}
+
+static void virtual_list_scroll_event(lv_event_t * e) {
+    virtualListUpdate((VirtualList *)lv_event_get_user_data(e));
+}
+
+static void virtual_list_delete_event(lv_event_t * e) {
+    // The screen was cleaned, forget the widgets
+    VirtualList * list = (VirtualList *)lv_event_get_user_data(e);
+    list->container = NULL;
+    list->spacer = NULL;
+    list->poolSize = 0;
+}
+
+static void virtual_list_row_event(lv_event_t * e) {
+    VirtualList * list = (VirtualList *)lv_event_get_user_data(e);
+    int slot = (int)(intptr_t)lv_obj_get_user_data(lv_event_get_current_target(e));
+    int index = list->rowIndex[slot];
+    if (index >= 0 && list->click) list->click(index, list->user);
+}
+
+// Create the list in a new scrollable container of size w x h
+lv_obj_t * virtualListCreate(VirtualList * list, lv_obj_t * parent, lv_coord_t w, lv_coord_t h,
+                             lv_coord_t pitch, int count,
+                             VirtualListCreateFunc create, VirtualListBindFunc bind,
+                             VirtualListClickFunc click, void * user) {
+    memset(list, 0, sizeof(*list));
+    list->pitch = pitch;
+    list->count = count;
+    list->create = create;
+    list->bind = bind;
+    list->click = click;
+    list->user = user;
+
+    list->container = lv_obj_create(parent);
+    lv_obj_set_size(list->container, w, h);
+    lv_obj_set_scroll_dir(list->container, LV_DIR_VER);
+    lv_obj_add_event_cb(list->container, virtual_list_scroll_event, LV_EVENT_SCROLL, list);
+    lv_obj_add_event_cb(list->container, virtual_list_delete_event, LV_EVENT_DELETE, list);
+
+    // Gives the content its full height without a widget per item
+    list->spacer = lv_obj_create(list->container);
+    lv_obj_remove_style_all(list->spacer);
+    lv_obj_set_size(list->spacer, 1, 1);
+    lv_obj_set_pos(list->spacer, 0, count > 0 ? count * pitch - 1 : 0);
+    lv_obj_clear_flag(list->spacer, LV_OBJ_FLAG_CLICKABLE);
+
+    int visible = (h + pitch - 1) / pitch + 1;
+    list->poolSize = visible + 2 * VLIST_OVERSCAN;
+    if (list->poolSize > VLIST_MAX_ROWS) list->poolSize = VLIST_MAX_ROWS;
+    if (list->poolSize > count) list->poolSize = count;
+
+    for (int slot = 0; slot < list->poolSize; slot++) {
+        lv_obj_t * row = create(list->container, user);
+        lv_obj_set_user_data(row, (void *)(intptr_t)slot);
+        lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_event_cb(row, virtual_list_row_event, LV_EVENT_CLICKED, list);
+        list->rows[slot] = row;
+        list->rowIndex[slot] = -1;
+    }
+
+    virtualListUpdate(list);
+    return list->container;
+}
+
+#endif // VIRTUAL_LIST_H
@@ -0,0 +1,280 @@
+/*
+ * Widget Registry
+ *
+ * Finds widgets by a stable name in O(1) instead of walking the object
+ * tree and comparing label text on every update.
+ * - Widgets are keyed by kvKey(name) and the name is kept in the slot;
+ *   a hit compares it, so two names with the same hash never return
+ *   each other's widget
+ * - The table is open addressing with linear probing, sized
+ *   WIDGET_REGISTRY_SIZE (a power of two); deleted slots are tombstoned
+ * - The registry follows the screen on display. widget_attach_screen()
+ *   hooks a screen root: when it starts loading, the EEZ objects
+ *   (objects_t) on it are registered under their field names; when it
+ *   is unloaded, everything registered on it is cleared. A screen kept
+ *   hot but hidden has no entries, so nothing on it is updated by name
+ * - Registering a widget hooks its LV_EVENT_DELETE as well, so an entry
+ *   never outlives its widget
+ *
+ * The objects_t field names come from eez_objects.h, generated from
+ * screens.h by tools/eez_objects.py; a stale table fails the build.
+ *
+ * UI task only, like every other LVGL call.
+ *
+ * File: widget_registry.h
+ */
+
+#ifndef WIDGET_REGISTRY_H
+#define WIDGET_REGISTRY_H
+
+#include <lvgl.h>
+#include "kv_parser.h"
+#include "screens.h"
+#include "eez_objects.h"
+#include "test_check.h"
+
+#define WIDGET_REGISTRY_SIZE  128   // Power of two, keep under half full
+#define WIDGET_NAME_MAX       24    // Longest name + 1, longer ones are refused
+#define WIDGET_KEY_EMPTY      0u
+#define WIDGET_KEY_DELETED    1u
+
+static_assert(sizeof(objects_t) == EEZ_OBJECT_COUNT * sizeof(lv_obj_t *),
+              "objects_t changed, run tools/eez_objects.py screens.h eez_objects.h");
+
+struct WidgetSlot {
+    uint32_t key;
+    lv_obj_t * obj;
+    char name[WIDGET_NAME_MAX];
+};
+
+struct WidgetRegistryStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t collisions;    // Key matched, name did not
+    uint32_t invalidated;   // Entries removed by widget deletion
+    uint32_t cleared;       // Entries removed when their screen unloaded
+    uint32_t refused;       // Registrations refused, table full or name too long
+};
+
+static WidgetSlot widgetSlots[WIDGET_REGISTRY_SIZE];
+static uint32_t widgetCount = 0;
+static uint32_t widgetTombstones = 0;
+static WidgetRegistryStats widgetStats = {0, 0, 0, 0, 0, 0};
+
+// Keep the two reserved values free for empty and deleted slots
+static inline uint32_t widget_key(uint32_t key) {
+    return key <= WIDGET_KEY_DELETED ? key + 2 : key;
+}
+
+// Slot holding name under key, or -1
+static int widget_slot(uint32_t key, const char * name) {
+    uint32_t mask = WIDGET_REGISTRY_SIZE - 1;
+    uint32_t slot = key & mask;
+    for (uint32_t n = 0; n < WIDGET_REGISTRY_SIZE; n++, slot = (slot + 1) & mask) {
+        if (widgetSlots[slot].key == key) {
+            if (strcmp(widgetSlots[slot].name, name) == 0) return slot;
+            widgetStats.collisions++;
+        }
+        if (widgetSlots[slot].key == WIDGET_KEY_EMPTY) return -1;
+    }
+    return -1;
+}
+
+static void widget_remove(int slot) {
+    widgetSlots[slot].key = WIDGET_KEY_DELETED;
+    widgetSlots[slot].obj = NULL;
+    widgetSlots[slot].name[0] = '\0';
+    widgetCount--;
+    widgetTombstones++;
+}
+
+static void widget_delete_event(lv_event_t * e) {
+    lv_obj_t * obj = lv_event_get_target(e);
+    uint32_t key = (uint32_t)(uintptr_t)lv_event_get_user_data(e);
+
+    // The name may have been registered again for another widget since
+    uint32_t mask = WIDGET_REGISTRY_SIZE - 1;
+    uint32_t slot = key & mask;
+    for (uint32_t n = 0; n < WIDGET_REGISTRY_SIZE; n++, slot = (slot + 1) & mask) {
+        if (widgetSlots[slot].key == WIDGET_KEY_EMPTY) return;
+        if (widgetSlots[slot].key == key && widgetSlots[slot].obj == obj) {
+            widget_remove(slot);
+            widgetStats.invalidated++;
+            return;
+        }
+    }
+}
+
+// Drop tombstones so misses keep hitting an empty slot quickly
+static void widget_rehash() {
+    static WidgetSlot live[WIDGET_REGISTRY_SIZE / 2];
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < WIDGET_REGISTRY_SIZE; i++) {
+        if (widgetSlots[i].key > WIDGET_KEY_DELETED) live[n++] = widgetSlots[i];
+    }
+    memset(widgetSlots, 0, sizeof(widgetSlots));
+
+    uint32_t mask = WIDGET_REGISTRY_SIZE - 1;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t slot = live[i].key & mask;
+        while (widgetSlots[slot].key != WIDGET_KEY_EMPTY) slot = (slot + 1) & mask;
+        widgetSlots[slot] = live[i];
+    }
+    widgetTombstones = 0;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PUBLIC API
+// ═══════════════════════════════════════════════════════════════
+
+bool widget_register(const char * name, lv_obj_t * obj) {
+    if (!obj) return false;
+    size_t len = strlen(name);
+    if (len == 0 || len >= WIDGET_NAME_MAX) {
+        widgetStats.refused++;
+        return false;
+    }
+    uint32_t key = widget_key(kvKeyRuntime(name, len));
+
+    int slot = widget_slot(key, name);
+    if (slot >= 0) {
+        if (widgetSlots[slot].obj == obj) return true;
+        lv_obj_remove_event_cb_with_user_data(widgetSlots[slot].obj, widget_delete_event, (void *)(uintptr_t)key);
+        widgetSlots[slot].obj = obj;
+    } else {
+        if (widgetCount >= WIDGET_REGISTRY_SIZE / 2) {
+            widgetStats.refused++;
+            return false;
+        }
+        if (widgetCount + widgetTombstones >= WIDGET_REGISTRY_SIZE * 3 / 4) widget_rehash();
+        uint32_t mask = WIDGET_REGISTRY_SIZE - 1;
+        slot = key & mask;
+        while (widgetSlots[slot].key > WIDGET_KEY_DELETED) slot = (slot + 1) & mask;
+        if (widgetSlots[slot].key == WIDGET_KEY_DELETED) widgetTombstones--;
+        widgetSlots[slot].key = key;
+        widgetSlots[slot].obj = obj;
+        memcpy(widgetSlots[slot].name, name, len + 1);
+        widgetCount++;
+    }
+    lv_obj_add_event_cb(obj, widget_delete_event, LV_EVENT_DELETE, (void *)(uintptr_t)key);
+    return true;
+}
+
+void widget_unregister(const char * name) {
+    uint32_t key = widget_key(kvKeyRuntime(name, strlen(name)));
+    int slot = widget_slot(key, name);
+    if (slot < 0) return;
+    lv_obj_remove_event_cb_with_user_data(widgetSlots[slot].obj, widget_delete_event, (void *)(uintptr_t)key);
+    widget_remove(slot);
+}
+
+// Widget registered as name. key is kvKey(name), so callers with a
+// literal name hash it at compile time: widget_find_key(kvKey("x"), "x")
+lv_obj_t * widget_find_key(uint32_t key, const char * name) {
+    int slot = widget_slot(widget_key(key), name);
+    if (slot < 0) {
+        widgetStats.misses++;
+        return NULL;
+    }
+    widgetStats.hits++;
+    return widgetSlots[slot].obj;
+}
+
+lv_obj_t * widget_find(const char * name) {
+    return widget_find_key(kvKeyRuntime(name, strlen(name)), name);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SCREENS
+// ═══════════════════════════════════════════════════════════════
+
+// Register the EEZ objects that live on root under their field names
+void widget_register_screen(lv_obj_t * root) {
+    lv_obj_t ** objs = (lv_obj_t **)&objects;
+    for (int i = 0; i < EEZ_OBJECT_COUNT; i++) {
+        if (objs[i] && lv_obj_get_screen(objs[i]) == root) widget_register(eezObjectNames[i], objs[i]);
+    }
+}
+
+// Drop every entry whose widget lives on root
+void widget_clear_screen(lv_obj_t * root) {
+    for (uint32_t i = 0; i < WIDGET_REGISTRY_SIZE; i++) {
+        if (widgetSlots[i].key <= WIDGET_KEY_DELETED) continue;
+        if (lv_obj_get_screen(widgetSlots[i].obj) != root) continue;
+        lv_obj_remove_event_cb_with_user_data(widgetSlots[i].obj, widget_delete_event,
+                                              (void *)(uintptr_t)widgetSlots[i].key);
+        widget_remove(i);
+        widgetStats.cleared++;
+    }
+}
+
+static void widget_screen_event(lv_event_t * e) {
+    lv_obj_t * root = lv_event_get_target(e);
+    if (lv_event_get_code(e) == LV_EVENT_SCREEN_LOAD_START) widget_register_screen(root);
+    else widget_clear_screen(root);
+}
+
+// Follow root's loads and unloads, call once a screen root is created.
+// Registers its objects right away when it is already on display.
+void widget_attach_screen(lv_obj_t * root) {
+    if (!root) return;
+    while (lv_obj_remove_event_cb(root, widget_screen_event)) {}
+    lv_obj_add_event_cb(root, widget_screen_event, LV_EVENT_SCREEN_LOAD_START, NULL);
+    lv_obj_add_event_cb(root, widget_screen_event, LV_EVENT_SCREEN_UNLOADED, NULL);
+    if (root == lv_scr_act()) widget_register_screen(root);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TEST
+// ═══════════════════════════════════════════════════════════════
+
+// Registry logic on a throwaway root: a real key collision, replacing,
+// refused names and clearing a screen, plus objects_t registration on
+// the host. Entries of other screens are left alone. Returns the number
+// of failures.
+uint32_t runWidgetRegistryTest() {
+    uint32_t failures = 0;
+    lv_obj_t * root = lv_obj_create(NULL);
+    lv_obj_t * a = lv_label_create(root);
+    lv_obj_t * b = lv_label_create(lv_obj_create(root));
+
+    // Two names with the same FNV-1a hash
+    static const char * nameA = "w673879";
+    static const char * nameB = "w1180600";
+    TEST_CHECK(kvKey("w673879") == kvKey("w1180600"), "test names no longer collide");
+    TEST_CHECK(widget_register(nameA, a) && widget_register(nameB, b), "registration refused");
+    TEST_CHECK(widget_find(nameA) == a && widget_find(nameB) == b, "colliding names returned the wrong widget");
+    TEST_CHECK(!widget_find_key(kvKey("w673879"), "w673879x"), "hit under the right key with the wrong name");
+    widget_unregister(nameA);
+    TEST_CHECK(!widget_find(nameA) && widget_find(nameB) == b, "unregister removed the wrong entry");
+
+    TEST_CHECK(widget_register(nameB, a) && widget_find(nameB) == a, "registering a name again did not replace it");
+    TEST_CHECK(!widget_register("name longer than a slot holds", a), "overlong name accepted");
+
+#if !defined(ARDUINO)
+    // On the device objects_t belongs to the live screens
+    lv_obj_t * saved = objects.obj1;
+    objects.obj1 = b;
+    widget_register_screen(root);
+    TEST_CHECK(widget_find("obj1") == b, "objects_t field obj1 not registered by name");
+    objects.obj1 = saved;
+#endif
+
+    widget_clear_screen(root);
+    TEST_CHECK(!widget_find(nameB), "entry survived clearing its screen");
+
+    lv_obj_del(root);
+    return failures;
+}
+
+void printWidgetRegistryStats() {
+    Serial.println("\n=== Widget Registry ===");
+    Serial.printf("Widgets: %lu / %d\n", widgetCount, WIDGET_REGISTRY_SIZE / 2);
+    Serial.printf("Hits: %lu, misses: %lu, key collisions: %lu\n",
+                  widgetStats.hits, widgetStats.misses, widgetStats.collisions);
+    Serial.printf("Invalidated: %lu, cleared on unload: %lu, refused: %lu\n",
+                  widgetStats.invalidated, widgetStats.cleared, widgetStats.refused);
+    Serial.println("=======================\n");
+}
+
+#endif // WIDGET_REGISTRY_H